@@ -0,0 +1,125 @@
+//
+//  AlignmentPyramid.cpp
+//  AudioCompareCore
+//
+
+#include "AlignmentPyramid.hpp"
+
+#include "AudioUtilities.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Extra lags scored at full rate so sinc interpolation has neighbours.
+const std::int64_t kInterpolationMargin = 16;
+
+double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct PyramidLevel {
+    std::vector<float> reference;
+    std::vector<float> candidate;
+    double decimationSeconds = 0.0;
+};
+
+} // namespace
+
+AlignmentPyramid::AlignmentPyramid(AlignmentOptions alignment, PyramidOptions options)
+    : alignment_(alignment)
+    , options_(options)
+{
+    if (options_.refineRadius < 1)
+        throw std::invalid_argument("refine radius must be at least 1");
+}
+
+PyramidAlignmentResult AlignmentPyramid::findOffset(AudioReader& reference, AudioReader& candidate)
+{
+    PyramidAlignmentResult result;
+    const double rate = reference.format().sampleRate;
+
+    Clock::time_point start = Clock::now();
+    std::vector<PyramidLevel> pyramid(1);
+    AlignmentExcerpt excerpt = readAlignmentExcerpt(reference, candidate, alignment_);
+    pyramid[0].reference = std::move(excerpt.reference);
+    pyramid[0].candidate = std::move(excerpt.candidate);
+    const std::int64_t range = excerpt.range;
+    result.readSeconds = secondsSince(start);
+
+    // Stop decimating once the excerpt would be too short to correlate.
+    for (std::size_t level = 1; level <= options_.levels; ++level) {
+        const PyramidLevel& finer = pyramid.back();
+        if (finer.reference.size() < 256)
+            break;
+        start = Clock::now();
+        PyramidLevel coarser;
+        coarser.reference.resize((finer.reference.size() + 1) / 2);
+        coarser.candidate.resize((finer.candidate.size() + 1) / 2);
+        decimateByTwo(finer.reference.data(), finer.reference.size(), coarser.reference.data());
+        decimateByTwo(finer.candidate.data(), finer.candidate.size(), coarser.candidate.data());
+        coarser.decimationSeconds = secondsSince(start);
+        pyramid.push_back(std::move(coarser));
+    }
+
+    // Full search at the coarsest level. Lags are measured into the candidate
+    // window, where `range` (scaled per level) means zero offset.
+    const std::size_t coarsest = pyramid.size() - 1;
+    const std::int64_t coarseRange = (range >> coarsest) + 1;
+    start = Clock::now();
+    {
+        const PyramidLevel& level = pyramid[coarsest];
+        result.coarsePeak = gccPhat(level.reference.data(), level.reference.size(),
+                                    level.candidate.data(), level.candidate.size(),
+                                    0, 2 * coarseRange,
+                                    coarsest == 0 ? alignment_.interpolation : PeakInterpolation::None);
+    }
+    std::int64_t lag = result.coarsePeak.lag;
+
+    PyramidLevelReport coarseReport;
+    coarseReport.level = coarsest;
+    coarseReport.sampleRate = rate / static_cast<double>(std::int64_t(1) << coarsest);
+    coarseReport.candidateSamples = pyramid[coarsest].candidate.size();
+    coarseReport.offset = (lag << coarsest) - range;
+    coarseReport.decimationSeconds = pyramid[coarsest].decimationSeconds;
+    coarseReport.searchSeconds = secondsSince(start);
+    result.levels.push_back(coarseReport);
+
+    for (std::size_t index = coarsest; index-- > 0;) {
+        const PyramidLevel& level = pyramid[index];
+        start = Clock::now();
+        lag *= 2;
+        const bool finest = index == 0;
+        const std::int64_t radius = options_.refineRadius + (finest ? kInterpolationMargin : 0);
+        const CorrelationPeak peak = refineLag(level.reference.data(), level.reference.size(),
+                                               level.candidate.data(), level.candidate.size(),
+                                               lag - radius, lag + radius,
+                                               finest ? alignment_.interpolation : PeakInterpolation::None);
+        lag = peak.lag;
+        if (finest)
+            result.fractionalOffset = peak.fractionalLag - static_cast<double>(range);
+
+        PyramidLevelReport report;
+        report.level = index;
+        report.sampleRate = rate / static_cast<double>(std::int64_t(1) << index);
+        report.candidateSamples = level.candidate.size();
+        report.offset = (lag << index) - range;
+        report.decimationSeconds = level.decimationSeconds;
+        report.searchSeconds = secondsSince(start);
+        result.levels.push_back(report);
+    }
+
+    result.offset = lag - range;
+    if (coarsest == 0)
+        result.fractionalOffset = result.coarsePeak.fractionalLag - static_cast<double>(range);
+    return result;
+}
+
+} // namespace audiocompare
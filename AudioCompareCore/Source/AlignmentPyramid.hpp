@@ -0,0 +1,61 @@
+//
+//  AlignmentPyramid.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "OffsetFinder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+struct PyramidOptions {
+    /// Number of 2x decimation stages below the full rate.
+    std::size_t levels = 4;
+    /// Lags searched either side of the coarser estimate at each finer level.
+    std::int64_t refineRadius = 8;
+};
+
+struct PyramidLevelReport {
+    std::size_t level = 0;
+    double sampleRate = 0.0;
+    std::size_t candidateSamples = 0;
+    /// Offset estimate at this level, in full-rate frames.
+    std::int64_t offset = 0;
+    double decimationSeconds = 0.0;
+    double searchSeconds = 0.0;
+};
+
+struct PyramidAlignmentResult {
+    /// Candidate frame = reference frame + offset.
+    std::int64_t offset = 0;
+    /// `offset` plus the sub-sample part interpolated at full rate.
+    double fractionalOffset = 0.0;
+    /// GCC-PHAT peak at the coarsest level.
+    CorrelationPeak coarsePeak;
+    double readSeconds = 0.0;
+    /// Coarsest level first.
+    std::vector<PyramidLevelReport> levels;
+};
+
+/// Coarse-to-fine offset search. The excerpt pair is repeatedly halved with
+/// `decimateByTwo`, the full lag range is searched with GCC-PHAT only at the
+/// coarsest level, and each finer level re-scores a few lags around the
+/// doubled estimate with direct cross-correlation. The full-rate peak is
+/// interpolated to sub-sample precision per `AlignmentOptions::interpolation`.
+class AlignmentPyramid {
+public:
+    explicit AlignmentPyramid(AlignmentOptions alignment = {}, PyramidOptions options = {});
+
+    PyramidAlignmentResult findOffset(AudioReader& reference, AudioReader& candidate);
+
+private:
+    AlignmentOptions alignment_;
+    PyramidOptions options_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,84 @@
+//
+//  AudioBufferView.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace audiocompare {
+
+/// Non-owning view of one channel's contiguous float samples, the
+/// counterpart of a single `AVAudioPCMBuffer floatChannelData` row. Cheap to
+/// copy; the storage must outlive it.
+class ChannelView {
+public:
+    ChannelView() = default;
+    ChannelView(const float* data, std::size_t size)
+        : data_(data)
+        , size_(size)
+    {
+    }
+
+    const float* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    float operator[](std::size_t index) const { return data_[index]; }
+
+    const float* begin() const { return data_; }
+    const float* end() const { return data_ + size_; }
+
+    /// Samples [offset, offset + count), clamped to this view.
+    ChannelView subview(std::size_t offset, std::size_t count) const
+    {
+        offset = std::min(offset, size_);
+        return ChannelView(data_ + offset, std::min(count, size_ - offset));
+    }
+
+private:
+    const float* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/// Non-owning planar view of `channelCount()` equally long channels, backed
+/// by `FloatBuffers`, a render callback's buffer list or a mapped file. The
+/// frame offset is applied lazily, so `subview` never allocates.
+class AudioBufferView {
+public:
+    AudioBufferView() = default;
+    AudioBufferView(const float* const* channels, std::size_t channelCount, std::size_t frames,
+                    std::size_t offset = 0)
+        : channels_(channels)
+        , channelCount_(channelCount)
+        , frames_(frames)
+        , offset_(offset)
+    {
+    }
+
+    std::size_t channelCount() const { return channelCount_; }
+    std::size_t frames() const { return frames_; }
+    bool empty() const { return frames_ == 0 || channelCount_ == 0; }
+
+    ChannelView channel(std::size_t index) const
+    {
+        return ChannelView(channels_[index] + offset_, frames_);
+    }
+
+    /// Frames [offset, offset + count), clamped to this view.
+    AudioBufferView subview(std::size_t offset, std::size_t count) const
+    {
+        offset = std::min(offset, frames_);
+        return AudioBufferView(channels_, channelCount_, std::min(count, frames_ - offset),
+                               offset_ + offset);
+    }
+
+private:
+    const float* const* channels_ = nullptr;
+    std::size_t channelCount_ = 0;
+    std::size_t frames_ = 0;
+    std::size_t offset_ = 0;
+};
+
+} // namespace audiocompare
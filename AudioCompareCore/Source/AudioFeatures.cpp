@@ -0,0 +1,121 @@
+//
+//  AudioFeatures.cpp
+//  AudioCompareCore
+//
+
+#include "AudioFeatures.hpp"
+
+#include "AudioUtilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const double kLowestBandHz = 40.0;
+const double kHighestBandHz = 16000.0;
+// Keeps log energy finite in digital silence (about -200 dB).
+const double kEnergyFloor = 1e-20;
+const std::size_t kReadFrames = 16384;
+
+const FeatureOptions& checkedOptions(const FeatureOptions& options)
+{
+    if (options.bandCount == 0 || options.fftSize < 64 || (options.fftSize & (options.fftSize - 1)) != 0)
+        throw std::invalid_argument("feature extraction needs a power-of-two FFT of at least 64 and one band");
+    return options;
+}
+
+} // namespace
+
+std::size_t featureDimension(const FeatureOptions& options)
+{
+    return 2 * options.bandCount;
+}
+
+FeatureSummaryExtractor::FeatureSummaryExtractor(double sampleRate, const FeatureOptions& options)
+    : options_(checkedOptions(options))
+    , stream_(options.fftSize, options.fftSize / 2)
+    , edges_(options.bandCount + 1)
+    , sum_(options.bandCount, 0.0)
+    , sumSquares_(options.bandCount, 0.0)
+{
+    // Bin ranges [edges[b], edges[b + 1]), at least one bin wide.
+    const std::size_t bands = options.bandCount;
+    const double binHz = sampleRate / static_cast<double>(options.fftSize);
+    const double top = std::min(kHighestBandHz, 0.5 * sampleRate);
+    for (std::size_t b = 0; b <= bands; ++b) {
+        const double hz = kLowestBandHz * std::pow(top / kLowestBandHz, static_cast<double>(b) / bands);
+        edges_[b] = std::min(static_cast<std::size_t>(hz / binHz), stream_.binCount() - 1);
+        if (b > 0)
+            edges_[b] = std::max(edges_[b], edges_[b - 1] + 1);
+    }
+    if (edges_[bands] > stream_.binCount())
+        throw std::invalid_argument("too many feature bands for the FFT size");
+}
+
+void FeatureSummaryExtractor::process(ChannelView mono)
+{
+    stream_.push(mono, [this](const float* magnitudes) { analyse(magnitudes); });
+}
+
+void FeatureSummaryExtractor::analyse(const float* magnitudes)
+{
+    for (std::size_t b = 0; b < options_.bandCount; ++b) {
+        double energy = 0.0;
+        for (std::size_t k = edges_[b]; k < edges_[b + 1]; ++k)
+            energy += static_cast<double>(magnitudes[k]) * magnitudes[k];
+        heard_ = heard_ || energy > 0.0;
+        const double level = 10.0 * std::log10(energy + kEnergyFloor);
+        sum_[b] += level;
+        sumSquares_[b] += level * level;
+    }
+    ++frames_;
+}
+
+std::vector<float> FeatureSummaryExtractor::finish()
+{
+    stream_.flush([this](const float* magnitudes) { analyse(magnitudes); });
+    const std::size_t bands = options_.bandCount;
+    std::vector<float> features(featureDimension(options_), 0.0f);
+    if (!heard_)
+        return features;
+
+    double meanOfMeans = 0.0;
+    for (std::size_t b = 0; b < bands; ++b)
+        meanOfMeans += sum_[b] / static_cast<double>(frames_);
+    meanOfMeans /= static_cast<double>(bands);
+
+    double norm = 0.0;
+    for (std::size_t b = 0; b < bands; ++b) {
+        const double mean = sum_[b] / static_cast<double>(frames_);
+        const double variance = std::max(0.0, sumSquares_[b] / static_cast<double>(frames_) - mean * mean);
+        features[b] = static_cast<float>(mean - meanOfMeans);
+        features[bands + b] = static_cast<float>(std::sqrt(variance));
+        norm += static_cast<double>(features[b]) * features[b]
+                + static_cast<double>(features[bands + b]) * features[bands + b];
+    }
+    if (norm > 0.0) {
+        const float scale = static_cast<float>(1.0 / std::sqrt(norm));
+        for (float& value : features)
+            value *= scale;
+    }
+    return features;
+}
+
+std::vector<float> extractFeatures(AudioReader& reader, const FeatureOptions& options)
+{
+    const AudioFormat format = reader.format();
+    FeatureSummaryExtractor extractor(format.sampleRate, options);
+    FloatBuffers block(format.channelCount, kReadFrames);
+    std::vector<float> mono(kReadFrames);
+    while (const std::size_t read = reader.readFrames(block.data(), kReadFrames)) {
+        mixToMono(block.view(0, read), mono.data());
+        extractor.process(ChannelView(mono.data(), read));
+    }
+    return extractor.finish();
+}
+
+} // namespace audiocompare
@@ -0,0 +1,56 @@
+//
+//  AudioFeatures.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+#include "AudioReader.hpp"
+#include "BatchedStft.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace audiocompare {
+
+struct FeatureOptions {
+    std::size_t fftSize = 2048;
+    /// Log-spaced bands between 40 Hz and 16 kHz (or Nyquist).
+    std::size_t bandCount = 32;
+};
+
+/// Length of the vectors `extractFeatures` returns.
+std::size_t featureDimension(const FeatureOptions& options);
+
+/// Compact timbre summary of a whole file for catalogue-scale similarity:
+/// the mean and standard deviation of each band's log energy over the mono
+/// downmix, analysed with 50% overlap. The means are centred, so a gain
+/// change does not move the vector, and the vector is scaled to unit length,
+/// so the dot product of two vectors is their cosine similarity. Silent
+/// files give a zero vector.
+class FeatureSummaryExtractor {
+public:
+    FeatureSummaryExtractor(double sampleRate, const FeatureOptions& options = {});
+
+    /// Feeds mono samples, in any block size.
+    void process(ChannelView mono);
+    std::vector<float> finish();
+
+private:
+    void analyse(const float* magnitudes);
+
+    FeatureOptions options_;
+    SpectrogramStream stream_;
+    std::vector<std::size_t> edges_;
+    std::vector<double> sum_;
+    std::vector<double> sumSquares_;
+    std::size_t frames_ = 0;
+    bool heard_ = false;
+};
+
+/// Runs a `FeatureSummaryExtractor` over `reader` from its current position
+/// to the end.
+std::vector<float> extractFeatures(AudioReader& reader, const FeatureOptions& options = {});
+
+} // namespace audiocompare
@@ -0,0 +1,39 @@
+//
+//  AudioReader.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audiocompare {
+
+struct AudioFormat {
+    double sampleRate = 0.0;
+    std::size_t channelCount = 0;
+};
+
+/// Sequential source of non-interleaved float frames, modelled on
+/// `EZAudioFile readFrames:audioBufferList:bufferSize:eof:`.
+class AudioReader {
+public:
+    virtual ~AudioReader() = default;
+
+    virtual AudioFormat format() const = 0;
+
+    /// Total number of frames in the source, or -1 when unknown.
+    virtual std::int64_t frameCount() const = 0;
+
+    /// Reads up to `frames` frames into one buffer per channel and returns the
+    /// number of frames read. Returns 0 at end of file.
+    virtual std::size_t readFrames(float* const* buffers, std::size_t frames) = 0;
+
+    /// Moves the read position; frames past the end leave the reader at EOF.
+    virtual void seekToFrame(std::int64_t frame) = 0;
+
+    virtual std::int64_t framePosition() const = 0;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,195 @@
+//
+//  AudioUtilities.cpp
+//  AudioCompareCore
+//
+
+#include "AudioUtilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace audiocompare {
+
+namespace {
+
+/// One side of the half-band decimation filter: taps at odd distances
+/// 1, 3, 5, ... from the centre (even taps are zero, the centre is 0.5).
+const std::size_t kHalfBandTaps = 12;
+
+const float* halfBandCoefficients()
+{
+    static const std::vector<float> coefficients = [] {
+        const double pi = 3.14159265358979323846;
+        const double span = static_cast<double>(4 * kHalfBandTaps);
+        std::vector<double> taps(kHalfBandTaps);
+        double sum = 0.0;
+        for (std::size_t i = 0; i < kHalfBandTaps; ++i) {
+            const double j = static_cast<double>(2 * i + 1);
+            const double sinc = std::sin(pi * j / 2.0) / (pi * j);
+            const double x = (j + span / 2.0) / span;
+            const double blackman = 0.42 - 0.5 * std::cos(2.0 * pi * x) + 0.08 * std::cos(4.0 * pi * x);
+            taps[i] = sinc * blackman;
+            sum += taps[i];
+        }
+        // Unity gain at DC: 0.5 + 2 * sum(taps) == 1.
+        std::vector<float> normalized(kHalfBandTaps);
+        for (std::size_t i = 0; i < kHalfBandTaps; ++i)
+            normalized[i] = static_cast<float>(taps[i] * 0.25 / sum);
+        return normalized;
+    }();
+    return coefficients.data();
+}
+
+} // namespace
+
+FloatBuffers::FloatBuffers(std::size_t channelCount, std::size_t frameCount)
+{
+    resize(channelCount, frameCount);
+}
+
+FloatBuffers::FloatBuffers(const FloatBuffers& other)
+    : storage_(other.storage_)
+    , pointers_(other.pointers_.size())
+    , frameCount_(other.frameCount_)
+{
+    bindPointers();
+}
+
+FloatBuffers& FloatBuffers::operator=(const FloatBuffers& other)
+{
+    if (this != &other) {
+        storage_ = other.storage_;
+        pointers_.resize(other.pointers_.size());
+        frameCount_ = other.frameCount_;
+        bindPointers();
+    }
+    return *this;
+}
+
+void FloatBuffers::resize(std::size_t channelCount, std::size_t frameCount)
+{
+    storage_.assign(channelCount * frameCount, 0.0f);
+    pointers_.resize(channelCount);
+    frameCount_ = frameCount;
+    bindPointers();
+}
+
+void FloatBuffers::clear()
+{
+    std::fill(storage_.begin(), storage_.end(), 0.0f);
+}
+
+void FloatBuffers::bindPointers()
+{
+    for (std::size_t c = 0; c < pointers_.size(); ++c)
+        pointers_[c] = storage_.data() + c * frameCount_;
+}
+
+void mixToMono(const AudioBufferView& buffers, float* mono)
+{
+    const std::size_t channelCount = buffers.channelCount();
+    const std::size_t frames = buffers.frames();
+    if (channelCount == 0) {
+        std::fill(mono, mono + frames, 0.0f);
+        return;
+    }
+    std::memcpy(mono, buffers.channel(0).data(), frames * sizeof(float));
+    for (std::size_t c = 1; c < channelCount; ++c) {
+        const ChannelView channel = buffers.channel(c);
+        for (std::size_t i = 0; i < frames; ++i)
+            mono[i] += channel[i];
+    }
+    if (channelCount > 1) {
+        const float scale = 1.0f / static_cast<float>(channelCount);
+        for (std::size_t i = 0; i < frames; ++i)
+            mono[i] *= scale;
+    }
+}
+
+void appendBufferAndShift(const float* buffer, std::size_t count,
+                          float* scrollHistory, std::size_t historyLength)
+{
+    if (count >= historyLength) {
+        std::memcpy(scrollHistory, buffer + (count - historyLength),
+                    historyLength * sizeof(float));
+        return;
+    }
+    std::memmove(scrollHistory, scrollHistory + count,
+                 (historyLength - count) * sizeof(float));
+    std::memcpy(scrollHistory + (historyLength - count), buffer,
+                count * sizeof(float));
+}
+
+std::size_t readMono(AudioReader& reader, std::int64_t start, std::size_t frames, float* mono)
+{
+    std::fill(mono, mono + frames, 0.0f);
+    std::size_t skip = 0;
+    if (start < 0) {
+        skip = static_cast<std::size_t>(std::min<std::int64_t>(-start, static_cast<std::int64_t>(frames)));
+        start = 0;
+    }
+    reader.seekToFrame(start);
+
+    const std::size_t channels = reader.format().channelCount;
+    const std::size_t blockSize = 16384;
+    FloatBuffers block(channels, blockSize);
+    std::size_t offset = skip;
+    std::size_t total = 0;
+    while (offset < frames) {
+        const std::size_t got = reader.readFrames(block.data(), std::min(blockSize, frames - offset));
+        if (got == 0)
+            break;
+        mixToMono(block.view(0, got), mono + offset);
+        offset += got;
+        total += got;
+    }
+    return total;
+}
+
+void decimateByTwo(const float* input, std::size_t count, float* output)
+{
+    const float* taps = halfBandCoefficients();
+    const std::size_t reach = 2 * kHalfBandTaps - 1;
+    const std::size_t outputCount = (count + 1) / 2;
+
+    auto sampleAt = [&](std::ptrdiff_t index) {
+        return index >= 0 && static_cast<std::size_t>(index) < count ? input[index] : 0.0f;
+    };
+
+    for (std::size_t m = 0; m < outputCount; ++m) {
+        const std::size_t centre = 2 * m;
+        float sum = 0.5f * input[centre];
+        if (centre >= reach && centre + reach < count) {
+            for (std::size_t i = 0; i < kHalfBandTaps; ++i) {
+                const std::size_t j = 2 * i + 1;
+                sum += taps[i] * (input[centre - j] + input[centre + j]);
+            }
+        } else {
+            for (std::size_t i = 0; i < kHalfBandTaps; ++i) {
+                const std::ptrdiff_t j = static_cast<std::ptrdiff_t>(2 * i + 1);
+                const std::ptrdiff_t c = static_cast<std::ptrdiff_t>(centre);
+                sum += taps[i] * (sampleAt(c - j) + sampleAt(c + j));
+            }
+        }
+        output[m] = sum;
+    }
+}
+
+std::size_t nextPowerOfTwo(std::size_t value)
+{
+    std::size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+double decibels(double powerRatio)
+{
+    if (powerRatio <= 0.0)
+        return -std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(powerRatio);
+}
+
+} // namespace audiocompare
@@ -0,0 +1,75 @@
+//
+//  AudioUtilities.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+#include "AudioReader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+/// Owning set of non-interleaved float buffers, the C++ counterpart of
+/// `EZAudioUtilities floatBuffersWithNumberOfFrames:numberOfChannels:`.
+class FloatBuffers {
+public:
+    FloatBuffers() = default;
+    FloatBuffers(std::size_t channelCount, std::size_t frameCount);
+
+    FloatBuffers(const FloatBuffers& other);
+    FloatBuffers& operator=(const FloatBuffers& other);
+    FloatBuffers(FloatBuffers&& other) noexcept = default;
+    FloatBuffers& operator=(FloatBuffers&& other) noexcept = default;
+
+    void resize(std::size_t channelCount, std::size_t frameCount);
+    void clear();
+
+    float* const* data() { return pointers_.data(); }
+    const float* const* data() const { return pointers_.data(); }
+    float* channel(std::size_t index) { return pointers_[index]; }
+    const float* channel(std::size_t index) const { return pointers_[index]; }
+
+    std::size_t channelCount() const { return pointers_.size(); }
+    std::size_t frameCount() const { return frameCount_; }
+
+    /// All channels, or frames [offset, offset + frames) of them.
+    AudioBufferView view() const { return AudioBufferView(data(), channelCount(), frameCount_); }
+    AudioBufferView view(std::size_t offset, std::size_t frames) const { return view().subview(offset, frames); }
+
+private:
+    void bindPointers();
+
+    std::vector<float> storage_;
+    std::vector<float*> pointers_;
+    std::size_t frameCount_ = 0;
+};
+
+/// Averages the channels of `buffers` into `mono`, which holds
+/// `buffers.frames()` samples.
+void mixToMono(const AudioBufferView& buffers, float* mono);
+
+/// Shifts `scrollHistory` left by `count` and appends `buffer` at the end,
+/// as `EZAudioUtilities appendBufferAndShift:withBufferSize:toScrollHistory:`.
+void appendBufferAndShift(const float* buffer, std::size_t count,
+                          float* scrollHistory, std::size_t historyLength);
+
+/// Reads `frames` frames starting at `start` and mixes them to mono. Frames
+/// before 0 or past the end are zero-filled. Returns the frames actually read
+/// and leaves the reader positioned after them.
+std::size_t readMono(AudioReader& reader, std::int64_t start, std::size_t frames, float* mono);
+
+/// Anti-aliased 2:1 decimation through a zero-phase half-band FIR, so
+/// output[m] is the low-passed input at 2m. `output` holds (count + 1) / 2
+/// samples; samples outside the input are treated as silence.
+void decimateByTwo(const float* input, std::size_t count, float* output);
+
+std::size_t nextPowerOfTwo(std::size_t value);
+
+double decibels(double powerRatio);
+
+} // namespace audiocompare
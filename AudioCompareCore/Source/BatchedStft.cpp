@@ -0,0 +1,372 @@
+//
+//  BatchedStft.cpp
+//  AudioCompareCore
+//
+
+#include "BatchedStft.hpp"
+
+#include "ScratchArena.hpp"
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if AUDIOCOMPARE_AVX2 || AUDIOCOMPARE_SSE2
+#include <immintrin.h>
+#endif
+#if AUDIOCOMPARE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audiocompare {
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+// Points per cache block for the early stages: 16 KB of AVX2 lanes.
+const std::size_t kBlockPoints = 256;
+
+// One register of frames: lane l of every value belongs to frame l of the
+// group being transformed.
+#if AUDIOCOMPARE_AVX2
+using Lanes = __m256;
+const std::size_t kLanes = 8;
+inline Lanes lanesLoad(const float* p) { return _mm256_loadu_ps(p); }
+inline void lanesStore(float* p, Lanes v) { _mm256_storeu_ps(p, v); }
+inline Lanes lanesSet(float v) { return _mm256_set1_ps(v); }
+inline Lanes lanesAdd(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+inline Lanes lanesSub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+inline Lanes lanesMul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+inline Lanes lanesSqrt(Lanes v) { return _mm256_sqrt_ps(v); }
+#elif AUDIOCOMPARE_SSE2
+using Lanes = __m128;
+const std::size_t kLanes = 4;
+inline Lanes lanesLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void lanesStore(float* p, Lanes v) { _mm_storeu_ps(p, v); }
+inline Lanes lanesSet(float v) { return _mm_set1_ps(v); }
+inline Lanes lanesAdd(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes lanesSub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+inline Lanes lanesMul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+inline Lanes lanesSqrt(Lanes v) { return _mm_sqrt_ps(v); }
+#elif AUDIOCOMPARE_NEON
+using Lanes = float32x4_t;
+const std::size_t kLanes = 4;
+inline Lanes lanesLoad(const float* p) { return vld1q_f32(p); }
+inline void lanesStore(float* p, Lanes v) { vst1q_f32(p, v); }
+inline Lanes lanesSet(float v) { return vdupq_n_f32(v); }
+inline Lanes lanesAdd(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+inline Lanes lanesSub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+inline Lanes lanesMul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+inline Lanes lanesSqrt(Lanes v) { return vsqrtq_f32(v); }
+#else
+using Lanes = float;
+const std::size_t kLanes = 1;
+inline Lanes lanesLoad(const float* p) { return *p; }
+inline void lanesStore(float* p, Lanes v) { *p = v; }
+inline Lanes lanesSet(float v) { return v; }
+inline Lanes lanesAdd(Lanes a, Lanes b) { return a + b; }
+inline Lanes lanesSub(Lanes a, Lanes b) { return a - b; }
+inline Lanes lanesMul(Lanes a, Lanes b) { return a * b; }
+inline Lanes lanesSqrt(Lanes v) { return std::sqrt(v); }
+#endif
+
+inline Lanes lanesMagnitude(Lanes re, Lanes im)
+{
+    return lanesSqrt(lanesAdd(lanesMul(re, re), lanesMul(im, im)));
+}
+
+/// a, b = a + W b, a - W b.
+inline void butterfly(Lanes& ar, Lanes& ai, Lanes& br, Lanes& bi, Lanes wr, Lanes wi)
+{
+    const Lanes tr = lanesSub(lanesMul(br, wr), lanesMul(bi, wi));
+    const Lanes ti = lanesAdd(lanesMul(br, wi), lanesMul(bi, wr));
+    br = lanesSub(ar, tr);
+    bi = lanesSub(ai, ti);
+    ar = lanesAdd(ar, tr);
+    ai = lanesAdd(ai, ti);
+}
+
+// The stage tables hold the twiddles of half-length h at [h - 1, 2h - 1),
+// as in the radix-2 `FftPlan`.
+
+/// The stages of half-length 1 and 2 over `points` points, whose twiddles
+/// are 1 and -i and need no multiplies.
+void firstStages(float* real, float* imag, std::size_t points)
+{
+    for (std::size_t start = 0; start < points; start += 4) {
+        float* re = real + start * kLanes;
+        float* im = imag + start * kLanes;
+        const Lanes r0 = lanesLoad(re), i0 = lanesLoad(im);
+        const Lanes r1 = lanesLoad(re + kLanes), i1 = lanesLoad(im + kLanes);
+        const Lanes r2 = lanesLoad(re + 2 * kLanes), i2 = lanesLoad(im + 2 * kLanes);
+        const Lanes r3 = lanesLoad(re + 3 * kLanes), i3 = lanesLoad(im + 3 * kLanes);
+        const Lanes ar = lanesAdd(r0, r1), ai = lanesAdd(i0, i1);
+        const Lanes br = lanesSub(r0, r1), bi = lanesSub(i0, i1);
+        const Lanes cr = lanesAdd(r2, r3), ci = lanesAdd(i2, i3);
+        const Lanes dr = lanesSub(r2, r3), di = lanesSub(i2, i3);
+        lanesStore(re, lanesAdd(ar, cr));
+        lanesStore(im, lanesAdd(ai, ci));
+        lanesStore(re + kLanes, lanesAdd(br, di));
+        lanesStore(im + kLanes, lanesSub(bi, dr));
+        lanesStore(re + 2 * kLanes, lanesSub(ar, cr));
+        lanesStore(im + 2 * kLanes, lanesSub(ai, ci));
+        lanesStore(re + 3 * kLanes, lanesSub(br, di));
+        lanesStore(im + 3 * kLanes, lanesAdd(bi, dr));
+    }
+}
+
+/// The stages of half-length h and 2h over `points` points in one pass.
+void radix4Pass(float* real, float* imag, std::size_t points, std::size_t halfLength, const float* stageCos,
+                const float* stageSin)
+{
+    const float* cosines = stageCos + halfLength - 1;
+    const float* sines = stageSin + halfLength - 1;
+    const float* nextCosines = stageCos + 2 * halfLength - 1;
+    const float* nextSines = stageSin + 2 * halfLength - 1;
+    const std::size_t quarter = halfLength * kLanes;
+    for (std::size_t start = 0; start < points; start += 4 * halfLength) {
+        for (std::size_t k = 0; k < halfLength; ++k) {
+            float* re = real + (start + k) * kLanes;
+            float* im = imag + (start + k) * kLanes;
+            Lanes r0 = lanesLoad(re), i0 = lanesLoad(im);
+            Lanes r1 = lanesLoad(re + quarter), i1 = lanesLoad(im + quarter);
+            Lanes r2 = lanesLoad(re + 2 * quarter), i2 = lanesLoad(im + 2 * quarter);
+            Lanes r3 = lanesLoad(re + 3 * quarter), i3 = lanesLoad(im + 3 * quarter);
+            const Lanes wr = lanesSet(cosines[k]), wi = lanesSet(sines[k]);
+            butterfly(r0, i0, r1, i1, wr, wi);
+            butterfly(r2, i2, r3, i3, wr, wi);
+            butterfly(r0, i0, r2, i2, lanesSet(nextCosines[k]), lanesSet(nextSines[k]));
+            butterfly(r1, i1, r3, i3, lanesSet(nextCosines[k + halfLength]), lanesSet(nextSines[k + halfLength]));
+            lanesStore(re, r0);
+            lanesStore(im, i0);
+            lanesStore(re + quarter, r1);
+            lanesStore(im + quarter, i1);
+            lanesStore(re + 2 * quarter, r2);
+            lanesStore(im + 2 * quarter, i2);
+            lanesStore(re + 3 * quarter, r3);
+            lanesStore(im + 3 * quarter, i3);
+        }
+    }
+}
+
+/// The final stage, of half-length points / 2, when the count is odd.
+void radix2Pass(float* real, float* imag, std::size_t points, std::size_t halfLength, const float* stageCos,
+                const float* stageSin)
+{
+    const float* cosines = stageCos + halfLength - 1;
+    const float* sines = stageSin + halfLength - 1;
+    for (std::size_t start = 0; start < points; start += 2 * halfLength) {
+        for (std::size_t k = 0; k < halfLength; ++k) {
+            float* re = real + (start + k) * kLanes;
+            float* im = imag + (start + k) * kLanes;
+            Lanes r0 = lanesLoad(re), i0 = lanesLoad(im);
+            Lanes r1 = lanesLoad(re + halfLength * kLanes), i1 = lanesLoad(im + halfLength * kLanes);
+            butterfly(r0, i0, r1, i1, lanesSet(cosines[k]), lanesSet(sines[k]));
+            lanesStore(re, r0);
+            lanesStore(im, i0);
+            lanesStore(re + halfLength * kLanes, r1);
+            lanesStore(im + halfLength * kLanes, i1);
+        }
+    }
+}
+
+bool isPowerOfTwo(std::size_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+} // namespace
+
+BatchedStft::BatchedStft(std::size_t fftSize, std::size_t hopSize, const FftWindow& window)
+    : fftSize_(fftSize)
+    , hopSize_(hopSize)
+{
+    if (fftSize < 4 || !isPowerOfTwo(fftSize) || hopSize == 0)
+        throw std::invalid_argument("STFT needs a power-of-two size >= 4 and a non-zero hop");
+    window_ = sharedWindow(fftSize, window);
+
+    // The real transform is a complex one of n = size / 2 points, the
+    // radix-2 way round: inputs are loaded in bit-reversed order.
+    const std::size_t n = fftSize / 2;
+    bitReverse_.resize(n);
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        bitReverse_[i] = static_cast<std::uint32_t>(j);
+    }
+    stageCos_.reserve(n);
+    stageSin_.reserve(n);
+    for (std::size_t halfLength = 1; halfLength < n; halfLength <<= 1) {
+        for (std::size_t k = 0; k < halfLength; ++k) {
+            const double angle = kPi * static_cast<double>(k) / static_cast<double>(halfLength);
+            stageCos_.push_back(static_cast<float>(std::cos(angle)));
+            stageSin_.push_back(static_cast<float>(-std::sin(angle)));
+        }
+    }
+    realCos_.resize(n / 2 + 1);
+    realSin_.resize(n / 2 + 1);
+    for (std::size_t k = 0; k <= n / 2; ++k) {
+        const double angle = kPi * static_cast<double>(k) / static_cast<double>(n);
+        realCos_[k] = static_cast<float>(std::cos(angle));
+        realSin_[k] = static_cast<float>(-std::sin(angle));
+    }
+}
+
+std::size_t BatchedStft::frameCount(std::size_t sampleCount) const
+{
+    return sampleCount < fftSize_ ? 0 : (sampleCount - fftSize_) / hopSize_ + 1;
+}
+
+void BatchedStft::process(const float* samples, std::size_t frames, float* magnitudes, float* phases,
+                          std::size_t rowStride) const
+{
+    if (rowStride == 0)
+        rowStride = binCount();
+    for (std::size_t first = 0; first < frames; first += kLanes) {
+        const std::size_t group = std::min(kLanes, frames - first);
+        transformGroup(samples + first * hopSize_, group, magnitudes + first * rowStride,
+                       phases ? phases + first * rowStride : nullptr, rowStride);
+    }
+}
+
+void BatchedStft::transformGroup(const float* samples, std::size_t frames, float* magnitudes, float* phases,
+                                 std::size_t rowStride) const
+{
+    const std::size_t n = fftSize_ / 2;
+    const std::size_t bins = n + 1;
+    // Point k of lane l lives at [k * kLanes + l]; unused lanes stay zero.
+    ScratchBuffer real(bins * kLanes);
+    ScratchBuffer imag(bins * kLanes);
+    if (frames < kLanes) {
+        std::fill(real.data(), real.data() + n * kLanes, 0.0f);
+        std::fill(imag.data(), imag.data() + n * kLanes, 0.0f);
+    }
+
+    // Radix-2 stages, taken two at a time so each pass over the points does
+    // twice the work. Points are windowed and packed, z[m] = x[2m] +
+    // i x[2m + 1], into their bit-reversed slots a block at a time, and the
+    // stages within a block run while it is still in L1.
+    const float* window = window_->data();
+    const std::size_t block = std::min(n, kBlockPoints);
+    std::size_t halfLength = 1;
+    for (std::size_t first = 0; first < n; first += block) {
+        float* re = real.data() + first * kLanes;
+        float* im = imag.data() + first * kLanes;
+        for (std::size_t j = 0; j < block; ++j) {
+            const std::size_t m = bitReverse_[first + j];
+            const float evenWeight = window[2 * m];
+            const float oddWeight = window[2 * m + 1];
+            const float* x = samples + 2 * m;
+            for (std::size_t l = 0; l < frames; ++l, x += hopSize_) {
+                re[j * kLanes + l] = x[0] * evenWeight;
+                im[j * kLanes + l] = x[1] * oddWeight;
+            }
+        }
+        halfLength = 1;
+        if (block >= 4) {
+            firstStages(re, im, block);
+            halfLength = 4;
+        }
+        for (; 4 * halfLength <= block; halfLength <<= 2)
+            radix4Pass(re, im, block, halfLength, stageCos_.data(), stageSin_.data());
+    }
+    for (; 2 * halfLength < n; halfLength <<= 2)
+        radix4Pass(real.data(), imag.data(), n, halfLength, stageCos_.data(), stageSin_.data());
+    if (halfLength < n)
+        radix2Pass(real.data(), imag.data(), n, halfLength, stageCos_.data(), stageSin_.data());
+
+    // Split into the real spectrum, as in `Fft::forward`, in place: bins k and
+    // n - k are computed together from points k and n - k. Without phases
+    // only the magnitudes are kept, in `real`.
+    const bool keepSpectrum = phases != nullptr;
+    const auto storeBin = [&](std::size_t k, Lanes re, Lanes im) {
+        if (keepSpectrum) {
+            lanesStore(real.data() + k * kLanes, re);
+            lanesStore(imag.data() + k * kLanes, im);
+        } else {
+            lanesStore(real.data() + k * kLanes, lanesMagnitude(re, im));
+        }
+    };
+    {
+        const Lanes a0r = lanesLoad(real.data()), a0i = lanesLoad(imag.data());
+        const Lanes zero = lanesSet(0.0f);
+        storeBin(0, lanesAdd(a0r, a0i), zero);
+        storeBin(n, lanesSub(a0r, a0i), zero);
+    }
+    const Lanes half = lanesSet(0.5f);
+    for (std::size_t k = 1; k <= n / 2; ++k) {
+        const std::size_t j = n - k;
+        const Lanes ar = lanesLoad(real.data() + k * kLanes), ai = lanesLoad(imag.data() + k * kLanes);
+        const Lanes br = lanesLoad(real.data() + j * kLanes), bi = lanesLoad(imag.data() + j * kLanes);
+        const Lanes wr = lanesSet(realCos_[k]);
+        const Lanes wi = lanesSet(realSin_[k]);
+
+        const Lanes er = lanesMul(half, lanesAdd(ar, br));
+        const Lanes ei = lanesMul(half, lanesSub(ai, bi));
+        const Lanes orr = lanesMul(half, lanesAdd(ai, bi));
+        const Lanes oi = lanesMul(half, lanesSub(br, ar));
+        const Lanes tr = lanesSub(lanesMul(orr, wr), lanesMul(oi, wi));
+        const Lanes ti = lanesAdd(lanesMul(orr, wi), lanesMul(oi, wr));
+
+        storeBin(k, lanesAdd(er, tr), lanesAdd(ei, ti));
+        if (j != k)
+            storeBin(j, lanesSub(er, tr), lanesSub(ti, ei));
+    }
+
+    if (keepSpectrum) {
+        for (std::size_t k = 0; k < bins; ++k) {
+            const float* re = real.data() + k * kLanes;
+            const float* im = imag.data() + k * kLanes;
+            for (std::size_t l = 0; l < frames; ++l)
+                phases[l * rowStride + k] = std::atan2(im[l], re[l]);
+            lanesStore(real.data() + k * kLanes, lanesMagnitude(lanesLoad(re), lanesLoad(im)));
+        }
+    }
+    for (std::size_t k = 0; k < bins; ++k)
+        for (std::size_t l = 0; l < frames; ++l)
+            magnitudes[l * rowStride + k] = real[k * kLanes + l];
+}
+
+SpectrogramStream::SpectrogramStream(std::size_t fftSize, std::size_t hopSize, std::size_t batchFrames,
+                                     const FftWindow& window)
+    : stft_(fftSize, hopSize, window)
+    , batchFrames_(std::max<std::size_t>(1, batchFrames))
+    , lead_(fftSize > hopSize ? fftSize - hopSize : 0)
+    , buffer_(lead_ + batchFrames_ * hopSize, 0.0f)
+    , filled_(lead_)
+    , magnitudes_(batchFrames_ * stft_.binCount())
+{
+}
+
+std::size_t SpectrogramStream::append(ChannelView samples)
+{
+    const std::size_t take = std::min(samples.size(), buffer_.size() - filled_);
+    std::copy(samples.begin(), samples.begin() + take, buffer_.begin() + static_cast<std::ptrdiff_t>(filled_));
+    filled_ += take;
+    return take;
+}
+
+std::size_t SpectrogramStream::pendingFrames() const
+{
+    return (filled_ - lead_) / stft_.hopSize();
+}
+
+std::size_t SpectrogramStream::transformPending()
+{
+    const std::size_t frames = pendingFrames();
+    const std::size_t hop = stft_.hopSize();
+    // With a hop longer than the window, each frame is the end of its hop.
+    const std::size_t skip = hop > stft_.fftSize() ? hop - stft_.fftSize() : 0;
+    stft_.process(buffer_.data() + skip, frames, magnitudes_.data());
+
+    // Keep the window's lead-in and any partial hop for the next batch.
+    const auto consumed = static_cast<std::ptrdiff_t>(frames * hop);
+    std::copy(buffer_.begin() + consumed, buffer_.begin() + static_cast<std::ptrdiff_t>(filled_), buffer_.begin());
+    filled_ -= frames * hop;
+    return frames;
+}
+
+} // namespace audiocompare
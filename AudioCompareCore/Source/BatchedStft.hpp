@@ -0,0 +1,120 @@
+//
+//  BatchedStft.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+#include "FftWindow.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace audiocompare {
+
+/// Offline short-time Fourier transform of many hop-spaced frames per call.
+/// `EZAudioFFTRolling` transforms one frame per callback, which suits live
+/// plotting; here frames are transformed in groups as wide as the SIMD
+/// registers. Each group is stored structure-of-arrays, with one lane per
+/// frame, so every butterfly works on all of the group's frames at once and
+/// the twiddles are broadcast rather than shuffled. Frames are windowed like
+/// `RollingFft`, Hann by default, and magnitudes are unscaled like
+/// `Fft::computeFFT`.
+///
+/// The tables are immutable after construction, so one instance can serve
+/// several threads; the work buffers come from the calling thread's
+/// `ScratchArena`.
+class BatchedStft {
+public:
+    /// Throws std::invalid_argument unless `fftSize` is a power of two of at
+    /// least 4 and `hopSize` is non-zero.
+    BatchedStft(std::size_t fftSize, std::size_t hopSize, const FftWindow& window = {});
+
+    std::size_t fftSize() const { return fftSize_; }
+    std::size_t hopSize() const { return hopSize_; }
+    std::size_t binCount() const { return fftSize_ / 2 + 1; }
+    /// Whole frames in `sampleCount` samples.
+    std::size_t frameCount(std::size_t sampleCount) const;
+
+    /// Transforms `frames` frames, frame f being the `fftSize()` samples at
+    /// `samples + f * hopSize()`. Row f of `magnitudes`, and of `phases`
+    /// unless it is null, receives the frame's `binCount()` values; rows are
+    /// `rowStride` floats apart, `binCount()` when 0.
+    void process(const float* samples, std::size_t frames, float* magnitudes, float* phases = nullptr,
+                 std::size_t rowStride = 0) const;
+
+private:
+    void transformGroup(const float* samples, std::size_t frames, float* magnitudes, float* phases,
+                        std::size_t rowStride) const;
+
+    std::size_t fftSize_;
+    std::size_t hopSize_;
+    std::shared_ptr<const std::vector<float>> window_;
+    std::vector<std::uint32_t> bitReverse_;
+    std::vector<float> stageCos_;
+    std::vector<float> stageSin_;
+    std::vector<float> realCos_;
+    std::vector<float> realSin_;
+};
+
+/// Streams samples through a `BatchedStft` with the framing of `RollingFft`:
+/// frame f is the window ending `(f + 1) * hopSize` samples into the stream,
+/// with silence before the start. Frames are transformed once
+/// `batchFrames` of them are complete, and `flush` transforms the rest, so
+/// the consumer sees every frame in order but up to a batch late.
+class SpectrogramStream {
+public:
+    SpectrogramStream(std::size_t fftSize, std::size_t hopSize, std::size_t batchFrames = 32,
+                      const FftWindow& window = {});
+
+    std::size_t fftSize() const { return stft_.fftSize(); }
+    std::size_t hopSize() const { return stft_.hopSize(); }
+    std::size_t binCount() const { return stft_.binCount(); }
+
+    /// Appends `samples`, calling `consume(magnitudes)` with the `binCount()`
+    /// magnitudes of every frame transformed along the way.
+    template <typename Consume>
+    void push(ChannelView samples, Consume&& consume)
+    {
+        while (!samples.empty()) {
+            samples = samples.subview(append(samples), samples.size());
+            if (pendingFrames() == batchFrames_)
+                deliver(consume);
+        }
+    }
+
+    /// Transforms the complete frames still pending. Samples past the last
+    /// whole hop are kept for the next `push`.
+    template <typename Consume>
+    void flush(Consume&& consume)
+    {
+        if (pendingFrames() > 0)
+            deliver(consume);
+    }
+
+private:
+    std::size_t append(ChannelView samples);
+    std::size_t pendingFrames() const;
+    std::size_t transformPending();
+
+    template <typename Consume>
+    void deliver(Consume& consume)
+    {
+        const std::size_t frames = transformPending();
+        for (std::size_t f = 0; f < frames; ++f)
+            consume(static_cast<const float*>(magnitudes_.data() + f * stft_.binCount()));
+    }
+
+    BatchedStft stft_;
+    std::size_t batchFrames_;
+    // Samples of the window before the first pending hop.
+    std::size_t lead_;
+    std::vector<float> buffer_;
+    std::size_t filled_;
+    std::vector<float> magnitudes_;
+};
+
+} // namespace audiocompare
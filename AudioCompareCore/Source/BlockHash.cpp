@@ -0,0 +1,213 @@
+//
+//  BlockHash.cpp
+//  AudioCompareCore
+//
+
+#include "BlockHash.hpp"
+
+#include "VectorKernels.hpp"
+
+#include <array>
+#include <cstring>
+
+#if AUDIOCOMPARE_AVX2 || AUDIOCOMPARE_SSE2
+#include <immintrin.h>
+#endif
+#if AUDIOCOMPARE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audiocompare {
+
+namespace {
+
+constexpr std::size_t kLanes = 8;
+constexpr std::size_t kStripeBytes = kLanes * sizeof(std::uint64_t);
+constexpr std::size_t kStripesPerBlock = 16;
+constexpr std::size_t kBlockBytes = kStripeBytes * kStripesPerBlock;
+constexpr std::size_t kKeyCount = kStripesPerBlock + kLanes;
+
+constexpr std::uint64_t kPrime32 = 0x9E3779B1ULL;
+constexpr std::uint64_t kPrime64 = 0x9E3779B185EBCA87ULL;
+
+constexpr std::uint64_t splitMix(std::uint64_t& state)
+{
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr std::array<std::uint64_t, kKeyCount> makeKeys()
+{
+    std::array<std::uint64_t, kKeyCount> keys{};
+    std::uint64_t state = 0x417564696F436D70ULL;
+    for (std::uint64_t& key : keys)
+        key = splitMix(state);
+    return keys;
+}
+
+// Stripe s of a block mixes lane i with key s + i; the scramble uses the
+// last kLanes keys.
+constexpr std::array<std::uint64_t, kKeyCount> kKeys = makeKeys();
+
+std::uint64_t foldedMultiply(std::uint64_t a, std::uint64_t b)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    std::uint64_t high = 0;
+    const std::uint64_t low = _umul128(a, b, &high);
+    return low ^ high;
+#else
+    const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+#endif
+}
+
+std::uint64_t avalanche(std::uint64_t h)
+{
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    return h ^ (h >> 32);
+}
+
+#if AUDIOCOMPARE_AVX2
+void accumulateStripes(std::uint64_t* acc, const unsigned char* p, std::size_t stripes,
+                       std::size_t firstKey)
+{
+    __m256i acc0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+    __m256i acc1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4));
+    for (std::size_t s = 0; s < stripes; ++s, p += kStripeBytes) {
+        const std::uint64_t* key = kKeys.data() + firstKey + s;
+        const __m256i data0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i data1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        const __m256i keyed0 = _mm256_xor_si256(data0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key)));
+        const __m256i keyed1 = _mm256_xor_si256(data1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 4)));
+        acc0 = _mm256_add_epi64(acc0, _mm256_mul_epu32(keyed0, _mm256_srli_epi64(keyed0, 32)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_mul_epu32(keyed1, _mm256_srli_epi64(keyed1, 32)));
+        acc0 = _mm256_add_epi64(acc0, _mm256_shuffle_epi32(data0, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_shuffle_epi32(data1, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), acc0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4), acc1);
+}
+#elif AUDIOCOMPARE_SSE2
+void accumulateStripes(std::uint64_t* acc, const unsigned char* p, std::size_t stripes,
+                       std::size_t firstKey)
+{
+    __m128i lanes[4];
+    for (std::size_t j = 0; j < 4; ++j)
+        lanes[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + 2 * j));
+    for (std::size_t s = 0; s < stripes; ++s, p += kStripeBytes) {
+        const std::uint64_t* key = kKeys.data() + firstKey + s;
+        for (std::size_t j = 0; j < 4; ++j) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * j));
+            const __m128i keyed = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 2 * j)));
+            lanes[j] = _mm_add_epi64(lanes[j], _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32)));
+            lanes[j] = _mm_add_epi64(lanes[j], _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+    }
+    for (std::size_t j = 0; j < 4; ++j)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2 * j), lanes[j]);
+}
+#elif AUDIOCOMPARE_NEON && (defined(__LITTLE_ENDIAN__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+void accumulateStripes(std::uint64_t* acc, const unsigned char* p, std::size_t stripes,
+                       std::size_t firstKey)
+{
+    uint64x2_t lanes[4];
+    for (std::size_t j = 0; j < 4; ++j)
+        lanes[j] = vld1q_u64(acc + 2 * j);
+    for (std::size_t s = 0; s < stripes; ++s, p += kStripeBytes) {
+        const std::uint64_t* key = kKeys.data() + firstKey + s;
+        for (std::size_t j = 0; j < 4; ++j) {
+            const uint64x2_t data = vreinterpretq_u64_u8(vld1q_u8(p + 16 * j));
+            const uint64x2_t keyed = veorq_u64(data, vld1q_u64(key + 2 * j));
+            lanes[j] = vaddq_u64(lanes[j], vmull_u32(vmovn_u64(keyed), vshrn_n_u64(keyed, 32)));
+            lanes[j] = vaddq_u64(lanes[j], vextq_u64(data, data, 1));
+        }
+    }
+    for (std::size_t j = 0; j < 4; ++j)
+        vst1q_u64(acc + 2 * j, lanes[j]);
+}
+#else
+std::uint64_t readLittleEndian64(const unsigned char* p)
+{
+    std::uint64_t value = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (int i = 7; i >= 0; --i)
+        value = (value << 8) | p[i];
+#else
+    std::memcpy(&value, p, sizeof(value));
+#endif
+    return value;
+}
+
+void accumulateStripes(std::uint64_t* acc, const unsigned char* p, std::size_t stripes,
+                       std::size_t firstKey)
+{
+    for (std::size_t s = 0; s < stripes; ++s, p += kStripeBytes) {
+        for (std::size_t i = 0; i < kLanes; ++i) {
+            const std::uint64_t data = readLittleEndian64(p + i * 8);
+            const std::uint64_t keyed = data ^ kKeys[firstKey + s + i];
+            acc[i ^ 1] += data;
+            acc[i] += (keyed & 0xFFFFFFFFULL) * (keyed >> 32);
+        }
+    }
+}
+#endif
+
+void scramble(std::uint64_t* acc)
+{
+    for (std::size_t i = 0; i < kLanes; ++i) {
+        std::uint64_t value = acc[i];
+        value ^= value >> 47;
+        value ^= kKeys[kStripesPerBlock + i];
+        acc[i] = value * kPrime32;
+    }
+}
+
+} // namespace
+
+std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t seed)
+{
+    std::uint64_t acc[kLanes] = {
+        0xC2B2AE3DULL ^ seed, kPrime64, 0x85EBCA77C2B2AE63ULL, 0x165667B1ULL,
+        0x27D4EB2F165667C5ULL, 0x85EBCA77ULL, 0x9E3779B1ULL ^ (seed >> 32), 0x61C8864E7A143579ULL,
+    };
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    std::size_t remaining = size;
+
+    for (; remaining >= kBlockBytes; remaining -= kBlockBytes, p += kBlockBytes) {
+        accumulateStripes(acc, p, kStripesPerBlock, 0);
+        scramble(acc);
+    }
+    const std::size_t stripes = remaining / kStripeBytes;
+    accumulateStripes(acc, p, stripes, 0);
+    p += stripes * kStripeBytes;
+    remaining -= stripes * kStripeBytes;
+    if (remaining > 0) {
+        // Zero padding is unambiguous because the length is mixed in below.
+        unsigned char last[kStripeBytes] = {};
+        std::memcpy(last, p, remaining);
+        accumulateStripes(acc, last, 1, stripes);
+    }
+
+    std::uint64_t h = static_cast<std::uint64_t>(size) * kPrime64 + seed;
+    for (std::size_t i = 0; i < kLanes; i += 2)
+        h += foldedMultiply(acc[i] ^ kKeys[i + 3], acc[i + 1] ^ kKeys[i + 4]);
+    return avalanche(h);
+}
+
+std::uint64_t combineHashes(std::uint64_t first, std::uint64_t second)
+{
+    return avalanche(foldedMultiply(first ^ kKeys[0], second ^ kKeys[1]) + first * kPrime64);
+}
+
+std::uint64_t hashBlock(const AudioBufferView& block)
+{
+    std::uint64_t h = hashBytes(nullptr, 0, block.frames());
+    for (std::size_t c = 0; c < block.channelCount(); ++c)
+        h = combineHashes(h, hashBytes(block.channel(c).data(), block.frames() * sizeof(float), c));
+    return h;
+}
+
+} // namespace audiocompare
@@ -0,0 +1,28 @@
+//
+//  BlockHash.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audiocompare {
+
+/// 64-bit non-cryptographic hash built like XXH3's long-input loop: eight
+/// 64-bit lanes accumulate 32x32-bit products of key-mixed input over 64-byte
+/// stripes, with a scramble every 1 KiB and a 128-bit fold at the end. The
+/// AVX2, SSE2, NEON and scalar paths produce identical values, so hashes can
+/// be compared across machines. Not suitable against adversarial input.
+std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t seed = 0);
+
+/// Order-dependent combination of two hashes, e.g. per-channel block hashes.
+std::uint64_t combineHashes(std::uint64_t first, std::uint64_t second);
+
+/// Hashes every channel of `block` as one block.
+std::uint64_t hashBlock(const AudioBufferView& block);
+
+} // namespace audiocompare
@@ -0,0 +1,107 @@
+//
+//  BlockHashComparator.cpp
+//  AudioCompareCore
+//
+
+#include "BlockHashComparator.hpp"
+
+#include "AudioUtilities.hpp"
+#include "BlockHash.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace audiocompare {
+
+BlockHashComparator::BlockHashComparator(ComparisonOptions options, std::size_t blockFrames)
+    : options_(options)
+{
+    if (blockFrames == 0)
+        throw std::invalid_argument("hash block size must be positive");
+    summary_.blockFrames = blockFrames;
+}
+
+ComparisonResult BlockHashComparator::compare(AudioReader& reference, AudioReader& candidate)
+{
+    const AudioFormat format = reference.format();
+    const AudioFormat candidateFormat = candidate.format();
+    if (format.channelCount != candidateFormat.channelCount)
+        throw std::invalid_argument("channel counts differ");
+    if (format.sampleRate != candidateFormat.sampleRate)
+        throw std::invalid_argument("sample rates differ");
+
+    const std::int64_t referenceStart = reference.framePosition();
+    const std::int64_t candidateStart = candidate.framePosition();
+    if (options_.candidateOffset > 0)
+        candidate.seekToFrame(candidateStart + options_.candidateOffset);
+    else if (options_.candidateOffset < 0)
+        reference.seekToFrame(referenceStart - options_.candidateOffset);
+
+    const std::size_t channels = format.channelCount;
+    const std::size_t blockFrames = summary_.blockFrames;
+    FloatBuffers referenceBlock(channels, blockFrames);
+    FloatBuffers candidateBlock(channels, blockFrames);
+    summary_.blocks = 0;
+    summary_.differingBlocks = 0;
+    summary_.differingRanges.clear();
+
+    std::int64_t position = 0;
+    std::int64_t referenceFrames = 0;
+    std::int64_t candidateFrames = 0;
+    for (;;) {
+        const std::size_t referenceRead = reference.readFrames(referenceBlock.data(), blockFrames);
+        const std::size_t candidateRead = candidate.readFrames(candidateBlock.data(), blockFrames);
+        referenceFrames += static_cast<std::int64_t>(referenceRead);
+        candidateFrames += static_cast<std::int64_t>(candidateRead);
+        if (referenceRead == 0 || candidateRead == 0)
+            break;
+
+        ++summary_.blocks;
+        const std::int64_t end = position + static_cast<std::int64_t>(std::min(referenceRead, candidateRead));
+        const bool same = referenceRead == candidateRead
+                          && hashBlock(referenceBlock.view(0, referenceRead))
+                                 == hashBlock(candidateBlock.view(0, candidateRead));
+        if (!same) {
+            ++summary_.differingBlocks;
+            if (!summary_.differingRanges.empty() && summary_.differingRanges.back().end == position)
+                summary_.differingRanges.back().end = end;
+            else
+                summary_.differingRanges.push_back({position, end});
+        }
+        position = end;
+        if (referenceRead != candidateRead)
+            break;
+    }
+
+    // Count the tail of the longer stream without decoding it.
+    const std::int64_t referenceTotal = reference.frameCount();
+    const std::int64_t candidateTotal = candidate.frameCount();
+    if (referenceTotal >= 0)
+        referenceFrames += referenceTotal - reference.framePosition();
+    if (candidateTotal >= 0)
+        candidateFrames += candidateTotal - candidate.framePosition();
+
+    std::int64_t differingFrames = 0;
+    for (const FrameRange& range : summary_.differingRanges)
+        differingFrames += range.end - range.start;
+
+    ComparisonResult result;
+    if (summary_.differingRanges.empty()) {
+        result.format = format;
+        result.channels.resize(channels);
+        result.candidateOffset = options_.candidateOffset;
+        result.referenceStart = referenceStart + std::max<std::int64_t>(-options_.candidateOffset, 0);
+        result.referenceFrames = referenceFrames;
+        result.candidateFrames = candidateFrames;
+    } else {
+        reference.seekToFrame(referenceStart);
+        candidate.seekToFrame(candidateStart);
+        StreamingComparator comparator(options_);
+        comparator.setObserver(observer_);
+        result = comparator.compareRanges(reference, candidate, summary_.differingRanges);
+    }
+    result.hashMatchedFrames = position - differingFrames;
+    return result;
+}
+
+} // namespace audiocompare
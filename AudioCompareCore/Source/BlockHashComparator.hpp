@@ -0,0 +1,49 @@
+//
+//  BlockHashComparator.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "StreamingComparator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+struct BlockHashSummary {
+    std::size_t blockFrames = 0;
+    std::int64_t blocks = 0;
+    std::int64_t differingBlocks = 0;
+    /// Runs of adjacent differing blocks, counted from the comparison start.
+    std::vector<FrameRange> differingRanges;
+};
+
+/// Bit-exact fast path in front of `StreamingComparator`, replacing the
+/// whole-render MD5 of `AKTesterAudioUnit`. Both streams are decoded once and
+/// hashed in fixed blocks of `blockFrames`; when every block matches the
+/// result is returned without any DSP, otherwise only the differing block
+/// ranges are handed to `StreamingComparator::compareRanges`.
+class BlockHashComparator {
+public:
+    explicit BlockHashComparator(ComparisonOptions options = {}, std::size_t blockFrames = 65536);
+
+    /// Same contract as `StreamingComparator::compare`. Identical blocks are
+    /// reported in `hashMatchedFrames` and contribute no sample or spectral
+    /// metrics.
+    ComparisonResult compare(AudioReader& reference, AudioReader& candidate);
+
+    const BlockHashSummary& summary() const { return summary_; }
+
+    /// Forwarded to the `StreamingComparator` that analyzes differing ranges.
+    void setObserver(ComparisonObserver* observer) { observer_ = observer; }
+
+private:
+    ComparisonOptions options_;
+    ComparisonObserver* observer_ = nullptr;
+    BlockHashSummary summary_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,68 @@
+//
+//  ComparisonObserver.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+/// Receives the comparison as it streams, e.g. to render the difference
+/// signal or index where the inputs differ. Called on the comparing thread;
+/// positions count frames from the comparison start.
+class ComparisonObserver {
+public:
+    virtual ~ComparisonObserver() = default;
+
+    /// Every compared block, after alignment; both views hold the same
+    /// number of frames, the first of which is at `position`.
+    virtual void processBlock(const AudioBufferView& reference, const AudioBufferView& candidate,
+                              std::int64_t position) = 0;
+
+    /// Log-spectral distance (dB) of the analysis window starting at
+    /// `frameStart`, averaged over channels.
+    virtual void processSpectralFrame(std::int64_t frameStart, std::size_t frameLength,
+                                      double distance)
+    {
+        (void)frameStart;
+        (void)frameLength;
+        (void)distance;
+    }
+};
+
+/// Forwards to several observers in order, for comparators that accept one.
+class CompositeObserver : public ComparisonObserver {
+public:
+    void add(ComparisonObserver* observer)
+    {
+        if (observer)
+            observers_.push_back(observer);
+    }
+
+    bool empty() const { return observers_.empty(); }
+
+    void processBlock(const AudioBufferView& reference, const AudioBufferView& candidate,
+                      std::int64_t position) override
+    {
+        for (ComparisonObserver* observer : observers_)
+            observer->processBlock(reference, candidate, position);
+    }
+
+    void processSpectralFrame(std::int64_t frameStart, std::size_t frameLength,
+                              double distance) override
+    {
+        for (ComparisonObserver* observer : observers_)
+            observer->processSpectralFrame(frameStart, frameLength, distance);
+    }
+
+private:
+    std::vector<ComparisonObserver*> observers_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,119 @@
+//
+//  ComparisonPipeline.cpp
+//  AudioCompareCore
+//
+
+#include "ComparisonPipeline.hpp"
+
+#include "AudioUtilities.hpp"
+#include "FractionalDelayReader.hpp"
+#include "ResamplingReader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace audiocompare {
+
+namespace {
+
+// Sub-sample offsets below this are checked for an exact integer match.
+const double kExactMatchFraction = 0.01;
+const double kExactMatchSeconds = 1.0;
+
+// Self-similar material interpolates to a tiny non-zero fraction even when
+// the integer lag is bit-exact; shifting it would only blur the match.
+bool matchesAtIntegerLag(AudioReader& reference, AudioReader& candidate, std::int64_t offset)
+{
+    const AudioFormat format = reference.format();
+    const std::size_t frames = static_cast<std::size_t>(kExactMatchSeconds * format.sampleRate);
+    const std::int64_t referencePosition = reference.framePosition();
+    const std::int64_t candidatePosition = candidate.framePosition();
+    reference.seekToFrame(referencePosition + std::max<std::int64_t>(-offset, 0));
+    candidate.seekToFrame(candidatePosition + std::max<std::int64_t>(offset, 0));
+    FloatBuffers referenceBlock(format.channelCount, frames);
+    FloatBuffers candidateBlock(format.channelCount, frames);
+    const std::size_t referenceRead = reference.readFrames(referenceBlock.data(), frames);
+    const std::size_t candidateRead = candidate.readFrames(candidateBlock.data(), frames);
+    reference.seekToFrame(referencePosition);
+    candidate.seekToFrame(candidatePosition);
+
+    bool same = referenceRead > 0 && referenceRead == candidateRead;
+    for (std::size_t c = 0; same && c < format.channelCount; ++c)
+        same = std::memcmp(referenceBlock.channel(c), candidateBlock.channel(c), referenceRead * sizeof(float)) == 0;
+    return same;
+}
+
+} // namespace
+
+ComparisonPipeline::ComparisonPipeline(AudioReader& reference, AudioReader& candidate,
+                                       PipelineOptions options)
+    : reference_(reference)
+    , candidate_(candidate)
+    , options_(options)
+{
+    options_.align = options_.align || options_.usePyramid || options_.drift;
+    fractionalOffset_ = static_cast<double>(options_.comparison.candidateOffset);
+}
+
+ComparisonPipeline::~ComparisonPipeline() = default;
+
+void ComparisonPipeline::align()
+{
+    if (!options_.align)
+        return;
+    if (options_.usePyramid) {
+        pyramidAlignment_ = AlignmentPyramid(options_.alignment, options_.pyramid).findOffset(reference_, candidate_);
+        options_.comparison.candidateOffset = pyramidAlignment_->offset;
+        fractionalOffset_ = pyramidAlignment_->fractionalOffset;
+    } else {
+        alignment_ = OffsetFinder(options_.alignment).findOffset(reference_, candidate_);
+        options_.comparison.candidateOffset = alignment_->offset;
+        fractionalOffset_ = alignment_->fractionalOffset;
+    }
+
+    double fraction = fractionalOffset_ - static_cast<double>(options_.comparison.candidateOffset);
+    if (fraction != 0.0 && std::fabs(fraction) < kExactMatchFraction
+        && matchesAtIntegerLag(reference_, candidate_, options_.comparison.candidateOffset)) {
+        fractionalOffset_ = static_cast<double>(options_.comparison.candidateOffset);
+        fraction = 0.0;
+    }
+    if (options_.drift) {
+        // Resample the candidate onto the reference clock; the resampler
+        // takes over both the integer and the fractional offset.
+        drift_ = DriftEstimator().estimate(reference_, candidate_, fractionalOffset_);
+        const std::int64_t skip = ResamplingReader::firstSupportedFrame(drift_->start, drift_->ratio);
+        corrected_ = std::make_unique<ResamplingReader>(
+            candidate_, drift_->start + drift_->ratio * static_cast<double>(skip), drift_->ratio);
+        options_.comparison.candidateOffset = -skip;
+    } else if (options_.subsample && fraction != 0.0) {
+        // Shift the candidate by the sub-sample remainder before differencing.
+        // When the comparison would start before the delayed candidate's first
+        // fully supported frame, both inputs skip ahead to it together.
+        auto delayed = std::make_unique<FractionalDelayReader>(candidate_, -fraction);
+        const std::int64_t candidateStart = delayed->framePosition()
+                                            + std::max<std::int64_t>(options_.comparison.candidateOffset, 0);
+        const std::int64_t lead = delayed->firstSupportedFrame() - candidateStart;
+        if (lead > 0) {
+            reference_.seekToFrame(reference_.framePosition() + lead);
+            delayed->seekToFrame(delayed->framePosition() + lead);
+        }
+        corrected_ = std::move(delayed);
+    }
+}
+
+ComparisonResult ComparisonPipeline::compare(ComparisonObserver* observer)
+{
+    if (options_.hash) {
+        BlockHashComparator comparator(options_.comparison, options_.hashBlockFrames);
+        comparator.setObserver(observer);
+        ComparisonResult result = comparator.compare(reference_, candidate());
+        hashSummary_ = comparator.summary();
+        return result;
+    }
+    StreamingComparator comparator(options_.comparison);
+    comparator.setObserver(observer);
+    return comparator.compare(reference_, candidate());
+}
+
+} // namespace audiocompare
@@ -0,0 +1,77 @@
+//
+//  ComparisonPipeline.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AlignmentPyramid.hpp"
+#include "BlockHashComparator.hpp"
+#include "DriftEstimator.hpp"
+#include "OffsetFinder.hpp"
+#include "StreamingComparator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace audiocompare {
+
+struct PipelineOptions {
+    ComparisonOptions comparison;
+    AlignmentOptions alignment;
+    PyramidOptions pyramid;
+    /// Estimate the offset with `OffsetFinder` (or the pyramid) first.
+    bool align = false;
+    bool usePyramid = false;
+    /// Correct the sub-sample part of the offset with a fractional delay.
+    bool subsample = true;
+    /// Estimate clock drift and resample the candidate; implies `align`.
+    bool drift = false;
+    /// Run `BlockHashComparator` instead of a full comparison.
+    bool hash = false;
+    std::size_t hashBlockFrames = 65536;
+};
+
+/// The comparison flow shared by the command-line tools, split in two stages
+/// so they can be scheduled separately: `align` finds the offset (and drift)
+/// and wraps the candidate in the matching correction reader, `compare`
+/// streams the comparison. The readers must outlive the pipeline.
+class ComparisonPipeline {
+public:
+    ComparisonPipeline(AudioReader& reference, AudioReader& candidate, PipelineOptions options);
+    ~ComparisonPipeline();
+
+    ComparisonPipeline(const ComparisonPipeline&) = delete;
+    ComparisonPipeline& operator=(const ComparisonPipeline&) = delete;
+
+    void align();
+    /// `observer` is optional and sees the aligned blocks.
+    ComparisonResult compare(ComparisonObserver* observer = nullptr);
+
+    AudioReader& reference() { return reference_; }
+    /// The candidate after sub-sample or drift correction.
+    AudioReader& candidate() { return corrected_ ? *corrected_ : candidate_; }
+    /// Offset to apply between `reference()` and `candidate()`.
+    std::int64_t candidateOffset() const { return options_.comparison.candidateOffset; }
+    double fractionalOffset() const { return fractionalOffset_; }
+
+    const std::optional<AlignmentResult>& alignment() const { return alignment_; }
+    const std::optional<PyramidAlignmentResult>& pyramidAlignment() const { return pyramidAlignment_; }
+    const std::optional<DriftEstimate>& driftEstimate() const { return drift_; }
+    const std::optional<BlockHashSummary>& hashSummary() const { return hashSummary_; }
+
+private:
+    AudioReader& reference_;
+    AudioReader& candidate_;
+    PipelineOptions options_;
+    std::unique_ptr<AudioReader> corrected_;
+    double fractionalOffset_ = 0.0;
+    std::optional<AlignmentResult> alignment_;
+    std::optional<PyramidAlignmentResult> pyramidAlignment_;
+    std::optional<DriftEstimate> drift_;
+    std::optional<BlockHashSummary> hashSummary_;
+};
+
+} // namespace audiocompare
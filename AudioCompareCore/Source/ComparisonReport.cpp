@@ -0,0 +1,62 @@
+//
+//  ComparisonReport.cpp
+//  AudioCompareCore
+//
+
+#include "ComparisonReport.hpp"
+
+#include <iomanip>
+
+namespace audiocompare {
+
+namespace {
+
+double seconds(std::int64_t frames, double sampleRate)
+{
+    return sampleRate > 0.0 ? static_cast<double>(frames) / sampleRate : 0.0;
+}
+
+} // namespace
+
+void writeReport(std::ostream& stream, const ComparisonResult& result)
+{
+    const double rate = result.format.sampleRate;
+    const SampleMetrics& overall = result.overall;
+
+    stream << std::fixed << std::setprecision(3);
+    stream << "format            " << rate << " Hz, " << result.format.channelCount << " ch\n";
+    stream << "reference frames  " << result.referenceFrames << " (" << seconds(result.referenceFrames, rate) << " s)\n";
+    stream << "candidate frames  " << result.candidateFrames << " (" << seconds(result.candidateFrames, rate) << " s)\n";
+    stream << "candidate offset  " << result.candidateOffset << " frames ("
+           << seconds(result.candidateOffset, rate) << " s)\n";
+    stream << "compared frames   " << result.comparedFrames << "\n";
+    if (result.hashMatchedFrames > 0)
+        stream << "hash-matched      " << result.hashMatchedFrames << " frames\n";
+    stream << "identical         " << (result.identical() ? "yes" : "no") << "\n";
+    stream << "differing samples " << overall.differingSamples << "\n";
+    stream << "peak difference   " << std::setprecision(9) << overall.peakDifference << std::setprecision(3);
+    if (overall.peakFrame >= 0)
+        stream << " at frame " << overall.peakFrame << " (" << seconds(overall.peakFrame, rate) << " s)";
+    stream << "\n";
+    stream << "difference rms    " << std::setprecision(9) << overall.differenceRms() << std::setprecision(3) << "\n";
+    stream << "null depth        " << overall.nullDepthDb() << " dB\n";
+    stream << "correlation       " << std::setprecision(9) << overall.correlation() << std::setprecision(3) << "\n";
+
+    for (std::size_t c = 0; c < result.channels.size(); ++c)
+        stream << "  channel " << c << "       null " << result.channels[c].nullDepthDb()
+               << " dB, peak " << std::setprecision(9) << result.channels[c].peakDifference
+               << std::setprecision(3) << "\n";
+
+    if (result.spectral.frames > 0) {
+        stream << "spectral frames   " << result.spectral.frames << "\n";
+        stream << "mean LSD          " << result.spectral.meanLogSpectralDistance() << " dB\n";
+        // No frame is recorded when every frame matched exactly.
+        stream << "max LSD           " << result.spectral.maxLogSpectralDistance << " dB";
+        if (result.spectral.maxDistanceFrame >= 0)
+            stream << " at frame " << result.spectral.maxDistanceFrame;
+        stream << "\n";
+        stream << "spectral error    " << result.spectral.spectralErrorDb() << " dB\n";
+    }
+}
+
+} // namespace audiocompare
@@ -0,0 +1,17 @@
+//
+//  ComparisonReport.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "StreamingComparator.hpp"
+
+#include <ostream>
+
+namespace audiocompare {
+
+/// Human-readable multi-line summary of a comparison.
+void writeReport(std::ostream& stream, const ComparisonResult& result);
+
+} // namespace audiocompare
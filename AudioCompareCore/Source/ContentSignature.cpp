@@ -0,0 +1,220 @@
+//
+//  ContentSignature.cpp
+//  AudioCompareCore
+//
+
+#include "ContentSignature.hpp"
+
+#include "BlockHash.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+namespace audiocompare {
+
+namespace {
+
+// Frames more than 50 dB below full scale carry no usable content.
+const float kSilenceDb = -50.0f;
+const std::size_t kStableFrames = 2;
+const std::size_t kShingleLength = 4;
+
+const std::size_t kMinHashBands = 16;
+const std::size_t kMinHashRows = ContentSignature::kMinHashCount / kMinHashBands;
+const std::size_t kSimHashBands = 4;
+const std::size_t kSimHashBits = 64 / kSimHashBands;
+// Keeps the bucket keys of the two families and of each band apart.
+const std::uint64_t kMinHashFamily = 0x4D696E48617368ULL;
+const std::uint64_t kSimHashFamily = 0x53696D48617368ULL;
+
+std::uint64_t permutationSeed(std::size_t index)
+{
+    return combineHashes(0x436F6E74656E74ULL, index);
+}
+
+/// Uniform in [-1, 1), the same on every platform.
+double hyperplaneCoefficient(std::size_t plane, std::size_t index)
+{
+    const std::uint64_t hash = combineHashes(combineHashes(kSimHashFamily, plane), index);
+    return static_cast<double>(hash >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+} // namespace
+
+ContentSignature computeSignature(const FrameFeatures& features)
+{
+    ContentSignature signature;
+    signature.minHash.fill(std::numeric_limits<std::uint32_t>::max());
+    const std::size_t coefficients = FrameFeatures::kMfccCoefficients;
+
+    // Dominant pitch class per audible frame. A class must hold for
+    // kStableFrames frames to count, which drops the mixtures of two notes
+    // at a change, and repeats are collapsed so tempo does not matter.
+    std::vector<std::uint32_t> notes;
+    std::uint32_t candidate = 0;
+    std::size_t held = 0;
+    for (std::size_t f = 0; f < features.frameCount; ++f) {
+        if (features.levelDb[f] < kSilenceDb) {
+            held = 0;
+            continue;
+        }
+        const float* chroma = &features.chroma[f * FrameFeatures::kChromaBins];
+        const auto dominant
+            = static_cast<std::uint32_t>(std::max_element(chroma, chroma + FrameFeatures::kChromaBins) - chroma);
+        held = dominant == candidate ? held + 1 : 1;
+        candidate = dominant;
+        if (held == kStableFrames && (notes.empty() || notes.back() != dominant))
+            notes.push_back(dominant);
+    }
+
+    std::uint64_t seeds[ContentSignature::kMinHashCount];
+    for (std::size_t k = 0; k < ContentSignature::kMinHashCount; ++k)
+        seeds[k] = permutationSeed(k);
+    for (std::size_t i = 0; i + kShingleLength <= notes.size(); ++i) {
+        std::uint64_t shingle = 0;
+        for (std::size_t n = 0; n < kShingleLength; ++n)
+            shingle = shingle * FrameFeatures::kChromaBins + notes[i + n];
+        for (std::size_t k = 0; k < ContentSignature::kMinHashCount; ++k) {
+            const auto value = static_cast<std::uint32_t>(combineHashes(seeds[k], shingle) >> 32);
+            signature.minHash[k] = std::min(signature.minHash[k], value);
+        }
+        signature.harmonic = true;
+    }
+
+    // Correlations between the cepstral coefficients 1 to 12 over the
+    // audible frames. An EQ adds a constant to each coefficient and tempo
+    // only reweights frames, so neither moves them much.
+    double mean[FrameFeatures::kMfccCoefficients] = {};
+    double products[FrameFeatures::kMfccCoefficients][FrameFeatures::kMfccCoefficients] = {};
+    std::size_t audible = 0;
+    for (std::size_t f = 0; f < features.frameCount; ++f) {
+        if (features.levelDb[f] < kSilenceDb)
+            continue;
+        const float* mfcc = &features.mfcc[f * coefficients];
+        for (std::size_t a = 1; a < coefficients; ++a) {
+            mean[a] += mfcc[a];
+            for (std::size_t b = a; b < coefficients; ++b)
+                products[a][b] += static_cast<double>(mfcc[a]) * mfcc[b];
+        }
+        ++audible;
+    }
+    if (audible < 2)
+        return signature;
+    signature.audible = true;
+
+    std::vector<double> correlations;
+    for (std::size_t a = 1; a < coefficients; ++a)
+        mean[a] /= static_cast<double>(audible);
+    for (std::size_t a = 1; a < coefficients; ++a) {
+        for (std::size_t b = a + 1; b < coefficients; ++b) {
+            const double covariance = products[a][b] / audible - mean[a] * mean[b];
+            const double varianceA = products[a][a] / audible - mean[a] * mean[a];
+            const double varianceB = products[b][b] / audible - mean[b] * mean[b];
+            const double denominator = std::sqrt(std::max(varianceA * varianceB, 0.0));
+            correlations.push_back(denominator > 0.0 ? covariance / denominator : 0.0);
+        }
+    }
+
+    // Charikar SimHash: bit k is the side of random hyperplane k, so the
+    // Hamming distance estimates the angle between correlation vectors.
+    for (std::size_t bit = 0; bit < 64; ++bit) {
+        double side = 0.0;
+        for (std::size_t i = 0; i < correlations.size(); ++i)
+            side += hyperplaneCoefficient(bit, i) * correlations[i];
+        if (side > 0.0)
+            signature.simHash |= std::uint64_t(1) << bit;
+    }
+    return signature;
+}
+
+double minHashSimilarity(const ContentSignature& a, const ContentSignature& b)
+{
+    if (!a.harmonic || !b.harmonic)
+        return std::numeric_limits<double>::quiet_NaN();
+    std::size_t equal = 0;
+    for (std::size_t k = 0; k < ContentSignature::kMinHashCount; ++k)
+        equal += a.minHash[k] == b.minHash[k];
+    return static_cast<double>(equal) / ContentSignature::kMinHashCount;
+}
+
+double simHashSimilarity(const ContentSignature& a, const ContentSignature& b)
+{
+    if (!a.audible || !b.audible)
+        return std::numeric_limits<double>::quiet_NaN();
+    std::uint64_t difference = a.simHash ^ b.simHash;
+    int distance = 0;
+    for (; difference != 0; difference &= difference - 1)
+        ++distance;
+    return 1.0 - distance / 64.0;
+}
+
+bool isNearDuplicate(const ContentSignature& a, const ContentSignature& b, const NearDuplicateOptions& options)
+{
+    const double harmony = minHashSimilarity(a, b);
+    const double timbre = simHashSimilarity(a, b);
+    if (std::isnan(harmony) && std::isnan(timbre))
+        return false;
+    // NaN compares false, so a test that does not apply never rejects.
+    return !(harmony < options.minMinHash) && !(timbre < options.minSimHash);
+}
+
+std::vector<std::uint64_t> LshIndex::bucketKeys(const ContentSignature& signature) const
+{
+    std::vector<std::uint64_t> keys;
+    keys.reserve(kMinHashBands + kSimHashBands);
+    for (std::size_t band = 0; band < kMinHashBands && signature.harmonic; ++band) {
+        std::uint64_t key = combineHashes(kMinHashFamily, band);
+        for (std::size_t row = 0; row < kMinHashRows; ++row)
+            key = combineHashes(key, signature.minHash[band * kMinHashRows + row]);
+        keys.push_back(key);
+    }
+    for (std::size_t band = 0; band < kSimHashBands && signature.audible; ++band) {
+        const std::uint64_t mask = (std::uint64_t(1) << kSimHashBits) - 1;
+        const std::uint64_t bits = (signature.simHash >> (band * kSimHashBits)) & mask;
+        keys.push_back(combineHashes(combineHashes(kSimHashFamily, band), bits));
+    }
+    return keys;
+}
+
+void LshIndex::add(std::uint32_t item, const ContentSignature& signature)
+{
+    for (const std::uint64_t key : bucketKeys(signature))
+        buckets_[key].push_back(item);
+}
+
+std::vector<std::uint32_t> LshIndex::candidates(const ContentSignature& signature) const
+{
+    std::vector<std::uint32_t> items;
+    for (const std::uint64_t key : bucketKeys(signature)) {
+        const auto bucket = buckets_.find(key);
+        if (bucket != buckets_.end())
+            items.insert(items.end(), bucket->second.begin(), bucket->second.end());
+    }
+    std::sort(items.begin(), items.end());
+    items.erase(std::unique(items.begin(), items.end()), items.end());
+    return items;
+}
+
+std::vector<std::pair<std::uint32_t, std::uint32_t>> LshIndex::candidatePairs() const
+{
+    std::unordered_set<std::uint64_t> seen;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs;
+    for (const auto& bucket : buckets_) {
+        const std::vector<std::uint32_t>& items = bucket.second;
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            for (std::size_t j = i + 1; j < items.size(); ++j) {
+                const std::uint32_t first = std::min(items[i], items[j]);
+                const std::uint32_t second = std::max(items[i], items[j]);
+                if (first != second && seen.insert((static_cast<std::uint64_t>(first) << 32) | second).second)
+                    pairs.emplace_back(first, second);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+} // namespace audiocompare
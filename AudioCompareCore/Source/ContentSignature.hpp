@@ -0,0 +1,88 @@
+//
+//  ContentSignature.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "FrameFeatures.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace audiocompare {
+
+/// Near-duplicate signature of a whole file.
+///
+/// `minHash` summarises the melody: the dominant pitch class of each frame,
+/// debounced and with repeats collapsed so tempo does not matter, is cut
+/// into overlapping 4-note shingles. Matching entries estimate the Jaccard
+/// similarity of the shingle sets, which survives EQ, re-encoding and small
+/// time-stretches.
+///
+/// `simHash` summarises the timbre: random hyperplanes split the
+/// correlations between MFCCs 1 to 12 over the file, so the Hamming
+/// distance tracks the angle between two files' correlation patterns. EQ
+/// and tempo barely move those correlations.
+struct ContentSignature {
+    static constexpr std::size_t kMinHashCount = 64;
+
+    std::array<std::uint32_t, kMinHashCount> minHash{};
+    std::uint64_t simHash = 0;
+    /// False when no frame was loud enough for a SimHash.
+    bool audible = false;
+    /// False when there were no chroma shingles for a MinHash.
+    bool harmonic = false;
+};
+
+ContentSignature computeSignature(const FrameFeatures& features);
+
+/// Estimated Jaccard similarity of the chroma shingles, 0 to 1. NaN when
+/// either file has no shingles: two files without a melody are not
+/// dissimilar, the test just does not apply.
+double minHashSimilarity(const ContentSignature& a, const ContentSignature& b);
+/// 1 - Hamming distance / 64 of the MFCC SimHashes. NaN when either file is
+/// silent.
+double simHashSimilarity(const ContentSignature& a, const ContentSignature& b);
+
+struct NearDuplicateOptions {
+    /// Least MinHash similarity: a shared melody.
+    double minMinHash = 0.125;
+    /// Least SimHash similarity: a shared timbre.
+    double minSimHash = 0.9;
+};
+
+/// True when every test that applies to the pair passes and at least one
+/// applies. Melody alone would match covers, timbre alone any two tracks
+/// from the same session, so neither is enough by itself.
+bool isNearDuplicate(const ContentSignature& a, const ContentSignature& b, const NearDuplicateOptions& options = {});
+
+/// Banded locality-sensitive hash over `ContentSignature`s. The MinHash is
+/// cut into 16 bands of 4 values, so pairs with a Jaccard similarity of 0.7
+/// collide in some band with probability 0.99, at 0.5 with 0.64 and at 0.1
+/// with 0.002; the SimHash into 4 bands of 16 bits, so any pair within 3
+/// bits shares a band while an unrelated pair does with probability 6e-5.
+/// Finding candidates touches only the colliding buckets, not every other
+/// item.
+class LshIndex {
+public:
+    /// Only the bands of the hashes the signature has are filed.
+    void add(std::uint32_t item, const ContentSignature& signature);
+
+    /// Items sharing at least one bucket with `signature`, ascending.
+    std::vector<std::uint32_t> candidates(const ContentSignature& signature) const;
+
+    /// Every colliding pair of added items, `first < second`, ascending.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> candidatePairs() const;
+
+private:
+    std::vector<std::uint64_t> bucketKeys(const ContentSignature& signature) const;
+
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> buckets_;
+};
+
+} // namespace audiocompare
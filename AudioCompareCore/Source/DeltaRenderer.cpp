@@ -0,0 +1,106 @@
+//
+//  DeltaRenderer.cpp
+//  AudioCompareCore
+//
+
+#include "DeltaRenderer.hpp"
+
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace audiocompare {
+
+namespace {
+
+const std::size_t kGainChunkFrames = 4096;
+
+} // namespace
+
+double estimateMatchingGain(AudioReader& reference, AudioReader& candidate,
+                            std::int64_t candidateOffset, std::size_t excerpts, double excerptSeconds)
+{
+    const AudioFormat format = reference.format();
+    const std::size_t channels = format.channelCount;
+    const std::int64_t referencePosition = reference.framePosition();
+    const std::int64_t candidatePosition = candidate.framePosition();
+    const std::int64_t referenceStart = referencePosition + std::max<std::int64_t>(-candidateOffset, 0);
+    const std::int64_t candidateStart = candidatePosition + std::max<std::int64_t>(candidateOffset, 0);
+    const std::int64_t excerptFrames =
+        std::max<std::int64_t>(static_cast<std::int64_t>(excerptSeconds * format.sampleRate), 1);
+
+    // Without known lengths only the start of the overlap can be measured.
+    std::int64_t overlap = excerptFrames * static_cast<std::int64_t>(excerpts);
+    if (reference.frameCount() >= 0 && candidate.frameCount() >= 0)
+        overlap = std::min(reference.frameCount() - referenceStart, candidate.frameCount() - candidateStart);
+    excerpts = std::max<std::size_t>(excerpts, 1);
+
+    FloatBuffers referenceChunk(channels, kGainChunkFrames);
+    FloatBuffers candidateChunk(channels, kGainChunkFrames);
+    double crossEnergy = 0.0;
+    double candidateEnergy = 0.0;
+    for (std::size_t e = 0; e < excerpts && overlap > 0; ++e) {
+        const std::int64_t length = std::min(excerptFrames, overlap);
+        const std::int64_t center = overlap * static_cast<std::int64_t>(2 * e + 1)
+                                    / static_cast<std::int64_t>(2 * excerpts);
+        const std::int64_t start = std::clamp<std::int64_t>(center - length / 2, 0, overlap - length);
+        reference.seekToFrame(referenceStart + start);
+        candidate.seekToFrame(candidateStart + start);
+        for (std::int64_t done = 0; done < length;) {
+            const std::size_t request = static_cast<std::size_t>(
+                std::min<std::int64_t>(static_cast<std::int64_t>(kGainChunkFrames), length - done));
+            const std::size_t frames = std::min(reference.readFrames(referenceChunk.data(), request),
+                                                candidate.readFrames(candidateChunk.data(), request));
+            if (frames == 0)
+                break;
+            for (std::size_t c = 0; c < channels; ++c) {
+                crossEnergy += dotProduct(referenceChunk.channel(c), candidateChunk.channel(c), frames);
+                candidateEnergy += dotProduct(candidateChunk.channel(c), candidateChunk.channel(c), frames);
+            }
+            done += static_cast<std::int64_t>(frames);
+        }
+    }
+
+    reference.seekToFrame(referencePosition);
+    candidate.seekToFrame(candidatePosition);
+    if (candidateEnergy <= 0.0 || !std::isfinite(crossEnergy / candidateEnergy))
+        return 1.0;
+    return crossEnergy / candidateEnergy;
+}
+
+DeltaRenderer::DeltaRenderer(WriteBehindWriter& output, std::size_t channelCount, float gain)
+    : output_(output)
+    , gain_(gain)
+    , delta_(channelCount, kGainChunkFrames)
+{
+}
+
+void DeltaRenderer::processBlock(const AudioBufferView& reference, const AudioBufferView& candidate,
+                                 std::int64_t position)
+{
+    const std::size_t channels = delta_.channelCount();
+    const std::size_t frames = reference.frames();
+    padTo(position);
+    if (frames > delta_.frameCount())
+        delta_.resize(channels, frames);
+    for (std::size_t c = 0; c < channels; ++c)
+        subtractScaled(reference.channel(c).data(), candidate.channel(c).data(), gain_, delta_.channel(c), frames);
+    output_.writeFrames(delta_.data(), frames);
+    framesWritten_ += static_cast<std::int64_t>(frames);
+}
+
+void DeltaRenderer::padTo(std::int64_t frames)
+{
+    if (frames <= framesWritten_)
+        return;
+    delta_.clear();
+    while (framesWritten_ < frames) {
+        const std::size_t gap = static_cast<std::size_t>(std::min<std::int64_t>(
+            static_cast<std::int64_t>(delta_.frameCount()), frames - framesWritten_));
+        output_.writeFrames(delta_.data(), gap);
+        framesWritten_ += static_cast<std::int64_t>(gap);
+    }
+}
+
+} // namespace audiocompare
@@ -0,0 +1,52 @@
+//
+//  DeltaRenderer.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioUtilities.hpp"
+#include "StreamingComparator.hpp"
+#include "WriteBehindWriter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audiocompare {
+
+/// Least-squares gain g minimizing |reference - g * candidate|^2, measured
+/// over `excerpts` excerpts of `excerptSeconds` spread across the overlap of
+/// the two streams once shifted by `candidateOffset`. Returns 1 when the
+/// candidate is silent there. Reader positions are restored.
+double estimateMatchingGain(AudioReader& reference, AudioReader& candidate,
+                            std::int64_t candidateOffset, std::size_t excerpts = 8,
+                            double excerptSeconds = 1.0);
+
+/// Null-test renderer: attached to a `StreamingComparator`, it writes
+/// reference - gain * candidate for every compared block through a
+/// `WriteBehindWriter`, so the difference file is produced during the same
+/// pass without waiting on the disk.
+class DeltaRenderer : public ComparisonObserver {
+public:
+    DeltaRenderer(WriteBehindWriter& output, std::size_t channelCount, float gain = 1.0f);
+
+    void processBlock(const AudioBufferView& reference, const AudioBufferView& candidate,
+                      std::int64_t position) override;
+
+    /// Writes silence up to `frames`, e.g. for hash-matched blocks after the
+    /// last compared one.
+    void padTo(std::int64_t frames);
+
+    float gain() const { return gain_; }
+    /// Frames skipped by `StreamingComparator::compareRanges` are written as
+    /// silence, so the output stays aligned with the reference.
+    std::int64_t framesWritten() const { return framesWritten_; }
+
+private:
+    WriteBehindWriter& output_;
+    float gain_;
+    FloatBuffers delta_;
+    std::int64_t framesWritten_ = 0;
+};
+
+} // namespace audiocompare
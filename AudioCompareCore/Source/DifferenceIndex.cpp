@@ -0,0 +1,270 @@
+//
+//  DifferenceIndex.cpp
+//  AudioCompareCore
+//
+
+#include "DifferenceIndex.hpp"
+
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const char kMagic[4] = {'A', 'C', 'D', 'I'};
+const std::uint32_t kVersion = 2;
+const std::size_t kHeaderBytes = 32 + 16 * DifferenceIndex::kLevelCount;
+const double kBaseCellSeconds = 0.01;
+// Children per cell: 100 x 10 ms = 1 s, 60 x 1 s = 1 min.
+const std::int64_t kLevelRatios[DifferenceIndex::kLevelCount] = {1, 100, 60};
+
+static_assert(sizeof(DifferenceCell) == 2 * sizeof(float), "cells are stored as two packed floats");
+
+bool hostIsLittleEndian()
+{
+    const std::uint16_t probe = 1;
+    unsigned char first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+void writeLE32(unsigned char* p, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void writeLE64(unsigned char* p, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+std::uint32_t readLE32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t readLE64(const unsigned char* p)
+{
+    return static_cast<std::uint64_t>(readLE32(p)) | (static_cast<std::uint64_t>(readLE32(p + 4)) << 32);
+}
+
+float metricValue(const DifferenceCell& cell, DifferenceMetric metric)
+{
+    return metric == DifferenceMetric::Residual ? cell.residualPower : cell.spectralDistance;
+}
+
+} // namespace
+
+DifferenceIndex DifferenceIndex::open(const std::string& path)
+{
+    if (!hostIsLittleEndian())
+        throw std::runtime_error("difference indexes need a little-endian host");
+    auto file = std::make_shared<const MappedFile>(path);
+    const unsigned char* data = file->data();
+    if (file->size() < kHeaderBytes || std::memcmp(data, kMagic, 4) != 0)
+        throw std::runtime_error(path + ": not a difference index");
+    if (readLE32(data + 4) != kVersion || readLE32(data + 16) != kLevelCount)
+        throw std::runtime_error(path + ": unsupported difference index version");
+
+    DifferenceIndex index;
+    const std::uint64_t rateBits = readLE64(data + 8);
+    std::memcpy(&index.sampleRate_, &rateBits, sizeof(rateBits));
+    index.originFrame_ = static_cast<std::int64_t>(readLE64(data + 24));
+    std::size_t offset = kHeaderBytes;
+    for (std::size_t l = 0; l < kLevelCount; ++l) {
+        DifferenceLevel& level = index.levels_[l];
+        level.cellFrames = static_cast<std::int64_t>(readLE64(data + 32 + 16 * l));
+        level.cellCount = static_cast<std::size_t>(readLE64(data + 40 + 16 * l));
+        if (level.cellFrames <= 0 || level.cellCount > (file->size() - offset) / sizeof(DifferenceCell))
+            throw std::runtime_error(path + ": truncated difference index");
+        level.cells = reinterpret_cast<const DifferenceCell*>(data + offset);
+        offset += level.cellCount * sizeof(DifferenceCell);
+    }
+    index.file_ = std::move(file);
+    return index;
+}
+
+void DifferenceIndex::write(const std::string& path) const
+{
+    if (!hostIsLittleEndian())
+        throw std::runtime_error("difference indexes need a little-endian host");
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("cannot create " + path);
+
+    unsigned char header[kHeaderBytes] = {};
+    std::uint64_t rateBits = 0;
+    std::memcpy(&rateBits, &sampleRate_, sizeof(rateBits));
+    std::memcpy(header, kMagic, 4);
+    writeLE32(header + 4, kVersion);
+    writeLE64(header + 8, rateBits);
+    writeLE32(header + 16, kLevelCount);
+    writeLE64(header + 24, static_cast<std::uint64_t>(originFrame_));
+    for (std::size_t l = 0; l < kLevelCount; ++l) {
+        writeLE64(header + 32 + 16 * l, static_cast<std::uint64_t>(levels_[l].cellFrames));
+        writeLE64(header + 40 + 16 * l, levels_[l].cellCount);
+    }
+
+    bool written = std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (std::size_t l = 0; l < kLevelCount && written; ++l)
+        written = std::fwrite(levels_[l].cells, sizeof(DifferenceCell), levels_[l].cellCount, file)
+                  == levels_[l].cellCount;
+    if (std::fclose(file) != 0 || !written)
+        throw std::runtime_error(path + ": write failed");
+}
+
+std::vector<DifferenceRegion> DifferenceIndex::worstRegions(std::size_t count, DifferenceMetric metric,
+                                                            std::size_t level) const
+{
+    if (level >= kLevelCount)
+        throw std::invalid_argument("no such difference index level");
+    const DifferenceLevel& cells = levels_[level];
+
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < cells.cellCount; ++i)
+        if (metricValue(cells.cells[i], metric) > 0.0f)
+            order.push_back(i);
+    count = std::min(count, order.size());
+    const auto worse = [&](std::size_t a, std::size_t b) {
+        return metricValue(cells.cells[a], metric) > metricValue(cells.cells[b], metric);
+    };
+    std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(count), order.end(), worse);
+
+    std::vector<DifferenceRegion> regions;
+    for (std::size_t r = 0; r < count; ++r) {
+        DifferenceRegion region;
+        region.level = level;
+        region.startFrame = originFrame_ + static_cast<std::int64_t>(order[r]) * cells.cellFrames;
+        region.frames = cells.cellFrames;
+        region.value = metricValue(cells.cells[order[r]], metric);
+
+        // Follow the maximum down to level 0.
+        std::size_t cell = order[r];
+        for (std::size_t l = level; l > 0; --l) {
+            const DifferenceLevel& finer = levels_[l - 1];
+            const std::size_t first = cell * static_cast<std::size_t>(kLevelRatios[l]);
+            const std::size_t last = std::min(first + static_cast<std::size_t>(kLevelRatios[l]), finer.cellCount);
+            cell = first;
+            for (std::size_t child = first + 1; child < last; ++child)
+                if (metricValue(finer.cells[child], metric) > metricValue(finer.cells[cell], metric))
+                    cell = child;
+        }
+        region.peakFrame = originFrame_ + static_cast<std::int64_t>(cell) * levels_[0].cellFrames;
+        regions.push_back(region);
+    }
+    return regions;
+}
+
+DifferenceIndexBuilder::DifferenceIndexBuilder(AudioFormat format)
+    : format_(format)
+    , cellFrames_(std::max<std::int64_t>(std::llround(format.sampleRate * kBaseCellSeconds), 1))
+{
+    if (format.channelCount == 0)
+        throw std::invalid_argument("difference index needs at least one channel");
+}
+
+void DifferenceIndexBuilder::processBlock(const AudioBufferView& reference, const AudioBufferView& candidate,
+                                          std::int64_t position)
+{
+    const std::size_t frames = reference.frames();
+    advanceTo(position);
+    if (difference_.size() < static_cast<std::size_t>(cellFrames_))
+        difference_.resize(static_cast<std::size_t>(cellFrames_));
+
+    for (std::size_t offset = 0; offset < frames;) {
+        const std::size_t count = static_cast<std::size_t>(
+            std::min<std::int64_t>(cellFrames_ - cellFill_, static_cast<std::int64_t>(frames - offset)));
+        for (std::size_t c = 0; c < format_.channelCount; ++c) {
+            subtractScaled(reference.channel(c).data() + offset, candidate.channel(c).data() + offset, 1.0f,
+                           difference_.data(), count);
+            cellEnergy_ += dotProduct(difference_.data(), difference_.data(), count);
+        }
+        cellFill_ += static_cast<std::int64_t>(count);
+        position_ += static_cast<std::int64_t>(count);
+        offset += count;
+        if (cellFill_ == cellFrames_)
+            closeCell();
+    }
+}
+
+void DifferenceIndexBuilder::processSpectralFrame(std::int64_t frameStart, std::size_t frameLength,
+                                                  double distance)
+{
+    const std::int64_t center = std::max<std::int64_t>(frameStart + static_cast<std::int64_t>(frameLength / 2), 0);
+    const std::size_t cell = static_cast<std::size_t>(center / cellFrames_);
+    if (cells_.size() <= cell)
+        cells_.resize(cell + 1);
+    cells_[cell].spectralDistance = std::max(cells_[cell].spectralDistance, static_cast<float>(distance));
+}
+
+DifferenceIndex DifferenceIndexBuilder::finish(std::int64_t totalFrames, std::int64_t originFrame)
+{
+    advanceTo(totalFrames);
+    if (cellFill_ > 0)
+        closeCell();
+
+    DifferenceIndex index;
+    index.sampleRate_ = format_.sampleRate;
+    index.originFrame_ = originFrame;
+    std::size_t counts[DifferenceIndex::kLevelCount];
+    std::int64_t cellFrames = cellFrames_;
+    counts[0] = cells_.size();
+    std::size_t total = counts[0];
+    for (std::size_t l = 1; l < DifferenceIndex::kLevelCount; ++l) {
+        counts[l] = (counts[l - 1] + static_cast<std::size_t>(kLevelRatios[l]) - 1)
+                    / static_cast<std::size_t>(kLevelRatios[l]);
+        total += counts[l];
+    }
+
+    index.storage_.resize(total);
+    std::copy(cells_.begin(), cells_.end(), index.storage_.begin());
+    std::size_t offset = 0;
+    for (std::size_t l = 0; l < DifferenceIndex::kLevelCount; ++l) {
+        cellFrames *= kLevelRatios[l];
+        DifferenceCell* level = index.storage_.data() + offset;
+        if (l > 0) {
+            const DifferenceCell* finer = index.storage_.data() + offset - counts[l - 1];
+            for (std::size_t i = 0; i < counts[l - 1]; ++i) {
+                DifferenceCell& cell = level[i / static_cast<std::size_t>(kLevelRatios[l])];
+                cell.residualPower = std::max(cell.residualPower, finer[i].residualPower);
+                cell.spectralDistance = std::max(cell.spectralDistance, finer[i].spectralDistance);
+            }
+        }
+        index.levels_[l] = DifferenceLevel{cellFrames, level, counts[l]};
+        offset += counts[l];
+    }
+    return index;
+}
+
+void DifferenceIndexBuilder::advanceTo(std::int64_t position)
+{
+    while (position_ < position) {
+        const std::int64_t count = std::min(cellFrames_ - cellFill_, position - position_);
+        cellFill_ += count;
+        position_ += count;
+        if (cellFill_ == cellFrames_)
+            closeCell();
+    }
+}
+
+void DifferenceIndexBuilder::closeCell()
+{
+    const std::size_t cell = static_cast<std::size_t>((position_ - 1) / cellFrames_);
+    if (cells_.size() <= cell)
+        cells_.resize(cell + 1);
+    cells_[cell].residualPower = static_cast<float>(
+        cellEnergy_ / static_cast<double>(cellFill_ * static_cast<std::int64_t>(format_.channelCount)));
+    cellEnergy_ = 0.0;
+    cellFill_ = 0;
+}
+
+} // namespace audiocompare
@@ -0,0 +1,120 @@
+//
+//  DifferenceIndex.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "ComparisonObserver.hpp"
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+struct DifferenceCell {
+    /// Mean squared sample difference over the cell (maximum of the finer
+    /// cells above level 0).
+    float residualPower = 0.0f;
+    /// Largest log-spectral distance of the analysis windows centred in it.
+    float spectralDistance = 0.0f;
+};
+
+enum class DifferenceMetric {
+    Residual,
+    Spectral,
+};
+
+struct DifferenceLevel {
+    std::int64_t cellFrames = 0;
+    const DifferenceCell* cells = nullptr;
+    std::size_t cellCount = 0;
+};
+
+struct DifferenceRegion {
+    std::size_t level = 0;
+    /// Reference frame where the region starts.
+    std::int64_t startFrame = 0;
+    std::int64_t frames = 0;
+    float value = 0.0f;
+    /// Reference frame where the worst level-0 cell inside the region starts.
+    std::int64_t peakFrame = 0;
+};
+
+/// Max pyramid of where two streams differ, a persisted and seekable take on
+/// `EZPlotHistoryInfo`: level 0 holds 10 ms cells, level 1 one-second cells
+/// and level 2 one-minute cells, each the maximum of its children. Cells
+/// count from `originFrame`, the reference frame the comparison started at.
+/// Opened files are memory-mapped, so a three-hour index is queried without
+/// reading it.
+class DifferenceIndex {
+public:
+    static constexpr std::size_t kLevelCount = 3;
+
+    DifferenceIndex() = default;
+    DifferenceIndex(DifferenceIndex&&) = default;
+    DifferenceIndex& operator=(DifferenceIndex&&) = default;
+    DifferenceIndex(const DifferenceIndex&) = delete;
+    DifferenceIndex& operator=(const DifferenceIndex&) = delete;
+
+    /// Throws std::runtime_error when the file is missing or malformed.
+    static DifferenceIndex open(const std::string& path);
+    /// Throws std::runtime_error on I/O errors.
+    void write(const std::string& path) const;
+
+    double sampleRate() const { return sampleRate_; }
+    std::int64_t originFrame() const { return originFrame_; }
+    std::size_t levelCount() const { return kLevelCount; }
+    const DifferenceLevel& level(std::size_t index) const { return levels_[index]; }
+
+    /// The `count` worst cells of `level` by `metric`, worst first, each
+    /// refined down to its worst 10 ms cell.
+    std::vector<DifferenceRegion> worstRegions(std::size_t count, DifferenceMetric metric,
+                                               std::size_t level = 1) const;
+
+private:
+    friend class DifferenceIndexBuilder;
+
+    double sampleRate_ = 0.0;
+    std::int64_t originFrame_ = 0;
+    DifferenceLevel levels_[kLevelCount];
+    std::vector<DifferenceCell> storage_;
+    std::shared_ptr<const MappedFile> file_;
+};
+
+/// Builds a `DifferenceIndex` from a running comparison; attach it with
+/// `StreamingComparator::setObserver`. Frames never reported (ranges
+/// skipped by the hash fast path) count as identical.
+class DifferenceIndexBuilder : public ComparisonObserver {
+public:
+    explicit DifferenceIndexBuilder(AudioFormat format);
+
+    void processBlock(const AudioBufferView& reference, const AudioBufferView& candidate,
+                      std::int64_t position) override;
+    void processSpectralFrame(std::int64_t frameStart, std::size_t frameLength,
+                              double distance) override;
+
+    /// Builds the coarser levels; `totalFrames` extends the index over
+    /// trailing frames that were never reported. `originFrame` is the
+    /// reference frame of position 0, `ComparisonResult::referenceStart`.
+    DifferenceIndex finish(std::int64_t totalFrames = 0, std::int64_t originFrame = 0);
+
+private:
+    void advanceTo(std::int64_t position);
+    void closeCell();
+
+    AudioFormat format_;
+    std::int64_t cellFrames_;
+    std::vector<DifferenceCell> cells_;
+    double cellEnergy_ = 0.0;
+    std::int64_t cellFill_ = 0;
+    std::int64_t position_ = 0;
+    std::vector<float> difference_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,164 @@
+//
+//  DriftEstimator.cpp
+//  AudioCompareCore
+//
+
+#include "DriftEstimator.hpp"
+
+#include "AudioUtilities.hpp"
+#include "ResamplingReader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+/// Search range of the refinement pass, which only has to absorb the error
+/// left by the coarse fit.
+const double kRefineSearchSeconds = 0.005;
+
+struct LineFit {
+    double start = 0.0;
+    double slope = 0.0;
+    double residualRms = 0.0;
+};
+
+LineFit fitLine(const std::vector<DriftSegment>& segments)
+{
+    LineFit fit;
+    const double count = static_cast<double>(segments.size());
+    double meanX = 0.0, meanY = 0.0;
+    for (const DriftSegment& segment : segments) {
+        meanX += static_cast<double>(segment.referenceFrame);
+        meanY += segment.offset;
+    }
+    meanX /= count;
+    meanY /= count;
+    double covariance = 0.0, variance = 0.0;
+    for (const DriftSegment& segment : segments) {
+        const double dx = static_cast<double>(segment.referenceFrame) - meanX;
+        covariance += dx * (segment.offset - meanY);
+        variance += dx * dx;
+    }
+    fit.slope = variance > 0.0 ? covariance / variance : 0.0;
+    fit.start = meanY - fit.slope * meanX;
+
+    double residual = 0.0;
+    for (const DriftSegment& segment : segments) {
+        const double error = segment.offset - (fit.start + fit.slope * static_cast<double>(segment.referenceFrame));
+        residual += error * error;
+    }
+    fit.residualRms = std::sqrt(residual / count);
+    return fit;
+}
+
+/// Measures the offset at `segmentCount` evenly spaced reference segments
+/// starting no earlier than `earliestStart`. Each search window is centred on
+/// the offset predicted by the segments measured so far, so accumulated drift
+/// never leaves the search range.
+std::vector<DriftSegment> measureSegments(AudioReader& reference, AudioReader& candidate,
+                                          double initialOffset, std::size_t segmentCount,
+                                          std::int64_t length, std::int64_t range,
+                                          std::int64_t earliestStart)
+{
+    const std::int64_t referenceFrames = reference.frameCount();
+    const std::int64_t candidateFrames = candidate.frameCount();
+    const std::int64_t offset = static_cast<std::int64_t>(std::llround(initialOffset));
+    const std::int64_t first = std::max<std::int64_t>(earliestStart, -offset);
+    const std::int64_t last = std::min(referenceFrames, candidateFrames - offset) - length;
+    if (last < first)
+        throw std::invalid_argument("files overlap too little for drift estimation");
+
+    std::vector<float> referenceSegment(static_cast<std::size_t>(length));
+    std::vector<float> candidateWindow(static_cast<std::size_t>(length + 2 * range));
+    std::vector<DriftSegment> segments;
+
+    for (std::size_t s = 0; s < segmentCount; ++s) {
+        const std::int64_t start = segmentCount == 1
+                                       ? first
+                                       : first + (last - first) * static_cast<std::int64_t>(s)
+                                                     / static_cast<std::int64_t>(segmentCount - 1);
+        double predicted = initialOffset;
+        if (segments.size() == 1) {
+            predicted = segments[0].offset;
+        } else if (segments.size() > 1) {
+            const LineFit fit = fitLine(segments);
+            predicted = fit.start + fit.slope * static_cast<double>(start + length / 2);
+        }
+        const std::int64_t centre = static_cast<std::int64_t>(std::llround(predicted));
+
+        readMono(reference, start, referenceSegment.size(), referenceSegment.data());
+        readMono(candidate, start + centre - range, candidateWindow.size(), candidateWindow.data());
+
+        DriftSegment segment;
+        segment.referenceFrame = start + length / 2;
+        segment.peak = gccPhat(referenceSegment.data(), referenceSegment.size(),
+                               candidateWindow.data(), candidateWindow.size(), 0, 2 * range,
+                               PeakInterpolation::Sinc);
+        segment.offset = static_cast<double>(centre - range) + segment.peak.fractionalLag;
+        segments.push_back(segment);
+    }
+    return segments;
+}
+
+} // namespace
+
+DriftEstimator::DriftEstimator(DriftOptions options)
+    : options_(options)
+{
+    if (options_.segments == 0 || options_.segmentSeconds <= 0.0 || options_.coarseSegmentSeconds <= 0.0
+        || options_.searchSeconds <= 0.0)
+        throw std::invalid_argument("invalid drift options");
+}
+
+DriftEstimate DriftEstimator::estimate(AudioReader& reference, AudioReader& candidate, double initialOffset)
+{
+    const double rate = reference.format().sampleRate;
+    if (rate != candidate.format().sampleRate)
+        throw std::invalid_argument("sample rates differ");
+    if (reference.frameCount() < 0 || candidate.frameCount() < 0)
+        throw std::invalid_argument("drift estimation needs readers of known length");
+
+    const std::int64_t referencePosition = reference.framePosition();
+    const std::int64_t candidatePosition = candidate.framePosition();
+    auto frames = [rate](double seconds) {
+        return std::max<std::int64_t>(std::llround(seconds * rate), 1);
+    };
+
+    // Coarse pass on short segments: drift smears a correlation peak by
+    // ratio error * segment length, so these stay sharp at tens of ppm.
+    const std::vector<DriftSegment> coarse = measureSegments(
+        reference, candidate, initialOffset, options_.segments,
+        frames(options_.coarseSegmentSeconds), frames(options_.searchSeconds), 0);
+    const LineFit coarseFit = fitLine(coarse);
+    const double coarseRatio = 1.0 + coarseFit.slope;
+
+    // Refinement pass on long segments of the candidate resampled with the
+    // coarse model, where only a tiny residual drift remains. Segments start
+    // where the resampler has real candidate material under its filter.
+    ResamplingReader resampled(candidate, coarseFit.start, coarseRatio);
+    DriftEstimate result;
+    result.segments = measureSegments(reference, resampled, 0.0, options_.segments,
+                                      frames(options_.segmentSeconds), frames(kRefineSearchSeconds),
+                                      ResamplingReader::firstSupportedFrame(coarseFit.start, coarseRatio)
+                                          + frames(kRefineSearchSeconds));
+    const LineFit refineFit = fitLine(result.segments);
+
+    // resampled[n] = candidate(start + ratio * n), and resampled[n + a + b n]
+    // matches reference[n], so the models compose as below.
+    result.start = coarseFit.start + coarseRatio * refineFit.start;
+    result.ratio = coarseRatio * (1.0 + refineFit.slope);
+    result.residualRms = refineFit.residualRms;
+    for (DriftSegment& segment : result.segments)
+        segment.offset = coarseFit.start + coarseRatio * (static_cast<double>(segment.referenceFrame) + segment.offset)
+                         - static_cast<double>(segment.referenceFrame);
+
+    reference.seekToFrame(referencePosition);
+    candidate.seekToFrame(candidatePosition);
+    return result;
+}
+
+} // namespace audiocompare
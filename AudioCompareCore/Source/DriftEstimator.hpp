@@ -0,0 +1,66 @@
+//
+//  DriftEstimator.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "OffsetFinder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+struct DriftOptions {
+    /// Matched segments spread evenly from the start to the end of the overlap.
+    std::size_t segments = 3;
+    /// Segment length of the coarse pass on the raw candidate; short enough
+    /// that drift does not smear the correlation peak.
+    double coarseSegmentSeconds = 1.0;
+    /// Segment length of the refinement pass on the resampled candidate.
+    double segmentSeconds = 10.0;
+    /// Coarse search range around the predicted offset at each segment.
+    double searchSeconds = 0.5;
+};
+
+struct DriftSegment {
+    /// Reference frame at the centre of the segment.
+    std::int64_t referenceFrame = 0;
+    /// Measured candidate - reference offset there, in frames (refinement pass).
+    double offset = 0.0;
+    CorrelationPeak peak;
+};
+
+/// Linear clock model: candidate frame = start + ratio * reference frame.
+struct DriftEstimate {
+    double start = 0.0;
+    double ratio = 1.0;
+    std::vector<DriftSegment> segments;
+    /// RMS distance of the measured offsets from the fitted line, in frames.
+    double residualRms = 0.0;
+
+    double ppm() const { return (ratio - 1.0) * 1e6; }
+};
+
+/// Measures the offset between two recordings at segments spread from start to
+/// end with GCC-PHAT and sub-sample peak interpolation, then least-squares
+/// fits a resampling ratio. A coarse pass on short segments is refined by a
+/// second pass over the candidate resampled with the coarse fit. Feed the
+/// result to `ResamplingReader` to compensate.
+class DriftEstimator {
+public:
+    explicit DriftEstimator(DriftOptions options = {});
+
+    /// `initialOffset` is the offset found at the start of the files (e.g. by
+    /// `AlignmentPyramid`).
+    /// Restores both readers' positions before returning.
+    DriftEstimate estimate(AudioReader& reference, AudioReader& candidate, double initialOffset);
+
+private:
+    DriftOptions options_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,213 @@
+//
+//  DtwAligner.cpp
+//  AudioCompareCore
+//
+
+#include "DtwAligner.hpp"
+
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+// Matches the signature code: frames this far below full scale are silence.
+const float kSilenceDb = -50.0f;
+const float kUnreachable = std::numeric_limits<float>::infinity();
+
+/// Rows of anti-diagonal `d` inside the band. With the band measured along
+/// the longer axis, the bounds move by at most one row per diagonal, which
+/// the sentinel cells in `align` rely on.
+struct DiagonalBounds {
+    std::int64_t first;
+    std::int64_t last;
+};
+
+class Band {
+public:
+    Band(std::int64_t rows, std::int64_t columns, std::int64_t width)
+        : rows_(rows)
+        , columns_(columns)
+        , width_(width)
+        , longer_(std::max<std::int64_t>({rows - 1, columns - 1, 1}))
+    {
+    }
+
+    DiagonalBounds bounds(std::int64_t d) const
+    {
+        // Cell (i, d - i) is in the band when
+        // |(d - i)(rows - 1) - i(columns - 1)| <= width * longer.
+        std::int64_t first = std::max<std::int64_t>(0, d - (columns_ - 1));
+        std::int64_t last = std::min(rows_ - 1, d);
+        const std::int64_t span = rows_ + columns_ - 2;
+        if (span > 0) {
+            const std::int64_t centre = d * (rows_ - 1);
+            const std::int64_t reach = width_ * longer_;
+            first = std::max(first, ceilDivide(centre - reach, span));
+            last = std::min(last, floorDivide(centre + reach, span));
+        }
+        return {first, last};
+    }
+
+private:
+    static std::int64_t floorDivide(std::int64_t a, std::int64_t b)
+    {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    static std::int64_t ceilDivide(std::int64_t a, std::int64_t b)
+    {
+        return -floorDivide(-a, b);
+    }
+
+    std::int64_t rows_;
+    std::int64_t columns_;
+    std::int64_t width_;
+    std::int64_t longer_;
+};
+
+} // namespace
+
+double DtwResult::meanCost() const
+{
+    return path.empty() ? 0.0 : totalCost / static_cast<double>(path.size());
+}
+
+std::vector<float> dtwFeatures(const FrameFeatures& features)
+{
+    std::vector<float> rows(features.frameCount * kDtwDimension, 0.0f);
+    for (std::size_t f = 0; f < features.frameCount; ++f) {
+        float* row = &rows[f * kDtwDimension];
+        const float* chroma = &features.chroma[f * FrameFeatures::kChromaBins];
+        double norm = 0.0;
+        for (std::size_t p = 0; p < FrameFeatures::kChromaBins; ++p)
+            norm += static_cast<double>(chroma[p]) * chroma[p];
+        if (features.levelDb[f] < kSilenceDb || norm <= 0.0) {
+            row[FrameFeatures::kChromaBins] = 1.0f;
+            continue;
+        }
+        const float scale = static_cast<float>(1.0 / std::sqrt(norm));
+        for (std::size_t p = 0; p < FrameFeatures::kChromaBins; ++p)
+            row[p] = chroma[p] * scale;
+    }
+    return rows;
+}
+
+DtwAligner::DtwAligner(std::size_t bandFrames)
+    : bandFrames_(std::max<std::size_t>(bandFrames, 1))
+{
+}
+
+DtwResult DtwAligner::align(const float* reference, std::size_t referenceFrames, const float* candidate,
+                            std::size_t candidateFrames, std::size_t dimension) const
+{
+    if (referenceFrames == 0 || candidateFrames == 0 || dimension == 0)
+        throw std::invalid_argument("DTW needs two non-empty sequences");
+    const auto rows = static_cast<std::int64_t>(referenceFrames);
+    const auto columns = static_cast<std::int64_t>(candidateFrames);
+    const Band band(rows, columns, static_cast<std::int64_t>(bandFrames_));
+    const std::int64_t diagonals = rows + columns - 1;
+
+    // Dimension-major copies: along an anti-diagonal the reference row
+    // rises and the candidate column falls, so the candidate is stored
+    // reversed and both operands of a dimension are contiguous.
+    std::vector<float> referenceByDimension(dimension * referenceFrames);
+    std::vector<float> candidateReversed(dimension * candidateFrames);
+    for (std::size_t f = 0; f < referenceFrames; ++f)
+        for (std::size_t k = 0; k < dimension; ++k)
+            referenceByDimension[k * referenceFrames + f] = reference[f * dimension + k];
+    for (std::size_t f = 0; f < candidateFrames; ++f)
+        for (std::size_t k = 0; k < dimension; ++k)
+            candidateReversed[k * candidateFrames + (candidateFrames - 1 - f)] = candidate[f * dimension + k];
+
+    // Three rotating anti-diagonals of accumulated cost. Slot 0 and the slot
+    // after the last cell hold infinity so the predecessors of edge cells
+    // read as unreachable.
+    const std::size_t capacity = 2 * bandFrames_ + 4;
+    std::vector<float> accumulated[3] = {std::vector<float>(capacity, kUnreachable),
+                                         std::vector<float>(capacity, kUnreachable),
+                                         std::vector<float>(capacity, kUnreachable)};
+    std::int64_t firstRow[3] = {0, 0, 0};
+    std::vector<float> similarity(capacity);
+    std::vector<float> cost(capacity);
+    std::vector<unsigned char> moves(capacity);
+
+    // 2-bit moves, packed in anti-diagonal order.
+    std::vector<std::uint64_t> diagonalStart(static_cast<std::size_t>(diagonals) + 1, 0);
+    std::vector<std::uint8_t> packed;
+
+    DtwResult result;
+    result.bandFrames = bandFrames_;
+    for (std::int64_t d = 0; d < diagonals; ++d) {
+        const DiagonalBounds bounds = band.bounds(d);
+        const std::size_t length = static_cast<std::size_t>(bounds.last - bounds.first + 1);
+        if (bounds.last < bounds.first || length + 2 > capacity)
+            throw std::logic_error("DTW band bounds out of range");
+
+        std::fill(similarity.begin(), similarity.begin() + static_cast<std::ptrdiff_t>(length), 0.0f);
+        const std::size_t candidateOffset = static_cast<std::size_t>(columns - 1 - d + bounds.first);
+        for (std::size_t k = 0; k < dimension; ++k)
+            multiplyAccumulate(&referenceByDimension[k * referenceFrames + static_cast<std::size_t>(bounds.first)],
+                               &candidateReversed[k * candidateFrames + candidateOffset], similarity.data(), length);
+        for (std::size_t c = 0; c < length; ++c)
+            cost[c] = std::max(0.0f, 1.0f - similarity[c]);
+
+        const int current = static_cast<int>(d % 3);
+        const int previous = static_cast<int>((d + 2) % 3);
+        const int beforePrevious = static_cast<int>((d + 1) % 3);
+        float* output = accumulated[current].data();
+        if (d == 0) {
+            output[1] = cost[0];
+            moves[0] = 0;
+        } else {
+            // Cell (i, j) reads (i - 1, j - 1), (i - 1, j) and (i, j - 1).
+            const float* diagonal = accumulated[beforePrevious].data() + (bounds.first - firstRow[beforePrevious]);
+            const float* up = accumulated[previous].data() + (bounds.first - firstRow[previous]);
+            const float* left = up + 1;
+            minPlusStep(cost.data(), diagonal, up, left, output + 1, moves.data(), length);
+        }
+        output[0] = kUnreachable;
+        output[length + 1] = kUnreachable;
+        firstRow[current] = bounds.first;
+
+        const std::uint64_t start = diagonalStart[static_cast<std::size_t>(d)];
+        diagonalStart[static_cast<std::size_t>(d) + 1] = start + length;
+        packed.resize(static_cast<std::size_t>((start + length + 3) / 4), 0);
+        for (std::size_t c = 0; c < length; ++c) {
+            const std::uint64_t cell = start + c;
+            packed[static_cast<std::size_t>(cell / 4)] |= static_cast<std::uint8_t>(moves[c] << (2 * (cell % 4)));
+        }
+        result.cellCount += length;
+        if (d == diagonals - 1)
+            result.totalCost = output[1];
+    }
+    if (!std::isfinite(result.totalCost))
+        throw std::logic_error("DTW band does not connect the end points");
+
+    std::int64_t i = rows - 1;
+    std::int64_t j = columns - 1;
+    for (;;) {
+        const float local = 1.0f - dotProduct(reference + i * static_cast<std::int64_t>(dimension),
+                                              candidate + j * static_cast<std::int64_t>(dimension), dimension);
+        result.path.push_back({static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(j), std::max(0.0f, local)});
+        if (i == 0 && j == 0)
+            break;
+        const std::int64_t d = i + j;
+        const std::uint64_t cell
+            = diagonalStart[static_cast<std::size_t>(d)] + static_cast<std::uint64_t>(i - band.bounds(d).first);
+        const unsigned move = (packed[static_cast<std::size_t>(cell / 4)] >> (2 * (cell % 4))) & 3u;
+        if (move != 2)
+            --i;
+        if (move != 1)
+            --j;
+    }
+    std::reverse(result.path.begin(), result.path.end());
+    return result;
+}
+
+} // namespace audiocompare
@@ -0,0 +1,62 @@
+//
+//  DtwAligner.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "FrameFeatures.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+struct DtwPathPoint {
+    std::uint32_t reference = 0;
+    std::uint32_t candidate = 0;
+    /// Local distance of the two frames, 0 (same) to 1 (unrelated).
+    float cost = 0.0f;
+};
+
+struct DtwResult {
+    double totalCost = 0.0;
+    /// Monotonic path from the first to the last frame of both sequences.
+    std::vector<DtwPathPoint> path;
+    std::size_t bandFrames = 0;
+    /// Cells evaluated inside the band.
+    std::uint64_t cellCount = 0;
+
+    double meanCost() const;
+};
+
+/// Frame-major DTW features of `features`: the unit-length chroma plus a
+/// thirteenth "silence" dimension, so silence matches silence and nothing
+/// else. Frames are `kDtwDimension` floats apart.
+constexpr std::size_t kDtwDimension = FrameFeatures::kChromaBins + 1;
+std::vector<float> dtwFeatures(const FrameFeatures& features);
+
+/// Dynamic time warping for performances and tempo-varied edits, where no
+/// fixed lag lines the two up. The search is limited to a Sakoe-Chiba band
+/// of `bandFrames` around the straight line between the first and last
+/// frame pairs. Cells are evaluated one anti-diagonal at a time, whose cells
+/// are independent, with the SIMD `multiplyAccumulate` and `minPlusStep`
+/// kernels. Only three anti-diagonals of cost are kept and the traceback is
+/// stored at 2 bits per cell, so an hour of 50 ms frames with a 5 s band
+/// needs under 4 MB of traceback.
+class DtwAligner {
+public:
+    explicit DtwAligner(std::size_t bandFrames);
+
+    /// `reference` and `candidate` hold `dimension` floats per frame, unit
+    /// length (or zero); the local distance is 1 - dot product. Throws
+    /// std::invalid_argument for empty sequences.
+    DtwResult align(const float* reference, std::size_t referenceFrames, const float* candidate,
+                    std::size_t candidateFrames, std::size_t dimension) const;
+
+private:
+    std::size_t bandFrames_;
+};
+
+} // namespace audiocompare
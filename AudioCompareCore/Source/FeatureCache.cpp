@@ -0,0 +1,569 @@
+//
+//  FeatureCache.cpp
+//  AudioCompareCore
+//
+
+#include "FeatureCache.hpp"
+
+#include "AudioUtilities.hpp"
+#include "BlockHash.hpp"
+#include "ParallelDecodeReader.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <climits>
+#include <cstdlib>
+#include <sys/stat.h>
+#else
+#include <filesystem>
+#endif
+
+namespace audiocompare {
+
+namespace {
+
+const char kMagic[4] = {'A', 'C', 'F', 'C'};
+const std::uint32_t kVersion = 1;
+// Bump whenever an extractor changes its output, so old entries stop
+// matching instead of returning stale features.
+const std::uint64_t kAnalysisVersion = 3;
+const char kIndexName[] = "index.txt";
+const char kEntryExtension[] = ".features";
+
+const std::size_t kReadFrames = 65536;
+const double kLoudnessSeconds = 0.1;
+// Keeps the loudness of digital silence finite (-200 dB).
+const double kPowerFloor = 1e-20;
+const std::size_t kWaveformLevels = 3;
+const std::size_t kWaveformFramesPerPoint[kWaveformLevels] = {256, 4096, 65536};
+
+enum Section {
+    kSummarySection,
+    kChromaSection,
+    kMfccSection,
+    kLevelSection,
+    kLoudnessSection,
+    kLandmarkSection,
+    kWaveformSection,
+    kSectionCount = kWaveformSection + kWaveformLevels
+};
+
+// Magic, version, content and parameter hashes, sample rate, channels,
+// frames, frame and loudness periods, then an (offset, count) pair per
+// section and the waveform zoom levels.
+const std::size_t kSectionTableOffset = 64;
+const std::size_t kWaveformTableOffset = kSectionTableOffset + 16 * kSectionCount;
+const std::size_t kHeaderBytes = kWaveformTableOffset + 8 * kWaveformLevels;
+
+bool hostIsLittleEndian()
+{
+    const std::uint16_t probe = 1;
+    unsigned char first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+void writeLE32(unsigned char* p, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void writeLE64(unsigned char* p, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+std::uint32_t readLE32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t readLE64(const unsigned char* p)
+{
+    return static_cast<std::uint64_t>(readLE32(p)) | (static_cast<std::uint64_t>(readLE32(p + 4)) << 32);
+}
+
+std::uint64_t doubleBits(double value)
+{
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bitsToDouble(std::uint64_t bits)
+{
+    double value = 0.0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::size_t alignTo8(std::size_t value)
+{
+    return (value + 7) & ~static_cast<std::size_t>(7);
+}
+
+std::string hex(std::uint64_t value)
+{
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016" PRIx64, value);
+    return text;
+}
+
+/// Size and modification time of `path`, or false when it cannot be read.
+bool statFile(const std::string& path, std::uint64_t& size, std::int64_t& modified)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+        return false;
+    size = static_cast<std::uint64_t>(info.st_size);
+#if defined(__APPLE__)
+    modified = static_cast<std::int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    modified = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    return true;
+#else
+    std::error_code error;
+    size = static_cast<std::uint64_t>(std::filesystem::file_size(path, error));
+    if (error)
+        return false;
+    modified = static_cast<std::int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    return !error;
+#endif
+}
+
+/// Resolves `path` to an absolute path without symbolic links, so "a.wav",
+/// "./a.wav" and a link to it share one index line. Empty when the file does
+/// not exist.
+std::string canonicalPath(const std::string& path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    char resolved[PATH_MAX];
+    if (!::realpath(path.c_str(), resolved))
+        return std::string();
+    return resolved;
+#else
+    std::error_code error;
+    const std::filesystem::path resolved = std::filesystem::canonical(path, error);
+    return error ? std::string() : resolved.string();
+#endif
+}
+
+void writeIndexLine(std::FILE* index, const std::string& path, std::uint64_t size, std::int64_t modified,
+                    std::uint64_t contentHash)
+{
+    std::fprintf(index, "%" PRIu64 "\t%" PRId64 "\t%s\t%s\n", size, modified, hex(contentHash).c_str(), path.c_str());
+}
+
+/// The analysis results of one decode, in the order they are written.
+struct Analysis {
+    AudioFormat format;
+    std::uint64_t frameCount = 0;
+    std::uint64_t contentHash = 0;
+    std::vector<float> summary;
+    FrameFeatures frames;
+    std::vector<float> loudness;
+    std::vector<Landmark> landmarks;
+    std::vector<float> waveform[kWaveformLevels];
+};
+
+/// Merges runs of `factor` min/max pairs into one.
+std::vector<float> coarsen(const std::vector<float>& minMax, std::size_t factor)
+{
+    std::vector<float> coarse;
+    for (std::size_t i = 0; i < minMax.size(); i += 2 * factor) {
+        const std::size_t end = std::min(minMax.size(), i + 2 * factor);
+        float low = minMax[i];
+        float high = minMax[i + 1];
+        for (std::size_t j = i + 2; j < end; j += 2) {
+            low = std::min(low, minMax[j]);
+            high = std::max(high, minMax[j + 1]);
+        }
+        coarse.push_back(low);
+        coarse.push_back(high);
+    }
+    return coarse;
+}
+
+/// Reads until `buffer` is full or the reader ends, so blocks do not depend
+/// on how the reader chunks its output.
+AudioBufferView readBlock(AudioReader& reader, FloatBuffers& buffer, std::vector<float*>& pointers)
+{
+    std::size_t filled = 0;
+    while (filled < buffer.frameCount()) {
+        for (std::size_t c = 0; c < buffer.channelCount(); ++c)
+            pointers[c] = buffer.channel(c) + filled;
+        const std::size_t read = reader.readFrames(pointers.data(), buffer.frameCount() - filled);
+        if (read == 0)
+            break;
+        filled += read;
+    }
+    return buffer.view(0, filled);
+}
+
+Analysis runExtractors(AudioReader& reader, const FeatureOptions& options)
+{
+    Analysis analysis;
+    const AudioFormat format = reader.format();
+    analysis.format = format;
+    FeatureSummaryExtractor summary(format.sampleRate, options);
+    FrameFeatureExtractor frames(format.sampleRate);
+    LandmarkExtractor landmarks(format.sampleRate);
+
+    const auto loudnessFrames = static_cast<std::size_t>(std::lround(format.sampleRate * kLoudnessSeconds));
+    double loudnessPower = 0.0;
+    std::size_t loudnessFilled = 0;
+    const double loudnessScale = 1.0 / static_cast<double>(std::max<std::size_t>(1, format.channelCount));
+    std::vector<float>& finest = analysis.waveform[0];
+    std::size_t pointFilled = 0;
+
+    analysis.contentHash = combineHashes(doubleBits(format.sampleRate), format.channelCount);
+    std::vector<float> mono(kReadFrames);
+    // Whole blocks until the end of the file, so the content hash does not
+    // depend on how the reader chunks the data.
+    FloatBuffers buffer(format.channelCount, kReadFrames);
+    std::vector<float*> pointers(format.channelCount);
+    for (AudioBufferView block = readBlock(reader, buffer, pointers); !block.empty();
+         block = readBlock(reader, buffer, pointers)) {
+        const std::size_t read = block.frames();
+        analysis.contentHash = combineHashes(analysis.contentHash, hashBlock(block));
+        analysis.frameCount += read;
+        mixToMono(block, mono.data());
+        const ChannelView monoView(mono.data(), read);
+        summary.process(monoView);
+        frames.process(monoView);
+        landmarks.process(monoView);
+
+        for (std::size_t i = 0; i < read; ++i) {
+            for (std::size_t c = 0; c < format.channelCount; ++c)
+                loudnessPower += static_cast<double>(block.channel(c)[i]) * block.channel(c)[i];
+            if (++loudnessFilled == loudnessFrames) {
+                analysis.loudness.push_back(static_cast<float>(
+                    decibels(loudnessPower * loudnessScale / static_cast<double>(loudnessFilled) + kPowerFloor)));
+                loudnessPower = 0.0;
+                loudnessFilled = 0;
+            }
+
+            const float value = mono[i];
+            if (pointFilled == 0) {
+                finest.push_back(value);
+                finest.push_back(value);
+            } else {
+                finest[finest.size() - 2] = std::min(finest[finest.size() - 2], value);
+                finest.back() = std::max(finest.back(), value);
+            }
+            if (++pointFilled == kWaveformFramesPerPoint[0])
+                pointFilled = 0;
+        }
+    }
+    if (loudnessFilled > 0)
+        analysis.loudness.push_back(static_cast<float>(
+            decibels(loudnessPower * loudnessScale / static_cast<double>(loudnessFilled) + kPowerFloor)));
+    for (std::size_t level = 1; level < kWaveformLevels; ++level)
+        analysis.waveform[level] = coarsen(finest, kWaveformFramesPerPoint[level] / kWaveformFramesPerPoint[0]);
+
+    analysis.summary = summary.finish();
+    analysis.frames = frames.finish();
+    analysis.landmarks = landmarks.finish();
+    return analysis;
+}
+
+void writeEntry(const std::string& path, const Analysis& analysis, std::uint64_t parameterHash)
+{
+    struct Source {
+        const void* data;
+        std::size_t count;
+        std::size_t width;
+    };
+    Source sources[kSectionCount] = {
+        {analysis.summary.data(), analysis.summary.size(), sizeof(float)},
+        {analysis.frames.chroma.data(), analysis.frames.chroma.size(), sizeof(float)},
+        {analysis.frames.mfcc.data(), analysis.frames.mfcc.size(), sizeof(float)},
+        {analysis.frames.levelDb.data(), analysis.frames.levelDb.size(), sizeof(float)},
+        {analysis.loudness.data(), analysis.loudness.size(), sizeof(float)},
+        {analysis.landmarks.data(), analysis.landmarks.size(), sizeof(Landmark)},
+    };
+    for (std::size_t level = 0; level < kWaveformLevels; ++level)
+        sources[kWaveformSection + level]
+            = {analysis.waveform[level].data(), analysis.waveform[level].size() / 2, 2 * sizeof(float)};
+
+    std::size_t offsets[kSectionCount];
+    std::size_t size = kHeaderBytes;
+    for (std::size_t s = 0; s < kSectionCount; ++s) {
+        offsets[s] = size;
+        size = alignTo8(size + sources[s].count * sources[s].width);
+    }
+
+    MappedOutputFile file(path, size);
+    unsigned char* data = file.data();
+    std::memset(data, 0, kHeaderBytes);
+    std::memcpy(data, kMagic, 4);
+    writeLE32(data + 4, kVersion);
+    writeLE64(data + 8, analysis.contentHash);
+    writeLE64(data + 16, parameterHash);
+    writeLE64(data + 24, doubleBits(analysis.format.sampleRate));
+    writeLE64(data + 32, analysis.format.channelCount);
+    writeLE64(data + 40, analysis.frameCount);
+    writeLE64(data + 48, doubleBits(analysis.frames.frameSeconds));
+    writeLE64(data + 56, doubleBits(static_cast<double>(std::lround(analysis.format.sampleRate * kLoudnessSeconds))
+                                    / analysis.format.sampleRate));
+    for (std::size_t s = 0; s < kSectionCount; ++s) {
+        writeLE64(data + kSectionTableOffset + 16 * s, offsets[s]);
+        writeLE64(data + kSectionTableOffset + 16 * s + 8, sources[s].count);
+        if (sources[s].count > 0)
+            std::memcpy(data + offsets[s], sources[s].data, sources[s].count * sources[s].width);
+    }
+    for (std::size_t level = 0; level < kWaveformLevels; ++level)
+        writeLE64(data + kWaveformTableOffset + 8 * level, kWaveformFramesPerPoint[level]);
+    file.close();
+}
+
+} // namespace
+
+CachedFeatures CachedFeatures::open(const std::string& path)
+{
+    if (!hostIsLittleEndian())
+        throw std::runtime_error("feature caches need a little-endian host");
+    auto file = std::make_shared<const MappedFile>(path);
+    const unsigned char* data = file->data();
+    const std::size_t size = file->size();
+    if (size < kHeaderBytes || std::memcmp(data, kMagic, 4) != 0)
+        throw std::runtime_error(path + ": not a feature cache entry");
+    if (readLE32(data + 4) != kVersion)
+        throw std::runtime_error(path + ": unsupported feature cache version");
+
+    CachedFeatures features;
+    features.contentHash_ = readLE64(data + 8);
+    features.parameterHash_ = readLE64(data + 16);
+    features.sampleRate_ = bitsToDouble(readLE64(data + 24));
+    features.channelCount_ = static_cast<std::size_t>(readLE64(data + 32));
+    features.frameCount_ = readLE64(data + 40);
+    features.frameSeconds_ = bitsToDouble(readLE64(data + 48));
+    features.loudnessSeconds_ = bitsToDouble(readLE64(data + 56));
+
+    const void* sections[kSectionCount];
+    std::size_t counts[kSectionCount];
+    for (std::size_t s = 0; s < kSectionCount; ++s) {
+        const std::size_t width = s >= kWaveformSection ? 2 * sizeof(float)
+                                  : s == kLandmarkSection ? sizeof(Landmark)
+                                                          : sizeof(float);
+        const auto offset = static_cast<std::size_t>(readLE64(data + kSectionTableOffset + 16 * s));
+        counts[s] = static_cast<std::size_t>(readLE64(data + kSectionTableOffset + 16 * s + 8));
+        if (offset > size || counts[s] > (size - offset) / width || offset % 4 != 0)
+            throw std::runtime_error(path + ": truncated feature cache entry");
+        sections[s] = data + offset;
+    }
+    features.frameFeatureCount_ = counts[kLevelSection];
+    if (counts[kChromaSection] != features.frameFeatureCount_ * FrameFeatures::kChromaBins
+        || counts[kMfccSection] != features.frameFeatureCount_ * FrameFeatures::kMfccCoefficients)
+        throw std::runtime_error(path + ": inconsistent feature cache entry");
+
+    features.summary_ = static_cast<const float*>(sections[kSummarySection]);
+    features.summaryDimension_ = counts[kSummarySection];
+    features.chroma_ = static_cast<const float*>(sections[kChromaSection]);
+    features.mfcc_ = static_cast<const float*>(sections[kMfccSection]);
+    features.levelDb_ = static_cast<const float*>(sections[kLevelSection]);
+    features.loudness_ = static_cast<const float*>(sections[kLoudnessSection]);
+    features.loudnessCount_ = counts[kLoudnessSection];
+    features.landmarks_ = static_cast<const Landmark*>(sections[kLandmarkSection]);
+    features.landmarkCount_ = counts[kLandmarkSection];
+    for (std::size_t level = 0; level < kWaveformLevels; ++level) {
+        WaveformLevel waveform;
+        waveform.framesPerPoint = static_cast<std::size_t>(readLE64(data + kWaveformTableOffset + 8 * level));
+        waveform.pointCount = counts[kWaveformSection + level];
+        waveform.minMax = static_cast<const float*>(sections[kWaveformSection + level]);
+        features.waveform_.push_back(waveform);
+    }
+    features.file_ = std::move(file);
+    return features;
+}
+
+FrameFeatures CachedFeatures::frameFeatures() const
+{
+    FrameFeatures features;
+    features.frameCount = frameFeatureCount_;
+    features.frameSeconds = frameSeconds_;
+    features.chroma.assign(chroma_, chroma_ + frameFeatureCount_ * FrameFeatures::kChromaBins);
+    features.mfcc.assign(mfcc_, mfcc_ + frameFeatureCount_ * FrameFeatures::kMfccCoefficients);
+    features.levelDb.assign(levelDb_, levelDb_ + frameFeatureCount_);
+    return features;
+}
+
+FeatureCache::FeatureCache(std::string directory, const FeatureOptions& options,
+                           ParallelDecodeOptions decodeOptions)
+    : directory_(std::move(directory))
+    , options_(options)
+    , decodeOptions_(std::move(decodeOptions))
+{
+    if (!directory_.empty() && directory_.back() != '/')
+        directory_ += '/';
+    const std::uint64_t parameters[] = {
+        kAnalysisVersion, options.fftSize, options.bandCount,
+        doubleBits(kLoudnessSeconds), kWaveformFramesPerPoint[0], kWaveformFramesPerPoint[1],
+        kWaveformFramesPerPoint[2],
+    };
+    parameterHash_ = hashBytes(parameters, sizeof(parameters));
+
+    // One line per path: size, modification time, content hash, path. Later
+    // lines supersede earlier ones.
+    std::FILE* index = std::fopen((directory_ + kIndexName).c_str(), "r");
+    if (!index)
+        return;
+    char line[8192];
+    std::size_t lines = 0;
+    while (std::fgets(line, sizeof(line), index)) {
+        std::size_t length = std::strlen(line);
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+        ++lines;
+        Identity identity;
+        int pathStart = 0;
+        if (std::sscanf(line, "%" SCNu64 "\t%" SCNd64 "\t%" SCNx64 "\t%n", &identity.size, &identity.modified,
+                        &identity.contentHash, &pathStart)
+                == 3
+            && pathStart > 0 && line[pathStart] != '\0')
+            index_[line + pathStart] = identity;
+    }
+    std::fclose(index);
+
+    // Keep only lines that can still hit: the file exists under its
+    // canonical path, unchanged since it was analysed. Older indexes hold raw
+    // paths, which canonicalise here.
+    std::map<std::string, Identity> live;
+    for (const auto& entry : index_) {
+        const std::string path = canonicalPath(entry.first);
+        Identity current;
+        if (!path.empty() && statFile(path, current.size, current.modified) && current.size == entry.second.size
+            && current.modified == entry.second.modified)
+            live[path] = entry.second;
+    }
+    index_.swap(live);
+    if (index_.size() < lines)
+        compactIndex();
+}
+
+void FeatureCache::compactIndex()
+{
+    // Rewrite under a unique name and rename, as entries are. A line another
+    // process appends meanwhile is lost, which only costs it a re-decode.
+    const std::string path = directory_ + kIndexName;
+    const std::string temporary = path + ".tmp" + hex(combineHashes(std::random_device()(), index_.size()));
+    std::FILE* index = std::fopen(temporary.c_str(), "w");
+    if (!index)
+        return;
+    for (const auto& entry : index_)
+        writeIndexLine(index, entry.first, entry.second.size, entry.second.modified, entry.second.contentHash);
+    if (std::fclose(index) != 0 || std::rename(temporary.c_str(), path.c_str()) != 0)
+        std::remove(temporary.c_str());
+}
+
+std::string FeatureCache::entryPath(std::uint64_t contentHash) const
+{
+    return directory_ + hex(contentHash) + "-" + hex(parameterHash_) + kEntryExtension;
+}
+
+bool FeatureCache::tryOpen(std::uint64_t contentHash, CachedFeatures& features) const
+{
+    std::uint64_t size = 0;
+    std::int64_t modified = 0;
+    const std::string path = entryPath(contentHash);
+    if (!statFile(path, size, modified))
+        return false;
+    try {
+        CachedFeatures candidate = CachedFeatures::open(path);
+        if (candidate.contentHash() != contentHash || candidate.parameterHash_ != parameterHash_)
+            return false;
+        features = std::move(candidate);
+        return true;
+    } catch (const std::runtime_error&) {
+        // A damaged entry is rebuilt.
+        return false;
+    }
+}
+
+CachedFeatures FeatureCache::open(const std::string& file)
+{
+    const std::string path = canonicalPath(file);
+    Identity identity;
+    if (path.empty() || !statFile(path, identity.size, identity.modified))
+        throw std::runtime_error("cannot open " + file);
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto found = index_.find(path);
+        if (found != index_.end() && found->second.size == identity.size
+            && found->second.modified == identity.modified) {
+            identity.contentHash = found->second.contentHash;
+            known = true;
+        }
+    }
+    CachedFeatures features;
+    if (known && tryOpen(identity.contentHash, features)) {
+        hits_.fetch_add(1);
+        return features;
+    }
+
+    misses_.fetch_add(1);
+    identity.contentHash = analyse(path);
+    remember(path, identity);
+    if (!tryOpen(identity.contentHash, features))
+        throw std::runtime_error(path + ": cannot open its feature cache entry");
+    return features;
+}
+
+std::uint64_t FeatureCache::analyse(const std::string& path)
+{
+    const std::unique_ptr<AudioReader> reader = openAudioFile(path, decodeOptions_);
+    const Analysis analysis = runExtractors(*reader, options_);
+    CachedFeatures existing;
+    if (tryOpen(analysis.contentHash, existing))
+        return analysis.contentHash;
+
+    // Write under a unique name and rename, so readers never see a partial
+    // entry and concurrent writers of the same content do not collide.
+    const std::string entry = entryPath(analysis.contentHash);
+    const std::uint64_t salt = combineHashes(std::random_device()(), hashBytes(path.data(), path.size()));
+    const std::string temporary = entry + ".tmp" + hex(salt);
+    try {
+        writeEntry(temporary, analysis, parameterHash_);
+    } catch (...) {
+        std::remove(temporary.c_str());
+        throw;
+    }
+    if (std::rename(temporary.c_str(), entry.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        if (!tryOpen(analysis.contentHash, existing))
+            throw std::runtime_error("cannot create " + entry);
+    }
+    return analysis.contentHash;
+}
+
+void FeatureCache::remember(const std::string& path, const Identity& identity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_[path] = identity;
+    if (path.find('\n') != std::string::npos)
+        return;
+    // One short append per line, so concurrent processes interleave whole
+    // lines. A lost line only costs a re-decode.
+    std::FILE* index = std::fopen((directory_ + kIndexName).c_str(), "a");
+    if (!index)
+        throw std::runtime_error("cannot write " + directory_ + kIndexName);
+    writeIndexLine(index, path, identity.size, identity.modified, identity.contentHash);
+    std::fclose(index);
+}
+
+} // namespace audiocompare
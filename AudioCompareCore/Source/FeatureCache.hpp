@@ -0,0 +1,150 @@
+//
+//  FeatureCache.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioFeatures.hpp"
+#include "Fingerprint.hpp"
+#include "FrameFeatures.hpp"
+#include "MappedFile.hpp"
+#include "ParallelDecodeReader.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+/// Min/max envelope of the mono downmix at one zoom level, the data behind
+/// `EZAudioFile getWaveformDataWithNumberOfPoints:`. Point `i` covers frames
+/// [i * framesPerPoint, (i + 1) * framesPerPoint) and is stored as the pair
+/// minMax[2 * i], minMax[2 * i + 1].
+struct WaveformLevel {
+    std::size_t framesPerPoint = 0;
+    std::size_t pointCount = 0;
+    const float* minMax = nullptr;
+};
+
+/// Everything the analysis tools derive from one decoded file, read straight
+/// from a memory-mapped cache entry. Move-only; the pointers stay valid while
+/// the object lives.
+class CachedFeatures {
+public:
+    CachedFeatures() = default;
+    CachedFeatures(CachedFeatures&&) = default;
+    CachedFeatures& operator=(CachedFeatures&&) = default;
+    CachedFeatures(const CachedFeatures&) = delete;
+    CachedFeatures& operator=(const CachedFeatures&) = delete;
+
+    /// Throws std::runtime_error when the file is missing or malformed.
+    static CachedFeatures open(const std::string& path);
+
+    double sampleRate() const { return sampleRate_; }
+    std::size_t channelCount() const { return channelCount_; }
+    std::uint64_t frameCount() const { return frameCount_; }
+    /// Hash of the decoded PCM, independent of the container it came from.
+    std::uint64_t contentHash() const { return contentHash_; }
+
+    /// The `extractFeatures` vector, `summaryDimension()` floats.
+    const float* summary() const { return summary_; }
+    std::size_t summaryDimension() const { return summaryDimension_; }
+
+    /// A copy of the `extractFrameFeatures` result.
+    FrameFeatures frameFeatures() const;
+
+    /// RMS level over all channels in dBFS, one value per `loudnessSeconds()`.
+    const float* loudnessDb() const { return loudness_; }
+    std::size_t loudnessCount() const { return loudnessCount_; }
+    double loudnessSeconds() const { return loudnessSeconds_; }
+
+    /// The `extractLandmarks` result, in frame order.
+    const Landmark* landmarks() const { return landmarks_; }
+    std::size_t landmarkCount() const { return landmarkCount_; }
+
+    /// Waveform envelopes, finest first.
+    std::size_t waveformLevelCount() const { return waveform_.size(); }
+    const WaveformLevel& waveformLevel(std::size_t level) const { return waveform_[level]; }
+
+private:
+    friend class FeatureCache;
+
+    std::shared_ptr<const MappedFile> file_;
+    double sampleRate_ = 0.0;
+    std::size_t channelCount_ = 0;
+    std::uint64_t frameCount_ = 0;
+    std::uint64_t contentHash_ = 0;
+    std::uint64_t parameterHash_ = 0;
+    const float* summary_ = nullptr;
+    std::size_t summaryDimension_ = 0;
+    double frameSeconds_ = 0.0;
+    std::size_t frameFeatureCount_ = 0;
+    const float* chroma_ = nullptr;
+    const float* mfcc_ = nullptr;
+    const float* levelDb_ = nullptr;
+    const float* loudness_ = nullptr;
+    std::size_t loudnessCount_ = 0;
+    double loudnessSeconds_ = 0.0;
+    const Landmark* landmarks_ = nullptr;
+    std::size_t landmarkCount_ = 0;
+    std::vector<WaveformLevel> waveform_;
+};
+
+/// On-disk cache of `CachedFeatures`, one entry per distinct decoded PCM
+/// stream and analysis configuration. Entries are named after a hash of the
+/// samples plus a hash of the parameters, so renamed or re-wrapped copies of
+/// a file share one entry and a parameter change never returns stale data.
+///
+/// A small index in the cache directory maps each path, size and
+/// modification time to its content hash, so opening a known file costs one
+/// mmap instead of a decode. Paths are canonicalised first, and the index is
+/// compacted on load to the lines that can still match. A miss decodes the
+/// file once and feeds every extractor from the same blocks. Safe to use from
+/// several threads; several processes may share a directory, since entries
+/// are written to a temporary file and renamed into place.
+class FeatureCache {
+public:
+    /// `directory` must exist. Throws std::runtime_error when its index
+    /// cannot be read. Files are opened with `openAudioFile` and
+    /// `decodeOptions`.
+    explicit FeatureCache(std::string directory, const FeatureOptions& options = {},
+                          ParallelDecodeOptions decodeOptions = {});
+
+    /// Opens the features of the WAVE, AIFF or CAF file at `path`, which may
+    /// be compressed, analysing it on a miss. Throws std::runtime_error on
+    /// I/O errors.
+    CachedFeatures open(const std::string& path);
+
+    std::size_t hits() const { return hits_.load(); }
+    std::size_t misses() const { return misses_.load(); }
+
+private:
+    struct Identity {
+        std::uint64_t size = 0;
+        std::int64_t modified = 0;
+        std::uint64_t contentHash = 0;
+    };
+
+    std::string entryPath(std::uint64_t contentHash) const;
+    bool tryOpen(std::uint64_t contentHash, CachedFeatures& features) const;
+    std::uint64_t analyse(const std::string& path);
+    void remember(const std::string& path, const Identity& identity);
+    void compactIndex();
+
+    std::string directory_;
+    FeatureOptions options_;
+    ParallelDecodeOptions decodeOptions_;
+    std::uint64_t parameterHash_;
+    std::mutex mutex_;
+    std::map<std::string, Identity> index_;
+    std::atomic<std::size_t> hits_{0};
+    std::atomic<std::size_t> misses_{0};
+};
+
+} // namespace audiocompare
@@ -0,0 +1,36 @@
+//
+//  Fft.cpp
+//  AudioCompareCore
+//
+
+#include "Fft.hpp"
+
+#include "ScratchArena.hpp"
+
+#include <cmath>
+
+namespace audiocompare {
+
+Fft::Fft(std::size_t size, FftBackend backend)
+    : plan_(FftPlan::shared(size, backend))
+{
+}
+
+const float* Fft::computeFFT(const float* buffer)
+{
+    magnitudes_.resize(binCount());
+    computeMagnitudes(buffer, magnitudes_.data());
+    return magnitudes_.data();
+}
+
+void Fft::computeMagnitudes(const float* buffer, float* magnitudes) const
+{
+    const std::size_t bins = binCount();
+    ScratchBuffer real(bins);
+    ScratchBuffer imag(bins);
+    forward(buffer, real.data(), imag.data());
+    for (std::size_t k = 0; k < bins; ++k)
+        magnitudes[k] = std::sqrt(real[k] * real[k] + imag[k] * imag[k]);
+}
+
+} // namespace audiocompare
@@ -0,0 +1,53 @@
+//
+//  Fft.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "FftPlan.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace audiocompare {
+
+/// Real-input FFT of a fixed power-of-two size, the counterpart of
+/// `EZAudioFFT`. Spectra are stored split-complex (as vDSP's
+/// `DSPSplitComplex`) with `binCount()` = size / 2 + 1 bins. The transform
+/// runs on the shared `FftPlan` for the size and backend, and its work
+/// buffers come from the calling thread's `ScratchArena`, so an instance
+/// only owns its magnitude output. `forward` and `inverse` may be called
+/// from several threads at once.
+class Fft {
+public:
+    explicit Fft(std::size_t size, FftBackend backend = defaultFftBackend());
+
+    std::size_t size() const { return plan_->size(); }
+    std::size_t binCount() const { return plan_->binCount(); }
+    FftBackend backend() const { return plan_->backend(); }
+
+    /// Unscaled forward transform of `size()` samples.
+    void forward(const float* input, float* real, float* imag) const { plan_->forward(input, real, imag); }
+
+    /// Inverse transform scaled by 1 / size(), so forward + inverse is identity.
+    void inverse(const float* real, const float* imag, float* output) const { plan_->inverse(real, imag, output); }
+
+    /// Computes the magnitude spectrum of `buffer` (size() samples) and returns
+    /// it, like `EZAudioFFT computeFFTWithBuffer:withBufferSize:`. The returned
+    /// pointer stays valid until the next call.
+    const float* computeFFT(const float* buffer);
+
+    /// Writes the `binCount()` magnitudes of `buffer` to `magnitudes`, for
+    /// callers that own the destination. Thread-safe like `forward`.
+    void computeMagnitudes(const float* buffer, float* magnitudes) const;
+
+    const float* fftData() const { return magnitudes_.data(); }
+
+private:
+    std::shared_ptr<const FftPlan> plan_;
+    std::vector<float> magnitudes_;
+};
+
+} // namespace audiocompare
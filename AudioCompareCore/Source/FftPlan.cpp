@@ -0,0 +1,570 @@
+//
+//  FftPlan.cpp
+//  AudioCompareCore
+//
+
+#include "FftPlan.hpp"
+
+#include "ScratchArena.hpp"
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if AUDIOCOMPARE_AVX2 || AUDIOCOMPARE_SSE2
+#include <immintrin.h>
+#endif
+#if AUDIOCOMPARE_NEON
+#include <arm_neon.h>
+#endif
+#if defined(__APPLE__)
+#include <Accelerate/Accelerate.h>
+#endif
+
+namespace audiocompare {
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+/// Complex points per cache-resident block in the early radix-2 stages.
+const std::size_t kCacheBlock = 8192;
+
+bool isPowerOfTwo(std::size_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+/// A real transform of size n computed as a complex transform of the n / 2
+/// points z[m] = x[2m] + i x[2m + 1], followed by the split that separates
+/// the even and odd halves. Subclasses supply the complex transform.
+class PackedRealPlan : public FftPlan {
+public:
+    explicit PackedRealPlan(std::size_t size)
+        : FftPlan(size)
+        , realCos_(size / 4 + 1)
+        , realSin_(size / 4 + 1)
+    {
+        const std::size_t half = size / 2;
+        for (std::size_t k = 0; k <= half / 2; ++k) {
+            const double angle = kPi * static_cast<double>(k) / static_cast<double>(half);
+            realCos_[k] = static_cast<float>(std::cos(angle));
+            realSin_[k] = static_cast<float>(-std::sin(angle));
+        }
+    }
+
+    void forward(const float* input, float* real, float* imag) const override
+    {
+        const std::size_t n = size() / 2;
+        ScratchBuffer workReal(n);
+        ScratchBuffer workImag(n);
+        transform(input, input + 1, 2, workReal.data(), workImag.data());
+
+        real[0] = workReal[0] + workImag[0];
+        imag[0] = 0.0f;
+        real[n] = workReal[0] - workImag[0];
+        imag[n] = 0.0f;
+
+        for (std::size_t k = 1; k <= n / 2; ++k) {
+            const std::size_t j = n - k;
+            const float ar = workReal[k], ai = workImag[k];
+            const float br = workReal[j], bi = workImag[j];
+
+            // E = (A + conj B) / 2, O = (A - conj B) / 2i, T = W^k O.
+            const float er = 0.5f * (ar + br);
+            const float ei = 0.5f * (ai - bi);
+            const float orr = 0.5f * (ai + bi);
+            const float oi = -0.5f * (ar - br);
+            const float tr = orr * realCos_[k] - oi * realSin_[k];
+            const float ti = orr * realSin_[k] + oi * realCos_[k];
+
+            real[k] = er + tr;
+            imag[k] = ei + ti;
+            real[j] = er - tr;
+            imag[j] = -(ei - ti);
+        }
+    }
+
+    void inverse(const float* real, const float* imag, float* output) const override
+    {
+        const std::size_t n = size() / 2;
+        ScratchBuffer packedReal(n);
+        ScratchBuffer packedImag(n);
+
+        packedReal[0] = 0.5f * (real[0] + real[n]);
+        packedImag[0] = 0.5f * (real[0] - real[n]);
+
+        for (std::size_t k = 1; k <= n / 2; ++k) {
+            const std::size_t j = n - k;
+            const float xr = real[k], xi = imag[k];
+            const float yr = real[j], yi = imag[j];
+
+            // E = (X[k] + conj X[j]) / 2, T = (X[k] - conj X[j]) / 2, O = T conj(W^k).
+            const float er = 0.5f * (xr + yr);
+            const float ei = 0.5f * (xi - yi);
+            const float tr = 0.5f * (xr - yr);
+            const float ti = 0.5f * (xi + yi);
+            const float orr = tr * realCos_[k] + ti * realSin_[k];
+            const float oi = ti * realCos_[k] - tr * realSin_[k];
+
+            // Z[k] = E + iO, Z[j] = conj E + i conj O.
+            packedReal[k] = er - oi;
+            packedImag[k] = ei + orr;
+            packedReal[j] = er + oi;
+            packedImag[j] = -ei + orr;
+        }
+
+        // Inverse via the conjugate trick: conj(FFT(conj(Z))) / n.
+        for (std::size_t k = 0; k < n; ++k)
+            packedImag[k] = -packedImag[k];
+        ScratchBuffer workReal(n);
+        ScratchBuffer workImag(n);
+        transform(packedReal.data(), packedImag.data(), 1, workReal.data(), workImag.data());
+
+        const float scale = 1.0f / static_cast<float>(n);
+        for (std::size_t k = 0; k < n; ++k) {
+            output[2 * k] = workReal[k] * scale;
+            output[2 * k + 1] = -workImag[k] * scale;
+        }
+    }
+
+protected:
+    /// Forward complex transform of the size / 2 points at `inReal[m * stride]`
+    /// and `inImag[m * stride]` into split `real` and `imag`.
+    virtual void transform(const float* inReal, const float* inImag, std::size_t stride,
+                           float* real, float* imag) const = 0;
+
+private:
+    std::vector<float> realCos_;
+    std::vector<float> realSin_;
+};
+
+class Radix2Plan : public PackedRealPlan {
+public:
+    explicit Radix2Plan(std::size_t size)
+        : PackedRealPlan(size)
+    {
+        const std::size_t half = size / 2;
+        std::vector<float> cosTable(half / 2);
+        std::vector<float> sinTable(half / 2);
+        for (std::size_t k = 0; k < half / 2; ++k) {
+            const double angle = 2.0 * kPi * static_cast<double>(k) / static_cast<double>(half);
+            cosTable[k] = static_cast<float>(std::cos(angle));
+            sinTable[k] = static_cast<float>(-std::sin(angle));
+        }
+
+        // Each stage reads its twiddles contiguously; strided reads across a
+        // big table thrash the TLB. Stages of half-length 1, 2, 4, ... are
+        // laid end to end, size / 2 - 1 twiddles in all.
+        stageCos_.reserve(half - 1);
+        stageSin_.reserve(half - 1);
+        for (std::size_t halfLength = 1; halfLength < half; halfLength <<= 1) {
+            const std::size_t stride = half / (2 * halfLength);
+            for (std::size_t k = 0; k < halfLength; ++k) {
+                stageCos_.push_back(cosTable[k * stride]);
+                stageSin_.push_back(sinTable[k * stride]);
+            }
+        }
+    }
+
+    FftBackend backend() const override { return FftBackend::Radix2; }
+
+protected:
+    void transform(const float* inReal, const float* inImag, std::size_t stride, float* real,
+                   float* imag) const override
+    {
+        const std::size_t n = size() / 2;
+        for (std::size_t i = 0; i < n; ++i) {
+            real[i] = inReal[i * stride];
+            imag[i] = inImag[i * stride];
+        }
+
+        for (std::size_t i = 1, j = 0; i < n; ++i) {
+            std::size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if (i < j) {
+                std::swap(real[i], real[j]);
+                std::swap(imag[i], imag[j]);
+            }
+        }
+
+        // Run the early stages one cache-sized block at a time, then stream
+        // the remaining stages over the whole array.
+        const std::size_t block = std::min(n, kCacheBlock);
+        for (std::size_t offset = 0; offset < n; offset += block)
+            butterflies(real + offset, imag + offset, 2, block);
+        butterflies(real, imag, block * 2, n);
+    }
+
+private:
+    void butterflies(float* real, float* imag, std::size_t firstLength, std::size_t span) const
+    {
+        for (std::size_t length = firstLength; length <= span; length <<= 1) {
+            const std::size_t halfLength = length / 2;
+            const float* cosines = stageCos_.data() + halfLength - 1;
+            const float* sines = stageSin_.data() + halfLength - 1;
+            for (std::size_t start = 0; start < span; start += length) {
+                float* re0 = real + start;
+                float* im0 = imag + start;
+                float* re1 = re0 + halfLength;
+                float* im1 = im0 + halfLength;
+                for (std::size_t k = 0; k < halfLength; ++k) {
+                    const float wr = cosines[k];
+                    const float wi = sines[k];
+                    const float tr = re1[k] * wr - im1[k] * wi;
+                    const float ti = re1[k] * wi + im1[k] * wr;
+                    re1[k] = re0[k] - tr;
+                    im1[k] = im0[k] - ti;
+                    re0[k] += tr;
+                    im0[k] += ti;
+                }
+            }
+        }
+    }
+
+    std::vector<float> stageCos_;
+    std::vector<float> stageSin_;
+};
+
+/// Decimation-in-time split-radix: a transform of m points is one of m / 2
+/// even points and two of m / 4 odd points, joined by an L-shaped butterfly
+/// that needs about a quarter fewer multiplies than two radix-2 stages. The
+/// recursion reads its input with a stride and writes contiguously, so the
+/// real input is consumed in place without a deinterleave pass, and each
+/// subtransform stays in cache until its butterflies are done.
+class SplitRadixPlan : public PackedRealPlan {
+public:
+    explicit SplitRadixPlan(std::size_t size)
+        : PackedRealPlan(size)
+    {
+        // Per level m >= 8: cos and -sin of 2 pi k / m, then of 6 pi k / m,
+        // for k < m / 4, so each butterfly loads its twiddles contiguously.
+        const std::size_t half = size / 2;
+        for (std::size_t m = 8; m <= half; m <<= 1) {
+            levelOffsets_.push_back(twiddles_.size());
+            const std::size_t quarter = m / 4;
+            twiddles_.resize(twiddles_.size() + 4 * quarter);
+            float* level = twiddles_.data() + levelOffsets_.back();
+            for (std::size_t k = 0; k < quarter; ++k) {
+                const double angle = 2.0 * kPi * static_cast<double>(k) / static_cast<double>(m);
+                level[k] = static_cast<float>(std::cos(angle));
+                level[quarter + k] = static_cast<float>(-std::sin(angle));
+                level[2 * quarter + k] = static_cast<float>(std::cos(3.0 * angle));
+                level[3 * quarter + k] = static_cast<float>(-std::sin(3.0 * angle));
+            }
+        }
+    }
+
+    FftBackend backend() const override { return FftBackend::SplitRadix; }
+
+protected:
+    void transform(const float* inReal, const float* inImag, std::size_t stride, float* real,
+                   float* imag) const override
+    {
+        recurse(inReal, inImag, stride, size() / 2, levelOffsets_.size() - 1, real, imag);
+    }
+
+private:
+    // `level` is log2(m) - 3, the index of the twiddles for size m.
+    void recurse(const float* inReal, const float* inImag, std::size_t stride, std::size_t m,
+                 std::size_t level, float* real, float* imag) const
+    {
+        if (m == 1) {
+            real[0] = inReal[0];
+            imag[0] = inImag[0];
+            return;
+        }
+        if (m == 2) {
+            const float ar = inReal[0], ai = inImag[0];
+            const float br = inReal[stride], bi = inImag[stride];
+            real[0] = ar + br;
+            imag[0] = ai + bi;
+            real[1] = ar - br;
+            imag[1] = ai - bi;
+            return;
+        }
+        if (m == 4) {
+            const float t0r = inReal[0] + inReal[2 * stride], t0i = inImag[0] + inImag[2 * stride];
+            const float t1r = inReal[0] - inReal[2 * stride], t1i = inImag[0] - inImag[2 * stride];
+            const float t2r = inReal[stride] + inReal[3 * stride], t2i = inImag[stride] + inImag[3 * stride];
+            const float t3r = inReal[stride] - inReal[3 * stride], t3i = inImag[stride] - inImag[3 * stride];
+            real[0] = t0r + t2r;
+            imag[0] = t0i + t2i;
+            real[2] = t0r - t2r;
+            imag[2] = t0i - t2i;
+            // X1 = t1 - i t3, X3 = t1 + i t3.
+            real[1] = t1r + t3i;
+            imag[1] = t1i - t3r;
+            real[3] = t1r - t3i;
+            imag[3] = t1i + t3r;
+            return;
+        }
+
+        const std::size_t half = m / 2;
+        const std::size_t quarter = m / 4;
+        // Below m = 16 the level passed down wraps, but sizes of 4 and less
+        // never read it.
+        recurse(inReal, inImag, 2 * stride, half, level - 1, real, imag);
+        recurse(inReal + stride, inImag + stride, 4 * stride, quarter, level - 2, real + half, imag + half);
+        recurse(inReal + 3 * stride, inImag + 3 * stride, 4 * stride, quarter, level - 2, real + half + quarter,
+                imag + half + quarter);
+        combine(twiddles_.data() + levelOffsets_[level], quarter, real, imag);
+    }
+
+    // Joins U (the first half) with Z and Z' (the last two quarters) in place:
+    // X[k] = U[k] + (w^k Z[k] + w^3k Z'[k]), X[k + m/2] = U[k] - (...),
+    // X[k + m/4] = U[k + m/4] - i (w^k Z[k] - w^3k Z'[k]), X[k + 3m/4] = ... + i (...).
+    static void combine(const float* twiddles, std::size_t quarter, float* real, float* imag)
+    {
+        const float* c1 = twiddles;
+        const float* s1 = twiddles + quarter;
+        const float* c3 = twiddles + 2 * quarter;
+        const float* s3 = twiddles + 3 * quarter;
+        float* u0r = real;
+        float* u0i = imag;
+        float* u1r = real + quarter;
+        float* u1i = imag + quarter;
+        float* zr = real + 2 * quarter;
+        float* zi = imag + 2 * quarter;
+        float* yr = real + 3 * quarter;
+        float* yi = imag + 3 * quarter;
+
+        std::size_t k = 0;
+#if AUDIOCOMPARE_AVX2
+        for (; k + 8 <= quarter; k += 8) {
+            const __m256 wr1 = _mm256_loadu_ps(c1 + k), wi1 = _mm256_loadu_ps(s1 + k);
+            const __m256 wr3 = _mm256_loadu_ps(c3 + k), wi3 = _mm256_loadu_ps(s3 + k);
+            const __m256 zrk = _mm256_loadu_ps(zr + k), zik = _mm256_loadu_ps(zi + k);
+            const __m256 yrk = _mm256_loadu_ps(yr + k), yik = _mm256_loadu_ps(yi + k);
+            const __m256 ar = _mm256_fmsub_ps(wr1, zrk, _mm256_mul_ps(wi1, zik));
+            const __m256 ai = _mm256_fmadd_ps(wr1, zik, _mm256_mul_ps(wi1, zrk));
+            const __m256 br = _mm256_fmsub_ps(wr3, yrk, _mm256_mul_ps(wi3, yik));
+            const __m256 bi = _mm256_fmadd_ps(wr3, yik, _mm256_mul_ps(wi3, yrk));
+            const __m256 sr = _mm256_add_ps(ar, br), si = _mm256_add_ps(ai, bi);
+            const __m256 dr = _mm256_sub_ps(ar, br), di = _mm256_sub_ps(ai, bi);
+            const __m256 u0rk = _mm256_loadu_ps(u0r + k), u0ik = _mm256_loadu_ps(u0i + k);
+            const __m256 u1rk = _mm256_loadu_ps(u1r + k), u1ik = _mm256_loadu_ps(u1i + k);
+            _mm256_storeu_ps(u0r + k, _mm256_add_ps(u0rk, sr));
+            _mm256_storeu_ps(u0i + k, _mm256_add_ps(u0ik, si));
+            _mm256_storeu_ps(zr + k, _mm256_sub_ps(u0rk, sr));
+            _mm256_storeu_ps(zi + k, _mm256_sub_ps(u0ik, si));
+            _mm256_storeu_ps(u1r + k, _mm256_add_ps(u1rk, di));
+            _mm256_storeu_ps(u1i + k, _mm256_sub_ps(u1ik, dr));
+            _mm256_storeu_ps(yr + k, _mm256_sub_ps(u1rk, di));
+            _mm256_storeu_ps(yi + k, _mm256_add_ps(u1ik, dr));
+        }
+#elif AUDIOCOMPARE_SSE2
+        for (; k + 4 <= quarter; k += 4) {
+            const __m128 wr1 = _mm_loadu_ps(c1 + k), wi1 = _mm_loadu_ps(s1 + k);
+            const __m128 wr3 = _mm_loadu_ps(c3 + k), wi3 = _mm_loadu_ps(s3 + k);
+            const __m128 zrk = _mm_loadu_ps(zr + k), zik = _mm_loadu_ps(zi + k);
+            const __m128 yrk = _mm_loadu_ps(yr + k), yik = _mm_loadu_ps(yi + k);
+            const __m128 ar = _mm_sub_ps(_mm_mul_ps(wr1, zrk), _mm_mul_ps(wi1, zik));
+            const __m128 ai = _mm_add_ps(_mm_mul_ps(wr1, zik), _mm_mul_ps(wi1, zrk));
+            const __m128 br = _mm_sub_ps(_mm_mul_ps(wr3, yrk), _mm_mul_ps(wi3, yik));
+            const __m128 bi = _mm_add_ps(_mm_mul_ps(wr3, yik), _mm_mul_ps(wi3, yrk));
+            const __m128 sr = _mm_add_ps(ar, br), si = _mm_add_ps(ai, bi);
+            const __m128 dr = _mm_sub_ps(ar, br), di = _mm_sub_ps(ai, bi);
+            const __m128 u0rk = _mm_loadu_ps(u0r + k), u0ik = _mm_loadu_ps(u0i + k);
+            const __m128 u1rk = _mm_loadu_ps(u1r + k), u1ik = _mm_loadu_ps(u1i + k);
+            _mm_storeu_ps(u0r + k, _mm_add_ps(u0rk, sr));
+            _mm_storeu_ps(u0i + k, _mm_add_ps(u0ik, si));
+            _mm_storeu_ps(zr + k, _mm_sub_ps(u0rk, sr));
+            _mm_storeu_ps(zi + k, _mm_sub_ps(u0ik, si));
+            _mm_storeu_ps(u1r + k, _mm_add_ps(u1rk, di));
+            _mm_storeu_ps(u1i + k, _mm_sub_ps(u1ik, dr));
+            _mm_storeu_ps(yr + k, _mm_sub_ps(u1rk, di));
+            _mm_storeu_ps(yi + k, _mm_add_ps(u1ik, dr));
+        }
+#elif AUDIOCOMPARE_NEON
+        for (; k + 4 <= quarter; k += 4) {
+            const float32x4_t wr1 = vld1q_f32(c1 + k), wi1 = vld1q_f32(s1 + k);
+            const float32x4_t wr3 = vld1q_f32(c3 + k), wi3 = vld1q_f32(s3 + k);
+            const float32x4_t zrk = vld1q_f32(zr + k), zik = vld1q_f32(zi + k);
+            const float32x4_t yrk = vld1q_f32(yr + k), yik = vld1q_f32(yi + k);
+            const float32x4_t ar = vmlsq_f32(vmulq_f32(wr1, zrk), wi1, zik);
+            const float32x4_t ai = vmlaq_f32(vmulq_f32(wr1, zik), wi1, zrk);
+            const float32x4_t br = vmlsq_f32(vmulq_f32(wr3, yrk), wi3, yik);
+            const float32x4_t bi = vmlaq_f32(vmulq_f32(wr3, yik), wi3, yrk);
+            const float32x4_t sr = vaddq_f32(ar, br), si = vaddq_f32(ai, bi);
+            const float32x4_t dr = vsubq_f32(ar, br), di = vsubq_f32(ai, bi);
+            const float32x4_t u0rk = vld1q_f32(u0r + k), u0ik = vld1q_f32(u0i + k);
+            const float32x4_t u1rk = vld1q_f32(u1r + k), u1ik = vld1q_f32(u1i + k);
+            vst1q_f32(u0r + k, vaddq_f32(u0rk, sr));
+            vst1q_f32(u0i + k, vaddq_f32(u0ik, si));
+            vst1q_f32(zr + k, vsubq_f32(u0rk, sr));
+            vst1q_f32(zi + k, vsubq_f32(u0ik, si));
+            vst1q_f32(u1r + k, vaddq_f32(u1rk, di));
+            vst1q_f32(u1i + k, vsubq_f32(u1ik, dr));
+            vst1q_f32(yr + k, vsubq_f32(u1rk, di));
+            vst1q_f32(yi + k, vaddq_f32(u1ik, dr));
+        }
+#endif
+        for (; k < quarter; ++k) {
+            const float ar = c1[k] * zr[k] - s1[k] * zi[k];
+            const float ai = c1[k] * zi[k] + s1[k] * zr[k];
+            const float br = c3[k] * yr[k] - s3[k] * yi[k];
+            const float bi = c3[k] * yi[k] + s3[k] * yr[k];
+            const float sr = ar + br, si = ai + bi;
+            const float dr = ar - br, di = ai - bi;
+            const float u0rk = u0r[k], u0ik = u0i[k];
+            const float u1rk = u1r[k], u1ik = u1i[k];
+            u0r[k] = u0rk + sr;
+            u0i[k] = u0ik + si;
+            zr[k] = u0rk - sr;
+            zi[k] = u0ik - si;
+            u1r[k] = u1rk + di;
+            u1i[k] = u1ik - dr;
+            yr[k] = u1rk - di;
+            yi[k] = u1ik + dr;
+        }
+    }
+
+    std::vector<float> twiddles_;
+    std::vector<std::size_t> levelOffsets_;
+};
+
+#if defined(__APPLE__)
+
+/// `vDSP_fft_zrip`, rescaled to the unscaled forward / 1 / n inverse
+/// convention and unpacked from vDSP's DC-and-Nyquist-in-one-bin layout.
+class AcceleratePlan : public FftPlan {
+public:
+    explicit AcceleratePlan(std::size_t size)
+        : FftPlan(size)
+    {
+        while ((std::size_t(1) << log2Size_) < size)
+            ++log2Size_;
+        setup_ = vDSP_create_fftsetup(log2Size_, kFFTRadix2);
+        if (!setup_)
+            throw std::runtime_error("vDSP_create_fftsetup failed");
+    }
+
+    ~AcceleratePlan() override { vDSP_destroy_fftsetup(setup_); }
+
+    AcceleratePlan(const AcceleratePlan&) = delete;
+    AcceleratePlan& operator=(const AcceleratePlan&) = delete;
+
+    FftBackend backend() const override { return FftBackend::Accelerate; }
+
+    void forward(const float* input, float* real, float* imag) const override
+    {
+        const std::size_t n = size() / 2;
+        ScratchBuffer workReal(n);
+        ScratchBuffer workImag(n);
+        DSPSplitComplex split = {workReal.data(), workImag.data()};
+        vDSP_ctoz(reinterpret_cast<const DSPComplex*>(input), 2, &split, 1, n);
+        vDSP_fft_zrip(setup_, &split, 1, log2Size_, kFFTDirection_Forward);
+
+        // vDSP returns twice the transform, with the Nyquist bin in imagp[0].
+        const float half = 0.5f;
+        vDSP_vsmul(workReal.data(), 1, &half, real, 1, n);
+        vDSP_vsmul(workImag.data(), 1, &half, imag, 1, n);
+        real[n] = workImag[0] * half;
+        imag[0] = 0.0f;
+        imag[n] = 0.0f;
+    }
+
+    void inverse(const float* real, const float* imag, float* output) const override
+    {
+        const std::size_t n = size() / 2;
+        ScratchBuffer workReal(n);
+        ScratchBuffer workImag(n);
+        std::copy(real, real + n, workReal.data());
+        std::copy(imag, imag + n, workImag.data());
+        workImag[0] = real[n];
+        DSPSplitComplex split = {workReal.data(), workImag.data()};
+        vDSP_fft_zrip(setup_, &split, 1, log2Size_, kFFTDirection_Inverse);
+        vDSP_ztoc(&split, 1, reinterpret_cast<DSPComplex*>(output), 2, n);
+
+        // The inverse of the unscaled spectrum comes back scaled by size().
+        const float scale = 1.0f / static_cast<float>(size());
+        vDSP_vsmul(output, 1, &scale, output, 1, size());
+    }
+
+private:
+    vDSP_Length log2Size_ = 0;
+    FFTSetup setup_ = nullptr;
+};
+
+#endif
+
+} // namespace
+
+FftBackend defaultFftBackend()
+{
+#if defined(__APPLE__)
+    return FftBackend::Accelerate;
+#else
+    return FftBackend::SplitRadix;
+#endif
+}
+
+const char* fftBackendName(FftBackend backend)
+{
+    switch (backend) {
+    case FftBackend::Radix2:
+        return "radix2";
+    case FftBackend::SplitRadix:
+        return "splitradix";
+    case FftBackend::Accelerate:
+        return "accelerate";
+    }
+    return "unknown";
+}
+
+bool isFftBackendAvailable(FftBackend backend)
+{
+#if defined(__APPLE__)
+    (void)backend;
+    return true;
+#else
+    return backend != FftBackend::Accelerate;
+#endif
+}
+
+std::shared_ptr<const FftPlan> FftPlan::shared(std::size_t size, FftBackend backend)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<std::size_t, FftBackend>, std::shared_ptr<const FftPlan>> plans;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const FftPlan>& plan = plans[{size, backend}];
+    if (!plan) {
+        try {
+            plan = create(size, backend);
+        } catch (...) {
+            plans.erase({size, backend});
+            throw;
+        }
+    }
+    return plan;
+}
+
+std::unique_ptr<FftPlan> FftPlan::create(std::size_t size, FftBackend backend)
+{
+    if (size < 4 || !isPowerOfTwo(size))
+        throw std::invalid_argument("FFT size must be a power of two >= 4");
+    switch (backend) {
+    case FftBackend::Radix2:
+        return std::make_unique<Radix2Plan>(size);
+    case FftBackend::SplitRadix:
+        return std::make_unique<SplitRadixPlan>(size);
+    case FftBackend::Accelerate:
+#if defined(__APPLE__)
+        return std::make_unique<AcceleratePlan>(size);
+#else
+        break;
+#endif
+    }
+    throw std::runtime_error(std::string("FFT backend ") + fftBackendName(backend) + " is not available");
+}
+
+} // namespace audiocompare
@@ -0,0 +1,71 @@
+//
+//  FftPlan.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace audiocompare {
+
+/// FFT implementations an `FftPlan` can be built on.
+enum class FftBackend {
+    /// Iterative radix-2, the original portable transform.
+    Radix2,
+    /// Recursive split-radix with SSE/AVX2/NEON butterflies.
+    SplitRadix,
+    /// Accelerate `vDSP_fft_zrip`, as `EZAudioFFT` uses; Apple platforms only.
+    Accelerate,
+};
+
+/// Accelerate on Apple platforms, split-radix elsewhere.
+FftBackend defaultFftBackend();
+const char* fftBackendName(FftBackend backend);
+/// False for backends this build cannot create.
+bool isFftBackendAvailable(FftBackend backend);
+
+/// Real-input FFT of one power-of-two size on one backend, the counterpart
+/// of a vDSP `FFTSetup`. `EZAudioFFT` builds a setup per instance; here
+/// every `Fft` of a size and backend shares one immutable plan, so any
+/// number of threads can transform with it at once. Work buffers come from
+/// the calling thread's `ScratchArena`.
+///
+/// Spectra are split-complex with size / 2 + 1 bins. Forward transforms are
+/// unscaled and inverse transforms are scaled by 1 / size, whatever the
+/// backend's native convention.
+class FftPlan {
+public:
+    /// Returns the process-wide plan for `size` on `backend`, building it on
+    /// first use. Thread-safe. Plans stay cached until the process exits;
+    /// there is one per size and backend in use.
+    static std::shared_ptr<const FftPlan> shared(std::size_t size, FftBackend backend = defaultFftBackend());
+
+    /// Builds an uncached plan. Throws std::invalid_argument unless `size`
+    /// is a power of two of at least 4, and std::runtime_error when the
+    /// backend is unavailable.
+    static std::unique_ptr<FftPlan> create(std::size_t size, FftBackend backend = defaultFftBackend());
+
+    virtual ~FftPlan() = default;
+
+    std::size_t size() const { return size_; }
+    std::size_t binCount() const { return size_ / 2 + 1; }
+    virtual FftBackend backend() const = 0;
+
+    /// Transforms `size()` real samples into `binCount()` bins.
+    virtual void forward(const float* input, float* real, float* imag) const = 0;
+    /// Transforms `binCount()` bins back into `size()` samples.
+    virtual void inverse(const float* real, const float* imag, float* output) const = 0;
+
+protected:
+    explicit FftPlan(std::size_t size)
+        : size_(size)
+    {
+    }
+
+private:
+    std::size_t size_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,29 @@
+//
+//  FftTap.cpp
+//  AudioCompareCore
+//
+
+#include "FftTap.hpp"
+
+namespace audiocompare {
+
+FftTap::FftTap(std::size_t windowSize, const RollingFftOptions& options)
+    : fft_(windowSize, options)
+    , publisher_(fft_.binCount())
+{
+}
+
+void FftTap::process(const float* buffer, std::size_t bufferSize)
+{
+    // The spectrum is computed straight into the publisher's back buffer.
+    fft_.processInto(
+        buffer, bufferSize, [this] { return publisher_.writeBuffer(); }, [this] { publisher_.publish(); });
+}
+
+std::vector<float> FftTap::fftData()
+{
+    const SnapshotPublisher::Snapshot snapshot = publisher_.acquire();
+    return std::vector<float>(snapshot.values.begin(), snapshot.values.end());
+}
+
+} // namespace audiocompare
@@ -0,0 +1,43 @@
+//
+//  FftTap.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "RollingFft.hpp"
+#include "SnapshotPublisher.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace audiocompare {
+
+/// Live spectrum tap, the counterpart of `AKFFTTap`. The audio or analysis
+/// thread feeds samples through a `RollingFft`, and every spectrum it makes
+/// is published to a `SnapshotPublisher`. One reader, such as a UI timer,
+/// polls `latest()` for the newest magnitudes without locks or allocation.
+class FftTap {
+public:
+    explicit FftTap(std::size_t windowSize, const RollingFftOptions& options = {});
+
+    std::size_t binCount() const { return fft_.binCount(); }
+
+    /// FFT thread: appends samples and publishes each spectrum computed.
+    void process(const float* buffer, std::size_t bufferSize);
+
+    /// Reader thread: the newest `binCount()` magnitudes and their sequence
+    /// number, valid until the next `latest` or `fftData` call.
+    SnapshotPublisher::Snapshot latest() { return publisher_.acquire(); }
+
+    /// Reader thread: a copy of the newest magnitudes, the shape of
+    /// `AKFFTTap.fftData`. Allocates on every call; kept for callers that
+    /// want to own the values, while `latest` is the allocation-free path.
+    std::vector<float> fftData();
+
+private:
+    RollingFft fft_;
+    SnapshotPublisher publisher_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,117 @@
+//
+//  FftWindow.cpp
+//  AudioCompareCore
+//
+
+#include "FftWindow.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+namespace audiocompare {
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+/// Modified Bessel function of the first kind, order 0, by its power series.
+double besselI0(double x)
+{
+    const double quarterSquare = 0.25 * x * x;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int k = 1; term > 1e-12 * sum; ++k) {
+        term *= quarterSquare / (static_cast<double>(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+std::vector<float> computeWindow(std::size_t size, const FftWindow& window)
+{
+    std::vector<float> coefficients(size);
+    switch (window.type) {
+    case WindowType::Hann:
+        for (std::size_t i = 0; i < size; ++i)
+            coefficients[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / size));
+        break;
+    case WindowType::BlackmanHarris:
+        for (std::size_t i = 0; i < size; ++i) {
+            const double phase = 2.0 * kPi * i / size;
+            coefficients[i] = static_cast<float>(0.35875 - 0.48829 * std::cos(phase) + 0.14128 * std::cos(2.0 * phase)
+                                                 - 0.01168 * std::cos(3.0 * phase));
+        }
+        break;
+    case WindowType::Kaiser: {
+        const double scale = 1.0 / besselI0(window.kaiserBeta);
+        for (std::size_t i = 0; i < size; ++i) {
+            const double x = 2.0 * static_cast<double>(i) / size - 1.0;
+            coefficients[i] = static_cast<float>(besselI0(window.kaiserBeta * std::sqrt(1.0 - x * x)) * scale);
+        }
+        break;
+    }
+    }
+    return coefficients;
+}
+
+} // namespace
+
+const char* windowTypeName(WindowType type)
+{
+    switch (type) {
+    case WindowType::Hann:
+        return "hann";
+    case WindowType::BlackmanHarris:
+        return "blackman-harris";
+    case WindowType::Kaiser:
+        return "kaiser";
+    }
+    return "unknown";
+}
+
+FftWindow parseFftWindow(const std::string& text)
+{
+    FftWindow window;
+    if (text == "hann") {
+        window.type = WindowType::Hann;
+    } else if (text == "blackman-harris") {
+        window.type = WindowType::BlackmanHarris;
+    } else if (text == "kaiser") {
+        window.type = WindowType::Kaiser;
+    } else if (text.compare(0, 7, "kaiser:") == 0) {
+        window.type = WindowType::Kaiser;
+        char* end = nullptr;
+        window.kaiserBeta = std::strtod(text.c_str() + 7, &end);
+        if (end == text.c_str() + 7 || *end != '\0' || !(window.kaiserBeta >= 0.0))
+            throw std::invalid_argument("Kaiser beta must be a non-negative number");
+    } else {
+        throw std::invalid_argument("unknown window: " + text);
+    }
+    return window;
+}
+
+std::shared_ptr<const std::vector<float>> sharedWindow(std::size_t size, const FftWindow& window)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<std::size_t, WindowType, double>, std::shared_ptr<const std::vector<float>>> windows;
+    const double beta = window.type == WindowType::Kaiser ? window.kaiserBeta : 0.0;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const std::vector<float>>& coefficients = windows[std::make_tuple(size, window.type, beta)];
+    if (!coefficients)
+        coefficients = std::make_shared<const std::vector<float>>(computeWindow(size, window));
+    return coefficients;
+}
+
+double fullScaleMagnitude(const std::vector<float>& coefficients)
+{
+    double sum = 0.0;
+    for (float value : coefficients)
+        sum += value;
+    return 0.5 * sum;
+}
+
+} // namespace audiocompare
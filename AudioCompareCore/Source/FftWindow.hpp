@@ -0,0 +1,49 @@
+//
+//  FftWindow.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+enum class WindowType {
+    /// Raised cosine, the window `EZAudioFFTRolling` always applies.
+    Hann,
+    /// Four-term Blackman-Harris: about -92 dB sidelobes for a main lobe
+    /// twice as wide as Hann's.
+    BlackmanHarris,
+    /// Kaiser-Bessel with a tunable `kaiserBeta`.
+    Kaiser,
+};
+
+/// Analysis window shape. Coefficients are periodic (the window repeats
+/// after `size` samples), as suits overlapped analysis.
+struct FftWindow {
+    WindowType type = WindowType::Hann;
+    /// Kaiser shape: 0 is rectangular, and larger values give lower sidelobes
+    /// for a wider main lobe. 8.6 is close to Blackman-Harris.
+    double kaiserBeta = 8.6;
+};
+
+const char* windowTypeName(WindowType type);
+
+/// Parses "hann", "blackman-harris", "kaiser" or "kaiser:BETA". Throws
+/// std::invalid_argument for anything else.
+FftWindow parseFftWindow(const std::string& text);
+
+/// Returns the process-wide coefficients of `window` over `size` samples,
+/// computing them on first use. Thread-safe; like `FftPlan::shared`, each
+/// size and shape is built once and kept until the process exits.
+std::shared_ptr<const std::vector<float>> sharedWindow(std::size_t size, const FftWindow& window = {});
+
+/// Magnitude of a full-scale sine at a bin centre, size / 4 for Hann: the
+/// reference level for dB-relative-to-full-scale spectra.
+double fullScaleMagnitude(const std::vector<float>& coefficients);
+
+} // namespace audiocompare
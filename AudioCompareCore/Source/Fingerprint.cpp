@@ -0,0 +1,250 @@
+//
+//  Fingerprint.cpp
+//  AudioCompareCore
+//
+
+#include "Fingerprint.hpp"
+
+#include "AudioUtilities.hpp"
+#include "BatchedStft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace audiocompare {
+
+namespace {
+
+// The classic 11025 Hz analysis: 256-sample hops, 1024-sample windows.
+const double kFrameSeconds = 256.0 / 11025.0;
+const double kWindowSeconds = 1024.0 / 11025.0;
+const double kFrequencyQuantumHz = 11025.0 / 1024.0;
+const double kMaximumHz = 5000.0;
+
+// A peak is the maximum of +-150 Hz and +-8 frames (about 190 ms) around it
+// and no more than 70 dB below a full-scale sine.
+const double kPeakSpreadHz = 150.0;
+const std::size_t kPeakSpreadFrames = 8;
+const float kPeakFloorDb = -70.0f;
+const std::size_t kMaxPeaksPerFrame = 5;
+
+// Target zone: 1 to 63 frames ahead, within 96 quanta (about 1 kHz).
+const std::uint32_t kMaxDeltaFrames = 63;
+const int kMaxDeltaQuanta = 96;
+const std::size_t kFanOut = 5;
+
+// Peaks are placed to half a quantum and half a frame by interpolation.
+// Finer steps split true matches across hashes faster than they thin out
+// the posting lists.
+const int kFrequencySteps = 2;
+const double kTimeSteps = 2.0;
+// Hash bits: anchor frequency (10), frequency delta offset to be positive
+// (9), then the time delta (13, of which 63 frames use 7).
+const int kAnchorShift = 22;
+const int kDeltaShift = 13;
+
+const std::size_t kReadFrames = 16384;
+
+struct Peak {
+    std::uint32_t frame;
+    /// Frequency in 1 / kFrequencySteps quanta.
+    std::uint32_t step;
+    float level;
+    /// Offset of the interpolated maximum from `frame`, -0.5 to 0.5.
+    float offset;
+};
+
+/// Vertex of the parabola through three levels around a maximum, relative
+/// to the middle one.
+float parabolicOffset(float before, float centre, float after)
+{
+    const float curvature = before - 2.0f * centre + after;
+    if (!std::isfinite(curvature) || curvature >= 0.0f)
+        return 0.0f;
+    return std::max(-0.5f, std::min(0.5f, 0.5f * (before - after) / curvature));
+}
+
+std::size_t nearestPowerOfTwo(double value)
+{
+    const double exponent = std::round(std::log2(std::max(value, 64.0)));
+    return static_cast<std::size_t>(1) << static_cast<int>(exponent);
+}
+
+/// Finds the peaks of a spectrogram streamed one frame at a time, keeping
+/// only the 2 * kPeakSpreadFrames + 1 frames the time test needs.
+class PeakPicker {
+public:
+    PeakPicker(std::size_t binCount, std::size_t spreadBins)
+        : binCount_(binCount)
+        , spreadBins_(spreadBins)
+        , levels_(kRingFrames, std::vector<float>(binCount, kSilence))
+        , bandMaxima_(kRingFrames, std::vector<float>(binCount, kSilence))
+    {
+    }
+
+    /// Adds frame `frame` and emits the peaks of the frame kPeakSpreadFrames
+    /// earlier, now that its whole neighbourhood is known.
+    void push(const float* levels, std::uint32_t frame, double binHz, std::vector<Peak>& peaks)
+    {
+        const std::size_t slot = frame % kRingFrames;
+        std::copy(levels, levels + binCount_, levels_[slot].begin());
+        std::vector<float>& bandMax = bandMaxima_[slot];
+        for (std::size_t k = 0; k < binCount_; ++k) {
+            const std::size_t low = k > spreadBins_ ? k - spreadBins_ : 0;
+            const std::size_t high = std::min(binCount_, k + spreadBins_ + 1);
+            bandMax[k] = *std::max_element(levels + low, levels + high);
+        }
+        if (frame >= kPeakSpreadFrames)
+            emit(frame - static_cast<std::uint32_t>(kPeakSpreadFrames), binHz, peaks);
+    }
+
+    /// Emits the peaks of the last kPeakSpreadFrames frames.
+    void finish(std::uint32_t frameCount, double binHz, std::vector<Peak>& peaks)
+    {
+        const std::vector<float> silence(binCount_, kSilence);
+        for (std::uint32_t frame = frameCount; frame < frameCount + kPeakSpreadFrames; ++frame)
+            push(silence.data(), frame, binHz, peaks);
+    }
+
+private:
+    static constexpr std::size_t kRingFrames = 2 * kPeakSpreadFrames + 1;
+    static constexpr float kSilence = -std::numeric_limits<float>::infinity();
+
+    void emit(std::uint32_t centre, double binHz, std::vector<Peak>& peaks)
+    {
+        const std::vector<float>& levels = levels_[centre % kRingFrames];
+        const std::vector<float>& bandMax = bandMaxima_[centre % kRingFrames];
+        candidates_.clear();
+        for (std::size_t k = 1; k < binCount_; ++k) {
+            const float level = levels[k];
+            if (level < kPeakFloorDb || level < bandMax[k])
+                continue;
+            bool dominant = true;
+            for (std::size_t r = 0; r < kRingFrames && dominant; ++r)
+                dominant = bandMaxima_[r][k] <= level;
+            if (dominant) {
+                // Interpolating between frames keeps time deltas intact for
+                // a query that starts part of a hop off the track's grid;
+                // between bins, it keeps frequencies apart at any rate.
+                const float after = k + 1 < binCount_ ? levels[k + 1] : kSilence;
+                const double bin = k + parabolicOffset(levels[k - 1], level, after);
+                const auto step
+                    = static_cast<std::uint32_t>(std::lround(bin * binHz / kFrequencyQuantumHz * kFrequencySteps));
+                const float offset = parabolicOffset(levels_[(centre + kRingFrames - 1) % kRingFrames][k], level,
+                                                     levels_[(centre + 1) % kRingFrames][k]);
+                candidates_.push_back({centre, step, level, offset});
+            }
+        }
+        const auto stronger = [](const Peak& a, const Peak& b) { return a.level > b.level; };
+        if (candidates_.size() > kMaxPeaksPerFrame) {
+            std::partial_sort(candidates_.begin(), candidates_.begin() + kMaxPeaksPerFrame, candidates_.end(),
+                              stronger);
+            candidates_.resize(kMaxPeaksPerFrame);
+        }
+        peaks.insert(peaks.end(), candidates_.begin(), candidates_.end());
+    }
+
+    std::size_t binCount_;
+    std::size_t spreadBins_;
+    std::vector<std::vector<float>> levels_;
+    std::vector<std::vector<float>> bandMaxima_;
+    std::vector<Peak> candidates_;
+};
+
+} // namespace
+
+double landmarkFrameSeconds()
+{
+    return kFrameSeconds;
+}
+
+struct LandmarkExtractor::State {
+    explicit State(double sampleRate)
+        : stream(nearestPowerOfTwo(sampleRate * kWindowSeconds),
+                 static_cast<std::size_t>(std::lround(sampleRate * kFrameSeconds)))
+        , binHz(sampleRate / static_cast<double>(stream.fftSize()))
+        , binCount(std::min(stream.binCount(), static_cast<std::size_t>(kMaximumHz / binHz) + 1))
+        , fullScale(static_cast<float>(stream.fftSize()) / 4.0f)
+        , picker(binCount, std::max<std::size_t>(1, static_cast<std::size_t>(kPeakSpreadHz / binHz)))
+        , levels(binCount)
+    {
+    }
+
+    void analyse(const float* magnitudes)
+    {
+        for (std::size_t k = 0; k < binCount; ++k)
+            levels[k] = 20.0f * std::log10(magnitudes[k] / fullScale + 1e-10f);
+        picker.push(levels.data(), frame++, binHz, peaks);
+    }
+
+    SpectrogramStream stream;
+    double binHz;
+    std::size_t binCount;
+    // Magnitudes relative to a full-scale sine, which peaks at size / 4
+    // through the Hann window.
+    float fullScale;
+    PeakPicker picker;
+    std::vector<float> levels;
+    std::vector<Peak> peaks;
+    std::uint32_t frame = 0;
+};
+
+LandmarkExtractor::LandmarkExtractor(double sampleRate)
+    : state_(std::make_unique<State>(sampleRate))
+{
+}
+
+LandmarkExtractor::~LandmarkExtractor() = default;
+
+void LandmarkExtractor::process(ChannelView mono)
+{
+    State& s = *state_;
+    s.stream.push(mono, [&s](const float* magnitudes) { s.analyse(magnitudes); });
+}
+
+std::vector<Landmark> LandmarkExtractor::finish()
+{
+    State& s = *state_;
+    s.stream.flush([&s](const float* magnitudes) { s.analyse(magnitudes); });
+    s.picker.finish(s.frame, s.binHz, s.peaks);
+    const std::vector<Peak>& peaks = s.peaks;
+
+    std::vector<Landmark> landmarks;
+    landmarks.reserve(peaks.size() * kFanOut);
+    for (std::size_t i = 0; i < peaks.size(); ++i) {
+        const Peak& anchor = peaks[i];
+        std::size_t paired = 0;
+        for (std::size_t j = i + 1; j < peaks.size() && paired < kFanOut; ++j) {
+            const Peak& target = peaks[j];
+            const std::uint32_t delta = target.frame - anchor.frame;
+            if (delta > kMaxDeltaFrames)
+                break;
+            const int steps = static_cast<int>(target.step) - static_cast<int>(anchor.step);
+            if (delta == 0 || std::abs(steps) > kMaxDeltaQuanta * kFrequencySteps)
+                continue;
+            const auto frequency = static_cast<std::uint32_t>(steps + kMaxDeltaQuanta * kFrequencySteps);
+            const auto time = static_cast<std::uint32_t>(
+                std::lround((static_cast<double>(delta) + target.offset - anchor.offset) * kTimeSteps));
+            landmarks.push_back(
+                {(anchor.step << kAnchorShift) | (frequency << kDeltaShift) | time, anchor.frame});
+            ++paired;
+        }
+    }
+    return landmarks;
+}
+
+std::vector<Landmark> extractLandmarks(AudioReader& reader)
+{
+    const AudioFormat format = reader.format();
+    LandmarkExtractor extractor(format.sampleRate);
+    FloatBuffers block(format.channelCount, kReadFrames);
+    std::vector<float> mono(kReadFrames);
+    while (const std::size_t read = reader.readFrames(block.data(), kReadFrames)) {
+        mixToMono(block.view(0, read), mono.data());
+        extractor.process(ChannelView(mono.data(), read));
+    }
+    return extractor.finish();
+}
+
+} // namespace audiocompare
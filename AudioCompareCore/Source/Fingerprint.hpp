@@ -0,0 +1,54 @@
+//
+//  Fingerprint.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+#include "AudioReader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace audiocompare {
+
+/// A pair of spectral peaks: the anchor's frequency, the frequency step to
+/// the target and the time between them, packed into 32 bits, plus the
+/// anchor's frame. Peaks are interpolated to half a frequency quantum and
+/// half a frame. Quanta are in Hz and frames a fixed `landmarkFrameSeconds()`
+/// apart, so hashes match across sample rates.
+struct Landmark {
+    std::uint32_t hash = 0;
+    std::uint32_t frame = 0;
+};
+
+/// Duration of one landmark frame (about 23 ms).
+double landmarkFrameSeconds();
+
+/// Streams mono samples into landmarks. Spectrogram frames of about 93 ms
+/// come from a `SpectrogramStream`, batched with `RollingFft` framing; peaks
+/// up to 5 kHz that dominate their time-frequency neighbourhood become
+/// anchors, each paired with the next few peaks in a target zone ahead of
+/// it. Landmarks are returned in frame order.
+class LandmarkExtractor {
+public:
+    explicit LandmarkExtractor(double sampleRate);
+    ~LandmarkExtractor();
+
+    /// Feeds mono samples, in any block size.
+    void process(ChannelView mono);
+    std::vector<Landmark> finish();
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+/// Runs a `LandmarkExtractor` over the mono downmix of `reader`, from its
+/// current position to the end.
+std::vector<Landmark> extractLandmarks(AudioReader& reader);
+
+} // namespace audiocompare
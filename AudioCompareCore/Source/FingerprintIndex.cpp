@@ -0,0 +1,340 @@
+//
+//  FingerprintIndex.cpp
+//  AudioCompareCore
+//
+
+#include "FingerprintIndex.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+namespace audiocompare {
+
+namespace {
+
+const char kMagic[4] = {'A', 'C', 'F', 'I'};
+// Version 2 has the 32-bit landmark hashes.
+const std::uint32_t kVersion = 2;
+const std::size_t kHeaderBytes = 72;
+const std::size_t kBufferEntries = 65536;
+// Hashes with more postings than this are too common to vote. The limit is
+// absolute, so a query costs the same however large the catalogue grows.
+const std::size_t kStopLength = 4096;
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+
+bool hostIsLittleEndian()
+{
+    const std::uint16_t probe = 1;
+    unsigned char first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+void writeLE32(unsigned char* p, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void writeLE64(unsigned char* p, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+std::uint32_t readLE32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t readLE64(const unsigned char* p)
+{
+    return static_cast<std::uint64_t>(readLE32(p)) | (static_cast<std::uint64_t>(readLE32(p + 4)) << 32);
+}
+
+std::size_t alignTo8(std::size_t value)
+{
+    return (value + 7) & ~static_cast<std::size_t>(7);
+}
+
+} // namespace
+
+FingerprintIndex FingerprintIndex::open(const std::string& path)
+{
+    if (!hostIsLittleEndian())
+        throw std::runtime_error("fingerprint indexes need a little-endian host");
+    auto file = std::make_shared<const MappedFile>(path);
+    const unsigned char* data = file->data();
+    const std::size_t size = file->size();
+    if (size < kHeaderBytes || std::memcmp(data, kMagic, 4) != 0)
+        throw std::runtime_error(path + ": not a fingerprint index");
+    if (readLE32(data + 4) != kVersion)
+        throw std::runtime_error(path + ": unsupported fingerprint index version");
+
+    FingerprintIndex index;
+    const std::uint64_t secondsBits = readLE64(data + 8);
+    std::memcpy(&index.frameSeconds_, &secondsBits, sizeof(secondsBits));
+    index.trackCount_ = static_cast<std::size_t>(readLE64(data + 16));
+    index.keyCount_ = static_cast<std::size_t>(readLE64(data + 24));
+    index.postingCount_ = static_cast<std::size_t>(readLE64(data + 32));
+    const std::size_t postingsOffset = static_cast<std::size_t>(readLE64(data + 40));
+    const std::size_t keysOffset = static_cast<std::size_t>(readLE64(data + 48));
+    const std::size_t startsOffset = static_cast<std::size_t>(readLE64(data + 56));
+    const std::size_t namesOffset = static_cast<std::size_t>(readLE64(data + 64));
+
+    const auto fits = [size](std::size_t offset, std::size_t count, std::size_t width) {
+        return offset <= size && count <= (size - offset) / width;
+    };
+    if (!fits(postingsOffset, index.postingCount_, sizeof(Posting)) || !fits(keysOffset, index.keyCount_, 4)
+        || !fits(startsOffset, index.keyCount_ + 1, 8) || !fits(namesOffset, index.trackCount_ + 1, 8))
+        throw std::runtime_error(path + ": truncated fingerprint index");
+    index.postings_ = reinterpret_cast<const Posting*>(data + postingsOffset);
+    index.keys_ = reinterpret_cast<const std::uint32_t*>(data + keysOffset);
+    index.starts_ = reinterpret_cast<const std::uint64_t*>(data + startsOffset);
+    index.nameOffsets_ = reinterpret_cast<const std::uint64_t*>(data + namesOffset);
+    index.names_ = reinterpret_cast<const char*>(data + namesOffset + 8 * (index.trackCount_ + 1));
+    if (index.starts_[index.keyCount_] != index.postingCount_
+        || !fits(namesOffset + 8 * (index.trackCount_ + 1), index.nameOffsets_[index.trackCount_], 1))
+        throw std::runtime_error(path + ": truncated fingerprint index");
+    index.file_ = std::move(file);
+    return index;
+}
+
+std::string FingerprintIndex::trackName(std::uint32_t track) const
+{
+    if (track >= trackCount_)
+        throw std::out_of_range("no such fingerprinted track");
+    return std::string(names_ + nameOffsets_[track], names_ + nameOffsets_[track + 1]);
+}
+
+std::vector<FingerprintMatch> FingerprintIndex::query(const std::vector<Landmark>& landmarks,
+                                                      std::size_t maxResults, std::size_t minimumVotes) const
+{
+    // One (track, offset) key per matching posting; sorted, a true match
+    // is a long run of one key. Offsets are biased so that they sort in
+    // order and neighbouring offsets of a track are neighbouring keys.
+    std::vector<std::uint64_t> hits;
+    for (const Landmark& landmark : landmarks) {
+        const std::uint32_t* key = std::lower_bound(keys_, keys_ + keyCount_, landmark.hash);
+        if (key == keys_ + keyCount_ || *key != landmark.hash)
+            continue;
+        const std::size_t k = static_cast<std::size_t>(key - keys_);
+        if (starts_[k + 1] - starts_[k] > kStopLength)
+            continue;
+        for (std::uint64_t p = starts_[k]; p < starts_[k + 1]; ++p) {
+            const Posting& posting = postings_[p];
+            const auto offset = static_cast<std::uint32_t>(static_cast<std::int64_t>(posting.frame) - landmark.frame
+                                                           + (std::int64_t(1) << 31));
+            hits.push_back((static_cast<std::uint64_t>(posting.track) << 32) | offset);
+        }
+    }
+    std::sort(hits.begin(), hits.end());
+    std::vector<std::pair<std::uint64_t, std::size_t>> votes;
+    for (const std::uint64_t key : hits) {
+        if (votes.empty() || votes.back().first != key)
+            votes.emplace_back(key, 0);
+        ++votes.back().second;
+    }
+
+    // Best offset per track, counting the neighbouring offsets too since
+    // peaks can land one frame either side.
+    std::vector<FingerprintMatch> best;
+    for (std::size_t v = 0; v < votes.size(); ++v) {
+        const std::uint64_t key = votes[v].first;
+        std::size_t total = votes[v].second;
+        if (v > 0 && votes[v - 1].first == key - 1)
+            total += votes[v - 1].second;
+        if (v + 1 < votes.size() && votes[v + 1].first == key + 1)
+            total += votes[v + 1].second;
+        const auto track = static_cast<std::uint32_t>(key >> 32);
+        if (best.empty() || best.back().track != track)
+            best.push_back({track, 0, 0.0, 0});
+        FingerprintMatch& match = best.back();
+        if (total > match.votes) {
+            match.offsetFrames = static_cast<std::int64_t>(key & 0xFFFFFFFFu) - (std::int64_t(1) << 31);
+            match.votes = total;
+        }
+    }
+
+    std::vector<FingerprintMatch> matches;
+    for (FingerprintMatch match : best) {
+        if (match.votes < minimumVotes)
+            continue;
+        match.offsetMilliseconds = 1000.0 * frameSeconds_ * static_cast<double>(match.offsetFrames);
+        matches.push_back(match);
+    }
+    std::sort(matches.begin(), matches.end(), [](const FingerprintMatch& a, const FingerprintMatch& b) {
+        return a.votes != b.votes ? a.votes > b.votes : a.track < b.track;
+    });
+    if (matches.size() > maxResults)
+        matches.resize(maxResults);
+    return matches;
+}
+
+FingerprintIndexBuilder::FingerprintIndexBuilder(const std::string& path, std::size_t memoryPostings)
+    : path_(path)
+    , memoryPostings_(std::max<std::size_t>(memoryPostings, kBufferEntries))
+{
+    if (!hostIsLittleEndian())
+        throw std::runtime_error("fingerprint indexes need a little-endian host");
+}
+
+FingerprintIndexBuilder::~FingerprintIndexBuilder()
+{
+    for (const std::string& run : runs_)
+        std::remove(run.c_str());
+}
+
+std::uint32_t FingerprintIndexBuilder::addTrack(const std::string& name, const std::vector<Landmark>& landmarks)
+{
+    const auto track = static_cast<std::uint32_t>(names_.size());
+    names_.push_back(name);
+    for (const Landmark& landmark : landmarks) {
+        entries_.push_back({landmark.hash, track, landmark.frame});
+        if (entries_.size() >= memoryPostings_)
+            spill();
+    }
+    return track;
+}
+
+bool FingerprintIndexBuilder::before(const Entry& a, const Entry& b)
+{
+    if (a.hash != b.hash)
+        return a.hash < b.hash;
+    return a.track != b.track ? a.track < b.track : a.frame < b.frame;
+}
+
+void FingerprintIndexBuilder::spill()
+{
+    std::sort(entries_.begin(), entries_.end(), before);
+    const std::string run = path_ + ".run" + std::to_string(runs_.size());
+    runs_.push_back(run);
+    std::unique_ptr<std::FILE, FileCloser> file(std::fopen(run.c_str(), "wb"));
+    if (!file)
+        throw std::runtime_error("cannot create " + run);
+    if (std::fwrite(entries_.data(), sizeof(Entry), entries_.size(), file.get()) != entries_.size()
+        || std::fclose(file.release()) != 0)
+        throw std::runtime_error(run + ": write failed");
+    entries_.clear();
+}
+
+void FingerprintIndexBuilder::finish()
+{
+    struct Source {
+        std::unique_ptr<std::FILE, FileCloser> file;
+        std::vector<Entry> buffer;
+        std::size_t position = 0;
+
+        bool refill()
+        {
+            if (!file)
+                return false;
+            buffer.resize(kBufferEntries);
+            buffer.resize(std::fread(buffer.data(), sizeof(Entry), kBufferEntries, file.get()));
+            position = 0;
+            return !buffer.empty();
+        }
+    };
+
+    // Runs on disk plus the sorted remainder in memory, merged k-way.
+    std::vector<Source> sources(runs_.size() + 1);
+    for (std::size_t r = 0; r < runs_.size(); ++r) {
+        sources[r].file.reset(std::fopen(runs_[r].c_str(), "rb"));
+        if (!sources[r].file)
+            throw std::runtime_error("cannot open " + runs_[r]);
+        sources[r].refill();
+    }
+    std::sort(entries_.begin(), entries_.end(), before);
+    sources.back().buffer.swap(entries_);
+
+    const auto later = [&sources](std::size_t a, std::size_t b) {
+        return before(sources[b].buffer[sources[b].position], sources[a].buffer[sources[a].position]);
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> heads(later);
+    for (std::size_t s = 0; s < sources.size(); ++s)
+        if (!sources[s].buffer.empty())
+            heads.push(s);
+
+    std::unique_ptr<std::FILE, FileCloser> file(std::fopen(path_.c_str(), "wb"));
+    if (!file)
+        throw std::runtime_error("cannot create " + path_);
+    unsigned char header[kHeaderBytes] = {};
+    bool written = std::fwrite(header, 1, sizeof(header), file.get()) == sizeof(header);
+
+    std::vector<std::uint32_t> keys;
+    std::vector<std::uint64_t> starts;
+    std::vector<std::uint32_t> postings;
+    std::uint64_t postingCount = 0;
+    while (!heads.empty() && written) {
+        const std::size_t s = heads.top();
+        heads.pop();
+        Source& source = sources[s];
+        const Entry entry = source.buffer[source.position];
+        if (keys.empty() || keys.back() != entry.hash) {
+            keys.push_back(entry.hash);
+            starts.push_back(postingCount);
+        }
+        postings.push_back(entry.track);
+        postings.push_back(entry.frame);
+        ++postingCount;
+        if (postings.size() >= 2 * kBufferEntries) {
+            written = std::fwrite(postings.data(), 4, postings.size(), file.get()) == postings.size();
+            postings.clear();
+        }
+        if (++source.position < source.buffer.size() || source.refill())
+            heads.push(s);
+    }
+    starts.push_back(postingCount);
+    if (written && !postings.empty())
+        written = std::fwrite(postings.data(), 4, postings.size(), file.get()) == postings.size();
+
+    const std::size_t postingsOffset = kHeaderBytes;
+    const std::size_t keysOffset = postingsOffset + 8 * postingCount;
+    const std::size_t startsOffset = alignTo8(keysOffset + 4 * keys.size());
+    const std::size_t namesOffset = startsOffset + 8 * starts.size();
+    const unsigned char padding[8] = {};
+    std::vector<std::uint64_t> nameOffsets(1, 0);
+    for (const std::string& name : names_)
+        nameOffsets.push_back(nameOffsets.back() + name.size());
+
+    written = written && std::fwrite(keys.data(), 4, keys.size(), file.get()) == keys.size();
+    const std::size_t padBytes = startsOffset - (keysOffset + 4 * keys.size());
+    written = written && std::fwrite(padding, 1, padBytes, file.get()) == padBytes;
+    written = written && std::fwrite(starts.data(), 8, starts.size(), file.get()) == starts.size();
+    written = written && std::fwrite(nameOffsets.data(), 8, nameOffsets.size(), file.get()) == nameOffsets.size();
+    for (const std::string& name : names_)
+        written = written && std::fwrite(name.data(), 1, name.size(), file.get()) == name.size();
+
+    const double frameSeconds = landmarkFrameSeconds();
+    std::uint64_t secondsBits = 0;
+    std::memcpy(&secondsBits, &frameSeconds, sizeof(secondsBits));
+    std::memcpy(header, kMagic, 4);
+    writeLE32(header + 4, kVersion);
+    writeLE64(header + 8, secondsBits);
+    writeLE64(header + 16, names_.size());
+    writeLE64(header + 24, keys.size());
+    writeLE64(header + 32, postingCount);
+    writeLE64(header + 40, postingsOffset);
+    writeLE64(header + 48, keysOffset);
+    writeLE64(header + 56, startsOffset);
+    writeLE64(header + 64, namesOffset);
+    written = written && std::fseek(file.get(), 0, SEEK_SET) == 0
+              && std::fwrite(header, 1, sizeof(header), file.get()) == sizeof(header);
+    if (std::fclose(file.release()) != 0 || !written)
+        throw std::runtime_error(path_ + ": write failed");
+
+    sources.clear();
+    for (const std::string& run : runs_)
+        std::remove(run.c_str());
+    runs_.clear();
+}
+
+} // namespace audiocompare
@@ -0,0 +1,108 @@
+//
+//  FingerprintIndex.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "Fingerprint.hpp"
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+struct FingerprintMatch {
+    std::uint32_t track = 0;
+    /// Track frame minus query frame, in landmark frames.
+    std::int64_t offsetFrames = 0;
+    /// Where the query starts in the track, in milliseconds.
+    double offsetMilliseconds = 0.0;
+    /// Query landmarks that agree on the offset.
+    std::size_t votes = 0;
+};
+
+/// Inverted index from landmark hash to (track, frame) postings. The file is
+/// memory-mapped; a query binary-searches the sorted hash table and touches
+/// only the posting lists of its own hashes, so lookups stay fast with a
+/// catalogue of millions of tracks.
+class FingerprintIndex {
+public:
+    FingerprintIndex() = default;
+    FingerprintIndex(FingerprintIndex&&) = default;
+    FingerprintIndex& operator=(FingerprintIndex&&) = default;
+    FingerprintIndex(const FingerprintIndex&) = delete;
+    FingerprintIndex& operator=(const FingerprintIndex&) = delete;
+
+    /// Throws std::runtime_error when the file is missing or malformed.
+    static FingerprintIndex open(const std::string& path);
+
+    std::size_t trackCount() const { return trackCount_; }
+    std::string trackName(std::uint32_t track) const;
+    std::size_t postingCount() const { return postingCount_; }
+
+    /// Tracks whose landmarks line up with the query's at a consistent time
+    /// offset, most votes first. Matches with fewer than `minimumVotes` are
+    /// dropped. Hashes so common they carry no information are skipped.
+    std::vector<FingerprintMatch> query(const std::vector<Landmark>& landmarks, std::size_t maxResults = 5,
+                                        std::size_t minimumVotes = 10) const;
+
+private:
+    struct Posting {
+        std::uint32_t track;
+        std::uint32_t frame;
+    };
+
+    double frameSeconds_ = 0.0;
+    std::size_t trackCount_ = 0;
+    std::size_t keyCount_ = 0;
+    std::size_t postingCount_ = 0;
+    const std::uint32_t* keys_ = nullptr;
+    const std::uint64_t* starts_ = nullptr;
+    const Posting* postings_ = nullptr;
+    const std::uint64_t* nameOffsets_ = nullptr;
+    const char* names_ = nullptr;
+    std::shared_ptr<const MappedFile> file_;
+};
+
+/// Builds a `FingerprintIndex` at `path`. Postings are buffered up to
+/// `memoryPostings` entries, then sorted and spilled to a run file next to
+/// the index; `finish` merges the runs, so the catalogue may be far larger
+/// than memory. Not thread-safe.
+class FingerprintIndexBuilder {
+public:
+    explicit FingerprintIndexBuilder(const std::string& path, std::size_t memoryPostings = std::size_t(1) << 24);
+    /// Removes leftover run files.
+    ~FingerprintIndexBuilder();
+
+    FingerprintIndexBuilder(const FingerprintIndexBuilder&) = delete;
+    FingerprintIndexBuilder& operator=(const FingerprintIndexBuilder&) = delete;
+
+    /// Returns the track number that queries report.
+    std::uint32_t addTrack(const std::string& name, const std::vector<Landmark>& landmarks);
+
+    /// Writes the index. Throws std::runtime_error on I/O errors.
+    void finish();
+
+private:
+    struct Entry {
+        std::uint32_t hash;
+        std::uint32_t track;
+        std::uint32_t frame;
+    };
+
+    static bool before(const Entry& a, const Entry& b);
+    void spill();
+
+    std::string path_;
+    std::size_t memoryPostings_;
+    std::vector<Entry> entries_;
+    std::vector<std::string> runs_;
+    std::vector<std::string> names_;
+};
+
+} // namespace audiocompare
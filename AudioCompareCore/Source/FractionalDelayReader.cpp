@@ -0,0 +1,150 @@
+//
+//  FractionalDelayReader.cpp
+//  AudioCompareCore
+//
+
+#include "FractionalDelayReader.hpp"
+
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const std::size_t kBlockFrames = 4096;
+
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double quarterSquare = 0.25 * x * x;
+    for (int k = 1; k < 64 && term > 1e-12 * sum; ++k) {
+        term *= quarterSquare / (static_cast<double>(k) * static_cast<double>(k));
+        sum += term;
+    }
+    return sum;
+}
+
+} // namespace
+
+std::vector<float> designFractionalDelay(std::size_t halfLength, double delay, double kaiserBeta)
+{
+    // Tap i weights source[n - halfLength + 1 + i]; its ideal value is
+    // sinc(j + delay) with j = i - halfLength + 1 the distance from n.
+    const double pi = 3.14159265358979323846;
+    const std::size_t length = 2 * halfLength;
+    const double radius = static_cast<double>(halfLength);
+    const double normalizer = besselI0(kaiserBeta);
+    std::vector<double> taps(length);
+    double sum = 0.0;
+    for (std::size_t i = 0; i < length; ++i) {
+        const double x = static_cast<double>(i) - radius + 1.0 + delay;
+        const double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(pi * x) / (pi * x);
+        const double ratio = x / radius;
+        const double window = std::fabs(ratio) < 1.0
+                                  ? besselI0(kaiserBeta * std::sqrt(1.0 - ratio * ratio)) / normalizer
+                                  : 0.0;
+        taps[i] = sinc * window;
+        sum += taps[i];
+    }
+    std::vector<float> result(length);
+    for (std::size_t i = 0; i < length; ++i)
+        result[i] = static_cast<float>(taps[i] / sum);
+    return result;
+}
+
+FractionalDelayReader::FractionalDelayReader(AudioReader& source, double delay,
+                                             std::size_t halfLength, double kaiserBeta)
+    : source_(source)
+    , delay_(delay)
+    , halfLength_(halfLength)
+{
+    if (halfLength == 0 || std::fabs(delay) > 1.0)
+        throw std::invalid_argument("invalid fractional delay");
+
+    taps_ = designFractionalDelay(halfLength, delay, kaiserBeta);
+    const std::size_t length = taps_.size();
+
+    const std::size_t channels = source.format().channelCount;
+    window_.resize(channels, kBlockFrames + length - 1);
+    readPointers_.resize(channels);
+    seekToFrame(source.framePosition());
+}
+
+std::int64_t FractionalDelayReader::frameCount() const
+{
+    const std::int64_t sourceFrames = source_.frameCount();
+    if (sourceFrames < 0)
+        return -1;
+    return std::max<std::int64_t>(sourceFrames - static_cast<std::int64_t>(halfLength_), 0);
+}
+
+void FractionalDelayReader::seekToFrame(std::int64_t frame)
+{
+    position_ = std::max<std::int64_t>(frame, 0);
+    const std::int64_t windowStart = position_ - static_cast<std::int64_t>(halfLength_) + 1;
+    const std::size_t zeroPrefix = windowStart < 0 ? static_cast<std::size_t>(-windowStart) : 0;
+    window_.clear();
+    available_ = zeroPrefix;
+    sourceEnd_ = -1;
+    source_.seekToFrame(std::max<std::int64_t>(windowStart, 0));
+}
+
+void FractionalDelayReader::fillWindow(std::size_t needed)
+{
+    while (available_ < needed && sourceEnd_ < 0) {
+        for (std::size_t c = 0; c < window_.channelCount(); ++c)
+            readPointers_[c] = window_.channel(c) + available_;
+        const std::size_t got = source_.readFrames(readPointers_.data(), needed - available_);
+        if (got == 0) {
+            sourceEnd_ = position_ - static_cast<std::int64_t>(halfLength_) + 1
+                         + static_cast<std::int64_t>(available_);
+            break;
+        }
+        available_ += got;
+    }
+    // Past the end of the source the filter runs on silence.
+    if (available_ < needed) {
+        for (std::size_t c = 0; c < window_.channelCount(); ++c)
+            std::fill(window_.channel(c) + available_, window_.channel(c) + needed, 0.0f);
+        available_ = needed;
+    }
+}
+
+std::size_t FractionalDelayReader::readFrames(float* const* buffers, std::size_t frames)
+{
+    const std::size_t length = taps_.size();
+    const std::size_t channels = window_.channelCount();
+    std::size_t done = 0;
+
+    while (done < frames) {
+        std::size_t chunk = std::min(kBlockFrames, frames - done);
+        fillWindow(chunk + length - 1);
+        if (sourceEnd_ >= 0) {
+            const std::int64_t supported = sourceEnd_ - static_cast<std::int64_t>(halfLength_) - position_;
+            chunk = static_cast<std::size_t>(std::clamp<std::int64_t>(supported, 0,
+                                                                      static_cast<std::int64_t>(chunk)));
+        }
+        if (chunk == 0)
+            break;
+
+        for (std::size_t c = 0; c < channels; ++c) {
+            const float* input = window_.channel(c);
+            float* output = buffers[c] + done;
+            for (std::size_t i = 0; i < chunk; ++i)
+                output[i] = dotProduct(taps_.data(), input + i, length);
+            std::memmove(window_.channel(c), input + chunk, (available_ - chunk) * sizeof(float));
+        }
+        available_ -= chunk;
+        position_ += static_cast<std::int64_t>(chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+} // namespace audiocompare
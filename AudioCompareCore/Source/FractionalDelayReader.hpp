@@ -0,0 +1,60 @@
+//
+//  FractionalDelayReader.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "AudioUtilities.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace audiocompare {
+
+/// Kaiser-windowed sinc taps (2 * halfLength, unit DC gain) for
+/// output[n] = sum(taps[i] * source[n - halfLength + 1 + i]) = source(n - delay).
+std::vector<float> designFractionalDelay(std::size_t halfLength, double delay, double kaiserBeta);
+
+/// Delays a source by a fraction of a sample with a Kaiser-windowed sinc FIR,
+/// so output[n] = source(n - delay). Seeking re-primes the filter history from
+/// the source, so block boundaries and seeks leave no edge artefacts. The last
+/// `halfLength` source frames lack full filter support and are not produced.
+/// Frames before `firstSupportedFrame` are filtered against silence in place
+/// of the missing history, so exact results start there.
+class FractionalDelayReader : public AudioReader {
+public:
+    /// `delay` must lie in [-1, 1]; the filter has 2 * halfLength taps.
+    FractionalDelayReader(AudioReader& source, double delay,
+                          std::size_t halfLength = 32, double kaiserBeta = 12.0);
+
+    AudioFormat format() const override { return source_.format(); }
+    std::int64_t frameCount() const override;
+    std::size_t readFrames(float* const* buffers, std::size_t frames) override;
+    void seekToFrame(std::int64_t frame) override;
+    std::int64_t framePosition() const override { return position_; }
+
+    /// First frame whose filter support starts at or after source frame 0.
+    std::int64_t firstSupportedFrame() const { return static_cast<std::int64_t>(halfLength_) - 1; }
+
+    double delay() const { return delay_; }
+    const std::vector<float>& taps() const { return taps_; }
+
+private:
+    void fillWindow(std::size_t needed);
+
+    AudioReader& source_;
+    double delay_;
+    std::size_t halfLength_;
+    std::vector<float> taps_;
+    FloatBuffers window_;
+    std::vector<float*> readPointers_;
+    /// Valid source samples in `window_`, which starts at position_ - halfLength_ + 1.
+    std::size_t available_ = 0;
+    std::int64_t position_ = 0;
+    /// Source length once its end has been reached, else -1.
+    std::int64_t sourceEnd_ = -1;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,159 @@
+//
+//  FrameFeatures.cpp
+//  AudioCompareCore
+//
+
+#include "FrameFeatures.hpp"
+
+#include "AudioUtilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace audiocompare {
+
+namespace {
+
+const double kFrameSeconds = 0.05;
+const double kWindowSeconds = 8192.0 / 44100.0;
+const double kChromaLowHz = 55.0;
+const double kChromaHighHz = 5000.0;
+const std::size_t kMelBands = 26;
+const double kMelLowHz = 60.0;
+const double kMelHighHz = 8000.0;
+const double kEnergyFloor = 1e-12;
+const std::size_t kReadFrames = 16384;
+
+std::size_t nearestPowerOfTwo(double value)
+{
+    const double exponent = std::round(std::log2(std::max(value, 64.0)));
+    return static_cast<std::size_t>(1) << static_cast<int>(exponent);
+}
+
+double hzToMel(double hz)
+{
+    return 2595.0 * std::log10(1.0 + hz / 700.0);
+}
+
+double melToHz(double mel)
+{
+    return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+}
+
+} // namespace
+
+FrameFeatureExtractor::FrameFeatureExtractor(double sampleRate)
+    : stream_(nearestPowerOfTwo(sampleRate * kWindowSeconds),
+              static_cast<std::size_t>(std::lround(sampleRate * kFrameSeconds)))
+    , fullScale_(static_cast<double>(stream_.fftSize()) / 4.0)
+    , pitchClass_(stream_.binCount(), -1)
+    , filters_(kMelBands)
+    , dct_(FrameFeatures::kMfccCoefficients * kMelBands)
+    , power_(stream_.binCount())
+    , melLog_(kMelBands)
+{
+    const double binHz = sampleRate / static_cast<double>(stream_.fftSize());
+    const std::size_t binCount = stream_.binCount();
+
+    // Pitch class of every bin in the chroma range, -1 elsewhere.
+    for (std::size_t k = 1; k < binCount; ++k) {
+        const double hz = static_cast<double>(k) * binHz;
+        if (hz >= kChromaLowHz && hz <= kChromaHighHz) {
+            const long note = std::lround(12.0 * std::log2(hz / 440.0)) + 69;
+            pitchClass_[k] = static_cast<int>(((note % 12) + 12) % 12);
+        }
+    }
+
+    // Triangular mel filters, each over bins [first, first + weights.size()).
+    const double high = std::min(kMelHighHz, 0.5 * sampleRate);
+    const double lowMel = hzToMel(kMelLowHz);
+    const double highMel = hzToMel(high);
+    std::vector<double> centres(kMelBands + 2);
+    for (std::size_t m = 0; m < centres.size(); ++m)
+        centres[m] = melToHz(lowMel + (highMel - lowMel) * static_cast<double>(m) / (kMelBands + 1)) / binHz;
+    for (std::size_t m = 0; m < kMelBands; ++m) {
+        const double left = centres[m];
+        const double centre = centres[m + 1];
+        const double right = centres[m + 2];
+        MelFilter& filter = filters_[m];
+        filter.first = static_cast<std::size_t>(std::ceil(left));
+        const std::size_t last = std::min(binCount - 1, static_cast<std::size_t>(std::floor(right)));
+        for (std::size_t k = filter.first; k <= last; ++k) {
+            const double x = static_cast<double>(k);
+            const double weight = x <= centre ? (x - left) / (centre - left) : (right - x) / (right - centre);
+            filter.weights.push_back(static_cast<float>(std::max(0.0, weight)));
+        }
+        // Narrow low bands can fall between bins; give them the nearest one.
+        if (filter.weights.empty()) {
+            filter.first = std::min(binCount - 1, static_cast<std::size_t>(std::lround(centre)));
+            filter.weights.push_back(1.0f);
+        }
+    }
+
+    const double pi = std::acos(-1.0);
+    for (std::size_t c = 0; c < FrameFeatures::kMfccCoefficients; ++c)
+        for (std::size_t m = 0; m < kMelBands; ++m)
+            dct_[c * kMelBands + m]
+                = static_cast<float>(std::cos(pi * static_cast<double>(c) * (m + 0.5) / kMelBands));
+    features_.frameSeconds = static_cast<double>(stream_.hopSize()) / sampleRate;
+}
+
+void FrameFeatureExtractor::process(ChannelView mono)
+{
+    stream_.push(mono, [this](const float* magnitudes) { analyse(magnitudes); });
+}
+
+FrameFeatures FrameFeatureExtractor::finish()
+{
+    stream_.flush([this](const float* magnitudes) { analyse(magnitudes); });
+    return std::move(features_);
+}
+
+void FrameFeatureExtractor::analyse(const float* magnitudes)
+{
+    const std::size_t binCount = stream_.binCount();
+    double total = 0.0;
+    for (std::size_t k = 0; k < binCount; ++k) {
+        power_[k] = magnitudes[k] * magnitudes[k];
+        total += power_[k];
+    }
+    features_.levelDb.push_back(
+        static_cast<float>(10.0 * std::log10(total / (fullScale_ * fullScale_) + kEnergyFloor)));
+
+    float chroma[FrameFeatures::kChromaBins] = {};
+    for (std::size_t k = 0; k < binCount; ++k)
+        if (pitchClass_[k] >= 0)
+            chroma[pitchClass_[k]] += power_[k];
+    const float peak = *std::max_element(chroma, chroma + FrameFeatures::kChromaBins);
+    for (float value : chroma)
+        features_.chroma.push_back(peak > 0.0f ? value / peak : 0.0f);
+
+    for (std::size_t m = 0; m < kMelBands; ++m) {
+        double energy = 0.0;
+        for (std::size_t w = 0; w < filters_[m].weights.size(); ++w)
+            energy += static_cast<double>(filters_[m].weights[w]) * power_[filters_[m].first + w];
+        melLog_[m] = static_cast<float>(std::log(energy / (fullScale_ * fullScale_) + kEnergyFloor));
+    }
+    for (std::size_t c = 0; c < FrameFeatures::kMfccCoefficients; ++c) {
+        float sum = 0.0f;
+        for (std::size_t m = 0; m < kMelBands; ++m)
+            sum += dct_[c * kMelBands + m] * melLog_[m];
+        features_.mfcc.push_back(sum);
+    }
+    ++features_.frameCount;
+}
+
+FrameFeatures extractFrameFeatures(AudioReader& reader)
+{
+    const AudioFormat format = reader.format();
+    FrameFeatureExtractor extractor(format.sampleRate);
+    FloatBuffers block(format.channelCount, kReadFrames);
+    std::vector<float> mono(kReadFrames);
+    while (const std::size_t read = reader.readFrames(block.data(), kReadFrames)) {
+        mixToMono(block.view(0, read), mono.data());
+        extractor.process(ChannelView(mono.data(), read));
+    }
+    return extractor.finish();
+}
+
+} // namespace audiocompare
@@ -0,0 +1,70 @@
+//
+//  FrameFeatures.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+#include "AudioReader.hpp"
+#include "BatchedStft.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace audiocompare {
+
+/// Per-frame chroma and MFCCs of a mono downmix, 50 ms apart. Rows are
+/// frame-major: frame `f` starts at `chroma[f * kChromaBins]` and
+/// `mfcc[f * kMfccCoefficients]`.
+struct FrameFeatures {
+    static constexpr std::size_t kChromaBins = 12;
+    static constexpr std::size_t kMfccCoefficients = 13;
+
+    std::size_t frameCount = 0;
+    double frameSeconds = 0.0;
+    /// Pitch-class energy from 55 Hz to 5 kHz, scaled so each frame peaks at 1.
+    std::vector<float> chroma;
+    /// DCT of 26 log mel-band energies between 60 Hz and 8 kHz; coefficient 0
+    /// carries the level.
+    std::vector<float> mfcc;
+    /// Frame level in dB relative to a full-scale sine.
+    std::vector<float> levelDb;
+};
+
+/// Streams mono samples through a `SpectrogramStream` window of about 186 ms,
+/// long enough to resolve semitones down to 55 Hz.
+class FrameFeatureExtractor {
+public:
+    explicit FrameFeatureExtractor(double sampleRate);
+
+    /// Feeds mono samples, in any block size.
+    void process(ChannelView mono);
+    /// Frames analysed so far, which may trail `process` by one batch.
+    const FrameFeatures& features() const { return features_; }
+    FrameFeatures finish();
+
+private:
+    struct MelFilter {
+        std::size_t first = 0;
+        std::vector<float> weights;
+    };
+
+    void analyse(const float* magnitudes);
+
+    SpectrogramStream stream_;
+    double fullScale_;
+    std::vector<int> pitchClass_;
+    std::vector<MelFilter> filters_;
+    std::vector<float> dct_;
+    std::vector<float> power_;
+    std::vector<float> melLog_;
+    FrameFeatures features_;
+};
+
+/// Runs a `FrameFeatureExtractor` over `reader` from its current position to
+/// the end.
+FrameFeatures extractFrameFeatures(AudioReader& reader);
+
+} // namespace audiocompare
@@ -0,0 +1,226 @@
+//
+//  HashManifest.cpp
+//  AudioCompareCore
+//
+
+#include "HashManifest.hpp"
+
+#include "BlockHash.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const char kMagic[4] = {'A', 'C', 'H', 'M'};
+const std::uint32_t kVersion = 1;
+const std::size_t kHeaderBytes = 40;
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+
+void writeLE32(unsigned char* p, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void writeLE64(unsigned char* p, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+std::uint32_t readLE32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t readLE64(const unsigned char* p)
+{
+    return static_cast<std::uint64_t>(readLE32(p)) | (static_cast<std::uint64_t>(readLE32(p + 4)) << 32);
+}
+
+} // namespace
+
+std::size_t HashManifest::blockCount() const
+{
+    return channelCount > 0 ? hashes.size() / channelCount : 0;
+}
+
+std::uint64_t HashManifest::hash(std::size_t block, std::size_t channel) const
+{
+    return hashes[block * channelCount + channel];
+}
+
+void HashManifest::write(const std::string& path) const
+{
+    std::unique_ptr<std::FILE, FileCloser> file(std::fopen(path.c_str(), "wb"));
+    if (!file)
+        throw std::runtime_error("cannot create " + path);
+
+    unsigned char header[kHeaderBytes];
+    std::uint64_t rateBits = 0;
+    std::memcpy(&rateBits, &sampleRate, sizeof(rateBits));
+    std::memcpy(header, kMagic, 4);
+    writeLE32(header + 4, kVersion);
+    writeLE32(header + 8, static_cast<std::uint32_t>(channelCount));
+    writeLE32(header + 12, static_cast<std::uint32_t>(blockFrames));
+    writeLE64(header + 16, rateBits);
+    writeLE64(header + 24, static_cast<std::uint64_t>(frames));
+    writeLE64(header + 32, hashes.size());
+
+    std::vector<unsigned char> body(hashes.size() * 8);
+    for (std::size_t i = 0; i < hashes.size(); ++i)
+        writeLE64(body.data() + 8 * i, hashes[i]);
+    if (std::fwrite(header, 1, sizeof(header), file.get()) != sizeof(header)
+        || std::fwrite(body.data(), 1, body.size(), file.get()) != body.size()
+        || std::fclose(file.release()) != 0)
+        throw std::runtime_error(path + ": write failed");
+}
+
+HashManifest HashManifest::read(const std::string& path)
+{
+    std::unique_ptr<std::FILE, FileCloser> file(std::fopen(path.c_str(), "rb"));
+    if (!file)
+        throw std::runtime_error("cannot open " + path);
+
+    unsigned char header[kHeaderBytes];
+    if (std::fread(header, 1, sizeof(header), file.get()) != sizeof(header)
+        || std::memcmp(header, kMagic, 4) != 0)
+        throw std::runtime_error(path + ": not a hash manifest");
+    if (readLE32(header + 4) != kVersion)
+        throw std::runtime_error(path + ": unsupported manifest version");
+
+    HashManifest manifest;
+    const std::uint64_t rateBits = readLE64(header + 16);
+    std::memcpy(&manifest.sampleRate, &rateBits, sizeof(rateBits));
+    manifest.channelCount = readLE32(header + 8);
+    manifest.blockFrames = readLE32(header + 12);
+    manifest.frames = static_cast<std::int64_t>(readLE64(header + 24));
+    const std::uint64_t count = readLE64(header + 32);
+    if (manifest.channelCount == 0 || manifest.blockFrames == 0 || manifest.frames < 0
+        || count % manifest.channelCount != 0
+        || count / manifest.channelCount
+               != (static_cast<std::uint64_t>(manifest.frames) + manifest.blockFrames - 1) / manifest.blockFrames)
+        throw std::runtime_error(path + ": malformed manifest");
+
+    std::vector<unsigned char> body(count * 8);
+    if (std::fread(body.data(), 1, body.size(), file.get()) != body.size())
+        throw std::runtime_error(path + ": truncated manifest");
+    manifest.hashes.resize(count);
+    for (std::size_t i = 0; i < count; ++i)
+        manifest.hashes[i] = readLE64(body.data() + 8 * i);
+    return manifest;
+}
+
+ManifestDifference diffManifests(const HashManifest& reference, const HashManifest& candidate)
+{
+    if (reference.blockFrames != candidate.blockFrames)
+        throw std::invalid_argument("manifest block sizes differ");
+    if (reference.channelCount != candidate.channelCount)
+        throw std::invalid_argument("manifest channel counts differ");
+
+    const std::size_t channels = reference.channelCount;
+    const std::size_t common = std::min(reference.blockCount(), candidate.blockCount());
+    ManifestDifference difference;
+    for (std::size_t block = 0; block < common; ++block) {
+        const std::uint64_t* a = reference.hashes.data() + block * channels;
+        const std::uint64_t* b = candidate.hashes.data() + block * channels;
+        if (std::equal(a, a + channels, b))
+            continue;
+        if (difference.firstBlock < 0) {
+            difference.firstBlock = static_cast<std::int64_t>(block);
+            difference.firstChannel = std::mismatch(a, a + channels, b).first - a;
+        }
+        ++difference.differingBlocks;
+    }
+
+    const std::size_t longest = std::max(reference.blockCount(), candidate.blockCount());
+    if (longest > common) {
+        difference.differingBlocks += static_cast<std::int64_t>(longest - common);
+        if (difference.firstBlock < 0) {
+            difference.firstBlock = static_cast<std::int64_t>(common);
+            difference.firstChannel = 0;
+        }
+    }
+    if (difference.firstBlock >= 0)
+        difference.firstFrame = difference.firstBlock * static_cast<std::int64_t>(reference.blockFrames);
+    return difference;
+}
+
+HashManifestBuilder::HashManifestBuilder(std::size_t channelCount, double sampleRate,
+                                         std::size_t blockFrames, std::int64_t capacityFrames)
+    : capacityFrames_(capacityFrames)
+    , pending_(channelCount, blockFrames)
+{
+    if (channelCount == 0 || blockFrames == 0)
+        throw std::invalid_argument("manifest needs channels and a positive block size");
+    if (capacityFrames < 0)
+        throw std::invalid_argument("manifest capacity must not be negative");
+    manifest_.sampleRate = sampleRate;
+    manifest_.channelCount = channelCount;
+    manifest_.blockFrames = blockFrames;
+    const std::size_t blocks = static_cast<std::size_t>((capacityFrames + blockFrames - 1) / blockFrames);
+    manifest_.hashes.assign(blocks * channelCount, 0);
+}
+
+void HashManifestBuilder::process(const AudioBufferView& buffers)
+{
+    const auto frames = static_cast<std::size_t>(std::min<std::int64_t>(
+        static_cast<std::int64_t>(buffers.frames()), capacityFrames_ - manifest_.frames));
+    const std::size_t blockFrames = manifest_.blockFrames;
+    std::size_t offset = 0;
+    while (offset < frames) {
+        const std::size_t count = std::min(blockFrames - pendingFrames_, frames - offset);
+        for (std::size_t c = 0; c < manifest_.channelCount; ++c)
+            std::memcpy(pending_.channel(c) + pendingFrames_, buffers.channel(c).data() + offset,
+                        count * sizeof(float));
+        pendingFrames_ += count;
+        offset += count;
+        if (pendingFrames_ == blockFrames)
+            hashPendingBlock();
+    }
+    manifest_.frames += static_cast<std::int64_t>(frames);
+}
+
+void HashManifestBuilder::finish()
+{
+    if (pendingFrames_ > 0)
+        hashPendingBlock();
+    manifest_.hashes.resize(hashedBlocks_ * manifest_.channelCount);
+}
+
+void HashManifestBuilder::hashPendingBlock()
+{
+    std::uint64_t* out = manifest_.hashes.data() + hashedBlocks_ * manifest_.channelCount;
+    for (std::size_t c = 0; c < manifest_.channelCount; ++c)
+        out[c] = hashBytes(pending_.channel(c), pendingFrames_ * sizeof(float));
+    ++hashedBlocks_;
+    pendingFrames_ = 0;
+}
+
+HashManifest computeManifest(AudioReader& reader, std::size_t blockFrames)
+{
+    const AudioFormat format = reader.format();
+    const std::int64_t total = reader.frameCount();
+    if (total < 0)
+        throw std::invalid_argument("manifest needs a reader with a known length");
+
+    HashManifestBuilder builder(format.channelCount, format.sampleRate, blockFrames,
+                                total - reader.framePosition());
+    FloatBuffers block(format.channelCount, blockFrames);
+    while (const std::size_t frames = reader.readFrames(block.data(), blockFrames))
+        builder.process(block.view(0, frames));
+    builder.finish();
+    return builder.manifest();
+}
+
+} // namespace audiocompare
@@ -0,0 +1,83 @@
+//
+//  HashManifest.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "AudioUtilities.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+/// One `hashBytes` digest per `blockFrames` block and channel of a render.
+/// Two manifests of the same material locate the first divergent block
+/// without re-rendering either side.
+struct HashManifest {
+    double sampleRate = 0.0;
+    std::size_t channelCount = 0;
+    std::size_t blockFrames = 0;
+    std::int64_t frames = 0;
+    /// Block-major: `hashes[block * channelCount + channel]`.
+    std::vector<std::uint64_t> hashes;
+
+    std::size_t blockCount() const;
+    std::uint64_t hash(std::size_t block, std::size_t channel) const;
+
+    /// Binary little-endian file. Throws std::runtime_error on I/O errors or
+    /// a malformed file.
+    void write(const std::string& path) const;
+    static HashManifest read(const std::string& path);
+};
+
+struct ManifestDifference {
+    std::int64_t differingBlocks = 0;
+    /// First divergent block and the lowest channel differing in it, or -1.
+    std::int64_t firstBlock = -1;
+    std::int64_t firstChannel = -1;
+    std::int64_t firstFrame = -1;
+
+    bool identical() const { return differingBlocks == 0; }
+};
+
+/// Compares two manifests block by block. Blocks present in only one of them
+/// count as differing. Throws std::invalid_argument when the block size or
+/// channel count differ.
+ManifestDifference diffManifests(const HashManifest& reference, const HashManifest& candidate);
+
+/// Builds a manifest from render callbacks, the per-block counterpart of the
+/// `md5` computed by `AKTesterAudioUnit`. Storage for `capacityFrames` frames
+/// is allocated up front and `process` neither allocates nor locks, so it can
+/// run on the render thread; like AKTester, frames beyond the capacity are
+/// ignored.
+class HashManifestBuilder {
+public:
+    HashManifestBuilder(std::size_t channelCount, double sampleRate, std::size_t blockFrames,
+                        std::int64_t capacityFrames);
+
+    void process(const AudioBufferView& buffers);
+    /// Hashes the final partial block. Call once rendering has stopped.
+    void finish();
+
+    bool complete() const { return manifest_.frames == capacityFrames_; }
+    const HashManifest& manifest() const { return manifest_; }
+
+private:
+    void hashPendingBlock();
+
+    HashManifest manifest_;
+    std::int64_t capacityFrames_;
+    FloatBuffers pending_;
+    std::size_t pendingFrames_ = 0;
+    std::size_t hashedBlocks_ = 0;
+};
+
+/// Reads `reader` from its current position to the end into a manifest.
+HashManifest computeManifest(AudioReader& reader, std::size_t blockFrames);
+
+} // namespace audiocompare
@@ -0,0 +1,153 @@
+//
+//  MappedFile.cpp
+//  AudioCompareCore
+//
+
+#include "MappedFile.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define AUDIOCOMPARE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace audiocompare {
+
+#if AUDIOCOMPARE_MMAP
+
+MappedFile::MappedFile(const std::string& path)
+    : path_(path)
+{
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("cannot open " + path);
+    struct stat info;
+    if (::fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        throw std::runtime_error(path + ": cannot stat");
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ > 0) {
+        void* address = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+        if (address == MAP_FAILED) {
+            ::close(descriptor);
+            throw std::runtime_error(path + ": cannot map");
+        }
+        data_ = static_cast<const unsigned char*>(address);
+        mapped_ = true;
+    }
+    ::close(descriptor);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mapped_)
+        ::munmap(const_cast<unsigned char*>(data_), size_);
+}
+
+MappedOutputFile::MappedOutputFile(const std::string& path, std::size_t size)
+    : path_(path)
+    , size_(size)
+{
+    const int descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0)
+        throw std::runtime_error("cannot create " + path);
+    if (::ftruncate(descriptor, static_cast<off_t>(size)) != 0) {
+        ::close(descriptor);
+        throw std::runtime_error(path + ": cannot resize");
+    }
+    if (size > 0) {
+        void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        if (address == MAP_FAILED) {
+            ::close(descriptor);
+            throw std::runtime_error(path + ": cannot map");
+        }
+        data_ = static_cast<unsigned char*>(address);
+    }
+    ::close(descriptor);
+    open_ = true;
+}
+
+MappedOutputFile::~MappedOutputFile()
+{
+    if (open_ && data_)
+        ::munmap(data_, size_);
+}
+
+void MappedOutputFile::close()
+{
+    if (!open_)
+        return;
+    open_ = false;
+    if (!data_)
+        return;
+    const bool synced = ::msync(data_, size_, MS_SYNC) == 0;
+    ::munmap(data_, size_);
+    data_ = nullptr;
+    if (!synced)
+        throw std::runtime_error(path_ + ": write failed");
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+    : path_(path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("cannot open " + path);
+    unsigned char chunk[65536];
+    while (const std::size_t got = std::fread(chunk, 1, sizeof(chunk), file))
+        fallback_.insert(fallback_.end(), chunk, chunk + got);
+    const bool failed = std::ferror(file) != 0;
+    std::fclose(file);
+    if (failed)
+        throw std::runtime_error(path + ": read failed");
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+MappedOutputFile::MappedOutputFile(const std::string& path, std::size_t size)
+    : path_(path)
+    , size_(size)
+    , fallback_(size)
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("cannot create " + path);
+    std::fclose(file);
+    data_ = fallback_.data();
+    open_ = true;
+}
+
+MappedOutputFile::~MappedOutputFile()
+{
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void MappedOutputFile::close()
+{
+    if (!open_)
+        return;
+    open_ = false;
+    std::FILE* file = std::fopen(path_.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("cannot create " + path_);
+    const bool written = std::fwrite(fallback_.data(), 1, size_, file) == size_;
+    if (std::fclose(file) != 0 || !written)
+        throw std::runtime_error(path_ + ": write failed");
+}
+
+#endif
+
+} // namespace audiocompare
@@ -0,0 +1,66 @@
+//
+//  MappedFile.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+/// Read-only view of a whole file. Uses mmap where available, so opening a
+/// large file costs no reads and pages are loaded on first access; other
+/// platforms fall back to reading the file into memory.
+class MappedFile {
+public:
+    /// Throws std::runtime_error when the file cannot be opened or mapped.
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<unsigned char> fallback_;
+};
+
+/// Writable counterpart of `MappedFile`: creates (or truncates) a file of
+/// `size` bytes and maps it shared, so disjoint ranges can be filled from
+/// several threads and the kernel writes the pages back. Other platforms
+/// fill a buffer that `close` writes out.
+class MappedOutputFile {
+public:
+    /// Throws std::runtime_error when the file cannot be created or mapped.
+    MappedOutputFile(const std::string& path, std::size_t size);
+    /// Closes the file, ignoring errors; call `close` to see them.
+    ~MappedOutputFile();
+
+    MappedOutputFile(const MappedOutputFile&) = delete;
+    MappedOutputFile& operator=(const MappedOutputFile&) = delete;
+
+    unsigned char* data() { return data_; }
+    std::size_t size() const { return size_; }
+
+    /// Flushes and unmaps. Throws std::runtime_error on I/O errors.
+    void close();
+
+private:
+    std::string path_;
+    unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_ = false;
+    std::vector<unsigned char> fallback_;
+};
+
+} // namespace audiocompare
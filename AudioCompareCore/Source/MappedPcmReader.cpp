@@ -0,0 +1,357 @@
+//
+//  MappedPcmReader.cpp
+//  AudioCompareCore
+//
+
+#include "MappedPcmReader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const std::size_t kBlockFrames = 4096;
+
+// CAF linear PCM format flags.
+const std::uint32_t kCafFloatFlag = 1;
+const std::uint32_t kCafLittleEndianFlag = 2;
+
+std::uint16_t readLE16(const unsigned char* p)
+{
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+std::uint32_t readLE32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t readLE64(const unsigned char* p)
+{
+    return static_cast<std::uint64_t>(readLE32(p)) | (static_cast<std::uint64_t>(readLE32(p + 4)) << 32);
+}
+
+std::uint16_t readBE16(const unsigned char* p)
+{
+    return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+std::uint32_t readBE32(const unsigned char* p)
+{
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16)
+           | (static_cast<std::uint32_t>(p[2]) << 8) | static_cast<std::uint32_t>(p[3]);
+}
+
+std::uint64_t readBE64(const unsigned char* p)
+{
+    return (static_cast<std::uint64_t>(readBE32(p)) << 32) | readBE32(p + 4);
+}
+
+/// The 80-bit IEEE extended sample rate of an AIFF COMM chunk.
+double readExtended(const unsigned char* p)
+{
+    const int exponent = ((p[0] & 0x7F) << 8) | p[1];
+    const std::uint64_t mantissa = readBE64(p + 2);
+    if (exponent == 0 && mantissa == 0)
+        return 0.0;
+    const double value = std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+    return (p[0] & 0x80) ? -value : value;
+}
+
+bool integerFormat(unsigned bits, SampleFormat& format)
+{
+    switch ((bits + 7) / 8) {
+    case 1: format = SampleFormat::Int8; return true;
+    case 2: format = SampleFormat::Int16; return true;
+    case 3: format = SampleFormat::Int24; return true;
+    case 4: format = SampleFormat::Int32; return true;
+    default: return false;
+    }
+}
+
+} // namespace
+
+MappedPcmReader::MappedPcmReader(const std::string& path)
+    : file_(std::make_shared<const MappedFile>(path))
+{
+    const unsigned char* data = file_->data();
+    if (file_->size() >= 12 && (std::memcmp(data, "RIFF", 4) == 0 || std::memcmp(data, "RF64", 4) == 0)
+        && std::memcmp(data + 8, "WAVE", 4) == 0) {
+        container_ = ContainerFormat::Wave;
+        parseWave();
+    } else if (file_->size() >= 12 && std::memcmp(data, "FORM", 4) == 0
+               && (std::memcmp(data + 8, "AIFF", 4) == 0 || std::memcmp(data + 8, "AIFC", 4) == 0)) {
+        container_ = ContainerFormat::Aiff;
+        parseAiff();
+    } else if (file_->size() >= 8 && std::memcmp(data, "caff", 4) == 0) {
+        container_ = ContainerFormat::Caf;
+        parseCaf();
+    } else {
+        throw std::runtime_error(path + ": not a WAVE, AIFF or CAF file");
+    }
+    if (format_.channelCount == 0 || !(format_.sampleRate > 0.0))
+        throw std::runtime_error(path + ": invalid format");
+}
+
+void MappedPcmReader::parseWave()
+{
+    const unsigned char* data = file_->data();
+    const std::uint64_t size = file_->size();
+    const bool isRf64 = std::memcmp(data, "RF64", 4) == 0;
+    std::uint64_t rf64DataSize = 0;
+    bool haveFormat = false;
+
+    for (std::uint64_t offset = 12; offset + 8 <= size;) {
+        const unsigned char* chunk = data + offset;
+        std::uint64_t chunkSize = readLE32(chunk + 4);
+        const std::uint64_t available = size - offset - 8;
+
+        if (std::memcmp(chunk, "ds64", 4) == 0) {
+            if (chunkSize < 24 || available < 24)
+                throw std::runtime_error(path() + ": malformed ds64 chunk");
+            rf64DataSize = readLE64(chunk + 16);
+        } else if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || available < chunkSize)
+                throw std::runtime_error(path() + ": malformed fmt chunk");
+            const unsigned char* fmt = chunk + 8;
+            std::uint16_t tag = readLE16(fmt);
+            format_.channelCount = readLE16(fmt + 2);
+            format_.sampleRate = readLE32(fmt + 4);
+            const std::uint16_t bits = readLE16(fmt + 14);
+            if (tag == 0xFFFE && chunkSize >= 40)
+                tag = readLE16(fmt + 24);
+
+            if (tag == 1 && bits == 8)
+                sampleFormat_ = SampleFormat::UInt8;
+            else if (tag == 1 && bits == 16)
+                sampleFormat_ = SampleFormat::Int16;
+            else if (tag == 1 && bits == 24)
+                sampleFormat_ = SampleFormat::Int24;
+            else if (tag == 1 && bits == 32)
+                sampleFormat_ = SampleFormat::Int32;
+            else if (tag == 3 && bits == 32)
+                sampleFormat_ = SampleFormat::Float32;
+            else if (tag == 3 && bits == 64)
+                sampleFormat_ = SampleFormat::Float64;
+            else
+                throw std::runtime_error(path() + ": unsupported sample format");
+            byteOrder_ = ByteOrder::LittleEndian;
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat)
+                throw std::runtime_error(path() + ": data chunk before fmt chunk");
+            if (isRf64 && chunkSize == 0xFFFFFFFFu)
+                chunkSize = rf64DataSize;
+            setDataChunk(offset + 8, chunkSize);
+            return;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    throw std::runtime_error(path() + ": no data chunk");
+}
+
+void MappedPcmReader::parseAiff()
+{
+    const unsigned char* data = file_->data();
+    const std::uint64_t size = file_->size();
+    const bool isCompressedType = std::memcmp(data + 8, "AIFC", 4) == 0;
+    std::uint64_t declaredFrames = 0;
+    std::uint64_t soundOffset = 0;
+    std::uint64_t soundSize = 0;
+    bool haveFormat = false;
+    bool haveSound = false;
+
+    for (std::uint64_t offset = 12; offset + 8 <= size;) {
+        const unsigned char* chunk = data + offset;
+        const std::uint64_t chunkSize = readBE32(chunk + 4);
+        const std::uint64_t available = size - offset - 8;
+
+        if (std::memcmp(chunk, "COMM", 4) == 0) {
+            if (chunkSize < 18 || available < 18 || (isCompressedType && (chunkSize < 22 || available < 22)))
+                throw std::runtime_error(path() + ": malformed COMM chunk");
+            const unsigned char* comm = chunk + 8;
+            format_.channelCount = readBE16(comm);
+            declaredFrames = readBE32(comm + 2);
+            const unsigned bits = readBE16(comm + 6);
+            format_.sampleRate = readExtended(comm + 8);
+
+            const char* compression = isCompressedType ? reinterpret_cast<const char*>(comm + 18) : "NONE";
+            const auto is = [compression](const char* type) { return std::memcmp(compression, type, 4) == 0; };
+            bool supported = true;
+            byteOrder_ = ByteOrder::BigEndian;
+            if (is("NONE") || is("twos")) {
+                supported = integerFormat(bits, sampleFormat_);
+            } else if (is("sowt")) {
+                supported = integerFormat(bits, sampleFormat_) && sampleFormat_ != SampleFormat::Int8;
+                byteOrder_ = ByteOrder::LittleEndian;
+            } else if (is("in24") || is("23ni")) {
+                sampleFormat_ = SampleFormat::Int24;
+                byteOrder_ = is("23ni") ? ByteOrder::LittleEndian : ByteOrder::BigEndian;
+            } else if (is("in32") || is("42ni")) {
+                sampleFormat_ = SampleFormat::Int32;
+                byteOrder_ = is("42ni") ? ByteOrder::LittleEndian : ByteOrder::BigEndian;
+            } else if (is("fl32") || is("FL32")) {
+                sampleFormat_ = SampleFormat::Float32;
+            } else if (is("fl64") || is("FL64")) {
+                sampleFormat_ = SampleFormat::Float64;
+            } else {
+                supported = false;
+            }
+            if (!supported)
+                throw std::runtime_error(path() + ": unsupported sample format");
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "SSND", 4) == 0) {
+            if (chunkSize < 8 || available < 8)
+                throw std::runtime_error(path() + ": malformed SSND chunk");
+            const std::uint64_t skip = readBE32(chunk + 8);
+            soundOffset = offset + 16 + skip;
+            soundSize = chunkSize >= 8 + skip ? chunkSize - 8 - skip : 0;
+            haveSound = true;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+    if (!haveFormat)
+        throw std::runtime_error(path() + ": no COMM chunk");
+    if (!haveSound) {
+        // A file with no frames may omit the sound chunk.
+        if (declaredFrames != 0)
+            throw std::runtime_error(path() + ": no SSND chunk");
+        soundOffset = size;
+    }
+    bytesPerFrame_ = format_.channelCount * bytesPerSample(sampleFormat_);
+    setDataChunk(soundOffset, std::min(soundSize, declaredFrames * bytesPerFrame_));
+}
+
+void MappedPcmReader::parseCaf()
+{
+    const unsigned char* data = file_->data();
+    const std::uint64_t size = file_->size();
+    if (readBE16(data + 4) != 1)
+        throw std::runtime_error(path() + ": unsupported CAF version");
+    bool haveFormat = false;
+
+    for (std::uint64_t offset = 8; offset + 12 <= size;) {
+        const unsigned char* chunk = data + offset;
+        const std::uint64_t chunkSize = readBE64(chunk + 4);
+        const std::uint64_t available = size - offset - 12;
+
+        if (std::memcmp(chunk, "desc", 4) == 0) {
+            if (chunkSize < 32 || available < 32)
+                throw std::runtime_error(path() + ": malformed desc chunk");
+            const unsigned char* desc = chunk + 12;
+            const std::uint64_t rateBits = readBE64(desc);
+            std::memcpy(&format_.sampleRate, &rateBits, sizeof(double));
+            const std::uint32_t flags = readBE32(desc + 12);
+            const std::uint32_t bytesPerPacket = readBE32(desc + 16);
+            const std::uint32_t framesPerPacket = readBE32(desc + 20);
+            format_.channelCount = readBE32(desc + 24);
+            const unsigned bits = readBE32(desc + 28);
+
+            bool supported = std::memcmp(desc + 8, "lpcm", 4) == 0 && framesPerPacket == 1;
+            if (flags & kCafFloatFlag) {
+                sampleFormat_ = bits == 64 ? SampleFormat::Float64 : SampleFormat::Float32;
+                supported = supported && (bits == 32 || bits == 64);
+            } else {
+                supported = supported && integerFormat(bits, sampleFormat_);
+            }
+            // Packed samples only; 24-bit audio in 4-byte containers is not.
+            supported = supported && bytesPerPacket == format_.channelCount * bytesPerSample(sampleFormat_);
+            if (!supported)
+                throw std::runtime_error(path() + ": unsupported sample format");
+            byteOrder_ = (flags & kCafLittleEndianFlag) ? ByteOrder::LittleEndian : ByteOrder::BigEndian;
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat)
+                throw std::runtime_error(path() + ": data chunk before desc chunk");
+            if (available < 4)
+                throw std::runtime_error(path() + ": malformed data chunk");
+            // Skip the edit count; a size of -1 means the data runs to the end.
+            const std::uint64_t audioSize = chunkSize == ~static_cast<std::uint64_t>(0) ? available - 4
+                                            : chunkSize >= 4                             ? chunkSize - 4
+                                                                                         : 0;
+            setDataChunk(offset + 16, audioSize);
+            return;
+        }
+        if (chunkSize > available)
+            break;
+        offset += 12 + chunkSize;
+    }
+    throw std::runtime_error(path() + ": no data chunk");
+}
+
+void MappedPcmReader::setDataChunk(std::uint64_t offset, std::uint64_t size)
+{
+    bytesPerFrame_ = format_.channelCount * bytesPerSample(sampleFormat_);
+    if (bytesPerFrame_ == 0)
+        throw std::runtime_error(path() + ": invalid format");
+    // Truncated file: treat what is there as the real length.
+    offset = std::min<std::uint64_t>(offset, file_->size());
+    size = std::min<std::uint64_t>(size, file_->size() - offset);
+    data_ = file_->data() + offset;
+    frameCount_ = static_cast<std::int64_t>(size / bytesPerFrame_);
+    zeroCopy_ = isNativeFloat(sampleFormat_, byteOrder_)
+                && reinterpret_cast<std::uintptr_t>(data_) % alignof(float) == 0;
+}
+
+PcmSpan MappedPcmReader::readSpan(std::size_t frames)
+{
+    PcmSpan span;
+    span.channelCount = format_.channelCount;
+    span.frames = static_cast<std::size_t>(std::min<std::int64_t>(static_cast<std::int64_t>(frames),
+                                                                  frameCount_ - position_));
+    if (span.frames == 0)
+        return span;
+    const unsigned char* source = data_ + static_cast<std::size_t>(position_) * bytesPerFrame_;
+    position_ += static_cast<std::int64_t>(span.frames);
+    if (zeroCopy_) {
+        span.samples = reinterpret_cast<const float*>(source);
+        return span;
+    }
+    const std::size_t count = span.frames * format_.channelCount;
+    if (converted_.size() < count)
+        converted_.resize(count);
+    convertToFloat(source, sampleFormat_, byteOrder_, count, converted_.data());
+    span.samples = converted_.data();
+    return span;
+}
+
+AudioBufferView MappedPcmReader::readView(std::size_t frames)
+{
+    const std::size_t channels = format_.channelCount;
+    if (channels == 1) {
+        const PcmSpan span = readSpan(frames);
+        monoChannel_ = span.samples;
+        return AudioBufferView(&monoChannel_, 1, span.frames);
+    }
+    const auto count = static_cast<std::size_t>(
+        std::min<std::int64_t>(static_cast<std::int64_t>(frames), frameCount_ - position_));
+    if (planar_.channelCount() != channels || planar_.frameCount() < count)
+        planar_.resize(channels, count);
+    return planar_.view(0, readFrames(planar_.data(), count));
+}
+
+std::size_t MappedPcmReader::readFrames(float* const* buffers, std::size_t frames)
+{
+    const std::size_t channels = format_.channelCount;
+    std::size_t done = 0;
+    while (done < frames) {
+        const PcmSpan span = readSpan(std::min(kBlockFrames, frames - done));
+        if (span.frames == 0)
+            break;
+        deinterleave(span.samples, channels, span.frames, buffers, done);
+        done += span.frames;
+    }
+    return done;
+}
+
+void MappedPcmReader::seekToFrame(std::int64_t frame)
+{
+    position_ = std::clamp<std::int64_t>(frame, 0, frameCount_);
+}
+
+} // namespace audiocompare
@@ -0,0 +1,92 @@
+//
+//  MappedPcmReader.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "AudioUtilities.hpp"
+#include "MappedFile.hpp"
+#include "SampleConversion.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+enum class ContainerFormat {
+    Wave,
+    Aiff,
+    Caf,
+};
+
+/// Interleaved float frames: sample `c` of frame `i` is
+/// `samples[i * channelCount + c]`.
+struct PcmSpan {
+    const float* samples = nullptr;
+    std::size_t frames = 0;
+    std::size_t channelCount = 0;
+};
+
+/// Reader for uncompressed PCM in RIFF/RF64 WAVE, AIFF/AIFF-C and CAF files
+/// that maps the whole file instead of streaming it through
+/// `EZAudioFile`'s ExtAudioFile conversion. `readSpan` hands out the data
+/// chunk itself when it already holds native float32; other sample formats
+/// are converted with SIMD kernels into one reused buffer. Opening costs one
+/// mmap, and pages load on first touch.
+class MappedPcmReader : public AudioReader {
+public:
+    /// Throws std::runtime_error when the file is missing, malformed or not
+    /// uncompressed PCM.
+    explicit MappedPcmReader(const std::string& path);
+
+    AudioFormat format() const override { return format_; }
+    std::int64_t frameCount() const override { return frameCount_; }
+    std::size_t readFrames(float* const* buffers, std::size_t frames) override;
+    void seekToFrame(std::int64_t frame) override;
+    std::int64_t framePosition() const override { return position_; }
+
+    /// Up to `frames` frames from the current position, which advances past
+    /// them. The span stays valid until the next read or the reader's
+    /// destruction. Returns an empty span at end of file.
+    PcmSpan readSpan(std::size_t frames);
+
+    /// Up to `frames` frames from the current position as planar channels,
+    /// with the same lifetime as `readSpan`. Mono native float32 files are
+    /// viewed in place; everything else is deinterleaved into one reused
+    /// buffer. Returns an empty view at end of file.
+    AudioBufferView readView(std::size_t frames);
+
+    /// True when `readSpan` points into the mapping without converting.
+    bool isZeroCopy() const { return zeroCopy_; }
+    ContainerFormat container() const { return container_; }
+    SampleFormat sampleFormat() const { return sampleFormat_; }
+    ByteOrder byteOrder() const { return byteOrder_; }
+    const std::string& path() const { return file_->path(); }
+
+private:
+    void parseWave();
+    void parseAiff();
+    void parseCaf();
+    void setDataChunk(std::uint64_t offset, std::uint64_t size);
+
+    std::shared_ptr<const MappedFile> file_;
+    ContainerFormat container_ = ContainerFormat::Wave;
+    AudioFormat format_;
+    SampleFormat sampleFormat_ = SampleFormat::Int16;
+    ByteOrder byteOrder_ = ByteOrder::LittleEndian;
+    std::size_t bytesPerFrame_ = 0;
+    const unsigned char* data_ = nullptr;
+    std::int64_t frameCount_ = 0;
+    std::int64_t position_ = 0;
+    bool zeroCopy_ = false;
+    std::vector<float> converted_;
+    FloatBuffers planar_;
+    const float* monoChannel_ = nullptr;
+};
+
+} // namespace audiocompare
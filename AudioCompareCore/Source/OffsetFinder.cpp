@@ -0,0 +1,297 @@
+//
+//  OffsetFinder.cpp
+//  AudioCompareCore
+//
+
+#include "OffsetFinder.hpp"
+
+#include "AudioUtilities.hpp"
+#include "Fft.hpp"
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace audiocompare {
+
+namespace {
+
+/// Lags within this many samples of the peak count as its main lobe.
+const std::int64_t kMainLobeWidth = 16;
+
+/// Whitening denominator floor relative to the mean cross-spectrum magnitude.
+const double kWhiteningFloor = 0.01;
+
+/// Longest raised-cosine fade applied to each end of a correlation input.
+const std::size_t kTaperLength = 4096;
+
+/// Fades both ends of `signal` so the hard edges of the excerpts do not add a
+/// broadband transient, which PHAT whitening would otherwise amplify into a
+/// spurious peak at the lag that lines the edges up.
+void taperEdges(float* signal, std::size_t length)
+{
+    const double pi = 3.14159265358979323846;
+    const std::size_t fade = std::min(kTaperLength, length / 8);
+    for (std::size_t i = 0; i < fade; ++i) {
+        const float gain = static_cast<float>(0.5 - 0.5 * std::cos(pi * (static_cast<double>(i) + 0.5) / fade));
+        signal[i] *= gain;
+        signal[length - 1 - i] *= gain;
+    }
+}
+
+/// Correlation values used either side of the peak for sinc interpolation.
+const std::size_t kSincHalfWidth = 16;
+
+/// Float SIMD partial sums are combined in double every this many samples.
+const std::int64_t kDotChunk = 4096;
+
+/// sum(reference[n] * candidate[n + lag]) over the overlapping samples, for
+/// each lag in [minLag, maxLag].
+std::vector<double> crossCorrelate(const float* reference, std::size_t referenceLength,
+                                   const float* candidate, std::size_t candidateLength,
+                                   std::int64_t minLag, std::int64_t maxLag)
+{
+    std::vector<double> values;
+    values.reserve(static_cast<std::size_t>(maxLag - minLag + 1));
+    for (std::int64_t lag = minLag; lag <= maxLag; ++lag) {
+        const std::int64_t begin = std::max<std::int64_t>(0, -lag);
+        const std::int64_t end = std::min<std::int64_t>(static_cast<std::int64_t>(referenceLength),
+                                                        static_cast<std::int64_t>(candidateLength) - lag);
+        double sum = 0.0;
+        for (std::int64_t chunk = begin; chunk < end; chunk += kDotChunk) {
+            const std::size_t count = static_cast<std::size_t>(std::min(kDotChunk, end - chunk));
+            sum += dotProduct(reference + chunk, candidate + chunk + lag, count);
+        }
+        values.push_back(sum);
+    }
+    return values;
+}
+
+double sincInterpolate(const double* values, std::size_t count, double position)
+{
+    const double pi = 3.14159265358979323846;
+    const double radius = static_cast<double>(kSincHalfWidth);
+    const std::ptrdiff_t first = std::max<std::ptrdiff_t>(0, static_cast<std::ptrdiff_t>(std::ceil(position - radius)));
+    const std::ptrdiff_t last = std::min<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(count) - 1,
+                                                         static_cast<std::ptrdiff_t>(std::floor(position + radius)));
+    double sum = 0.0;
+    for (std::ptrdiff_t k = first; k <= last; ++k) {
+        const double x = position - static_cast<double>(k);
+        const double sinc = std::fabs(x) < 1e-12 ? 1.0 : std::sin(pi * x) / (pi * x);
+        const double window = 0.42 + 0.5 * std::cos(pi * x / radius) + 0.08 * std::cos(2.0 * pi * x / radius);
+        sum += values[k] * sinc * window;
+    }
+    return sum;
+}
+
+} // namespace
+
+double interpolatePeak(const double* values, std::size_t count, std::size_t index,
+                       PeakInterpolation method)
+{
+    if (method == PeakInterpolation::None || index == 0 || index + 1 >= count)
+        return 0.0;
+
+    if (method == PeakInterpolation::Parabolic) {
+        const double left = values[index - 1];
+        const double centre = values[index];
+        const double right = values[index + 1];
+        const double curvature = left - 2.0 * centre + right;
+        if (curvature >= 0.0)
+            return 0.0;
+        return std::clamp(0.5 * (left - right) / curvature, -1.0, 1.0);
+    }
+
+    // Golden-section search for the maximum of the band-limited
+    // reconstruction, which is unimodal within one sample of the peak.
+    const double ratio = 0.6180339887498949;
+    double low = static_cast<double>(index) - 1.0;
+    double high = static_cast<double>(index) + 1.0;
+    double a = high - ratio * (high - low);
+    double b = low + ratio * (high - low);
+    double fa = sincInterpolate(values, count, a);
+    double fb = sincInterpolate(values, count, b);
+    for (int iteration = 0; iteration < 60; ++iteration) {
+        if (fa < fb) {
+            low = a;
+            a = b;
+            fa = fb;
+            b = low + ratio * (high - low);
+            fb = sincInterpolate(values, count, b);
+        } else {
+            high = b;
+            b = a;
+            fb = fa;
+            a = high - ratio * (high - low);
+            fa = sincInterpolate(values, count, a);
+        }
+    }
+    return 0.5 * (low + high) - static_cast<double>(index);
+}
+
+CorrelationPeak gccPhat(const float* reference, std::size_t referenceLength,
+                        const float* candidate, std::size_t candidateLength,
+                        std::int64_t minLag, std::int64_t maxLag,
+                        PeakInterpolation interpolation)
+{
+    if (referenceLength == 0 || candidateLength == 0)
+        throw std::invalid_argument("gccPhat: empty input");
+
+    // Padding to the combined length keeps the circular correlation free of
+    // wrap-around for every representable lag.
+    const std::size_t size = std::max<std::size_t>(nextPowerOfTwo(referenceLength + candidateLength), 4);
+    const std::size_t bins = size / 2 + 1;
+    minLag = std::max<std::int64_t>(minLag, -static_cast<std::int64_t>(referenceLength) + 1);
+    maxLag = std::min<std::int64_t>(maxLag, static_cast<std::int64_t>(candidateLength) - 1);
+    if (minLag > maxLag)
+        throw std::invalid_argument("gccPhat: empty lag range");
+
+    Fft fft(size);
+    std::vector<float> signal(size, 0.0f);
+    std::vector<float> referenceReal(bins), referenceImag(bins);
+    std::vector<float> real(bins), imag(bins);
+
+    std::copy(reference, reference + referenceLength, signal.begin());
+    taperEdges(signal.data(), referenceLength);
+    fft.forward(signal.data(), referenceReal.data(), referenceImag.data());
+    std::fill(signal.begin(), signal.end(), 0.0f);
+    std::copy(candidate, candidate + candidateLength, signal.begin());
+    taperEdges(signal.data(), candidateLength);
+    fft.forward(signal.data(), real.data(), imag.data());
+
+    // Cross spectrum conj(R) * C, whitened to unit magnitude. The whitening
+    // denominator is floored relative to the mean so near-empty bands (e.g.
+    // above a band-limited master's cutoff) do not contribute pure noise.
+    double meanMagnitude = 0.0;
+    for (std::size_t k = 0; k < bins; ++k) {
+        const float cr = referenceReal[k] * real[k] + referenceImag[k] * imag[k];
+        const float ci = referenceReal[k] * imag[k] - referenceImag[k] * real[k];
+        real[k] = cr;
+        imag[k] = ci;
+        meanMagnitude += std::sqrt(cr * cr + ci * ci);
+    }
+    meanMagnitude /= static_cast<double>(bins);
+    const float floor = static_cast<float>(meanMagnitude * kWhiteningFloor) + 1e-30f;
+    for (std::size_t k = 0; k < bins; ++k) {
+        const float magnitude = std::sqrt(real[k] * real[k] + imag[k] * imag[k]);
+        const float scale = 1.0f / std::max(magnitude, floor);
+        real[k] *= scale;
+        imag[k] *= scale;
+    }
+    fft.inverse(real.data(), imag.data(), signal.data());
+
+    auto correlationAt = [&](std::int64_t lag) {
+        return signal[static_cast<std::size_t>(lag < 0 ? lag + static_cast<std::int64_t>(size) : lag)];
+    };
+
+    CorrelationPeak peak;
+    peak.lag = minLag;
+    peak.value = correlationAt(minLag);
+    for (std::int64_t lag = minLag + 1; lag <= maxLag; ++lag) {
+        const float value = correlationAt(lag);
+        if (value > peak.value) {
+            peak.value = value;
+            peak.lag = lag;
+        }
+    }
+
+    double sidelobe = 0.0;
+    for (std::int64_t lag = minLag; lag <= maxLag; ++lag) {
+        if (std::llabs(lag - peak.lag) > kMainLobeWidth)
+            sidelobe = std::max(sidelobe, std::fabs(static_cast<double>(correlationAt(lag))));
+    }
+    peak.sidelobeRatio = sidelobe > 0.0 ? peak.value / sidelobe : 0.0;
+
+    // Whitening reshapes the peak, so interpolating the PHAT output would bias
+    // the sub-sample part; it is taken from the plain cross-correlation of the
+    // untapered inputs around the same integer lag instead.
+    peak.fractionalLag = static_cast<double>(peak.lag);
+    if (interpolation == PeakInterpolation::None)
+        return peak;
+    const std::int64_t first = std::max<std::int64_t>(minLag, peak.lag - static_cast<std::int64_t>(kSincHalfWidth));
+    const std::int64_t last = std::min<std::int64_t>(maxLag, peak.lag + static_cast<std::int64_t>(kSincHalfWidth));
+    const std::vector<double> neighbourhood = crossCorrelate(reference, referenceLength, candidate, candidateLength,
+                                                             first, last);
+    peak.fractionalLag = static_cast<double>(peak.lag)
+                         + interpolatePeak(neighbourhood.data(), neighbourhood.size(),
+                                           static_cast<std::size_t>(peak.lag - first), interpolation);
+    return peak;
+}
+
+CorrelationPeak refineLag(const float* reference, std::size_t referenceLength,
+                          const float* candidate, std::size_t candidateLength,
+                          std::int64_t minLag, std::int64_t maxLag,
+                          PeakInterpolation interpolation)
+{
+    if (minLag > maxLag)
+        throw std::invalid_argument("refineLag: empty lag range");
+
+    const std::vector<double> values = crossCorrelate(reference, referenceLength, candidate, candidateLength,
+                                                      minLag, maxLag);
+    const std::size_t best = static_cast<std::size_t>(
+        std::max_element(values.begin(), values.end()) - values.begin());
+    CorrelationPeak peak;
+    peak.lag = minLag + static_cast<std::int64_t>(best);
+    peak.value = values[best];
+    peak.fractionalLag = static_cast<double>(peak.lag)
+                         + interpolatePeak(values.data(), values.size(), best, interpolation);
+    return peak;
+}
+
+AlignmentExcerpt readAlignmentExcerpt(AudioReader& reference, AudioReader& candidate,
+                                      const AlignmentOptions& options)
+{
+    const double rate = reference.format().sampleRate;
+    if (rate != candidate.format().sampleRate)
+        throw std::invalid_argument("sample rates differ");
+
+    const std::int64_t referencePosition = reference.framePosition();
+    const std::int64_t candidatePosition = candidate.framePosition();
+
+    const std::int64_t range = static_cast<std::int64_t>(std::llround(options.maxOffsetSeconds * rate));
+    std::int64_t length = std::max<std::int64_t>(static_cast<std::int64_t>(std::llround(options.excerptSeconds * rate)), 1);
+    const std::int64_t referenceLength = reference.frameCount();
+    if (referenceLength > 0)
+        length = std::min(length, referenceLength);
+
+    // Start the excerpt one search range in, when the file allows it, so that
+    // negative offsets still find candidate material to match.
+    std::int64_t start = range;
+    if (referenceLength > 0)
+        start = std::max<std::int64_t>(0, std::min(start, referenceLength - length));
+
+    AlignmentExcerpt excerpt;
+    excerpt.range = range;
+    excerpt.reference.resize(static_cast<std::size_t>(length));
+    excerpt.candidate.resize(static_cast<std::size_t>(length + 2 * range));
+    readMono(reference, start, excerpt.reference.size(), excerpt.reference.data());
+    readMono(candidate, start - range, excerpt.candidate.size(), excerpt.candidate.data());
+
+    reference.seekToFrame(referencePosition);
+    candidate.seekToFrame(candidatePosition);
+    return excerpt;
+}
+
+OffsetFinder::OffsetFinder(AlignmentOptions options)
+    : options_(options)
+{
+    if (options_.maxOffsetSeconds < 0.0 || options_.excerptSeconds <= 0.0)
+        throw std::invalid_argument("invalid alignment options");
+}
+
+AlignmentResult OffsetFinder::findOffset(AudioReader& reference, AudioReader& candidate)
+{
+    const AlignmentExcerpt excerpt = readAlignmentExcerpt(reference, candidate, options_);
+
+    AlignmentResult result;
+    result.peak = gccPhat(excerpt.reference.data(), excerpt.reference.size(),
+                          excerpt.candidate.data(), excerpt.candidate.size(), 0, 2 * excerpt.range,
+                          options_.interpolation);
+    result.offset = result.peak.lag - excerpt.range;
+    result.fractionalOffset = result.peak.fractionalLag - static_cast<double>(excerpt.range);
+    return result;
+}
+
+} // namespace audiocompare
@@ -0,0 +1,104 @@
+//
+//  OffsetFinder.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+enum class PeakInterpolation {
+    None,
+    /// Vertex of the parabola through the peak and its two neighbours.
+    Parabolic,
+    /// Maximum of the windowed-sinc reconstruction of the correlation.
+    Sinc,
+};
+
+struct AlignmentOptions {
+    /// Largest offset searched in either direction.
+    double maxOffsetSeconds = 60.0;
+    /// Length of the reference excerpt matched against the candidate.
+    double excerptSeconds = 20.0;
+    PeakInterpolation interpolation = PeakInterpolation::Sinc;
+};
+
+struct CorrelationPeak {
+    /// Lag maximising sum(reference[n] * candidate[n + lag]).
+    std::int64_t lag = 0;
+    /// `lag` refined to sub-sample precision by peak interpolation.
+    double fractionalLag = 0.0;
+    double value = 0.0;
+    /// Peak height over the strongest correlation outside the main lobe.
+    double sidelobeRatio = 0.0;
+};
+
+/// Generalised cross-correlation with phase transform (GCC-PHAT), computed
+/// with one FFT per input and one inverse FFT, i.e. O(n log n) in the total
+/// length. Only lags in [minLag, maxLag] are considered. The sub-sample
+/// part of the peak is interpolated on the plain cross-correlation, which
+/// whitening would bias.
+CorrelationPeak gccPhat(const float* reference, std::size_t referenceLength,
+                        const float* candidate, std::size_t candidateLength,
+                        std::int64_t minLag, std::int64_t maxLag,
+                        PeakInterpolation interpolation = PeakInterpolation::Sinc);
+
+/// Best lag in [minLag, maxLag] by direct cross-correlation,
+/// sum(reference[n] * candidate[n + lag]) over the overlapping samples. The
+/// window is too narrow for a meaningful sidelobe ratio, so that is left 0.
+CorrelationPeak refineLag(const float* reference, std::size_t referenceLength,
+                          const float* candidate, std::size_t candidateLength,
+                          std::int64_t minLag, std::int64_t maxLag,
+                          PeakInterpolation interpolation = PeakInterpolation::None);
+
+/// Sub-sample position of the maximum of a sampled curve, relative to the
+/// local maximum at `index` and within (-1, 1). Neighbours outside
+/// [0, count) are ignored.
+double interpolatePeak(const double* values, std::size_t count, std::size_t index,
+                       PeakInterpolation method);
+
+/// Mono material for an offset search: a reference excerpt and the candidate
+/// window covering it shifted by up to `range` frames either way, so that
+/// candidate[n + range + offset] lines up with reference[n].
+struct AlignmentExcerpt {
+    std::vector<float> reference;
+    std::vector<float> candidate;
+    std::int64_t range = 0;
+};
+
+/// Reads an excerpt pair and restores both readers' positions.
+AlignmentExcerpt readAlignmentExcerpt(AudioReader& reference, AudioReader& candidate,
+                                      const AlignmentOptions& options);
+
+struct AlignmentResult {
+    /// Candidate frame = reference frame + offset.
+    std::int64_t offset = 0;
+    /// `offset` plus the interpolated sub-sample part.
+    double fractionalOffset = 0.0;
+    CorrelationPeak peak;
+};
+
+/// Estimates the time offset between two recordings of the same material.
+/// A mono reference excerpt is correlated against the matching candidate
+/// region widened by the search range, so memory is bounded by
+/// excerpt + 2 * range rather than by the file length.
+class OffsetFinder {
+public:
+    explicit OffsetFinder(AlignmentOptions options = {});
+
+    const AlignmentOptions& options() const { return options_; }
+
+    /// Restores both readers' positions before returning.
+    AlignmentResult findOffset(AudioReader& reference, AudioReader& candidate);
+
+private:
+    AlignmentOptions options_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,370 @@
+//
+//  PacketDecoder.cpp
+//  AudioCompareCore
+//
+
+#include "PacketDecoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__APPLE__)
+#include <AudioToolbox/AudioToolbox.h>
+#endif
+
+namespace audiocompare {
+
+namespace {
+
+const std::uint32_t kLinearPcm = 0x6C70636D;   // 'lpcm'
+const std::uint32_t kAppleIma4 = 0x696D6134;   // 'ima4'
+
+// Apple IMA4 packs 64 samples per channel into a 2-byte header and 32 bytes
+// of 4-bit codes; the channels of a packet follow each other.
+const std::size_t kIma4FramesPerPacket = 64;
+const std::size_t kIma4BytesPerChannel = 34;
+
+const int kImaStepTable[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+    544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+    9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+const int kImaIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+std::uint16_t readBE16(const unsigned char* p)
+{
+    return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+}
+
+std::uint32_t readBE32(const unsigned char* p)
+{
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16)
+           | (static_cast<std::uint32_t>(p[2]) << 8) | static_cast<std::uint32_t>(p[3]);
+}
+
+std::uint64_t readBE64(const unsigned char* p)
+{
+    return (static_cast<std::uint64_t>(readBE32(p)) << 32) | readBE32(p + 4);
+}
+
+/// CAF's variable-length integers: seven bits per byte, most significant
+/// group first, high bit set on every byte but the last.
+bool readVarint(const unsigned char*& p, const unsigned char* end, std::uint64_t& value)
+{
+    value = 0;
+    for (int i = 0; i < 10 && p < end; ++i) {
+        const unsigned char byte = *p++;
+        value = (value << 7) | (byte & 0x7F);
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+class Ima4Decoder : public PacketDecoder {
+public:
+    explicit Ima4Decoder(std::size_t channelCount)
+        : channelCount_(channelCount)
+    {
+    }
+
+    // Every packet carries its own predictor and step index.
+    std::size_t preRollPackets() const override { return 0; }
+
+    std::size_t decodePacket(const unsigned char* packet, std::size_t size, float* output) override
+    {
+        if (size < kIma4BytesPerChannel * channelCount_)
+            throw std::runtime_error("truncated IMA4 packet");
+        for (std::size_t c = 0; c < channelCount_; ++c) {
+            const unsigned char* block = packet + c * kIma4BytesPerChannel;
+            const std::uint16_t header = readBE16(block);
+            int predictor = static_cast<std::int16_t>(header & 0xFF80);
+            int index = std::min(header & 0x7F, 88);
+            for (std::size_t i = 0; i < kIma4FramesPerPacket; ++i) {
+                const int code = (block[2 + i / 2] >> (4 * (i & 1))) & 0x0F;
+                const int step = kImaStepTable[index];
+                int difference = step >> 3;
+                if (code & 4)
+                    difference += step;
+                if (code & 2)
+                    difference += step >> 1;
+                if (code & 1)
+                    difference += step >> 2;
+                predictor = std::clamp(code & 8 ? predictor - difference : predictor + difference, -32768, 32767);
+                index = std::clamp(index + kImaIndexTable[code], 0, 88);
+                output[i * channelCount_ + c] = static_cast<float>(predictor) * (1.0f / 32768.0f);
+            }
+        }
+        return kIma4FramesPerPacket;
+    }
+
+private:
+    std::size_t channelCount_;
+};
+
+#if defined(__APPLE__)
+
+// Returned from the input callback when the single queued packet has been
+// consumed: unlike reporting end of stream, this keeps the decoder state.
+const OSStatus kNeedMorePackets = 0x6D6F7265;  // 'more'
+
+/// AudioConverter decoding one packet per call into interleaved float32.
+class ConverterDecoder : public PacketDecoder {
+public:
+    explicit ConverterDecoder(const PacketTable& table)
+        : formatId_(table.formatId)
+        , framesPerPacket_(table.framesPerPacket)
+        , channelCount_(static_cast<UInt32>(table.channelCount))
+    {
+        AudioStreamBasicDescription input = {};
+        input.mSampleRate = table.sampleRate;
+        input.mFormatID = table.formatId;
+        input.mFormatFlags = table.formatFlags;
+        input.mBytesPerPacket = table.bytesPerPacket;
+        input.mFramesPerPacket = table.framesPerPacket;
+        input.mChannelsPerFrame = channelCount_;
+        input.mBitsPerChannel = table.bitsPerChannel;
+
+        AudioStreamBasicDescription output = {};
+        output.mSampleRate = table.sampleRate;
+        output.mFormatID = kAudioFormatLinearPCM;
+        output.mFormatFlags = kAudioFormatFlagsNativeFloatPacked;
+        output.mFramesPerPacket = 1;
+        output.mChannelsPerFrame = channelCount_;
+        output.mBitsPerChannel = 32;
+        output.mBytesPerFrame = 4 * channelCount_;
+        output.mBytesPerPacket = output.mBytesPerFrame;
+
+        if (AudioConverterNew(&input, &output, &converter_) != noErr)
+            throw std::runtime_error("AudioConverter cannot decode this format");
+        if (!table.magicCookie.empty()
+            && AudioConverterSetProperty(converter_, kAudioConverterDecompressionMagicCookie,
+                                         static_cast<UInt32>(table.magicCookie.size()),
+                                         table.magicCookie.data())
+                   != noErr) {
+            AudioConverterDispose(converter_);
+            throw std::runtime_error("AudioConverter rejected the magic cookie");
+        }
+        // Priming frames are trimmed using the packet table, as ExtAudioFile does.
+        const UInt32 primeMethod = kConverterPrimeMethod_None;
+        AudioConverterSetProperty(converter_, kAudioConverterPrimeMethod, sizeof(primeMethod), &primeMethod);
+    }
+
+    ~ConverterDecoder() override { AudioConverterDispose(converter_); }
+
+    ConverterDecoder(const ConverterDecoder&) = delete;
+    ConverterDecoder& operator=(const ConverterDecoder&) = delete;
+
+    // ALAC packets are independent. AAC needs the previous packet for the
+    // MDCT overlap; the SBR and parametric stereo of HE-AAC reach further.
+    std::size_t preRollPackets() const override
+    {
+        switch (formatId_) {
+        case kAudioFormatAppleLossless: return 0;
+        case kAudioFormatMPEG4AAC_HE:
+        case kAudioFormatMPEG4AAC_HE_V2: return 4;
+        default: return 2;
+        }
+    }
+
+    std::size_t decodePacket(const unsigned char* packet, std::size_t size, float* output) override
+    {
+        packet_ = packet;
+        description_.mStartOffset = 0;
+        description_.mVariableFramesInPacket = 0;
+        description_.mDataByteSize = static_cast<UInt32>(size);
+        pending_ = true;
+
+        UInt32 frames = framesPerPacket_;
+        AudioBufferList list;
+        list.mNumberBuffers = 1;
+        list.mBuffers[0].mNumberChannels = channelCount_;
+        list.mBuffers[0].mDataByteSize = frames * channelCount_ * static_cast<UInt32>(sizeof(float));
+        list.mBuffers[0].mData = output;
+        const OSStatus status = AudioConverterFillComplexBuffer(converter_, supplyPacket, this, &frames, &list, nullptr);
+        if (status != noErr && status != kNeedMorePackets)
+            throw std::runtime_error("AudioConverter failed to decode a packet");
+        return frames;
+    }
+
+private:
+    static OSStatus supplyPacket(AudioConverterRef, UInt32* packetCount, AudioBufferList* data,
+                                 AudioStreamPacketDescription** descriptions, void* context)
+    {
+        auto* self = static_cast<ConverterDecoder*>(context);
+        if (!self->pending_) {
+            *packetCount = 0;
+            return kNeedMorePackets;
+        }
+        self->pending_ = false;
+        *packetCount = 1;
+        data->mBuffers[0].mNumberChannels = self->channelCount_;
+        data->mBuffers[0].mDataByteSize = self->description_.mDataByteSize;
+        data->mBuffers[0].mData = const_cast<unsigned char*>(self->packet_);
+        if (descriptions)
+            *descriptions = &self->description_;
+        return noErr;
+    }
+
+    AudioConverterRef converter_ = nullptr;
+    std::uint32_t formatId_;
+    UInt32 framesPerPacket_;
+    UInt32 channelCount_;
+    const unsigned char* packet_ = nullptr;
+    AudioStreamPacketDescription description_ = {};
+    bool pending_ = false;
+};
+
+#endif
+
+} // namespace
+
+std::uint32_t cafFormatId(const MappedFile& file)
+{
+    const unsigned char* data = file.data();
+    const std::uint64_t size = file.size();
+    if (size < 8 || std::memcmp(data, "caff", 4) != 0)
+        return 0;
+    for (std::uint64_t offset = 8; offset + 12 <= size;) {
+        const std::uint64_t chunkSize = readBE64(data + offset + 4);
+        if (std::memcmp(data + offset, "desc", 4) == 0)
+            return size - offset - 12 >= 12 ? readBE32(data + offset + 20) : 0;
+        if (chunkSize > size - offset - 12)
+            break;
+        offset += 12 + chunkSize;
+    }
+    return 0;
+}
+
+PacketTable PacketTable::readCaf(const MappedFile& file)
+{
+    const unsigned char* data = file.data();
+    const std::uint64_t size = file.size();
+    const std::string& path = file.path();
+    if (size < 8 || std::memcmp(data, "caff", 4) != 0)
+        throw std::runtime_error(path + ": not a CAF file");
+    if (readBE16(data + 4) != 1)
+        throw std::runtime_error(path + ": unsupported CAF version");
+
+    PacketTable table;
+    bool haveFormat = false;
+    const unsigned char* packetSizes = nullptr;
+    const unsigned char* packetSizesEnd = nullptr;
+    std::int64_t declaredPackets = -1;
+    std::int64_t declaredFrames = -1;
+    std::int64_t remainderFrames = 0;
+    std::uint64_t dataOffset = 0;
+    std::uint64_t dataSize = 0;
+    bool haveData = false;
+
+    for (std::uint64_t offset = 8; offset + 12 <= size;) {
+        const unsigned char* chunk = data + offset;
+        const std::uint64_t chunkSize = readBE64(chunk + 4);
+        const std::uint64_t available = size - offset - 12;
+        const unsigned char* body = chunk + 12;
+
+        if (std::memcmp(chunk, "desc", 4) == 0) {
+            if (chunkSize < 32 || available < 32)
+                throw std::runtime_error(path + ": malformed desc chunk");
+            const std::uint64_t rateBits = readBE64(body);
+            std::memcpy(&table.sampleRate, &rateBits, sizeof(double));
+            table.formatId = readBE32(body + 8);
+            table.formatFlags = readBE32(body + 12);
+            table.bytesPerPacket = readBE32(body + 16);
+            table.framesPerPacket = readBE32(body + 20);
+            table.channelCount = readBE32(body + 24);
+            table.bitsPerChannel = readBE32(body + 28);
+            if (table.formatId == kLinearPcm)
+                throw std::runtime_error(path + ": linear PCM has no packet table");
+            if (table.framesPerPacket == 0)
+                throw std::runtime_error(path + ": variable frames per packet are not supported");
+            if (table.channelCount == 0 || !(table.sampleRate > 0.0))
+                throw std::runtime_error(path + ": invalid format");
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "kuki", 4) == 0) {
+            const std::uint64_t cookieSize = std::min(chunkSize, available);
+            table.magicCookie.assign(body, body + cookieSize);
+        } else if (std::memcmp(chunk, "pakt", 4) == 0) {
+            if (chunkSize < 24 || available < 24)
+                throw std::runtime_error(path + ": malformed pakt chunk");
+            declaredPackets = static_cast<std::int64_t>(readBE64(body));
+            declaredFrames = static_cast<std::int64_t>(readBE64(body + 8));
+            table.primingFrames = static_cast<std::int32_t>(readBE32(body + 16));
+            remainderFrames = static_cast<std::int32_t>(readBE32(body + 20));
+            packetSizes = body + 24;
+            packetSizesEnd = body + std::min(chunkSize, available);
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (available < 4)
+                throw std::runtime_error(path + ": malformed data chunk");
+            // Skip the edit count; a size of -1 means the data runs to the end.
+            dataOffset = offset + 16;
+            dataSize = chunkSize == ~static_cast<std::uint64_t>(0) ? available - 4
+                       : chunkSize >= 4                             ? std::min(chunkSize, available) - 4
+                                                                    : 0;
+            haveData = true;
+        }
+        if (chunkSize == ~static_cast<std::uint64_t>(0) || chunkSize > available)
+            break;
+        offset += 12 + chunkSize;
+    }
+    if (!haveFormat)
+        throw std::runtime_error(path + ": no desc chunk");
+    if (!haveData)
+        throw std::runtime_error(path + ": no data chunk");
+
+    table.offsets.push_back(dataOffset);
+    const std::uint64_t dataEnd = dataOffset + dataSize;
+    if (table.bytesPerPacket != 0) {
+        std::uint64_t packets = dataSize / table.bytesPerPacket;
+        if (declaredPackets >= 0)
+            packets = std::min<std::uint64_t>(packets, static_cast<std::uint64_t>(declaredPackets));
+        table.offsets.reserve(packets + 1);
+        for (std::uint64_t i = 1; i <= packets; ++i)
+            table.offsets.push_back(dataOffset + i * table.bytesPerPacket);
+    } else {
+        if (!packetSizes)
+            throw std::runtime_error(path + ": variable bit rate stream without a pakt chunk");
+        table.offsets.reserve(static_cast<std::size_t>(std::max<std::int64_t>(declaredPackets, 0)) + 1);
+        // A truncated file keeps the packets that are wholly present.
+        for (std::int64_t i = 0; i < declaredPackets; ++i) {
+            std::uint64_t packetSize = 0;
+            if (!readVarint(packetSizes, packetSizesEnd, packetSize))
+                throw std::runtime_error(path + ": malformed pakt chunk");
+            if (packetSize > dataEnd - table.offsets.back())
+                break;
+            table.offsets.push_back(table.offsets.back() + packetSize);
+        }
+    }
+
+    const std::int64_t decodedFrames
+        = static_cast<std::int64_t>(table.packetCount()) * static_cast<std::int64_t>(table.framesPerPacket);
+    table.primingFrames = std::clamp<std::int64_t>(table.primingFrames, 0, decodedFrames);
+    table.validFrames = declaredFrames >= 0 && table.packetCount() == static_cast<std::uint64_t>(declaredPackets)
+                            ? declaredFrames
+                            : decodedFrames - table.primingFrames - remainderFrames;
+    table.validFrames = std::clamp<std::int64_t>(table.validFrames, 0, decodedFrames - table.primingFrames);
+    return table;
+}
+
+std::unique_ptr<PacketDecoder> makePacketDecoder(const PacketTable& table)
+{
+    if (table.formatId == kAppleIma4) {
+        if (table.framesPerPacket != kIma4FramesPerPacket
+            || table.bytesPerPacket != kIma4BytesPerChannel * table.channelCount)
+            throw std::runtime_error("malformed IMA4 stream description");
+        return std::make_unique<Ima4Decoder>(table.channelCount);
+    }
+#if defined(__APPLE__)
+    return std::make_unique<ConverterDecoder>(table);
+#else
+    throw std::runtime_error("no decoder for this format on this platform");
+#endif
+}
+
+} // namespace audiocompare
@@ -0,0 +1,71 @@
+//
+//  PacketDecoder.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace audiocompare {
+
+/// A compressed stream in a CAF file: the codec description, its magic
+/// cookie and the byte range of every packet, from the 'pakt' chunk or, for
+/// constant bit rate codecs, from the packet size. Decoded stream frame 0 is
+/// the first frame of packet 0; the first `primingFrames` are encoder delay.
+struct PacketTable {
+    std::uint32_t formatId = 0;
+    std::uint32_t formatFlags = 0;
+    double sampleRate = 0.0;
+    std::size_t channelCount = 0;
+    std::uint32_t bitsPerChannel = 0;
+    /// 0 when packet sizes vary.
+    std::uint32_t bytesPerPacket = 0;
+    std::uint32_t framesPerPacket = 0;
+    std::int64_t primingFrames = 0;
+    /// Frames left after dropping the priming and remainder frames.
+    std::int64_t validFrames = 0;
+    std::vector<unsigned char> magicCookie;
+    /// Packet `i` occupies file bytes [offsets[i], offsets[i + 1]).
+    std::vector<std::uint64_t> offsets;
+
+    std::size_t packetCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    /// Throws std::runtime_error unless `file` is a CAF file holding a
+    /// packetised (not linear PCM) stream with a fixed number of frames per
+    /// packet.
+    static PacketTable readCaf(const MappedFile& file);
+};
+
+/// The four-character format ID of a CAF file's 'desc' chunk, e.g. 'lpcm' or
+/// 'aac ', or 0 when `file` is not a CAF file.
+std::uint32_t cafFormatId(const MappedFile& file);
+
+/// Decodes one packet at a time into interleaved float, carrying whatever
+/// state the codec keeps between packets. One instance per decoding thread.
+class PacketDecoder {
+public:
+    virtual ~PacketDecoder() = default;
+
+    /// Packets to decode and discard ahead of a chunk that starts
+    /// mid-stream, so that the decoder state, and with it the output,
+    /// matches a sequential decode.
+    virtual std::size_t preRollPackets() const = 0;
+
+    /// Decodes `packet` into `output`, which holds `framesPerPacket` frames,
+    /// and returns the frames produced: all of them for every packet but the
+    /// last. Throws std::runtime_error on corrupt data.
+    virtual std::size_t decodePacket(const unsigned char* packet, std::size_t size, float* output) = 0;
+};
+
+/// A decoder for `table`'s codec: Apple IMA4 everywhere, plus AAC, ALAC and
+/// the other codecs of AudioToolbox's `AudioConverter` on Apple platforms.
+/// Throws std::runtime_error for anything else.
+std::unique_ptr<PacketDecoder> makePacketDecoder(const PacketTable& table);
+
+} // namespace audiocompare
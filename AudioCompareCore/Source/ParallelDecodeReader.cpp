@@ -0,0 +1,216 @@
+//
+//  ParallelDecodeReader.cpp
+//  AudioCompareCore
+//
+
+#include "ParallelDecodeReader.hpp"
+
+#include "MappedPcmReader.hpp"
+#include "SampleConversion.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace audiocompare {
+
+namespace {
+
+const std::uint32_t kLinearPcm = 0x6C70636D;  // 'lpcm'
+
+} // namespace
+
+ParallelDecodeReader::ParallelDecodeReader(const std::string& path, const ParallelDecodeOptions& options)
+    : file_(std::make_shared<const MappedFile>(path))
+    , table_(PacketTable::readCaf(*file_))
+    , decoderFactory_(options.decoderFactory ? options.decoderFactory : PacketDecoderFactory(makePacketDecoder))
+{
+    format_.sampleRate = table_.sampleRate;
+    format_.channelCount = table_.channelCount;
+    // Fail here rather than on the first read when the codec is unsupported.
+    if (!decoderFactory_(table_))
+        throw std::runtime_error(path + ": no decoder for this format");
+
+    chunkPackets_ = std::max<std::size_t>(1, options.chunkFrames / table_.framesPerPacket);
+    chunkCount_ = (table_.packetCount() + chunkPackets_ - 1) / chunkPackets_;
+    if (options.pool) {
+        pool_ = options.pool;
+    } else {
+        ownedPool_ = std::make_unique<ThreadPool>(options.threadCount);
+        pool_ = ownedPool_.get();
+    }
+    const std::size_t slotCount = options.chunksInFlight > 0 ? options.chunksInFlight : 2 * pool_->threadCount();
+    slots_.resize(std::max<std::size_t>(1, std::min(slotCount, chunkCount_)));
+    restart(0);
+}
+
+ParallelDecodeReader::~ParallelDecodeReader()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    changed_.wait(lock, [this] { return outstanding_ == 0; });
+}
+
+std::size_t ParallelDecodeReader::readFrames(float* const* buffers, std::size_t frames)
+{
+    const std::size_t channels = format_.channelCount;
+    std::size_t done = 0;
+    while (done < frames && position_ < table_.validFrames && chunk_ < chunkCount_) {
+        Slot& slot = slots_[chunk_ % slots_.size()];
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!slot.ready) {
+                ++stalls_;
+                changed_.wait(lock, [&slot] { return slot.ready; });
+            }
+            if (slot.error)
+                std::rethrow_exception(slot.error);
+        }
+
+        // Until the reader moves past it, no worker touches a ready slot.
+        const std::size_t available = slot.end - slot.begin - std::min(chunkOffset_, slot.end - slot.begin);
+        if (available == 0) {
+            const std::size_t next = chunk_ + slots_.size();
+            ++chunk_;
+            chunkOffset_ = 0;
+            if (next < chunkCount_)
+                schedule(next);
+            continue;
+        }
+        const std::size_t count = static_cast<std::size_t>(std::min<std::int64_t>(
+            static_cast<std::int64_t>(std::min(frames - done, available)), table_.validFrames - position_));
+        for (std::size_t c = 0; c < channels; ++c)
+            std::memcpy(buffers[c] + done, slot.samples.channel(c) + slot.begin + chunkOffset_, count * sizeof(float));
+        chunkOffset_ += count;
+        position_ += static_cast<std::int64_t>(count);
+        done += count;
+    }
+    return done;
+}
+
+void ParallelDecodeReader::seekToFrame(std::int64_t frame)
+{
+    frame = std::clamp<std::int64_t>(frame, 0, table_.validFrames);
+    // Within the current chunk the decoded samples stay usable.
+    const std::int64_t chunkStart = chunkFirstFrame(chunk_);
+    if (chunk_ < chunkCount_ && frame >= chunkStart && frame < chunkFirstFrame(chunk_ + 1)) {
+        chunkOffset_ = static_cast<std::size_t>(frame - chunkStart);
+        position_ = frame;
+        return;
+    }
+    restart(frame);
+}
+
+void ParallelDecodeReader::restart(std::int64_t frame)
+{
+    ++generation_;
+    const std::int64_t chunkFrames
+        = static_cast<std::int64_t>(chunkPackets_) * static_cast<std::int64_t>(table_.framesPerPacket);
+    position_ = frame;
+    chunk_ = std::min(static_cast<std::size_t>((frame + table_.primingFrames) / chunkFrames), chunkCount_);
+    chunkOffset_ = static_cast<std::size_t>(frame - chunkFirstFrame(chunk_));
+    for (std::size_t c = chunk_; c < chunkCount_ && c < chunk_ + slots_.size(); ++c)
+        schedule(c);
+}
+
+void ParallelDecodeReader::schedule(std::size_t chunk)
+{
+    std::uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& slot = slots_[chunk % slots_.size()];
+        slot.chunk = chunk;
+        slot.ready = false;
+        slot.error = nullptr;
+        generation = generation_.load();
+        ++outstanding_;
+    }
+    pool_->submit([this, chunk, generation] {
+        Slot result;
+        {
+            // The slot's previous chunk has been consumed; reuse its storage.
+            std::lock_guard<std::mutex> lock(mutex_);
+            Slot& slot = slots_[chunk % slots_.size()];
+            if (generation == generation_.load() && slot.chunk == chunk)
+                std::swap(result.samples, slot.samples);
+        }
+        try {
+            decodeChunk(chunk, generation, result);
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& slot = slots_[chunk % slots_.size()];
+        if (generation == generation_.load() && slot.chunk == chunk) {
+            std::swap(slot.samples, result.samples);
+            slot.begin = result.begin;
+            slot.end = result.end;
+            slot.error = result.error;
+            slot.ready = true;
+        }
+        --outstanding_;
+        // Notify under the lock: once it is released the reader may be gone.
+        changed_.notify_all();
+    });
+}
+
+void ParallelDecodeReader::decodeChunk(std::size_t chunk, std::uint64_t generation, Slot& result) const
+{
+    const std::size_t channels = format_.channelCount;
+    const std::size_t framesPerPacket = table_.framesPerPacket;
+    const std::size_t first = chunk * chunkPackets_;
+    const std::size_t last = std::min(table_.packetCount(), first + chunkPackets_);
+    const std::size_t capacity = (last - first) * framesPerPacket;
+    if (result.samples.channelCount() != channels || result.samples.frameCount() < capacity)
+        result.samples.resize(channels, capacity);
+
+    const std::unique_ptr<PacketDecoder> decoder = decoderFactory_(table_);
+    const std::size_t preRoll = std::min(first, decoder->preRollPackets());
+    std::vector<float> packet(framesPerPacket * channels);
+    std::size_t produced = 0;
+    for (std::size_t p = first - preRoll; p < last; ++p) {
+        // A seek has made this chunk stale.
+        if (generation != generation_.load(std::memory_order_relaxed))
+            return;
+        const std::uint64_t offset = table_.offsets[p];
+        std::size_t count = decoder->decodePacket(file_->data() + offset,
+                                                  static_cast<std::size_t>(table_.offsets[p + 1] - offset),
+                                                  packet.data());
+        if (p < first)
+            continue;
+        // Frames are placed by packet number, so only the last packet may
+        // come up short; anywhere else the rest of the stream would shift.
+        if (count > framesPerPacket || (count < framesPerPacket && p + 1 < table_.packetCount()))
+            throw std::runtime_error("packet " + std::to_string(p) + " decoded to " + std::to_string(count)
+                                     + " frames instead of " + std::to_string(framesPerPacket));
+        count = std::min(count, capacity - produced);
+        deinterleave(packet.data(), channels, count, result.samples.data(), produced);
+        produced += count;
+    }
+
+    // Drop the encoder delay and the padding of the last packet.
+    const auto streamStart = static_cast<std::int64_t>(first * framesPerPacket);
+    const auto size = static_cast<std::int64_t>(produced);
+    result.begin = static_cast<std::size_t>(std::clamp<std::int64_t>(table_.primingFrames - streamStart, 0, size));
+    result.end = static_cast<std::size_t>(std::clamp<std::int64_t>(
+        table_.primingFrames + table_.validFrames - streamStart, static_cast<std::int64_t>(result.begin), size));
+}
+
+std::int64_t ParallelDecodeReader::chunkFirstFrame(std::size_t chunk) const
+{
+    const auto streamStart = static_cast<std::int64_t>(chunk * chunkPackets_ * table_.framesPerPacket);
+    return std::clamp<std::int64_t>(streamStart - table_.primingFrames, 0, table_.validFrames);
+}
+
+std::unique_ptr<AudioReader> openAudioFile(const std::string& path, const ParallelDecodeOptions& options)
+{
+    const std::uint32_t formatId = cafFormatId(MappedFile(path));
+    if (formatId != 0 && formatId != kLinearPcm)
+        return std::make_unique<ParallelDecodeReader>(path, options);
+    return std::make_unique<MappedPcmReader>(path);
+}
+
+} // namespace audiocompare
@@ -0,0 +1,115 @@
+//
+//  ParallelDecodeReader.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "AudioUtilities.hpp"
+#include "MappedFile.hpp"
+#include "PacketDecoder.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+class ThreadPool;
+
+using PacketDecoderFactory = std::function<std::unique_ptr<PacketDecoder>(const PacketTable&)>;
+
+struct ParallelDecodeOptions {
+    /// Decoded frames per chunk, rounded to whole packets.
+    std::size_t chunkFrames = 1 << 20;
+    /// Worker threads when `pool` is null; 0 uses one per hardware thread.
+    std::size_t threadCount = 0;
+    /// Chunks decoded ahead of the reader; 0 uses twice the worker count.
+    std::size_t chunksInFlight = 0;
+    /// Shared pool to decode on instead of a private one. Do not read from
+    /// one of its own tasks: the read could wait on a chunk queued behind it.
+    ThreadPool* pool = nullptr;
+    /// Decoder per chunk; `makePacketDecoder` when empty.
+    PacketDecoderFactory decoderFactory;
+};
+
+/// `AudioReader` over a compressed CAF file that decodes on several threads
+/// where `EZAudioFile` decodes on one. The packet table is split into
+/// chunks of whole packets, each decoded by its own `PacketDecoder`. A chunk
+/// that starts mid-stream first decodes and drops the decoder's pre-roll
+/// packets, so the output is sample-identical to a sequential decode.
+/// Finished chunks wait in a fixed ring of slots and are handed out in
+/// order, so memory is bounded by `chunksInFlight`, not the file length.
+class ParallelDecodeReader : public AudioReader {
+public:
+    /// Throws std::runtime_error when the file is missing, malformed or its
+    /// codec has no decoder. Decoding errors, including a packet before the
+    /// last that decodes to fewer than `framesPerPacket` frames, surface from
+    /// `readFrames`.
+    explicit ParallelDecodeReader(const std::string& path, const ParallelDecodeOptions& options = {});
+    /// Waits for the chunks still being decoded.
+    ~ParallelDecodeReader() override;
+
+    ParallelDecodeReader(const ParallelDecodeReader&) = delete;
+    ParallelDecodeReader& operator=(const ParallelDecodeReader&) = delete;
+
+    AudioFormat format() const override { return format_; }
+    std::int64_t frameCount() const override { return table_.validFrames; }
+    std::size_t readFrames(float* const* buffers, std::size_t frames) override;
+    void seekToFrame(std::int64_t frame) override;
+    std::int64_t framePosition() const override { return position_; }
+
+    const PacketTable& packetTable() const { return table_; }
+    std::size_t chunkCount() const { return chunkCount_; }
+    /// Times `readFrames` had to wait for a chunk to finish decoding.
+    std::size_t stalls() const { return stalls_; }
+
+private:
+    struct Slot {
+        std::size_t chunk = 0;
+        bool ready = false;
+        FloatBuffers samples;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::exception_ptr error;
+    };
+
+    void restart(std::int64_t frame);
+    void decodeChunk(std::size_t chunk, std::uint64_t generation, Slot& result) const;
+    void schedule(std::size_t chunk);
+    std::int64_t chunkFirstFrame(std::size_t chunk) const;
+
+    std::shared_ptr<const MappedFile> file_;
+    PacketTable table_;
+    AudioFormat format_;
+    PacketDecoderFactory decoderFactory_;
+    std::size_t chunkPackets_ = 0;
+    std::size_t chunkCount_ = 0;
+    std::int64_t position_ = 0;
+    std::size_t chunk_ = 0;
+    std::size_t chunkOffset_ = 0;
+    std::size_t stalls_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<Slot> slots_;
+    std::atomic<std::uint64_t> generation_{0};
+    std::size_t outstanding_ = 0;
+
+    std::unique_ptr<ThreadPool> ownedPool_;
+    ThreadPool* pool_ = nullptr;
+};
+
+/// Opens `path` with `MappedPcmReader` when it holds linear PCM and with
+/// `ParallelDecodeReader` when it is a compressed CAF file.
+std::unique_ptr<AudioReader> openAudioFile(const std::string& path, const ParallelDecodeOptions& options = {});
+
+} // namespace audiocompare
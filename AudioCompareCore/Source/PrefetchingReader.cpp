@@ -0,0 +1,158 @@
+//
+//  PrefetchingReader.cpp
+//  AudioCompareCore
+//
+
+#include "PrefetchingReader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace audiocompare {
+
+PrefetchingReader::PrefetchingReader(AudioReader& source, std::size_t lookAheadFrames, std::size_t chunkFrames)
+    : source_(source)
+    , format_(source.format())
+    , frameCount_(source.frameCount())
+    , capacity_(lookAheadFrames)
+    , chunkFrames_(chunkFrames)
+    , ring_(format_.channelCount, lookAheadFrames)
+    , position_(source.framePosition())
+{
+    if (lookAheadFrames == 0 || chunkFrames == 0)
+        throw std::invalid_argument("prefetch needs a non-empty look-ahead");
+    thread_ = std::thread(&PrefetchingReader::run, this);
+}
+
+PrefetchingReader::~PrefetchingReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+std::size_t PrefetchingReader::readFrames(float* const* buffers, std::size_t frames)
+{
+    const std::size_t channels = format_.channelCount;
+    std::size_t done = 0;
+    while (done < frames) {
+        const std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+        const std::uint64_t head = head_.load(std::memory_order_acquire);
+        if (head == tail) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (head_.load() == tail) {
+                // Hand out what was read before the error; the next call throws.
+                if (ended_ && (done > 0 || !error_))
+                    break;
+                if (error_)
+                    std::rethrow_exception(error_);
+                ++stalls_;
+                const auto start = std::chrono::steady_clock::now();
+                ready_.wait(lock, [&] { return head_.load() != tail || ended_; });
+                stallSeconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            continue;
+        }
+
+        const std::size_t index = static_cast<std::size_t>(tail % capacity_);
+        const std::size_t count = std::min({frames - done, static_cast<std::size_t>(head - tail), capacity_ - index});
+        for (std::size_t c = 0; c < channels; ++c)
+            std::memcpy(buffers[c] + done, ring_.channel(c) + index, count * sizeof(float));
+        tail_.store(tail + count);
+        // Pairs with the flag the producer sets before it re-checks for space.
+        if (producerWaiting_.load()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wake_.notify_one();
+        }
+        done += count;
+        position_ += static_cast<std::int64_t>(count);
+    }
+    return done;
+}
+
+void PrefetchingReader::seekToFrame(std::int64_t frame)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    seekTarget_ = frame;
+    seekPending_ = true;
+    wake_.notify_one();
+    ready_.wait(lock, [this] { return !seekPending_; });
+    position_ = seekTarget_;
+}
+
+void PrefetchingReader::run()
+{
+    const std::size_t channels = format_.channelCount;
+    std::vector<float*> pointers(channels);
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        if (stopping_)
+            return;
+        if (seekPending_) {
+            // The consumer is blocked in seekToFrame, so the ring is ours.
+            try {
+                source_.seekToFrame(seekTarget_);
+                seekTarget_ = source_.framePosition();
+                error_ = nullptr;
+                ended_ = false;
+            } catch (...) {
+                error_ = std::current_exception();
+                ended_ = true;
+            }
+            head_.store(0);
+            tail_.store(0);
+            seekPending_ = false;
+            ready_.notify_all();
+            continue;
+        }
+        if (ended_) {
+            wake_.wait(lock);
+            continue;
+        }
+
+        const std::uint64_t head = head_.load(std::memory_order_relaxed);
+        std::size_t space = capacity_ - static_cast<std::size_t>(head - tail_.load());
+        if (space == 0) {
+            producerWaiting_.store(true);
+            space = capacity_ - static_cast<std::size_t>(head - tail_.load());
+            if (space == 0)
+                wake_.wait(lock);
+            producerWaiting_.store(false);
+            continue;
+        }
+
+        const std::size_t index = static_cast<std::size_t>(head % capacity_);
+        const std::size_t count = std::min({space, chunkFrames_, capacity_ - index});
+        for (std::size_t c = 0; c < channels; ++c)
+            pointers[c] = ring_.channel(c) + index;
+        lock.unlock();
+        std::size_t read = 0;
+        std::exception_ptr error;
+        try {
+            read = source_.readFrames(pointers.data(), count);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        // A seek requested meanwhile discards this read.
+        if (seekPending_ || stopping_)
+            continue;
+        if (error) {
+            error_ = error;
+            ended_ = true;
+        } else if (read == 0) {
+            ended_ = true;
+        } else {
+            head_.store(head + read, std::memory_order_release);
+        }
+        ready_.notify_one();
+    }
+}
+
+} // namespace audiocompare
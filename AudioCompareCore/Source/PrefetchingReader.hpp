@@ -0,0 +1,87 @@
+//
+//  PrefetchingReader.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "AudioUtilities.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace audiocompare {
+
+/// Moves `source` decoding onto a background thread, the read-ahead that
+/// `EZAudioFile readFrames:` lacks. The thread keeps up to `lookAheadFrames`
+/// frames decoded in a single-producer, single-consumer planar ring, in the
+/// manner of a `TPCircularBuffer`. `readFrames` copies frames that are
+/// already decoded without taking a lock and only waits when the ring has
+/// run dry. Each such wait counts as a stall, which shows how deep the
+/// look-ahead needs to be.
+///
+/// `source` must not be used directly while the reader exists.
+class PrefetchingReader : public AudioReader {
+public:
+    /// `chunkFrames` is the largest read issued to `source`.
+    explicit PrefetchingReader(AudioReader& source, std::size_t lookAheadFrames = 1 << 18,
+                               std::size_t chunkFrames = 16384);
+    /// Stops the thread; a read in progress on `source` completes first.
+    ~PrefetchingReader() override;
+
+    PrefetchingReader(const PrefetchingReader&) = delete;
+    PrefetchingReader& operator=(const PrefetchingReader&) = delete;
+
+    AudioFormat format() const override { return format_; }
+    std::int64_t frameCount() const override { return frameCount_; }
+    /// Rethrows errors raised by `source` once the frames before them have
+    /// been read.
+    std::size_t readFrames(float* const* buffers, std::size_t frames) override;
+    /// Drops the look-ahead and restarts decoding at `frame`.
+    void seekToFrame(std::int64_t frame) override;
+    std::int64_t framePosition() const override { return position_; }
+
+    std::size_t lookAheadFrames() const { return capacity_; }
+    /// Reads that found the ring empty before the end of the source.
+    std::size_t stalls() const { return stalls_; }
+    /// Total time `readFrames` spent waiting in those stalls.
+    double stallSeconds() const { return stallSeconds_; }
+
+private:
+    void run();
+
+    AudioReader& source_;
+    AudioFormat format_;
+    std::int64_t frameCount_;
+    std::size_t capacity_;
+    std::size_t chunkFrames_;
+    FloatBuffers ring_;
+
+    // Frames written and read since the last seek; the ring holds
+    // [tail_, head_) at index (frame % capacity_).
+    std::atomic<std::uint64_t> head_{0};
+    std::atomic<std::uint64_t> tail_{0};
+    std::atomic<bool> producerWaiting_{false};
+
+    std::int64_t position_ = 0;
+    std::size_t stalls_ = 0;
+    double stallSeconds_ = 0.0;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable ready_;
+    bool ended_ = false;
+    bool seekPending_ = false;
+    std::int64_t seekTarget_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+    std::thread thread_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,178 @@
+//
+//  ResamplingReader.cpp
+//  AudioCompareCore
+//
+
+#include "ResamplingReader.hpp"
+
+#include "FractionalDelayReader.hpp"
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const std::size_t kBlockFrames = 4096;
+
+} // namespace
+
+ResamplingReader::ResamplingReader(AudioReader& source, double start, double ratio,
+                                   std::size_t phases, std::size_t halfLength, double kaiserBeta)
+    : source_(source)
+    , start_(start)
+    , ratio_(ratio)
+    , phases_(phases)
+    , halfLength_(halfLength)
+{
+    if (!(ratio > 0.5 && ratio < 2.0) || phases == 0 || halfLength == 0)
+        throw std::invalid_argument("invalid resampler configuration");
+
+    // Phase p reads the source p / phases of a sample after the tap centre.
+    const std::size_t length = 2 * halfLength;
+    bank_.resize((phases + 1) * length);
+    for (std::size_t p = 0; p <= phases; ++p) {
+        const std::vector<float> taps = designFractionalDelay(
+            halfLength, -static_cast<double>(p) / static_cast<double>(phases), kaiserBeta);
+        std::copy(taps.begin(), taps.end(), bank_.begin() + p * length);
+    }
+
+    const std::size_t channels = source.format().channelCount;
+    const std::size_t capacity = static_cast<std::size_t>(std::ceil(kBlockFrames * ratio)) + length + 2;
+    window_.resize(channels, capacity);
+    edge_.resize(length);
+    readPointers_.resize(channels);
+    seekToFrame(0);
+}
+
+std::int64_t ResamplingReader::firstSupportedFrame(double start, double ratio, std::size_t halfLength)
+{
+    const double earliest = static_cast<double>(halfLength) - 1.0;
+    if (start >= earliest)
+        return 0;
+    return static_cast<std::int64_t>(std::ceil((earliest - start) / ratio));
+}
+
+double ResamplingReader::sourceTime(std::int64_t frame) const
+{
+    return start_ + ratio_ * static_cast<double>(frame);
+}
+
+std::int64_t ResamplingReader::sourceIndex(std::int64_t frame) const
+{
+    return static_cast<std::int64_t>(std::floor(sourceTime(frame)));
+}
+
+std::int64_t ResamplingReader::frameCount() const
+{
+    const std::int64_t sourceFrames = source_.frameCount();
+    if (sourceFrames < 0)
+        return -1;
+    const double last = std::floor((static_cast<double>(sourceFrames - 1 - static_cast<std::int64_t>(halfLength_))
+                                    - start_) / ratio_);
+    return last < 0.0 ? 0 : static_cast<std::int64_t>(last) + 1;
+}
+
+void ResamplingReader::seekToFrame(std::int64_t frame)
+{
+    position_ = std::max<std::int64_t>(frame, 0);
+    windowStart_ = std::max<std::int64_t>(sourceIndex(position_) - static_cast<std::int64_t>(halfLength_) + 1, 0);
+    window_.clear();
+    available_ = 0;
+    sourceEnd_ = -1;
+    source_.seekToFrame(windowStart_);
+}
+
+void ResamplingReader::fillWindow(std::size_t needed)
+{
+    while (available_ < needed && sourceEnd_ < 0) {
+        for (std::size_t c = 0; c < window_.channelCount(); ++c)
+            readPointers_[c] = window_.channel(c) + available_;
+        const std::size_t got = source_.readFrames(readPointers_.data(), needed - available_);
+        if (got == 0) {
+            sourceEnd_ = windowStart_ + static_cast<std::int64_t>(available_);
+            break;
+        }
+        available_ += got;
+    }
+    if (available_ < needed) {
+        for (std::size_t c = 0; c < window_.channelCount(); ++c)
+            std::fill(window_.channel(c) + available_, window_.channel(c) + needed, 0.0f);
+        available_ = needed;
+    }
+}
+
+std::size_t ResamplingReader::readFrames(float* const* buffers, std::size_t frames)
+{
+    const std::size_t length = 2 * halfLength_;
+    const std::int64_t half = static_cast<std::int64_t>(halfLength_);
+    const std::size_t channels = window_.channelCount();
+    std::size_t done = 0;
+
+    while (done < frames) {
+        std::size_t chunk = std::min(kBlockFrames, frames - done);
+        const std::int64_t lastIndex = sourceIndex(position_ + static_cast<std::int64_t>(chunk) - 1);
+        fillWindow(static_cast<std::size_t>(std::max<std::int64_t>(lastIndex + half - windowStart_ + 1, 0)));
+        if (sourceEnd_ >= 0) {
+            // Keep outputs whose filter support ends inside the source.
+            std::size_t supported = 0;
+            while (supported < chunk
+                   && sourceIndex(position_ + static_cast<std::int64_t>(supported)) + half < sourceEnd_)
+                ++supported;
+            chunk = supported;
+        }
+        if (chunk == 0)
+            break;
+
+        for (std::size_t i = 0; i < chunk; ++i) {
+            const double time = sourceTime(position_ + static_cast<std::int64_t>(i));
+            const double index = std::floor(time);
+            const double phase = (time - index) * static_cast<double>(phases_);
+            const std::size_t p = std::min(static_cast<std::size_t>(phase), phases_ - 1);
+            const float mix = static_cast<float>(phase - static_cast<double>(p));
+            const float* lower = bank_.data() + p * length;
+            const float* upper = lower + length;
+            const std::int64_t first = static_cast<std::int64_t>(index) - half + 1;
+            // Support reaching before source frame 0 sees silence there.
+            const std::size_t zeros = static_cast<std::size_t>(std::clamp<std::int64_t>(
+                -first, 0, static_cast<std::int64_t>(length)));
+            for (std::size_t c = 0; c < channels; ++c) {
+                const float* input = edge_.data();
+                if (zeros == 0) {
+                    input = window_.channel(c) + (first - windowStart_);
+                } else {
+                    std::fill(edge_.begin(), edge_.begin() + zeros, 0.0f);
+                    std::copy(window_.channel(c), window_.channel(c) + (length - zeros), edge_.begin() + zeros);
+                }
+                const float a = dotProduct(lower, input, length);
+                const float b = dotProduct(upper, input, length);
+                buffers[c][done + i] = a + mix * (b - a);
+            }
+        }
+        position_ += static_cast<std::int64_t>(chunk);
+        done += chunk;
+
+        // Drop source frames the next output no longer needs.
+        const std::int64_t nextStart = std::max<std::int64_t>(sourceIndex(position_) - half + 1, 0);
+        const std::int64_t drop = nextStart - windowStart_;
+        if (drop >= static_cast<std::int64_t>(available_)) {
+            windowStart_ = nextStart;
+            available_ = 0;
+            if (sourceEnd_ < 0)
+                source_.seekToFrame(windowStart_);
+        } else if (drop > 0) {
+            for (std::size_t c = 0; c < channels; ++c)
+                std::memmove(window_.channel(c), window_.channel(c) + drop,
+                             (available_ - static_cast<std::size_t>(drop)) * sizeof(float));
+            available_ -= static_cast<std::size_t>(drop);
+            windowStart_ = nextStart;
+        }
+    }
+    return done;
+}
+
+} // namespace audiocompare
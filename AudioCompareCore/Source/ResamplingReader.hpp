@@ -0,0 +1,65 @@
+//
+//  ResamplingReader.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "AudioUtilities.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace audiocompare {
+
+/// Streams a source at a slightly different rate, output[n] =
+/// source(start + ratio * n), for compensating clock drift in one pass.
+/// Each output is a polyphase Kaiser-windowed sinc filter evaluated at the two
+/// nearest of `phases` precomputed sub-sample phases and linearly
+/// interpolated between them. Output ends where the filter would need
+/// frames past the end of the source.
+class ResamplingReader : public AudioReader {
+public:
+    ResamplingReader(AudioReader& source, double start, double ratio,
+                     std::size_t phases = 512, std::size_t halfLength = 32,
+                     double kaiserBeta = 12.0);
+
+    AudioFormat format() const override { return source_.format(); }
+    std::int64_t frameCount() const override;
+    std::size_t readFrames(float* const* buffers, std::size_t frames) override;
+    void seekToFrame(std::int64_t frame) override;
+    std::int64_t framePosition() const override { return position_; }
+
+    /// First output frame whose filter support lies entirely at or after
+    /// source frame 0 for the given model.
+    static std::int64_t firstSupportedFrame(double start, double ratio, std::size_t halfLength = 32);
+
+    double start() const { return start_; }
+    double ratio() const { return ratio_; }
+
+private:
+    double sourceTime(std::int64_t frame) const;
+    std::int64_t sourceIndex(std::int64_t frame) const;
+    void fillWindow(std::size_t needed);
+
+    AudioReader& source_;
+    double start_;
+    double ratio_;
+    std::size_t phases_;
+    std::size_t halfLength_;
+    /// (phases + 1) filters of 2 * halfLength taps, one per sub-sample phase.
+    std::vector<float> bank_;
+    FloatBuffers window_;
+    /// Filter input for outputs whose support starts before source frame 0.
+    std::vector<float> edge_;
+    std::vector<float*> readPointers_;
+    /// Source frame held at window_[0]; never negative, so the window only
+    /// ever holds real source frames.
+    std::int64_t windowStart_ = 0;
+    std::size_t available_ = 0;
+    std::int64_t position_ = 0;
+    std::int64_t sourceEnd_ = -1;
+};
+
+} // namespace audiocompare
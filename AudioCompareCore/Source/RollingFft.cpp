@@ -0,0 +1,85 @@
+//
+//  RollingFft.cpp
+//  AudioCompareCore
+//
+
+#include "RollingFft.hpp"
+
+#include "AudioUtilities.hpp"
+#include "ScratchArena.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+std::size_t transformSize(std::size_t windowSize, const RollingFftOptions& options)
+{
+    if (windowSize == 0)
+        throw std::invalid_argument("window size must be positive");
+    if (options.fftSize == 0)
+        return windowSize;
+    if (options.fftSize < windowSize)
+        throw std::invalid_argument("FFT size must be at least the window size");
+    return options.fftSize;
+}
+
+} // namespace
+
+RollingFft::RollingFft(std::size_t windowSize, FftBackend backend)
+    : fft_(windowSize, backend)
+    , history_(windowSize, 0.0f)
+    , window_(sharedWindow(windowSize))
+{
+}
+
+RollingFft::RollingFft(std::size_t windowSize, const RollingFftOptions& options)
+    : fft_(transformSize(windowSize, options), options.backend)
+    , hopSize_(options.hopSize)
+    , history_(windowSize, 0.0f)
+    , window_(sharedWindow(windowSize, options.window))
+{
+}
+
+const float* RollingFft::computeFFT(const float* buffer, std::size_t bufferSize)
+{
+    appendBufferAndShift(buffer, bufferSize, history_.data(), history_.size());
+    return transform();
+}
+
+void RollingFft::appendSamples(const float* buffer, std::size_t bufferSize)
+{
+    appendBufferAndShift(buffer, bufferSize, history_.data(), history_.size());
+}
+
+void RollingFft::reset()
+{
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    pending_ = 0;
+}
+
+void RollingFft::windowHistory(float* windowed) const
+{
+    const std::vector<float>& window = *window_;
+    for (std::size_t i = 0; i < history_.size(); ++i)
+        windowed[i] = history_[i] * window[i];
+    std::fill(windowed + history_.size(), windowed + fft_.size(), 0.0f);
+}
+
+const float* RollingFft::transform()
+{
+    ScratchBuffer windowed(fft_.size());
+    windowHistory(windowed.data());
+    return fft_.computeFFT(windowed.data());
+}
+
+void RollingFft::transformInto(float* magnitudes)
+{
+    ScratchBuffer windowed(fft_.size());
+    windowHistory(windowed.data());
+    fft_.computeMagnitudes(windowed.data(), magnitudes);
+}
+
+} // namespace audiocompare
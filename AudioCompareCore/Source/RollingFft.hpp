@@ -0,0 +1,113 @@
+//
+//  RollingFft.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "Fft.hpp"
+#include "FftWindow.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace audiocompare {
+
+struct RollingFftOptions {
+    /// Samples between the transforms `process` makes. 0 transforms once per
+    /// call, as `computeFFT` always does.
+    std::size_t hopSize = 0;
+    FftWindow window;
+    /// Transform size, a power of two no smaller than the window; 0 uses the
+    /// window size. Larger sizes zero-pad each window, which samples the
+    /// spectrum more finely without lengthening the window.
+    std::size_t fftSize = 0;
+    FftBackend backend = defaultFftBackend();
+};
+
+/// Sliding-window FFT, the counterpart of `EZAudioFFTRolling`. Each call
+/// appends the incoming buffer to a history of `windowSize` samples and
+/// transforms the windowed history, so with `computeFFT` the hop equals the
+/// buffer size. `process` decouples the two with a fixed hop instead.
+class RollingFft {
+public:
+    /// Hann window, no padding; `windowSize` must be a power of two.
+    explicit RollingFft(std::size_t windowSize, FftBackend backend = defaultFftBackend());
+    /// Throws std::invalid_argument if `options.fftSize` is not a power of
+    /// two of at least `windowSize`.
+    RollingFft(std::size_t windowSize, const RollingFftOptions& options);
+
+    std::size_t windowSize() const { return history_.size(); }
+    std::size_t fftSize() const { return fft_.size(); }
+    std::size_t hopSize() const { return hopSize_; }
+    std::size_t binCount() const { return fft_.binCount(); }
+    /// The shared window coefficients, `windowSize()` of them.
+    const std::vector<float>& window() const { return *window_; }
+
+    const float* computeFFT(const float* buffer, std::size_t bufferSize);
+    /// Appends to the history without transforming it.
+    void appendSamples(const float* buffer, std::size_t bufferSize);
+
+    /// Appends `bufferSize` samples, calling `consume(magnitudes)` with the
+    /// `binCount()` magnitudes each time another `hopSize()` samples have
+    /// arrived; a partial hop carries over to the next call. With no hop set,
+    /// transforms once at the end of the buffer.
+    template <typename Consume>
+    void process(const float* buffer, std::size_t bufferSize, Consume&& consume)
+    {
+        forEachHop(buffer, bufferSize, [&] { consume(transform()); });
+    }
+
+    /// As `process`, but each spectrum is written straight into the
+    /// `binCount()` floats `target()` returns, and `done()` is called once
+    /// they are filled. `fftData()` is not updated.
+    template <typename Target, typename Done>
+    void processInto(const float* buffer, std::size_t bufferSize, Target&& target, Done&& done)
+    {
+        forEachHop(buffer, bufferSize, [&] {
+            transformInto(target());
+            done();
+        });
+    }
+
+    const float* fftData() const { return fft_.fftData(); }
+    const float* timeDomainData() const { return history_.data(); }
+
+    void reset();
+
+private:
+    template <typename Hop>
+    void forEachHop(const float* buffer, std::size_t bufferSize, Hop&& hop)
+    {
+        if (hopSize_ == 0) {
+            appendSamples(buffer, bufferSize);
+            hop();
+            return;
+        }
+        while (bufferSize > 0) {
+            const std::size_t take = std::min(bufferSize, hopSize_ - pending_);
+            appendSamples(buffer, take);
+            buffer += take;
+            bufferSize -= take;
+            pending_ += take;
+            if (pending_ == hopSize_) {
+                pending_ = 0;
+                hop();
+            }
+        }
+    }
+
+    const float* transform();
+    void transformInto(float* magnitudes);
+    void windowHistory(float* windowed) const;
+
+    Fft fft_;
+    std::size_t hopSize_ = 0;
+    std::size_t pending_ = 0;
+    std::vector<float> history_;
+    std::shared_ptr<const std::vector<float>> window_;
+};
+
+} // namespace audiocompare
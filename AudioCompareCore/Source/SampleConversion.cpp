@@ -0,0 +1,466 @@
+//
+//  SampleConversion.cpp
+//  AudioCompareCore
+//
+
+#include "SampleConversion.hpp"
+
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if AUDIOCOMPARE_AVX2 || AUDIOCOMPARE_SSE2
+#include <immintrin.h>
+#endif
+#if AUDIOCOMPARE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audiocompare {
+
+namespace {
+
+const float kInt8Scale = 1.0f / 128.0f;
+const float kInt16Scale = 1.0f / 32768.0f;
+const float kInt32Scale = 1.0f / 2147483648.0f;
+const std::size_t kStrideBlockFrames = 256;
+
+bool hostIsLittleEndian()
+{
+    const std::uint16_t probe = 1;
+    unsigned char first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+std::uint32_t readLE32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint32_t readBE32(const unsigned char* p)
+{
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16)
+           | (static_cast<std::uint32_t>(p[2]) << 8) | static_cast<std::uint32_t>(p[3]);
+}
+
+std::uint64_t read64(const unsigned char* p, bool little)
+{
+    return little ? static_cast<std::uint64_t>(readLE32(p)) | (static_cast<std::uint64_t>(readLE32(p + 4)) << 32)
+                  : (static_cast<std::uint64_t>(readBE32(p)) << 32) | readBE32(p + 4);
+}
+
+void convertInt16(const unsigned char* source, bool swap, std::size_t count, float* output)
+{
+    std::size_t i = 0;
+#if AUDIOCOMPARE_AVX2
+    const __m256 scale = _mm256_set1_ps(kInt16Scale);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * i));
+        if (swap)
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), scale));
+    }
+#elif AUDIOCOMPARE_SSE2
+    const __m128 scale = _mm_set1_ps(kInt16Scale);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 2 * i));
+        if (swap)
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        // Unpacking a lane with itself and shifting back sign-extends it.
+        const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+#elif AUDIOCOMPARE_NEON
+    for (; i + 8 <= count; i += 8) {
+        uint8x16_t bytes = vld1q_u8(source + 2 * i);
+        if (swap)
+            bytes = vrev16q_u8(bytes);
+        const int16x8_t v = vreinterpretq_s16_u8(bytes);
+        vst1q_f32(output + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), kInt16Scale));
+        vst1q_f32(output + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), kInt16Scale));
+    }
+#endif
+    for (; i < count; ++i) {
+        const unsigned char* p = source + 2 * i;
+        const auto value = static_cast<std::int16_t>(swap ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8));
+        output[i] = static_cast<float>(value) * kInt16Scale;
+    }
+}
+
+// Each sample is placed in the top three bytes of an int32: the conversion
+// stays exact and the scale becomes 2^-31.
+void convertInt24(const unsigned char* source, bool swap, std::size_t count, float* output)
+{
+    std::size_t i = 0;
+    if (!swap) {
+#if AUDIOCOMPARE_AVX2
+        // Each 128-bit lane takes four samples; the two loads read 28 bytes.
+        const __m256i shuffle = _mm256_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+                                                 -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+        const __m256 scale = _mm256_set1_ps(kInt32Scale);
+        for (; i + 10 <= count; i += 8) {
+            const unsigned char* p = source + 3 * i;
+            const __m256i bytes = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+            const __m256i values = _mm256_shuffle_epi8(bytes, shuffle);
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(values), scale));
+        }
+#elif AUDIOCOMPARE_SSE2
+        // Without a byte shuffle, each 64-bit half takes two samples: bytes
+        // 0-7 and 6-13 of the 16-byte load. Shifting the half left by 8 and
+        // by 16 lines its low and high sample up under their masks.
+        const __m128i lowMask = _mm_set_epi32(0, -256, 0, -256);
+        const __m128i highMask = _mm_set_epi32(-256, 0, -256, 0);
+        const __m128 scale = _mm_set1_ps(kInt32Scale);
+        for (; i + 6 <= count; i += 4) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 3 * i));
+            const __m128i pairs = _mm_unpacklo_epi64(bytes, _mm_srli_si128(bytes, 6));
+            const __m128i values = _mm_or_si128(_mm_and_si128(_mm_slli_epi64(pairs, 8), lowMask),
+                                                _mm_and_si128(_mm_slli_epi64(pairs, 16), highMask));
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(values), scale));
+        }
+#elif AUDIOCOMPARE_NEON
+        for (; i + 8 <= count; i += 8) {
+            const uint8x8x3_t bytes = vld3_u8(source + 3 * i);
+            const uint16x8_t low = vshll_n_u8(bytes.val[0], 8);
+            const uint16x8_t middle = vmovl_u8(bytes.val[1]);
+            const uint16x8_t high = vshll_n_u8(bytes.val[2], 8);
+            // low16 = byte0 << 8, high16 = byte2 << 8 | byte1.
+            const uint16x8_t upper = vorrq_u16(high, middle);
+            const uint32x4_t first = vorrq_u32(vshll_n_u16(vget_low_u16(upper), 16), vmovl_u16(vget_low_u16(low)));
+            const uint32x4_t second
+                = vorrq_u32(vshll_n_u16(vget_high_u16(upper), 16), vmovl_u16(vget_high_u16(low)));
+            vst1q_f32(output + i, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(first)), kInt32Scale));
+            vst1q_f32(output + i + 4, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(second)), kInt32Scale));
+        }
+#endif
+    }
+    for (; i < count; ++i) {
+        const unsigned char* p = source + 3 * i;
+        const std::uint32_t bits = swap ? (static_cast<std::uint32_t>(p[0]) << 24)
+                                              | (static_cast<std::uint32_t>(p[1]) << 16)
+                                              | (static_cast<std::uint32_t>(p[2]) << 8)
+                                        : (static_cast<std::uint32_t>(p[2]) << 24)
+                                              | (static_cast<std::uint32_t>(p[1]) << 16)
+                                              | (static_cast<std::uint32_t>(p[0]) << 8);
+        output[i] = static_cast<float>(static_cast<std::int32_t>(bits)) * kInt32Scale;
+    }
+}
+
+void convertInt32(const unsigned char* source, bool swap, std::size_t count, float* output)
+{
+    std::size_t i = 0;
+    if (!swap) {
+#if AUDIOCOMPARE_AVX2
+        const __m256 scale = _mm256_set1_ps(kInt32Scale);
+        for (; i + 8 <= count; i += 8) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 4 * i));
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+        }
+#elif AUDIOCOMPARE_SSE2
+        const __m128 scale = _mm_set1_ps(kInt32Scale);
+        for (; i + 4 <= count; i += 4) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 4 * i));
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+#elif AUDIOCOMPARE_NEON
+        for (; i + 4 <= count; i += 4) {
+            const int32x4_t v = vreinterpretq_s32_u8(vld1q_u8(source + 4 * i));
+            vst1q_f32(output + i, vmulq_n_f32(vcvtq_f32_s32(v), kInt32Scale));
+        }
+#endif
+    }
+    for (; i < count; ++i) {
+        const std::uint32_t bits = swap ? readBE32(source + 4 * i) : readLE32(source + 4 * i);
+        output[i] = static_cast<float>(static_cast<std::int32_t>(bits)) * kInt32Scale;
+    }
+}
+
+void deinterleaveStereo(const float* in, std::size_t frames, float* left, float* right)
+{
+    std::size_t i = 0;
+#if AUDIOCOMPARE_AVX2
+    for (; i + 8 <= frames; i += 8) {
+        const __m256 a = _mm256_loadu_ps(in + 2 * i);
+        const __m256 b = _mm256_loadu_ps(in + 2 * i + 8);
+        // Within each 128-bit lane the shuffle yields frames {0, 1, 4, 5} and
+        // {2, 3, 6, 7}; swapping the middle 64-bit pairs puts them in order.
+        const __m256 even = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 odd = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_ps(left + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(even), _MM_SHUFFLE(3, 1, 2, 0))));
+        _mm256_storeu_ps(right + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(odd), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+#elif AUDIOCOMPARE_SSE2
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 a = _mm_loadu_ps(in + 2 * i);
+        const __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif AUDIOCOMPARE_NEON
+    for (; i + 4 <= frames; i += 4) {
+        const float32x4x2_t v = vld2q_f32(in + 2 * i);
+        vst1q_f32(left + i, v.val[0]);
+        vst1q_f32(right + i, v.val[1]);
+    }
+#endif
+    for (; i < frames; ++i) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+void interleaveStereo(const float* left, const float* right, std::size_t frames, float* out)
+{
+    std::size_t i = 0;
+#if AUDIOCOMPARE_AVX2
+    for (; i + 8 <= frames; i += 8) {
+        const __m256 l = _mm256_loadu_ps(left + i);
+        const __m256 r = _mm256_loadu_ps(right + i);
+        // Per lane: frames {0, 1} and {4, 5} low, {2, 3} and {6, 7} high.
+        const __m256 low = _mm256_unpacklo_ps(l, r);
+        const __m256 high = _mm256_unpackhi_ps(l, r);
+        _mm256_storeu_ps(out + 2 * i, _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(out + 2 * i + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+#elif AUDIOCOMPARE_SSE2
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+#elif AUDIOCOMPARE_NEON
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t v;
+        v.val[0] = vld1q_f32(left + i);
+        v.val[1] = vld1q_f32(right + i);
+        vst2q_f32(out + 2 * i, v);
+    }
+#endif
+    for (; i < frames; ++i) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+// Returns the frames handled; the caller finishes the rest.
+std::size_t deinterleaveVector(const float* in, std::size_t channels, std::size_t frames, float* const* out)
+{
+    std::size_t i = 0;
+#if AUDIOCOMPARE_SSE2
+    if (channels == 4) {
+        // Four frames of four channels form a 4x4 matrix to transpose.
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(in + 4 * i);
+            __m128 b = _mm_loadu_ps(in + 4 * i + 4);
+            __m128 c = _mm_loadu_ps(in + 4 * i + 8);
+            __m128 d = _mm_loadu_ps(in + 4 * i + 12);
+            _MM_TRANSPOSE4_PS(a, b, c, d);
+            _mm_storeu_ps(out[0] + i, a);
+            _mm_storeu_ps(out[1] + i, b);
+            _mm_storeu_ps(out[2] + i, c);
+            _mm_storeu_ps(out[3] + i, d);
+        }
+    }
+#elif AUDIOCOMPARE_NEON
+    if (channels == 3) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x3_t v = vld3q_f32(in + 3 * i);
+            for (int c = 0; c < 3; ++c)
+                vst1q_f32(out[c] + i, v.val[c]);
+        }
+    } else if (channels == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            const float32x4x4_t v = vld4q_f32(in + 4 * i);
+            for (int c = 0; c < 4; ++c)
+                vst1q_f32(out[c] + i, v.val[c]);
+        }
+    }
+#else
+    (void)in;
+    (void)channels;
+    (void)frames;
+    (void)out;
+#endif
+    return i;
+}
+
+std::size_t interleaveVector(const float* const* in, std::size_t channels, std::size_t frames, float* out)
+{
+    std::size_t i = 0;
+#if AUDIOCOMPARE_SSE2
+    if (channels == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(in[0] + i);
+            __m128 b = _mm_loadu_ps(in[1] + i);
+            __m128 c = _mm_loadu_ps(in[2] + i);
+            __m128 d = _mm_loadu_ps(in[3] + i);
+            _MM_TRANSPOSE4_PS(a, b, c, d);
+            _mm_storeu_ps(out + 4 * i, a);
+            _mm_storeu_ps(out + 4 * i + 4, b);
+            _mm_storeu_ps(out + 4 * i + 8, c);
+            _mm_storeu_ps(out + 4 * i + 12, d);
+        }
+    }
+#elif AUDIOCOMPARE_NEON
+    if (channels == 3) {
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x3_t v;
+            for (int c = 0; c < 3; ++c)
+                v.val[c] = vld1q_f32(in[c] + i);
+            vst3q_f32(out + 3 * i, v);
+        }
+    } else if (channels == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x4_t v;
+            for (int c = 0; c < 4; ++c)
+                v.val[c] = vld1q_f32(in[c] + i);
+            vst4q_f32(out + 4 * i, v);
+        }
+    }
+#else
+    (void)in;
+    (void)channels;
+    (void)frames;
+    (void)out;
+#endif
+    return i;
+}
+
+} // namespace
+
+std::size_t bytesPerSample(SampleFormat format)
+{
+    switch (format) {
+    case SampleFormat::UInt8: return 1;
+    case SampleFormat::Int8: return 1;
+    case SampleFormat::Int16: return 2;
+    case SampleFormat::Int24: return 3;
+    case SampleFormat::Int32: return 4;
+    case SampleFormat::Float32: return 4;
+    case SampleFormat::Float64: return 8;
+    }
+    return 0;
+}
+
+bool isNativeFloat(SampleFormat format, ByteOrder order)
+{
+    return format == SampleFormat::Float32 && (order == ByteOrder::LittleEndian) == hostIsLittleEndian();
+}
+
+void convertToFloat(const unsigned char* source, SampleFormat format, ByteOrder order,
+                    std::size_t count, float* output)
+{
+    // The integer kernels take a "big-endian source" flag. Their scalar
+    // tails assemble bytes explicitly, so they work on any host; the SIMD
+    // loads assume a little-endian one, as on every target that has them.
+    const bool little = order == ByteOrder::LittleEndian;
+    const bool swap = !little;
+    switch (format) {
+    case SampleFormat::UInt8:
+        for (std::size_t i = 0; i < count; ++i)
+            output[i] = (static_cast<float>(source[i]) - 128.0f) * kInt8Scale;
+        break;
+    case SampleFormat::Int8:
+        for (std::size_t i = 0; i < count; ++i)
+            output[i] = static_cast<float>(static_cast<signed char>(source[i])) * kInt8Scale;
+        break;
+    case SampleFormat::Int16:
+        convertInt16(source, swap, count, output);
+        break;
+    case SampleFormat::Int24:
+        convertInt24(source, swap, count, output);
+        break;
+    case SampleFormat::Int32:
+        convertInt32(source, swap, count, output);
+        break;
+    case SampleFormat::Float32:
+        if (isNativeFloat(format, order)) {
+            std::memcpy(output, source, count * sizeof(float));
+            break;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint32_t bits = little ? readLE32(source + 4 * i) : readBE32(source + 4 * i);
+            std::memcpy(&output[i], &bits, sizeof(float));
+        }
+        break;
+    case SampleFormat::Float64:
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint64_t bits = read64(source + 8 * i, little);
+            double value;
+            std::memcpy(&value, &bits, sizeof(double));
+            output[i] = static_cast<float>(value);
+        }
+        break;
+    }
+}
+
+void deinterleave(const float* interleaved, std::size_t channelCount, std::size_t frames,
+                  float* const* planar, std::size_t planarOffset)
+{
+    if (channelCount == 1) {
+        std::memcpy(planar[0] + planarOffset, interleaved, frames * sizeof(float));
+        return;
+    }
+    if (channelCount == 2) {
+        deinterleaveStereo(interleaved, frames, planar[0] + planarOffset, planar[1] + planarOffset);
+        return;
+    }
+    float* out[4];
+    std::size_t done = 0;
+    if (channelCount <= 4) {
+        for (std::size_t c = 0; c < channelCount; ++c)
+            out[c] = planar[c] + planarOffset;
+        done = deinterleaveVector(interleaved, channelCount, frames, out);
+    }
+    // Strided copies in blocks small enough that the interleaved frames stay
+    // in L1 while every channel is pulled out of them.
+    for (std::size_t start = done; start < frames; start += kStrideBlockFrames) {
+        const std::size_t count = std::min(kStrideBlockFrames, frames - start);
+        for (std::size_t c = 0; c < channelCount; ++c) {
+            float* channel = planar[c] + planarOffset + start;
+            const float* in = interleaved + start * channelCount + c;
+            for (std::size_t i = 0; i < count; ++i)
+                channel[i] = in[i * channelCount];
+        }
+    }
+}
+
+void interleave(const float* const* planar, std::size_t channelCount, std::size_t frames,
+                float* interleaved, std::size_t planarOffset)
+{
+    if (channelCount == 1) {
+        std::memcpy(interleaved, planar[0] + planarOffset, frames * sizeof(float));
+        return;
+    }
+    if (channelCount == 2) {
+        interleaveStereo(planar[0] + planarOffset, planar[1] + planarOffset, frames, interleaved);
+        return;
+    }
+    const float* in[4];
+    std::size_t done = 0;
+    if (channelCount <= 4) {
+        for (std::size_t c = 0; c < channelCount; ++c)
+            in[c] = planar[c] + planarOffset;
+        done = interleaveVector(in, channelCount, frames, interleaved);
+    }
+    for (std::size_t start = done; start < frames; start += kStrideBlockFrames) {
+        const std::size_t count = std::min(kStrideBlockFrames, frames - start);
+        for (std::size_t c = 0; c < channelCount; ++c) {
+            const float* channel = planar[c] + planarOffset + start;
+            float* out = interleaved + start * channelCount + c;
+            for (std::size_t i = 0; i < count; ++i)
+                out[i * channelCount] = channel[i];
+        }
+    }
+}
+
+} // namespace audiocompare
@@ -0,0 +1,53 @@
+//
+//  SampleConversion.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace audiocompare {
+
+enum class SampleFormat {
+    UInt8,
+    Int8,
+    Int16,
+    Int24,
+    Int32,
+    Float32,
+    Float64,
+};
+
+enum class ByteOrder {
+    LittleEndian,
+    BigEndian,
+};
+
+std::size_t bytesPerSample(SampleFormat format);
+
+/// True when `format` in `order` is the host's own float layout, so mapped
+/// samples can be used in place.
+bool isNativeFloat(SampleFormat format, ByteOrder order);
+
+/// Converts `count` packed samples to float, the work
+/// `EZAudioFloatConverter` hands to an AudioConverter. Integers are scaled so
+/// full scale maps to [-1, 1); unsigned 8-bit samples are centred on 128.
+/// Little-endian 16/24/32-bit and big-endian 16-bit integers take SIMD paths
+/// whose results match the scalar conversion bit for bit. `source` needs no
+/// alignment.
+void convertToFloat(const unsigned char* source, SampleFormat format, ByteOrder order,
+                    std::size_t count, float* output);
+
+/// Splits `frames` interleaved frames of `channelCount` channels into one
+/// buffer per channel, starting at `planar[c] + planarOffset`. Mono, stereo
+/// and four-channel layouts (three-channel too on NEON) take SIMD paths.
+void deinterleave(const float* interleaved, std::size_t channelCount, std::size_t frames,
+                  float* const* planar, std::size_t planarOffset = 0);
+
+/// The inverse of `deinterleave`, the layout `EZAudioFloatConverter` hands
+/// back to Core Audio.
+void interleave(const float* const* planar, std::size_t channelCount, std::size_t frames,
+                float* interleaved, std::size_t planarOffset = 0);
+
+} // namespace audiocompare
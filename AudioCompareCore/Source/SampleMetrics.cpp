@@ -0,0 +1,85 @@
+//
+//  SampleMetrics.cpp
+//  AudioCompareCore
+//
+
+#include "SampleMetrics.hpp"
+
+#include "AudioUtilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace audiocompare {
+
+void SampleMetrics::accumulate(ChannelView reference, ChannelView candidate, std::int64_t startFrame)
+{
+    const std::size_t count = std::min(reference.size(), candidate.size());
+    double refSum = 0.0, candSum = 0.0, diffSum = 0.0, crossSum = 0.0;
+    std::int64_t differing = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const double r = reference[i];
+        const double c = candidate[i];
+        const double d = r - c;
+        refSum += r * r;
+        candSum += c * c;
+        diffSum += d * d;
+        crossSum += r * c;
+        const double magnitude = std::fabs(d);
+        if (magnitude > 0.0) {
+            ++differing;
+            if (magnitude > peakDifference) {
+                peakDifference = magnitude;
+                peakFrame = startFrame + static_cast<std::int64_t>(i);
+            }
+        }
+    }
+    frames += static_cast<std::int64_t>(count);
+    referenceEnergy += refSum;
+    candidateEnergy += candSum;
+    differenceEnergy += diffSum;
+    crossEnergy += crossSum;
+    differingSamples += differing;
+}
+
+void SampleMetrics::merge(const SampleMetrics& other)
+{
+    frames += other.frames;
+    referenceEnergy += other.referenceEnergy;
+    candidateEnergy += other.candidateEnergy;
+    differenceEnergy += other.differenceEnergy;
+    crossEnergy += other.crossEnergy;
+    differingSamples += other.differingSamples;
+    if (other.peakDifference > peakDifference) {
+        peakDifference = other.peakDifference;
+        peakFrame = other.peakFrame;
+    }
+}
+
+double SampleMetrics::referenceRms() const
+{
+    return frames > 0 ? std::sqrt(referenceEnergy / static_cast<double>(frames)) : 0.0;
+}
+
+double SampleMetrics::differenceRms() const
+{
+    return frames > 0 ? std::sqrt(differenceEnergy / static_cast<double>(frames)) : 0.0;
+}
+
+double SampleMetrics::nullDepthDb() const
+{
+    if (referenceEnergy <= 0.0)
+        return differenceEnergy > 0.0 ? 0.0 : decibels(0.0);
+    return decibels(differenceEnergy / referenceEnergy);
+}
+
+double SampleMetrics::correlation() const
+{
+    const double denominator = std::sqrt(referenceEnergy * candidateEnergy);
+    if (denominator > 0.0)
+        return crossEnergy / denominator;
+    // Silence against silence (or nothing compared) matches exactly.
+    return differenceEnergy > 0.0 ? 0.0 : 1.0;
+}
+
+} // namespace audiocompare
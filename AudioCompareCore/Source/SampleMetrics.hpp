@@ -0,0 +1,39 @@
+//
+//  SampleMetrics.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audiocompare {
+
+/// Running sample-domain difference statistics for one channel.
+struct SampleMetrics {
+    std::int64_t frames = 0;
+    double referenceEnergy = 0.0;
+    double candidateEnergy = 0.0;
+    double differenceEnergy = 0.0;
+    double crossEnergy = 0.0;
+    double peakDifference = 0.0;
+    std::int64_t peakFrame = -1;
+    std::int64_t differingSamples = 0;
+
+    /// Adds the common length of `reference` and `candidate`, whose first
+    /// sample is frame `startFrame`.
+    void accumulate(ChannelView reference, ChannelView candidate, std::int64_t startFrame);
+    void merge(const SampleMetrics& other);
+
+    double referenceRms() const;
+    double differenceRms() const;
+    /// Residual energy relative to the reference, in dB (the null-test depth).
+    double nullDepthDb() const;
+    /// Pearson-style correlation without mean removal (audio is zero-mean).
+    double correlation() const;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,82 @@
+//
+//  ScratchArena.cpp
+//  AudioCompareCore
+//
+
+#include "ScratchArena.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace audiocompare {
+
+namespace {
+
+/// Allocations are rounded to whole 64-byte lines.
+const std::size_t kLineFloats = 16;
+const std::size_t kMinimumBlockFloats = 1 << 16;
+
+thread_local ScratchArena tArena;
+
+} // namespace
+
+ScratchArena& ScratchArena::local()
+{
+    return tArena;
+}
+
+std::size_t ScratchArena::capacity() const
+{
+    std::size_t total = 0;
+    for (const Block& block : blocks_)
+        total += block.capacity;
+    return total;
+}
+
+float* ScratchArena::allocate(std::size_t count)
+{
+    count = (std::max<std::size_t>(count, 1) + kLineFloats - 1) / kLineFloats * kLineFloats;
+    // Blocks above the current one are empty; skip any too small for this
+    // request rather than splitting it.
+    for (; current_ < blocks_.size(); ++current_) {
+        Block& block = blocks_[current_];
+        if (block.capacity - block.used >= count) {
+            float* data = block.data.get() + block.used;
+            block.used += count;
+            return data;
+        }
+    }
+    Block block;
+    block.capacity = std::max({count, kMinimumBlockFloats, capacity()});
+    block.data.reset(new float[block.capacity]);
+    block.used = count;
+    blocks_.push_back(std::move(block));
+    current_ = blocks_.size() - 1;
+    return blocks_.back().data.get();
+}
+
+ScratchArena::Mark ScratchArena::mark() const
+{
+    if (blocks_.empty())
+        return Mark();
+    return Mark{current_, blocks_[current_].used};
+}
+
+void ScratchArena::release(Mark mark)
+{
+    if (blocks_.empty())
+        return;
+    for (std::size_t b = mark.block + 1; b <= current_ && b < blocks_.size(); ++b)
+        blocks_[b].used = 0;
+    current_ = mark.block;
+    blocks_[current_].used = mark.used;
+}
+
+ScratchBuffer::ScratchBuffer(std::size_t count)
+    : arena_(ScratchArena::local())
+    , mark_(arena_.mark())
+    , data_(arena_.allocate(count))
+{
+}
+
+} // namespace audiocompare
@@ -0,0 +1,73 @@
+//
+//  ScratchArena.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace audiocompare {
+
+/// Per-thread stack of float scratch memory. Transforms borrow their work
+/// buffers here instead of owning them, so a thread running hundreds of
+/// analyses one after another keeps a single set of buffers warm rather
+/// than one set per analyzer. Memory grows to the deepest use seen on the
+/// thread and is reused from then on; it is released when the thread ends.
+class ScratchArena {
+public:
+    /// The calling thread's arena.
+    static ScratchArena& local();
+
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    /// Floats held across all blocks.
+    std::size_t capacity() const;
+
+private:
+    friend class ScratchBuffer;
+
+    struct Block {
+        std::unique_ptr<float[]> data;
+        std::size_t capacity = 0;
+        std::size_t used = 0;
+    };
+    struct Mark {
+        std::size_t block = 0;
+        std::size_t used = 0;
+    };
+
+    float* allocate(std::size_t count);
+    Mark mark() const;
+    void release(Mark mark);
+
+    std::vector<Block> blocks_;
+    std::size_t current_ = 0;
+};
+
+/// `count` floats borrowed from the calling thread's arena until the buffer
+/// goes out of scope. Buffers must be released in reverse order of
+/// creation, which scoping guarantees, and must not be handed to another
+/// thread. The contents start out unspecified.
+class ScratchBuffer {
+public:
+    explicit ScratchBuffer(std::size_t count);
+    ~ScratchBuffer() { arena_.release(mark_); }
+
+    ScratchBuffer(const ScratchBuffer&) = delete;
+    ScratchBuffer& operator=(const ScratchBuffer&) = delete;
+
+    float* data() const { return data_; }
+    float& operator[](std::size_t i) const { return data_[i]; }
+
+private:
+    ScratchArena& arena_;
+    ScratchArena::Mark mark_;
+    float* data_;
+};
+
+} // namespace audiocompare
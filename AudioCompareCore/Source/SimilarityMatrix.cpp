@@ -0,0 +1,152 @@
+//
+//  SimilarityMatrix.cpp
+//  AudioCompareCore
+//
+
+#include "SimilarityMatrix.hpp"
+
+#include "VectorKernels.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const char kMagic[4] = {'A', 'C', 'S', 'M'};
+const std::uint32_t kVersion = 1;
+const std::size_t kHeaderBytes = 16;
+// Both operand tiles of a task fit in a 32 KiB L1 data cache.
+const std::size_t kTileBytes = 16384;
+
+bool hostIsLittleEndian()
+{
+    const std::uint16_t probe = 1;
+    unsigned char first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+void writeLE32(unsigned char* p, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void writeLE64(unsigned char* p, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+std::uint32_t readLE32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t readLE64(const unsigned char* p)
+{
+    return static_cast<std::uint64_t>(readLE32(p)) | (static_cast<std::uint64_t>(readLE32(p + 4)) << 32);
+}
+
+/// Offset of element (i, j), i <= j, in the packed upper triangle.
+std::size_t triangleIndex(std::size_t count, std::size_t i, std::size_t j)
+{
+    return i * count - i * (i - 1) / 2 + (j - i);
+}
+
+std::size_t triangleSize(std::size_t count)
+{
+    return count * (count + 1) / 2;
+}
+
+} // namespace
+
+SimilarityMatrix SimilarityMatrix::compute(const float* features, std::size_t count, std::size_t dimension,
+                                           const std::string& path, ThreadPool& pool, std::size_t tileRows)
+{
+    if (!hostIsLittleEndian())
+        throw std::runtime_error("similarity matrices need a little-endian host");
+    if (dimension == 0)
+        throw std::invalid_argument("similarity features need at least one dimension");
+    if (tileRows == 0)
+        tileRows = std::max<std::size_t>(8, kTileBytes / (dimension * sizeof(float)));
+
+    {
+        MappedOutputFile file(path, kHeaderBytes + triangleSize(count) * sizeof(float));
+        unsigned char* header = file.data();
+        std::memcpy(header, kMagic, 4);
+        writeLE32(header + 4, kVersion);
+        writeLE64(header + 8, count);
+        float* values = reinterpret_cast<float*>(file.data() + kHeaderBytes);
+
+        // Tiles cover disjoint cells of the triangle, so the tasks need no
+        // locking.
+        for (std::size_t rowStart = 0; rowStart < count; rowStart += tileRows) {
+            for (std::size_t columnStart = rowStart; columnStart < count; columnStart += tileRows) {
+                pool.submit([=] {
+                    const std::size_t rowEnd = std::min(rowStart + tileRows, count);
+                    const std::size_t columnEnd = std::min(columnStart + tileRows, count);
+                    for (std::size_t i = rowStart; i < rowEnd; ++i) {
+                        const float* row = features + i * dimension;
+                        float* output = values + triangleIndex(count, i, i);
+                        for (std::size_t j = std::max(i, columnStart); j < columnEnd; ++j)
+                            output[j - i] = dotProduct(row, features + j * dimension, dimension);
+                    }
+                });
+            }
+        }
+        pool.wait();
+        file.close();
+    }
+    return open(path);
+}
+
+SimilarityMatrix SimilarityMatrix::open(const std::string& path)
+{
+    if (!hostIsLittleEndian())
+        throw std::runtime_error("similarity matrices need a little-endian host");
+    auto file = std::make_shared<const MappedFile>(path);
+    const unsigned char* data = file->data();
+    if (file->size() < kHeaderBytes || std::memcmp(data, kMagic, 4) != 0)
+        throw std::runtime_error(path + ": not a similarity matrix");
+    if (readLE32(data + 4) != kVersion)
+        throw std::runtime_error(path + ": unsupported similarity matrix version");
+
+    SimilarityMatrix matrix;
+    matrix.count_ = static_cast<std::size_t>(readLE64(data + 8));
+    if (triangleSize(matrix.count_) > (file->size() - kHeaderBytes) / sizeof(float))
+        throw std::runtime_error(path + ": truncated similarity matrix");
+    matrix.values_ = reinterpret_cast<const float*>(data + kHeaderBytes);
+    matrix.file_ = std::move(file);
+    return matrix;
+}
+
+float SimilarityMatrix::similarity(std::size_t i, std::size_t j) const
+{
+    if (i > j)
+        std::swap(i, j);
+    if (j >= count_)
+        throw std::out_of_range("similarity matrix index out of range");
+    return values_[triangleIndex(count_, i, j)];
+}
+
+std::vector<SimilarPair> SimilarityMatrix::pairsAbove(float threshold) const
+{
+    std::vector<SimilarPair> pairs;
+    for (std::size_t i = 0; i < count_; ++i) {
+        const float* row = values_ + triangleIndex(count_, i, i);
+        for (std::size_t j = i + 1; j < count_; ++j)
+            if (row[j - i] >= threshold)
+                pairs.push_back({i, j, row[j - i]});
+    }
+    std::sort(pairs.begin(), pairs.end(),
+              [](const SimilarPair& a, const SimilarPair& b) { return a.similarity > b.similarity; });
+    return pairs;
+}
+
+} // namespace audiocompare
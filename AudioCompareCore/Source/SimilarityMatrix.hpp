@@ -0,0 +1,62 @@
+//
+//  SimilarityMatrix.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+struct SimilarPair {
+    std::size_t first = 0;
+    std::size_t second = 0;
+    float similarity = 0.0f;
+};
+
+/// All-pairs similarity of a catalogue, stored as the upper triangle
+/// (diagonal included) of an N x N float matrix in row-major order. Opened
+/// files are memory-mapped, so a matrix of tens of thousands of files is
+/// queried without reading it.
+class SimilarityMatrix {
+public:
+    SimilarityMatrix() = default;
+    SimilarityMatrix(SimilarityMatrix&&) = default;
+    SimilarityMatrix& operator=(SimilarityMatrix&&) = default;
+    SimilarityMatrix(const SimilarityMatrix&) = delete;
+    SimilarityMatrix& operator=(const SimilarityMatrix&) = delete;
+
+    /// Dot products of the `count` rows of `features` (`dimension` floats
+    /// each, unit length for cosine similarity) written straight into a
+    /// mapped file at `path`. The triangle is cut into square tiles of
+    /// `tileRows` rows, sized by default so both operand tiles stay in L1;
+    /// every tile is one task on `pool`. Throws std::runtime_error on I/O
+    /// errors.
+    static SimilarityMatrix compute(const float* features, std::size_t count, std::size_t dimension,
+                                    const std::string& path, ThreadPool& pool, std::size_t tileRows = 0);
+
+    /// Throws std::runtime_error when the file is missing or malformed.
+    static SimilarityMatrix open(const std::string& path);
+
+    std::size_t count() const { return count_; }
+    /// Either order of `i` and `j`.
+    float similarity(std::size_t i, std::size_t j) const;
+
+    /// Pairs `i < j` with a similarity of at least `threshold`, most similar
+    /// first.
+    std::vector<SimilarPair> pairsAbove(float threshold) const;
+
+private:
+    std::size_t count_ = 0;
+    const float* values_ = nullptr;
+    std::shared_ptr<const MappedFile> file_;
+};
+
+} // namespace audiocompare
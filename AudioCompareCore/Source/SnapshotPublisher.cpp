@@ -0,0 +1,47 @@
+//
+//  SnapshotPublisher.cpp
+//  AudioCompareCore
+//
+
+#include "SnapshotPublisher.hpp"
+
+#include <cstring>
+
+namespace audiocompare {
+
+namespace {
+
+// Buffers start on separate cache lines, so the writer filling one does not
+// disturb the reader scanning another.
+const std::size_t kLineFloats = 16;
+
+} // namespace
+
+SnapshotPublisher::SnapshotPublisher(std::size_t size)
+    : size_(size)
+    , stride_((size + kLineFloats - 1) / kLineFloats * kLineFloats)
+    , storage_(3 * stride_, 0.0f)
+{
+}
+
+void SnapshotPublisher::publish()
+{
+    sequences_[back_] = ++published_;
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) & ~kFresh;
+}
+
+void SnapshotPublisher::publish(const float* values)
+{
+    if (size_ > 0)
+        std::memcpy(writeBuffer(), values, size_ * sizeof(float));
+    publish();
+}
+
+SnapshotPublisher::Snapshot SnapshotPublisher::acquire()
+{
+    if (middle_.load(std::memory_order_relaxed) & kFresh)
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & ~kFresh;
+    return {ChannelView(slot(front_), size_), sequences_[front_]};
+}
+
+} // namespace audiocompare
@@ -0,0 +1,79 @@
+//
+//  SnapshotPublisher.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioBufferView.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+/// Hands fixed-size float snapshots, such as the latest spectrum, from one
+/// writer thread to one reader thread by triple buffering. `AKFFTTap`
+/// rebuilds an `NSArray` of boxed numbers for every result; here the writer
+/// fills a buffer it owns and publishes it with a single atomic index swap,
+/// and the reader swaps the newest buffer in the same way. Neither side
+/// locks, waits or allocates, and the reader never copies: it gets a view of
+/// the buffer it holds. Snapshots the reader is too slow to see are skipped.
+///
+/// Each side must stay on one thread; give every reader its own publisher.
+class SnapshotPublisher {
+public:
+    struct Snapshot {
+        ChannelView values;
+        /// 1 for the first snapshot published and one more for each after;
+        /// 0 (with zeroed values) until the first. A gap means the reader
+        /// missed snapshots, and an unchanged number means nothing new.
+        std::uint64_t sequence = 0;
+    };
+
+    explicit SnapshotPublisher(std::size_t size);
+
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    std::size_t size() const { return size_; }
+
+    /// Writer: the `size()` floats the next snapshot is written into. The
+    /// reader cannot see them until `publish`.
+    float* writeBuffer() { return slot(back_); }
+    /// Writer: publishes `writeBuffer()` and takes a new one, whose contents
+    /// are stale.
+    void publish();
+    /// Writer: copies `size()` values into `writeBuffer()` and publishes.
+    void publish(const float* values);
+
+    /// Reader: the newest snapshot. Its values stay valid and unchanged until
+    /// the reader's next `acquire`.
+    Snapshot acquire();
+
+private:
+    // The shared index carries this bit while it names a buffer the reader
+    // has not taken yet.
+    static constexpr unsigned kFresh = 4;
+
+    float* slot(unsigned index) { return storage_.data() + index * stride_; }
+
+    std::size_t size_;
+    std::size_t stride_;
+    std::vector<float> storage_;
+    // Written by the writer before the buffer is published and read by the
+    // reader after taking it, so the index swap orders them.
+    std::uint64_t sequences_[3] = {};
+
+    // Writer side.
+    unsigned back_ = 0;
+    std::uint64_t published_ = 0;
+    // The buffer between the two sides, on its own cache line.
+    alignas(64) std::atomic<unsigned> middle_{1};
+    // Reader side.
+    alignas(64) unsigned front_ = 2;
+};
+
+} // namespace audiocompare
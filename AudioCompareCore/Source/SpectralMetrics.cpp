@@ -0,0 +1,136 @@
+//
+//  SpectralMetrics.cpp
+//  AudioCompareCore
+//
+
+#include "SpectralMetrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace audiocompare {
+
+double SpectralMetrics::meanLogSpectralDistance() const
+{
+    return frames > 0 ? sumLogSpectralDistance / static_cast<double>(frames) : 0.0;
+}
+
+double SpectralMetrics::meanBinDifferenceDb(std::size_t bin) const
+{
+    return frames > 0 ? binDifferenceDbSum[bin] / static_cast<double>(frames) : 0.0;
+}
+
+double SpectralMetrics::spectralErrorDb() const
+{
+    if (referencePower <= 0.0)
+        return differencePower > 0.0 ? 0.0 : decibels(0.0);
+    return decibels(differencePower / referencePower);
+}
+
+SpectralComparator::SpectralComparator(std::size_t channelCount, std::size_t fftSize,
+                                       const RollingFftOptions& options)
+    : fftSize_(fftSize)
+    , hopSize_(options.hopSize > 0 ? options.hopSize : fftSize / 2)
+    , binCount_((options.fftSize > 0 ? options.fftSize : fftSize) / 2 + 1)
+    , referencePending_(channelCount, hopSize_)
+    , candidatePending_(channelCount, hopSize_)
+{
+    if (hopSize_ == 0)
+        throw std::invalid_argument("spectral hop must be positive");
+    for (std::size_t c = 0; c < channelCount; ++c) {
+        referenceFfts_.emplace_back(fftSize, options);
+        candidateFfts_.emplace_back(fftSize, options);
+    }
+    referenceMagnitudes_.resize(binCount_);
+    metrics_.binDifferenceDbSum.assign(binCount_, 0.0);
+
+    // Floor the spectra 120 dB below a full-scale sine (fftSize / 4 through
+    // a Hann window) so silence compares as equal.
+    magnitudeFloor_ = static_cast<float>(fullScaleMagnitude(*sharedWindow(fftSize, options.window)) * 1e-6);
+}
+
+void SpectralComparator::process(const AudioBufferView& reference, const AudioBufferView& candidate)
+{
+    const std::size_t frames = std::min(reference.frames(), candidate.frames());
+    std::size_t offset = 0;
+    while (offset < frames) {
+        const std::size_t count = std::min(hopSize_ - pendingFrames_, frames - offset);
+        for (std::size_t c = 0; c < referenceFfts_.size(); ++c) {
+            std::memcpy(referencePending_.channel(c) + pendingFrames_,
+                        reference.channel(c).data() + offset, count * sizeof(float));
+            std::memcpy(candidatePending_.channel(c) + pendingFrames_,
+                        candidate.channel(c).data() + offset, count * sizeof(float));
+        }
+        pendingFrames_ += count;
+        offset += count;
+        if (pendingFrames_ == hopSize_) {
+            analyzeHop();
+            pendingFrames_ = 0;
+        }
+    }
+}
+
+void SpectralComparator::restart(std::int64_t streamPosition, std::size_t primingFrames)
+{
+    for (RollingFft& fft : referenceFfts_)
+        fft.reset();
+    for (RollingFft& fft : candidateFfts_)
+        fft.reset();
+    pendingFrames_ = 0;
+    streamPosition_ = streamPosition;
+    primingHops_ = primingFrames / hopSize_;
+}
+
+void SpectralComparator::analyzeHop()
+{
+    const std::size_t bins = binCount_;
+    const std::size_t channels = referenceFfts_.size();
+    if (primingHops_ > 0) {
+        for (std::size_t c = 0; c < channels; ++c) {
+            referenceFfts_[c].appendSamples(referencePending_.channel(c), hopSize_);
+            candidateFfts_[c].appendSamples(candidatePending_.channel(c), hopSize_);
+        }
+        streamPosition_ += static_cast<std::int64_t>(hopSize_);
+        --primingHops_;
+        return;
+    }
+    double frameDistance = 0.0;
+
+    for (std::size_t c = 0; c < channels; ++c) {
+        const float* ref = referenceFfts_[c].computeFFT(referencePending_.channel(c), hopSize_);
+        std::copy(ref, ref + bins, referenceMagnitudes_.begin());
+        const float* cand = candidateFfts_[c].computeFFT(candidatePending_.channel(c), hopSize_);
+
+        double squaredLevelDifference = 0.0;
+        for (std::size_t k = 0; k < bins; ++k) {
+            const double r = referenceMagnitudes_[k];
+            const double m = cand[k];
+            const double levelDifference = 20.0 * std::log10(std::max(r, double(magnitudeFloor_)) /
+                                                              std::max(m, double(magnitudeFloor_)));
+            squaredLevelDifference += levelDifference * levelDifference;
+            metrics_.binDifferenceDbSum[k] += std::fabs(levelDifference) / static_cast<double>(channels);
+            metrics_.referencePower += r * r;
+            metrics_.differencePower += (r - m) * (r - m);
+        }
+        frameDistance += std::sqrt(squaredLevelDifference / static_cast<double>(bins));
+    }
+    frameDistance /= static_cast<double>(channels);
+
+    // The window ends at the current stream position; report its start.
+    const std::int64_t frameStart = streamPosition_ + static_cast<std::int64_t>(hopSize_)
+                                    - static_cast<std::int64_t>(fftSize_);
+    streamPosition_ += static_cast<std::int64_t>(hopSize_);
+
+    if (observer_)
+        observer_->processSpectralFrame(frameStart, fftSize_, frameDistance);
+    ++metrics_.frames;
+    metrics_.sumLogSpectralDistance += frameDistance;
+    if (frameDistance > metrics_.maxLogSpectralDistance) {
+        metrics_.maxLogSpectralDistance = frameDistance;
+        metrics_.maxDistanceFrame = std::max<std::int64_t>(frameStart, 0);
+    }
+}
+
+} // namespace audiocompare
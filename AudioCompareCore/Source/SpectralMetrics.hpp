@@ -0,0 +1,81 @@
+//
+//  SpectralMetrics.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioUtilities.hpp"
+#include "ComparisonObserver.hpp"
+#include "RollingFft.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+struct SpectralMetrics {
+    std::int64_t frames = 0;
+    double sumLogSpectralDistance = 0.0;
+    double maxLogSpectralDistance = 0.0;
+    /// Start of the most distant frame; -1 when no frame differed.
+    std::int64_t maxDistanceFrame = -1;
+    double referencePower = 0.0;
+    double differencePower = 0.0;
+    /// Absolute level difference per bin in dB, summed over frames.
+    std::vector<double> binDifferenceDbSum;
+
+    double meanLogSpectralDistance() const;
+    double meanBinDifferenceDb(std::size_t bin) const;
+    /// Magnitude-spectrum error energy relative to the reference, in dB.
+    double spectralErrorDb() const;
+};
+
+/// Feeds reference and candidate blocks through one pair of `RollingFft`s
+/// per channel and accumulates `SpectralMetrics`. The hop defaults to 50%
+/// overlap; `options` can also pick the window and zero-pad it, in which case
+/// `binDifferenceDbSum` has one entry per bin of the padded transform.
+/// Memory is bounded by the FFT size regardless of the stream length.
+class SpectralComparator {
+public:
+    SpectralComparator(std::size_t channelCount, std::size_t fftSize, const RollingFftOptions& options = {});
+
+    /// Feeds the common length of `reference` and `candidate`.
+    void process(const AudioBufferView& reference, const AudioBufferView& candidate);
+
+    /// Drops the window history and continues at `streamPosition`, e.g. after
+    /// a seek. Hops completed within the next `primingFrames` frames only
+    /// refill the windows and are not counted.
+    void restart(std::int64_t streamPosition, std::size_t primingFrames);
+
+    /// Optional; receives the distance of every counted frame.
+    void setObserver(ComparisonObserver* observer) { observer_ = observer; }
+
+    const SpectralMetrics& metrics() const { return metrics_; }
+
+    /// Analysis window length in frames.
+    std::size_t fftSize() const { return fftSize_; }
+    std::size_t hopSize() const { return hopSize_; }
+    std::size_t binCount() const { return binCount_; }
+
+private:
+    void analyzeHop();
+
+    std::size_t fftSize_;
+    std::size_t hopSize_;
+    std::size_t binCount_;
+    std::vector<RollingFft> referenceFfts_;
+    std::vector<RollingFft> candidateFfts_;
+    FloatBuffers referencePending_;
+    FloatBuffers candidatePending_;
+    std::size_t pendingFrames_ = 0;
+    std::int64_t streamPosition_ = 0;
+    std::size_t primingHops_ = 0;
+    std::vector<float> referenceMagnitudes_;
+    float magnitudeFloor_;
+    SpectralMetrics metrics_;
+    ComparisonObserver* observer_ = nullptr;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,156 @@
+//
+//  StreamingComparator.cpp
+//  AudioCompareCore
+//
+
+#include "StreamingComparator.hpp"
+
+#include "AudioUtilities.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+std::int64_t remainingFrames(const AudioReader& reader)
+{
+    const std::int64_t total = reader.frameCount();
+    return total < 0 ? -1 : total - reader.framePosition();
+}
+
+} // namespace
+
+bool ComparisonResult::identical() const
+{
+    return referenceFrames == candidateFrames && overall.differingSamples == 0;
+}
+
+StreamingComparator::StreamingComparator(ComparisonOptions options)
+    : options_(options)
+{
+    if (options_.blockSize == 0)
+        throw std::invalid_argument("block size must be positive");
+    if (options_.zeroPadding == 0 || (options_.zeroPadding & (options_.zeroPadding - 1)) != 0)
+        throw std::invalid_argument("zero padding must be a power of two");
+}
+
+ComparisonResult StreamingComparator::compare(AudioReader& reference, AudioReader& candidate)
+{
+    return compareRanges(reference, candidate,
+                         {FrameRange{0, std::numeric_limits<std::int64_t>::max()}});
+}
+
+ComparisonResult StreamingComparator::compareRanges(AudioReader& reference, AudioReader& candidate,
+                                                    const std::vector<FrameRange>& ranges)
+{
+    const AudioFormat format = reference.format();
+    const AudioFormat candidateFormat = candidate.format();
+    if (format.channelCount != candidateFormat.channelCount)
+        throw std::invalid_argument("channel counts differ");
+    if (format.sampleRate != candidateFormat.sampleRate)
+        throw std::invalid_argument("sample rates differ");
+
+    const std::size_t channels = format.channelCount;
+    ComparisonResult result;
+    result.format = format;
+    result.channels.resize(channels);
+    result.candidateOffset = options_.candidateOffset;
+
+    if (options_.candidateOffset > 0)
+        candidate.seekToFrame(candidate.framePosition() + options_.candidateOffset);
+    else if (options_.candidateOffset < 0)
+        reference.seekToFrame(reference.framePosition() - options_.candidateOffset);
+    const std::int64_t referenceBase = reference.framePosition();
+    const std::int64_t candidateBase = candidate.framePosition();
+    result.referenceStart = referenceBase;
+
+    std::unique_ptr<SpectralComparator> spectral;
+    if (options_.spectral) {
+        RollingFftOptions fftOptions;
+        fftOptions.hopSize = options_.hopSize;
+        fftOptions.window = options_.window;
+        fftOptions.fftSize = options_.fftSize * options_.zeroPadding;
+        spectral = std::make_unique<SpectralComparator>(channels, options_.fftSize, fftOptions);
+        spectral->setObserver(observer_);
+    }
+
+    FloatBuffers referenceBlock(channels, options_.blockSize);
+    FloatBuffers candidateBlock(channels, options_.blockSize);
+    std::int64_t position = 0;
+    std::size_t referenceRead = 0;
+    std::size_t candidateRead = 0;
+    bool ended = false;
+
+    for (const FrameRange& range : ranges) {
+        if (ended)
+            break;
+        if (range.start < position || range.end <= range.start)
+            throw std::invalid_argument("frame ranges must be sorted and non-empty");
+
+        std::int64_t primingFrames = 0;
+        if (spectral) {
+            const std::size_t lead = spectral->fftSize() > spectral->hopSize()
+                                         ? spectral->fftSize() - spectral->hopSize() : 0;
+            primingFrames = std::min<std::int64_t>(range.start, static_cast<std::int64_t>(lead));
+            spectral->restart(range.start - primingFrames, static_cast<std::size_t>(primingFrames));
+        }
+        position = range.start - primingFrames;
+        if (position != 0 || &range != &ranges.front()) {
+            reference.seekToFrame(referenceBase + position);
+            candidate.seekToFrame(candidateBase + position);
+        }
+
+        while (position < range.end) {
+            const std::size_t request = static_cast<std::size_t>(
+                std::min<std::int64_t>(static_cast<std::int64_t>(options_.blockSize), range.end - position));
+            referenceRead = reference.readFrames(referenceBlock.data(), request);
+            candidateRead = candidate.readFrames(candidateBlock.data(), request);
+            const std::size_t frames = std::min(referenceRead, candidateRead);
+            if (frames == 0) {
+                ended = true;
+                break;
+            }
+
+            // Priming frames only refill the spectral windows.
+            const std::size_t skip = static_cast<std::size_t>(
+                std::clamp<std::int64_t>(range.start - position, 0, static_cast<std::int64_t>(frames)));
+            const AudioBufferView referenceView = referenceBlock.view(skip, frames - skip);
+            const AudioBufferView candidateView = candidateBlock.view(skip, frames - skip);
+            for (std::size_t c = 0; c < channels; ++c)
+                result.channels[c].accumulate(referenceView.channel(c), candidateView.channel(c),
+                                              position + static_cast<std::int64_t>(skip));
+            if (observer_ && frames > skip)
+                observer_->processBlock(referenceView, candidateView, position + static_cast<std::int64_t>(skip));
+            if (spectral)
+                spectral->process(referenceBlock.view(0, frames), candidateBlock.view(0, frames));
+            position += static_cast<std::int64_t>(frames);
+            result.comparedFrames += static_cast<std::int64_t>(frames - skip);
+
+            if (referenceRead != candidateRead) {
+                ended = true;
+                break;
+            }
+        }
+    }
+
+    const std::int64_t referenceTail = remainingFrames(reference);
+    const std::int64_t candidateTail = remainingFrames(candidate);
+    result.referenceFrames = position + static_cast<std::int64_t>(referenceRead)
+                             - std::min<std::int64_t>(referenceRead, candidateRead)
+                             + std::max<std::int64_t>(referenceTail, 0);
+    result.candidateFrames = position + static_cast<std::int64_t>(candidateRead)
+                             - std::min<std::int64_t>(referenceRead, candidateRead)
+                             + std::max<std::int64_t>(candidateTail, 0);
+
+    for (const SampleMetrics& metrics : result.channels)
+        result.overall.merge(metrics);
+    if (spectral)
+        result.spectral = spectral->metrics();
+    return result;
+}
+
+} // namespace audiocompare
@@ -0,0 +1,90 @@
+//
+//  StreamingComparator.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "ComparisonObserver.hpp"
+#include "FftWindow.hpp"
+#include "SampleMetrics.hpp"
+#include "SpectralMetrics.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audiocompare {
+
+struct ComparisonOptions {
+    /// Frames pulled from each reader per iteration.
+    std::size_t blockSize = 4096;
+    /// Analysis window for the spectral metrics (power of two).
+    std::size_t fftSize = 2048;
+    /// Frames between spectral windows; 0 for 50% overlap. Larger hops cost
+    /// less and resolve differences in time less finely.
+    std::size_t hopSize = 0;
+    FftWindow window;
+    /// Spectral transform length as a multiple of `fftSize`, a power of
+    /// two. Above 1, each window is zero-padded for finer bin spacing.
+    std::size_t zeroPadding = 1;
+    bool spectral = true;
+    /// Candidate frame matching the first reference frame, e.g. from
+    /// `OffsetFinder`. Negative values skip reference frames instead.
+    std::int64_t candidateOffset = 0;
+};
+
+/// Half-open frame range [start, end) counted from the comparison start.
+struct FrameRange {
+    std::int64_t start = 0;
+    std::int64_t end = 0;
+};
+
+struct ComparisonResult {
+    AudioFormat format;
+    std::int64_t referenceFrames = 0;
+    std::int64_t candidateFrames = 0;
+    std::int64_t comparedFrames = 0;
+    std::int64_t candidateOffset = 0;
+    /// Reference frame the comparison started at. Observers see positions
+    /// relative to it.
+    std::int64_t referenceStart = 0;
+    /// Frames skipped because their block hashes matched bit for bit.
+    std::int64_t hashMatchedFrames = 0;
+    std::vector<SampleMetrics> channels;
+    SampleMetrics overall;
+    SpectralMetrics spectral;
+
+    bool identical() const;
+};
+
+/// Single-pass comparison of two readers. Both streams are pulled in
+/// `blockSize` chunks and every metric is updated incrementally, so memory
+/// use is independent of the file length.
+class StreamingComparator {
+public:
+    explicit StreamingComparator(ComparisonOptions options = {});
+
+    const ComparisonOptions& options() const { return options_; }
+
+    /// Optional; not owned and must outlive `compare`.
+    void setObserver(ComparisonObserver* observer) { observer_ = observer; }
+
+    /// Compares from the readers' current positions, shifted by
+    /// `candidateOffset`, to the end of the shorter stream. Throws std::invalid_argument when the formats differ.
+    ComparisonResult compare(AudioReader& reference, AudioReader& candidate);
+
+    /// Like `compare`, but only analyzes `ranges` (sorted, non-overlapping),
+    /// seeking both readers between them. Spectral windows are refilled from
+    /// up to fftSize / 2 frames before each range. `comparedFrames` counts the
+    /// analyzed frames only; the stream lengths are still reported in full.
+    ComparisonResult compareRanges(AudioReader& reference, AudioReader& candidate,
+                                   const std::vector<FrameRange>& ranges);
+
+private:
+    ComparisonOptions options_;
+    ComparisonObserver* observer_ = nullptr;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,126 @@
+//
+//  ThreadPool.cpp
+//  AudioCompareCore
+//
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace audiocompare {
+
+namespace {
+
+// Lets `submit` find the calling worker's own deque.
+thread_local const ThreadPool* tCurrentPool = nullptr;
+thread_local std::size_t tWorkerIndex = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < threadCount; ++i)
+        workers_.push_back(std::make_unique<Worker>());
+    for (std::size_t i = 0; i < threadCount; ++i)
+        threads_.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    try {
+        wait();
+    } catch (...) {
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_)
+        thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    const std::size_t target = tCurrentPool == this
+                                   ? tWorkerIndex
+                                   : nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    unfinished_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+        workers_[target]->tasks.push_back(std::move(task));
+        queued_.fetch_add(1);
+    }
+    {
+        // Pairs with the predicate check in `run` so the wake-up is not lost.
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    wake_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return unfinished_.load() == 0; });
+    if (error_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+bool ThreadPool::takeTask(std::size_t self, std::function<void()>& task)
+{
+    {
+        Worker& own = *workers_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    for (std::size_t k = 1; k < workers_.size(); ++k) {
+        Worker& victim = *workers_[(self + k) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(std::size_t self)
+{
+    tCurrentPool = this;
+    tWorkerIndex = self;
+    for (;;) {
+        std::function<void()> task;
+        if (takeTask(self, task)) {
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_)
+                    error_ = std::current_exception();
+            }
+            task = nullptr;
+            if (unfinished_.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                idle_.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_ && queued_.load() == 0)
+            return;
+    }
+}
+
+} // namespace audiocompare
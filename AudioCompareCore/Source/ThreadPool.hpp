@@ -0,0 +1,67 @@
+//
+//  ThreadPool.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace audiocompare {
+
+/// Work-stealing pool. Each worker owns a deque: tasks submitted from a
+/// worker go to the back of its own deque and are taken back LIFO, so a
+/// follow-up stage runs while its data is still hot; idle workers steal the
+/// oldest task from the front of another worker's deque. Tasks submitted
+/// from outside are spread round-robin.
+class ThreadPool {
+public:
+    /// `threadCount` 0 uses one worker per hardware thread.
+    explicit ThreadPool(std::size_t threadCount = 0);
+    /// Finishes the queued tasks, then joins the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    /// Blocks until every submitted task, including tasks they submitted,
+    /// has run. Rethrows the first exception a task threw.
+    void wait();
+
+    std::size_t threadCount() const { return threads_.size(); }
+    std::size_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(std::size_t self);
+    bool takeTask(std::size_t self, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<std::size_t> unfinished_{0};
+    std::atomic<std::size_t> nextWorker_{0};
+    std::atomic<std::size_t> steals_{0};
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
+
+} // namespace audiocompare
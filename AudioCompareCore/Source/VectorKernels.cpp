@@ -0,0 +1,179 @@
+//
+//  VectorKernels.cpp
+//  AudioCompareCore
+//
+
+#include "VectorKernels.hpp"
+
+#if AUDIOCOMPARE_AVX2 || AUDIOCOMPARE_SSE2
+#include <immintrin.h>
+#endif
+#if AUDIOCOMPARE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace audiocompare {
+
+const char* vectorKernelIsa()
+{
+#if AUDIOCOMPARE_AVX2
+    return "avx2";
+#elif AUDIOCOMPARE_SSE2
+    return "sse2";
+#elif AUDIOCOMPARE_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+float dotProduct(const float* a, const float* b, std::size_t count)
+{
+    std::size_t i = 0;
+    float sum = 0.0f;
+#if AUDIOCOMPARE_AVX2
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#elif AUDIOCOMPARE_SSE2
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#elif AUDIOCOMPARE_NEON
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= count; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+    for (; i < count; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+void subtractScaled(const float* a, const float* b, float gain, float* output, std::size_t count)
+{
+    std::size_t i = 0;
+#if AUDIOCOMPARE_AVX2
+    const __m256 g = _mm256_set1_ps(gain);
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(output + i, _mm256_fnmadd_ps(g, _mm256_loadu_ps(b + i), _mm256_loadu_ps(a + i)));
+#elif AUDIOCOMPARE_SSE2
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(output + i, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_mul_ps(g, _mm_loadu_ps(b + i))));
+#elif AUDIOCOMPARE_NEON
+    const float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(output + i, vmlsq_f32(vld1q_f32(a + i), g, vld1q_f32(b + i)));
+#endif
+    for (; i < count; ++i)
+        output[i] = a[i] - gain * b[i];
+}
+
+void multiplyAccumulate(const float* a, const float* b, float* accumulator, std::size_t count)
+{
+    std::size_t i = 0;
+#if AUDIOCOMPARE_AVX2
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(accumulator + i, _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i),
+                                                          _mm256_loadu_ps(accumulator + i)));
+#elif AUDIOCOMPARE_SSE2
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(accumulator + i, _mm_add_ps(_mm_loadu_ps(accumulator + i),
+                                                  _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i))));
+#elif AUDIOCOMPARE_NEON
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(accumulator + i, vmlaq_f32(vld1q_f32(accumulator + i), vld1q_f32(a + i), vld1q_f32(b + i)));
+#endif
+    for (; i < count; ++i)
+        accumulator[i] += a[i] * b[i];
+}
+
+void minPlusStep(const float* cost, const float* diagonal, const float* up, const float* left,
+                 float* output, unsigned char* moves, std::size_t count)
+{
+    std::size_t i = 0;
+#if AUDIOCOMPARE_AVX2
+    for (; i + 8 <= count; i += 8) {
+        const __m256 d = _mm256_loadu_ps(diagonal + i);
+        const __m256 u = _mm256_loadu_ps(up + i);
+        const __m256 l = _mm256_loadu_ps(left + i);
+        const __m256 upLess = _mm256_cmp_ps(u, d, _CMP_LT_OQ);
+        const __m256 best = _mm256_blendv_ps(d, u, upLess);
+        const __m256 leftLess = _mm256_cmp_ps(l, best, _CMP_LT_OQ);
+        _mm256_storeu_ps(output + i, _mm256_add_ps(_mm256_loadu_ps(cost + i), _mm256_blendv_ps(best, l, leftLess)));
+        const int upBits = _mm256_movemask_ps(upLess);
+        const int leftBits = _mm256_movemask_ps(leftLess);
+        for (int k = 0; k < 8; ++k)
+            moves[i + k] = static_cast<unsigned char>((leftBits >> k) & 1 ? 2 : (upBits >> k) & 1);
+    }
+#elif AUDIOCOMPARE_SSE2
+    for (; i + 4 <= count; i += 4) {
+        const __m128 d = _mm_loadu_ps(diagonal + i);
+        const __m128 u = _mm_loadu_ps(up + i);
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 upLess = _mm_cmplt_ps(u, d);
+        const __m128 best = _mm_or_ps(_mm_and_ps(upLess, u), _mm_andnot_ps(upLess, d));
+        const __m128 leftLess = _mm_cmplt_ps(l, best);
+        const __m128 minimum = _mm_or_ps(_mm_and_ps(leftLess, l), _mm_andnot_ps(leftLess, best));
+        _mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(cost + i), minimum));
+        const int upBits = _mm_movemask_ps(upLess);
+        const int leftBits = _mm_movemask_ps(leftLess);
+        for (int k = 0; k < 4; ++k)
+            moves[i + k] = static_cast<unsigned char>((leftBits >> k) & 1 ? 2 : (upBits >> k) & 1);
+    }
+#elif AUDIOCOMPARE_NEON
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t d = vld1q_f32(diagonal + i);
+        const float32x4_t u = vld1q_f32(up + i);
+        const float32x4_t l = vld1q_f32(left + i);
+        const uint32x4_t upLess = vcltq_f32(u, d);
+        const float32x4_t best = vbslq_f32(upLess, u, d);
+        const uint32x4_t leftLess = vcltq_f32(l, best);
+        vst1q_f32(output + i, vaddq_f32(vld1q_f32(cost + i), vbslq_f32(leftLess, l, best)));
+        // Lane masks to move codes: 2 where left won, else 1 where up won.
+        const uint32x4_t codes = vbslq_u32(leftLess, vdupq_n_u32(2), vandq_u32(upLess, vdupq_n_u32(1)));
+        const uint16x4_t narrow = vmovn_u32(codes);
+        moves[i] = static_cast<unsigned char>(vget_lane_u16(narrow, 0));
+        moves[i + 1] = static_cast<unsigned char>(vget_lane_u16(narrow, 1));
+        moves[i + 2] = static_cast<unsigned char>(vget_lane_u16(narrow, 2));
+        moves[i + 3] = static_cast<unsigned char>(vget_lane_u16(narrow, 3));
+    }
+#endif
+    for (; i < count; ++i) {
+        float best = diagonal[i];
+        unsigned char move = 0;
+        if (up[i] < best) {
+            best = up[i];
+            move = 1;
+        }
+        if (left[i] < best) {
+            best = left[i];
+            move = 2;
+        }
+        output[i] = cost[i] + best;
+        moves[i] = move;
+    }
+}
+
+} // namespace audiocompare
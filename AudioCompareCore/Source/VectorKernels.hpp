@@ -0,0 +1,44 @@
+//
+//  VectorKernels.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include <cstddef>
+
+// Define AUDIOCOMPARE_NO_SIMD to build the portable scalar kernels only.
+#if !defined(AUDIOCOMPARE_NO_SIMD)
+#if defined(__AVX2__) && defined(__FMA__)
+#define AUDIOCOMPARE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#define AUDIOCOMPARE_SSE2 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AUDIOCOMPARE_NEON 1
+#endif
+#endif
+
+namespace audiocompare {
+
+/// Name of the instruction set the kernels were compiled for.
+const char* vectorKernelIsa();
+
+/// sum(a[i] * b[i]) with single-precision SIMD accumulation.
+float dotProduct(const float* a, const float* b, std::size_t count);
+
+/// output[i] = a[i] - gain * b[i]. `output` may alias `a`.
+void subtractScaled(const float* a, const float* b, float gain, float* output, std::size_t count);
+
+/// accumulator[i] += a[i] * b[i].
+void multiplyAccumulate(const float* a, const float* b, float* accumulator, std::size_t count);
+
+/// One dynamic-programming step over independent cells:
+/// output[i] = cost[i] + min(diagonal[i], up[i], left[i]), and moves[i] is
+/// 0, 1 or 2 for the diagonal, up or left predecessor (ties prefer that
+/// order). Infinite inputs mark cells outside the search band.
+void minPlusStep(const float* cost, const float* diagonal, const float* up, const float* left,
+                 float* output, unsigned char* moves, std::size_t count);
+
+} // namespace audiocompare
@@ -0,0 +1,170 @@
+//
+//  WaveFileReader.cpp
+//  AudioCompareCore
+//
+
+#include "WaveFileReader.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const std::size_t kStagingFrames = 4096;
+
+void seekFile(std::FILE* file, std::int64_t offset, int whence)
+{
+    fseeko(file, static_cast<off_t>(offset), whence);
+}
+
+std::uint16_t readLE16(const unsigned char* p)
+{
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+std::uint32_t readLE32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8)
+           | (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t readLE64(const unsigned char* p)
+{
+    return static_cast<std::uint64_t>(readLE32(p)) | (static_cast<std::uint64_t>(readLE32(p + 4)) << 32);
+}
+
+} // namespace
+
+WaveFileReader::WaveFileReader(const std::string& path)
+    : path_(path)
+{
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_)
+        throw std::runtime_error("cannot open " + path);
+    try {
+        parseHeader();
+    } catch (...) {
+        std::fclose(file_);
+        throw;
+    }
+    staging_.resize(kStagingFrames * bytesPerFrame_);
+    converted_.resize(kStagingFrames * format_.channelCount);
+}
+
+WaveFileReader::~WaveFileReader()
+{
+    if (file_)
+        std::fclose(file_);
+}
+
+void WaveFileReader::parseHeader()
+{
+    unsigned char header[12];
+    if (std::fread(header, 1, sizeof(header), file_) != sizeof(header))
+        throw std::runtime_error(path_ + ": truncated header");
+    const bool isRf64 = std::memcmp(header, "RF64", 4) == 0;
+    if ((!isRf64 && std::memcmp(header, "RIFF", 4) != 0) || std::memcmp(header + 8, "WAVE", 4) != 0)
+        throw std::runtime_error(path_ + ": not a WAVE file");
+
+    std::uint64_t rf64DataSize = 0;
+    bool haveFormat = false;
+    std::int64_t offset = 12;
+
+    for (;;) {
+        unsigned char chunk[8];
+        if (std::fread(chunk, 1, sizeof(chunk), file_) != sizeof(chunk))
+            throw std::runtime_error(path_ + ": no data chunk");
+        offset += 8;
+        std::uint64_t size = readLE32(chunk + 4);
+
+        if (std::memcmp(chunk, "ds64", 4) == 0) {
+            unsigned char ds64[24];
+            if (size < sizeof(ds64) || std::fread(ds64, 1, sizeof(ds64), file_) != sizeof(ds64))
+                throw std::runtime_error(path_ + ": malformed ds64 chunk");
+            rf64DataSize = readLE64(ds64 + 8);
+            seekFile(file_, static_cast<std::int64_t>(size - sizeof(ds64) + (size & 1)), SEEK_CUR);
+        } else if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            std::vector<unsigned char> fmt(size);
+            if (size < 16 || std::fread(fmt.data(), 1, size, file_) != size)
+                throw std::runtime_error(path_ + ": malformed fmt chunk");
+            if (size & 1)
+                seekFile(file_, 1, SEEK_CUR);
+
+            std::uint16_t tag = readLE16(&fmt[0]);
+            format_.channelCount = readLE16(&fmt[2]);
+            format_.sampleRate = readLE32(&fmt[4]);
+            const std::uint16_t bits = readLE16(&fmt[14]);
+            if (tag == 0xFFFE && size >= 40)
+                tag = readLE16(&fmt[24]);
+
+            if (tag == 1 && bits == 8)
+                sampleFormat_ = SampleFormat::UInt8;
+            else if (tag == 1 && bits == 16)
+                sampleFormat_ = SampleFormat::Int16;
+            else if (tag == 1 && bits == 24)
+                sampleFormat_ = SampleFormat::Int24;
+            else if (tag == 1 && bits == 32)
+                sampleFormat_ = SampleFormat::Int32;
+            else if (tag == 3 && bits == 32)
+                sampleFormat_ = SampleFormat::Float32;
+            else if (tag == 3 && bits == 64)
+                sampleFormat_ = SampleFormat::Float64;
+            else
+                throw std::runtime_error(path_ + ": unsupported sample format");
+            if (format_.channelCount == 0 || format_.sampleRate <= 0.0)
+                throw std::runtime_error(path_ + ": invalid format");
+            bytesPerFrame_ = format_.channelCount * bytesPerSample(sampleFormat_);
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat)
+                throw std::runtime_error(path_ + ": data chunk before fmt chunk");
+            if (isRf64 && size == 0xFFFFFFFFu)
+                size = rf64DataSize;
+            dataOffset_ = offset;
+            frameCount_ = static_cast<std::int64_t>(size / bytesPerFrame_);
+            return;
+        } else {
+            seekFile(file_, static_cast<std::int64_t>(size + (size & 1)), SEEK_CUR);
+        }
+        offset += static_cast<std::int64_t>(size + (size & 1));
+    }
+}
+
+std::size_t WaveFileReader::readFrames(float* const* buffers, std::size_t frames)
+{
+    if (needsSeek_) {
+        seekFile(file_, dataOffset_ + position_ * static_cast<std::int64_t>(bytesPerFrame_), SEEK_SET);
+        needsSeek_ = false;
+    }
+
+    const std::size_t available = static_cast<std::size_t>(frameCount_ - position_);
+    frames = std::min(frames, available);
+    std::size_t done = 0;
+    while (done < frames) {
+        const std::size_t chunk = std::min(kStagingFrames, frames - done);
+        const std::size_t got = std::fread(staging_.data(), bytesPerFrame_, chunk, file_);
+        const std::size_t samples = got * format_.channelCount;
+        convertToFloat(staging_.data(), sampleFormat_, ByteOrder::LittleEndian, samples, converted_.data());
+        deinterleave(converted_.data(), format_.channelCount, got, buffers, done);
+        done += got;
+        if (got < chunk) {
+            // Truncated file: treat what we have as the real length.
+            frameCount_ = position_ + static_cast<std::int64_t>(done);
+            break;
+        }
+    }
+    position_ += static_cast<std::int64_t>(done);
+    return done;
+}
+
+void WaveFileReader::seekToFrame(std::int64_t frame)
+{
+    position_ = std::clamp<std::int64_t>(frame, 0, frameCount_);
+    needsSeek_ = true;
+}
+
+} // namespace audiocompare
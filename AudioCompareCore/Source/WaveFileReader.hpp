@@ -0,0 +1,53 @@
+//
+//  WaveFileReader.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+#include "SampleConversion.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+/// Streaming reader for RIFF/RF64 WAVE files (integer or float PCM). Frames
+/// are decoded block by block through a fixed staging buffer, so memory use
+/// does not depend on the file length.
+class WaveFileReader : public AudioReader {
+public:
+    explicit WaveFileReader(const std::string& path);
+    ~WaveFileReader() override;
+
+    WaveFileReader(const WaveFileReader&) = delete;
+    WaveFileReader& operator=(const WaveFileReader&) = delete;
+
+    AudioFormat format() const override { return format_; }
+    std::int64_t frameCount() const override { return frameCount_; }
+    std::size_t readFrames(float* const* buffers, std::size_t frames) override;
+    void seekToFrame(std::int64_t frame) override;
+    std::int64_t framePosition() const override { return position_; }
+
+    SampleFormat sampleFormat() const { return sampleFormat_; }
+    const std::string& path() const { return path_; }
+
+private:
+    void parseHeader();
+
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    AudioFormat format_;
+    SampleFormat sampleFormat_ = SampleFormat::Int16;
+    std::size_t bytesPerFrame_ = 0;
+    std::int64_t dataOffset_ = 0;
+    std::int64_t frameCount_ = 0;
+    std::int64_t position_ = 0;
+    bool needsSeek_ = false;
+    std::vector<unsigned char> staging_;
+    std::vector<float> converted_;
+};
+
+} // namespace audiocompare
@@ -0,0 +1,142 @@
+//
+//  WaveFileWriter.cpp
+//  AudioCompareCore
+//
+
+#include "WaveFileWriter.hpp"
+
+#include "SampleConversion.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace audiocompare {
+
+namespace {
+
+const std::size_t kInterleaveFrames = 4096;
+const std::size_t kHeaderBytes = 80;
+const std::uint64_t kRiffLimit = 0xFFFFFFFFULL;
+
+void writeLE16(unsigned char* p, std::uint16_t value)
+{
+    p[0] = static_cast<unsigned char>(value);
+    p[1] = static_cast<unsigned char>(value >> 8);
+}
+
+void writeLE32(unsigned char* p, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void writeLE64(unsigned char* p, std::uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+// RIFF header, a 28-byte JUNK chunk that becomes ds64 for RF64, fmt and the
+// data chunk header.
+void buildHeader(unsigned char* header, const AudioFormat& format, std::uint64_t dataBytes)
+{
+    const std::uint16_t channels = static_cast<std::uint16_t>(format.channelCount);
+    const std::uint32_t rate = static_cast<std::uint32_t>(format.sampleRate);
+    const std::uint16_t blockAlign = static_cast<std::uint16_t>(channels * sizeof(float));
+    const std::uint64_t riffBytes = kHeaderBytes - 8 + dataBytes;
+    const bool rf64 = riffBytes > kRiffLimit;
+
+    std::memset(header, 0, kHeaderBytes);
+    std::memcpy(header, rf64 ? "RF64" : "RIFF", 4);
+    writeLE32(header + 4, rf64 ? 0xFFFFFFFFU : static_cast<std::uint32_t>(riffBytes));
+    std::memcpy(header + 8, "WAVE", 4);
+
+    std::memcpy(header + 12, rf64 ? "ds64" : "JUNK", 4);
+    writeLE32(header + 16, 28);
+    if (rf64) {
+        writeLE64(header + 20, riffBytes);
+        writeLE64(header + 28, dataBytes);
+        writeLE64(header + 36, dataBytes / blockAlign);
+    }
+
+    std::memcpy(header + 48, "fmt ", 4);
+    writeLE32(header + 52, 16);
+    writeLE16(header + 56, 3); // WAVE_FORMAT_IEEE_FLOAT
+    writeLE16(header + 58, channels);
+    writeLE32(header + 60, rate);
+    writeLE32(header + 64, rate * blockAlign);
+    writeLE16(header + 68, blockAlign);
+    writeLE16(header + 70, 32);
+
+    std::memcpy(header + 72, "data", 4);
+    writeLE32(header + 76, rf64 ? 0xFFFFFFFFU : static_cast<std::uint32_t>(dataBytes));
+}
+
+} // namespace
+
+WaveFileWriter::WaveFileWriter(const std::string& path, AudioFormat format)
+    : path_(path)
+    , format_(format)
+{
+    if (format.channelCount == 0 || format.channelCount > 0xFFFF || format.sampleRate <= 0.0)
+        throw std::invalid_argument("unsupported output format");
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_)
+        throw std::runtime_error("cannot create " + path);
+
+    unsigned char header[kHeaderBytes];
+    buildHeader(header, format_, 0);
+    if (std::fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+        std::fclose(file_);
+        throw std::runtime_error(path_ + ": write failed");
+    }
+    interleaved_.resize(kInterleaveFrames * format.channelCount);
+}
+
+WaveFileWriter::~WaveFileWriter()
+{
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void WaveFileWriter::writeFrames(const float* const* buffers, std::size_t frames)
+{
+    const std::size_t channels = format_.channelCount;
+    for (std::size_t offset = 0; offset < frames;) {
+        const std::size_t count = std::min(kInterleaveFrames, frames - offset);
+        interleave(buffers, channels, count, interleaved_.data(), offset);
+        writeInterleaved(interleaved_.data(), count);
+        offset += count;
+    }
+}
+
+void WaveFileWriter::writeInterleaved(const float* samples, std::size_t frames)
+{
+    if (!file_)
+        throw std::runtime_error(path_ + ": writer is closed");
+    const std::size_t count = frames * format_.channelCount;
+    if (std::fwrite(samples, sizeof(float), count, file_) != count)
+        throw std::runtime_error(path_ + ": write failed");
+    framesWritten_ += static_cast<std::int64_t>(frames);
+}
+
+void WaveFileWriter::close()
+{
+    if (!file_)
+        return;
+    std::FILE* file = file_;
+    file_ = nullptr;
+
+    unsigned char header[kHeaderBytes];
+    buildHeader(header, format_,
+                static_cast<std::uint64_t>(framesWritten_) * format_.channelCount * sizeof(float));
+    const bool written = std::fseek(file, 0, SEEK_SET) == 0
+                         && std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    if (std::fclose(file) != 0 || !written)
+        throw std::runtime_error(path_ + ": cannot finalize header");
+}
+
+} // namespace audiocompare
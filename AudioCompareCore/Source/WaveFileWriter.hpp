@@ -0,0 +1,51 @@
+//
+//  WaveFileWriter.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace audiocompare {
+
+/// 32-bit float WAVE writer, the counterpart of `EZRecorder`. The header
+/// reserves room for a ds64 chunk, so files past 4 GiB are finalized as RF64.
+class WaveFileWriter {
+public:
+    /// Throws std::runtime_error when the file cannot be created.
+    WaveFileWriter(const std::string& path, AudioFormat format);
+    /// Finalizes the header if `close` was not called; errors are ignored.
+    ~WaveFileWriter();
+
+    WaveFileWriter(const WaveFileWriter&) = delete;
+    WaveFileWriter& operator=(const WaveFileWriter&) = delete;
+
+    AudioFormat format() const { return format_; }
+    std::int64_t framesWritten() const { return framesWritten_; }
+    const std::string& path() const { return path_; }
+
+    /// Interleaves and appends `frames` frames of planar audio.
+    void writeFrames(const float* const* buffers, std::size_t frames);
+    /// Appends already interleaved frames.
+    void writeInterleaved(const float* samples, std::size_t frames);
+
+    /// Patches the chunk sizes and closes the file. Throws std::runtime_error
+    /// on I/O errors.
+    void close();
+
+private:
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    AudioFormat format_;
+    std::int64_t framesWritten_ = 0;
+    std::vector<float> interleaved_;
+};
+
+} // namespace audiocompare
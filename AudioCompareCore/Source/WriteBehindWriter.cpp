@@ -0,0 +1,136 @@
+//
+//  WriteBehindWriter.cpp
+//  AudioCompareCore
+//
+
+#include "WriteBehindWriter.hpp"
+
+#include "SampleConversion.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace audiocompare {
+
+WriteBehindWriter::WriteBehindWriter(WaveFileWriter& writer, std::size_t chunkFrames,
+                                     std::size_t chunkCount, std::size_t maxOverflowChunks)
+    : writer_(writer)
+    , chunkFrames_(chunkFrames)
+    , channelCount_(writer.format().channelCount)
+    , maxOverflowChunks_(maxOverflowChunks)
+{
+    if (chunkFrames == 0 || chunkCount == 0)
+        throw std::invalid_argument("write-behind buffer needs at least one chunk");
+    current_.resize(chunkFrames_ * channelCount_);
+    for (std::size_t i = 1; i < chunkCount; ++i)
+        free_.emplace_back(chunkFrames_ * channelCount_);
+    thread_ = std::thread(&WriteBehindWriter::run, this);
+}
+
+WriteBehindWriter::~WriteBehindWriter()
+{
+    try {
+        flush();
+    } catch (...) {
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void WriteBehindWriter::writeFrames(const float* const* buffers, std::size_t frames)
+{
+    for (std::size_t offset = 0; offset < frames;) {
+        const std::size_t count = std::min(chunkFrames_ - currentFrames_, frames - offset);
+        interleave(buffers, channelCount_, count, current_.data() + currentFrames_ * channelCount_, offset);
+        currentFrames_ += count;
+        offset += count;
+        if (currentFrames_ == chunkFrames_)
+            submitCurrent();
+    }
+}
+
+void WriteBehindWriter::flush()
+{
+    if (currentFrames_ > 0)
+        submitCurrent();
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_.wait(lock, [this] { return queue_.empty() && !busy_; });
+    if (error_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+std::size_t WriteBehindWriter::overflowChunks() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return overflowChunks_;
+}
+
+std::size_t WriteBehindWriter::stalls() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stalls_;
+}
+
+void WriteBehindWriter::submitCurrent()
+{
+    Chunk next;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queue_.emplace_back(std::move(current_), currentFrames_);
+        wake_.notify_one();
+        if (free_.empty() && overflowChunks_ < maxOverflowChunks_) {
+            ++overflowChunks_;
+        } else {
+            if (free_.empty()) {
+                ++stalls_;
+                recycled_.wait(lock, [this] { return !free_.empty(); });
+            }
+            next = std::move(free_.back());
+            free_.pop_back();
+        }
+    }
+    if (next.empty())
+        next.resize(chunkFrames_ * channelCount_);
+    current_ = std::move(next);
+    currentFrames_ = 0;
+}
+
+void WriteBehindWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty())
+            return;
+        std::pair<Chunk, std::size_t> item = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        const bool skip = static_cast<bool>(error_);
+        lock.unlock();
+
+        std::exception_ptr error;
+        if (!skip) {
+            try {
+                writer_.writeInterleaved(item.first.data(), item.second);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        lock.lock();
+        if (error && !error_)
+            error_ = error;
+        free_.push_back(std::move(item.first));
+        recycled_.notify_one();
+        busy_ = false;
+        if (queue_.empty())
+            drained_.notify_all();
+    }
+}
+
+} // namespace audiocompare
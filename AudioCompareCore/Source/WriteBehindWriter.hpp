@@ -0,0 +1,75 @@
+//
+//  WriteBehindWriter.hpp
+//  AudioCompareCore
+//
+
+#pragma once
+
+#include "WaveFileWriter.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace audiocompare {
+
+/// Moves `WaveFileWriter` disk I/O onto a background thread. Callers only
+/// interleave into an in-memory chunk; full chunks are queued for the
+/// writer thread and recycled afterwards. When the disk falls behind and the
+/// pool is exhausted, up to `maxOverflowChunks` more chunks are allocated to
+/// absorb the burst; past that the caller waits for a chunk to be written,
+/// so memory stays bounded however long the stream.
+class WriteBehindWriter {
+public:
+    explicit WriteBehindWriter(WaveFileWriter& writer, std::size_t chunkFrames = 65536,
+                               std::size_t chunkCount = 8, std::size_t maxOverflowChunks = 8);
+    /// Drains the queue; errors are ignored, call `flush` to see them.
+    ~WriteBehindWriter();
+
+    WriteBehindWriter(const WriteBehindWriter&) = delete;
+    WriteBehindWriter& operator=(const WriteBehindWriter&) = delete;
+
+    void writeFrames(const float* const* buffers, std::size_t frames);
+
+    /// Waits until everything written so far is on disk. Rethrows the first
+    /// error raised by the writer thread.
+    void flush();
+
+    /// Chunks allocated beyond the initial pool because the disk fell behind.
+    std::size_t overflowChunks() const;
+    /// Times the caller waited for the disk because every chunk was in use.
+    std::size_t stalls() const;
+
+private:
+    using Chunk = std::vector<float>;
+
+    void submitCurrent();
+    void run();
+
+    WaveFileWriter& writer_;
+    std::size_t chunkFrames_;
+    std::size_t channelCount_;
+    Chunk current_;
+    std::size_t currentFrames_ = 0;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    std::condition_variable recycled_;
+    std::deque<std::pair<Chunk, std::size_t>> queue_;
+    std::vector<Chunk> free_;
+    std::size_t maxOverflowChunks_;
+    std::size_t overflowChunks_ = 0;
+    std::size_t stalls_ = 0;
+    bool busy_ = false;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+    std::thread thread_;
+};
+
+} // namespace audiocompare
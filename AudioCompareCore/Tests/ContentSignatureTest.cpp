@@ -0,0 +1,117 @@
+//
+//  ContentSignatureTest.cpp
+//  AudioCompareCore
+//
+//  Checks that the near-duplicate search keeps altered copies of a
+//  synthetic melody and rejects unrelated material: a gain change, a lossy
+//  re-encode and a 3% time-stretch must collide in the LSH index and pass
+//  the default tests, while a different melody must not, even in the same
+//  timbre.
+//
+
+#include "ContentSignature.hpp"
+#include "FrameFeatures.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace audiocompare;
+using namespace audiocompare::test;
+
+namespace {
+
+const double kSampleRate = 44100.0;
+const double kSeconds = 30.0;
+
+/// Random notes over two octaves from A3, each an eighth to a quarter second
+/// with a decaying envelope, in the timbre given by `harmonics`.
+std::vector<float> melody(unsigned seed, const std::vector<double>& harmonics, double stretch = 1.0)
+{
+    const double pi = 3.14159265358979323846;
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> notes(0, 23);
+    std::uniform_int_distribution<int> eighths(2, 4);
+    std::vector<float> samples(static_cast<std::size_t>(kSeconds * kSampleRate * stretch), 0.0f);
+    for (std::size_t position = 0; position < samples.size();) {
+        const double frequency = 220.0 * std::pow(2.0, notes(random) / 12.0);
+        const std::size_t length = static_cast<std::size_t>(eighths(random) * 0.125 * kSampleRate * stretch);
+        const double seconds = static_cast<double>(length) / kSampleRate;
+        for (std::size_t i = 0; i < length && position + i < samples.size(); ++i) {
+            const double t = static_cast<double>(i) / kSampleRate;
+            const double envelope = std::exp(-3.0 * t / seconds) * std::min(1.0, static_cast<double>(i) / 200.0);
+            double sample = 0.0;
+            for (std::size_t h = 0; h < harmonics.size(); ++h)
+                sample += harmonics[h] * std::sin(2.0 * pi * frequency * static_cast<double>(h + 1) * t);
+            samples[position + i] += static_cast<float>(0.3 * envelope * sample);
+        }
+        position += length;
+    }
+    return samples;
+}
+
+/// A one-pole low-pass, a little noise and 16-bit rounding, as a stand-in
+/// for a lossy round trip.
+std::vector<float> reencoded(std::vector<float> samples)
+{
+    std::mt19937 random(9);
+    std::normal_distribution<float> noise(0.0f, 1e-4f);
+    float state = 0.0f;
+    for (float& sample : samples) {
+        state += 0.6f * (sample - state);
+        sample = std::round((state + noise(random)) * 32767.0f) / 32767.0f;
+    }
+    return samples;
+}
+
+ContentSignature signature(std::vector<float> samples)
+{
+    SignalReader reader(std::move(samples), kSampleRate);
+    return computeSignature(extractFrameFeatures(reader));
+}
+
+} // namespace
+
+int main()
+{
+    Checks checks("ContentSignatureTest");
+    const std::vector<double> bright = {1.0, 0.5, 0.3, 0.2, 0.1};
+    const std::vector<double> hollow = {1.0, 0.05, 0.6, 0.02, 0.4, 0.01, 0.2};
+
+    const std::vector<float> original = melody(1, bright);
+    std::vector<float> quieter = original;
+    for (float& sample : quieter)
+        sample *= 0.5f;
+
+    const std::vector<std::pair<std::string, ContentSignature>> signatures = {
+        {"original", signature(original)},
+        {"gain change", signature(quieter)},
+        {"re-encode", signature(reencoded(original))},
+        {"time-stretch", signature(melody(1, bright, 1.03))},
+        {"other melody", signature(melody(2, hollow))},
+        {"other melody, same timbre", signature(melody(3, bright))},
+    };
+    const std::size_t copies = 4;
+
+    LshIndex index;
+    for (std::size_t i = 0; i < signatures.size(); ++i)
+        index.add(static_cast<std::uint32_t>(i), signatures[i].second);
+    const auto pairs = index.candidatePairs();
+    for (std::size_t i = 1; i < signatures.size(); ++i) {
+        const bool copy = i < copies;
+        const bool collides = std::find(pairs.begin(), pairs.end(), std::make_pair(0u, static_cast<std::uint32_t>(i)))
+                              != pairs.end();
+        const bool near = isNearDuplicate(signatures[0].second, signatures[i].second);
+        if (copy) {
+            checks.expect(collides, signatures[i].first + " shares an LSH bucket");
+            checks.expect(near, signatures[i].first + " passes the near-duplicate tests");
+        } else {
+            checks.expect(!near, signatures[i].first + " fails the near-duplicate tests");
+        }
+    }
+    return checks.report();
+}
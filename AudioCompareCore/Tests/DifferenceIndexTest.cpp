@@ -0,0 +1,87 @@
+//
+//  DifferenceIndexTest.cpp
+//  AudioCompareCore
+//
+//  Checks that a difference index locates a burst at its reference frame
+//  when the comparison does not start at reference frame 0, both straight
+//  from the builder and after a write / open round trip.
+//
+
+#include "DifferenceIndex.hpp"
+#include "StreamingComparator.hpp"
+#include "TestSupport.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+using namespace audiocompare::test;
+
+namespace {
+
+const std::int64_t kFrames = 200000;
+const std::int64_t kBurstFrame = 100000;
+const std::int64_t kBurstFrames = 100;
+
+/// Mono pattern starting `shift` frames into the reference, with a burst
+/// added over [kBurstFrame, kBurstFrame + kBurstFrames) in reference frames.
+std::vector<float> shiftedPattern(std::int64_t shift, bool burst)
+{
+    std::vector<float> samples(static_cast<std::size_t>(kFrames - shift));
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const std::int64_t frame = static_cast<std::int64_t>(i) + shift;
+        samples[i] = patternSample(frame, 0);
+        if (burst && frame >= kBurstFrame && frame < kBurstFrame + kBurstFrames)
+            samples[i] += 0.25f;
+    }
+    return samples;
+}
+
+void checkRegion(Checks& checks, const DifferenceIndex& index, std::int64_t origin, const std::string& what)
+{
+    checks.expect(index.originFrame() == origin, "origin frame" + what);
+    const std::vector<DifferenceRegion> regions = index.worstRegions(1, DifferenceMetric::Residual, 1);
+    checks.expect(regions.size() == 1, "one region" + what);
+    if (regions.size() != 1)
+        return;
+    const std::int64_t cell = index.level(0).cellFrames;
+    checks.expect(regions[0].peakFrame <= kBurstFrame && kBurstFrame < regions[0].peakFrame + cell,
+                  "peak at the burst's reference frame" + what);
+    checks.expect(regions[0].startFrame <= regions[0].peakFrame
+                      && regions[0].peakFrame < regions[0].startFrame + regions[0].frames,
+                  "peak inside its region" + what);
+}
+
+} // namespace
+
+int main()
+{
+    Checks checks("DifferenceIndexTest");
+    // The candidate starts 700 reference frames in, so the comparison skips
+    // that much of the reference, and the reference reader starts 50 in.
+    const std::int64_t shift = 700;
+    const std::int64_t start = 50;
+    SignalReader reference(shiftedPattern(0, false));
+    SignalReader candidate(shiftedPattern(shift, true));
+    reference.seekToFrame(start);
+    candidate.seekToFrame(start);
+
+    ComparisonOptions options;
+    options.candidateOffset = -shift;
+    options.spectral = false;
+    StreamingComparator comparator(options);
+    DifferenceIndexBuilder builder(reference.format());
+    comparator.setObserver(&builder);
+    const ComparisonResult result = comparator.compare(reference, candidate);
+    checks.expect(result.referenceStart == start + shift, "comparison start");
+
+    const DifferenceIndex built = builder.finish(result.comparedFrames, result.referenceStart);
+    checkRegion(checks, built, start + shift, " when built");
+
+    const std::string path = "DifferenceIndexTest.acdi";
+    built.write(path);
+    checkRegion(checks, DifferenceIndex::open(path), start + shift, " after reopening");
+    std::remove(path.c_str());
+    return checks.report();
+}
@@ -0,0 +1,133 @@
+//
+//  FftPlanTest.cpp
+//  AudioCompareCore
+//
+//  Checks every FFT backend in this build against a double-precision
+//  transform, forward and inverse, for each power-of-two size from 4 to 64K.
+//  Errors are relative to the peak magnitude of the expected result, with
+//  the tolerance audiofftbench reports against.
+//
+
+#include "FftPlan.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+using namespace audiocompare::test;
+
+namespace {
+
+const double kTolerance = 1e-5;
+const std::size_t kMinSize = 4;
+const std::size_t kMaxSize = 65536;
+
+/// In-place unscaled forward DFT through an iterative radix-2 transform.
+void referenceTransform(std::vector<std::complex<double>>& values)
+{
+    const std::size_t n = values.size();
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(values[i], values[j]);
+    }
+    for (std::size_t length = 2; length <= n; length <<= 1) {
+        const double angle = -2.0 * 3.14159265358979323846 / static_cast<double>(length);
+        for (std::size_t start = 0; start < n; start += length) {
+            for (std::size_t k = 0; k < length / 2; ++k) {
+                const std::complex<double> w = std::polar(1.0, angle * static_cast<double>(k));
+                const std::complex<double> t = w * values[start + k + length / 2];
+                values[start + k + length / 2] = values[start + k] - t;
+                values[start + k] += t;
+            }
+        }
+    }
+}
+
+template <typename Value>
+double peakMagnitude(const std::vector<Value>& values)
+{
+    double peak = 0.0;
+    for (const Value& value : values)
+        peak = std::max(peak, static_cast<double>(std::abs(value)));
+    return std::max(peak, 1e-30);
+}
+
+double forwardError(const FftPlan& plan, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+    std::vector<float> input(plan.size());
+    for (float& value : input)
+        value = sample(random);
+    std::vector<std::complex<double>> expected(input.begin(), input.end());
+    referenceTransform(expected);
+    expected.resize(plan.binCount());
+
+    std::vector<float> real(plan.binCount()), imag(plan.binCount());
+    plan.forward(input.data(), real.data(), imag.data());
+    double worst = 0.0;
+    for (std::size_t k = 0; k < real.size(); ++k)
+        worst = std::max(worst, std::abs(expected[k] - std::complex<double>(real[k], imag[k])));
+    return worst / peakMagnitude(expected);
+}
+
+/// Inverts random bins, with the DC and Nyquist bins real as in any real
+/// signal's spectrum, and compares with the conjugate-symmetric spectrum
+/// inverted in double precision and scaled by 1 / size.
+double inverseError(const FftPlan& plan, std::mt19937& random)
+{
+    const std::size_t size = plan.size();
+    const std::size_t bins = plan.binCount();
+    std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+    std::vector<float> real(bins), imag(bins);
+    for (std::size_t k = 0; k < bins; ++k) {
+        real[k] = sample(random);
+        imag[k] = k == 0 || k == bins - 1 ? 0.0f : sample(random);
+    }
+    // The inverse is the conjugate of the forward transform of the conjugate.
+    std::vector<std::complex<double>> expected(size);
+    for (std::size_t k = 0; k < bins; ++k) {
+        expected[k] = std::complex<double>(real[k], -imag[k]);
+        if (k > 0 && k < bins - 1)
+            expected[size - k] = std::complex<double>(real[k], imag[k]);
+    }
+    referenceTransform(expected);
+    std::vector<double> signal(size);
+    for (std::size_t i = 0; i < size; ++i)
+        signal[i] = expected[i].real() / static_cast<double>(size);
+
+    std::vector<float> output(size);
+    plan.inverse(real.data(), imag.data(), output.data());
+    double worst = 0.0;
+    for (std::size_t i = 0; i < size; ++i)
+        worst = std::max(worst, std::fabs(signal[i] - static_cast<double>(output[i])));
+    return worst / peakMagnitude(signal);
+}
+
+} // namespace
+
+int main()
+{
+    Checks checks("FftPlanTest");
+    std::mt19937 random(22);
+    for (const FftBackend backend : {FftBackend::Radix2, FftBackend::SplitRadix, FftBackend::Accelerate}) {
+        if (!isFftBackendAvailable(backend))
+            continue;
+        for (std::size_t size = kMinSize; size <= kMaxSize; size <<= 1) {
+            const std::unique_ptr<FftPlan> plan = FftPlan::create(size, backend);
+            const std::string what = std::string(" of ") + fftBackendName(backend) + " at " + std::to_string(size);
+            checks.expect(forwardError(*plan, random) <= kTolerance, "forward transform" + what);
+            checks.expect(inverseError(*plan, random) <= kTolerance, "inverse transform" + what);
+        }
+    }
+    return checks.report();
+}
@@ -0,0 +1,134 @@
+//
+//  FractionalAlignmentTest.cpp
+//  AudioCompareCore
+//
+//  Checks that an aligned comparison nulls band-limited noise against a
+//  copy shifted by a fractional number of samples: the offset estimate and
+//  the fractional delay together must leave a residual below -90 dB, with
+//  and without the alignment pyramid, and only frames the delay filter
+//  cannot support may be left out.
+//
+
+#include "ComparisonPipeline.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+using namespace audiocompare::test;
+
+namespace {
+
+const double kSampleRate = 48000.0;
+const double kBandEdge = 18000.0;
+const std::size_t kFrames = std::size_t(1) << 19;
+const double kRequiredNullDb = -90.0;
+
+/// Double-precision inverse DFT of a Hermitian spectrum, so the test signals
+/// carry no error of the library's own float FFT.
+std::vector<double> inverseTransform(std::vector<std::complex<double>> values)
+{
+    const double pi = 3.14159265358979323846;
+    const std::size_t n = values.size();
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(values[i], values[j]);
+    }
+    for (std::size_t length = 2; length <= n; length <<= 1) {
+        for (std::size_t start = 0; start < n; start += length) {
+            for (std::size_t k = 0; k < length / 2; ++k) {
+                const std::complex<double> twiddle = std::polar(1.0, 2.0 * pi * k / length);
+                const std::complex<double> even = values[start + k];
+                const std::complex<double> odd = values[start + k + length / 2] * twiddle;
+                values[start + k] = even + odd;
+                values[start + k + length / 2] = even - odd;
+            }
+        }
+    }
+    std::vector<double> result(n);
+    for (std::size_t i = 0; i < n; ++i)
+        result[i] = values[i].real() / static_cast<double>(n);
+    return result;
+}
+
+/// Periodic white noise band-limited to `kBandEdge`, delayed circularly by
+/// exactly `delay` samples.
+std::vector<double> bandLimitedNoise(double delay)
+{
+    const double pi = 3.14159265358979323846;
+    std::mt19937 random(1);
+    std::normal_distribution<double> normal;
+    std::vector<std::complex<double>> spectrum(kFrames);
+    for (std::size_t k = 1; k < kFrames / 2; ++k) {
+        const double re = normal(random);
+        const double im = normal(random);
+        if (kSampleRate * static_cast<double>(k) / static_cast<double>(kFrames) > kBandEdge)
+            continue;
+        const double phase = -2.0 * pi * static_cast<double>(k) * delay / static_cast<double>(kFrames);
+        spectrum[k] = std::complex<double>(re, im) * std::polar(1.0, phase);
+        spectrum[kFrames - k] = std::conj(spectrum[k]);
+    }
+    return inverseTransform(std::move(spectrum));
+}
+
+std::vector<float> scaled(const std::vector<double>& signal, double gain)
+{
+    std::vector<float> result(signal.size());
+    for (std::size_t i = 0; i < signal.size(); ++i)
+        result[i] = static_cast<float>(signal[i] * gain);
+    return result;
+}
+
+void checkNull(Checks& checks, double delay, bool pyramid)
+{
+    const std::vector<double> reference = bandLimitedNoise(0.0);
+    double peak = 0.0;
+    for (const double sample : reference)
+        peak = std::max(peak, std::fabs(sample));
+    SignalReader referenceReader(scaled(reference, 0.5 / peak));
+    SignalReader candidateReader(scaled(bandLimitedNoise(delay), 0.5 / peak));
+
+    PipelineOptions options;
+    options.align = true;
+    options.usePyramid = pyramid;
+    options.alignment.maxOffsetSeconds = 1.0;
+    options.alignment.excerptSeconds = 4.0;
+    options.comparison.spectral = false;
+    ComparisonPipeline pipeline(referenceReader, candidateReader, options);
+    pipeline.align();
+    const ComparisonResult result = pipeline.compare();
+
+    const std::string what = " for delay " + std::to_string(delay) + (pyramid ? " with pyramid" : "");
+    checks.expect(std::fabs(pipeline.fractionalOffset() - delay) < 1e-4, "offset estimate" + what);
+    checks.expect(result.overall.nullDepthDb() < kRequiredNullDb,
+                  "null depth " + std::to_string(result.overall.nullDepthDb()) + " dB" + what);
+
+    // The delay filter's 2 * 32 taps cost the first 31 candidate frames, and
+    // only when the offset has not already skipped past them, and the last 32.
+    const std::int64_t offset = result.candidateOffset;
+    const std::int64_t lead = std::max<std::int64_t>(31 - std::max<std::int64_t>(offset, 0), 0);
+    const std::int64_t frames = static_cast<std::int64_t>(kFrames);
+    const std::int64_t expected = std::min(frames - std::max<std::int64_t>(-offset, 0),
+                                           frames - 32 - std::max<std::int64_t>(offset, 0)) - lead;
+    checks.expect(result.comparedFrames == expected, "compared frames" + what);
+}
+
+} // namespace
+
+int main()
+{
+    Checks checks("FractionalAlignmentTest");
+    for (const bool pyramid : {false, true})
+        for (const double delay : {0.37, 1234.37, -100.37})
+            checkNull(checks, delay, pyramid);
+    return checks.report();
+}
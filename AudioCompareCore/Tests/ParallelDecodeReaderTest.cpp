@@ -0,0 +1,325 @@
+//
+//  ParallelDecodeReaderTest.cpp
+//  AudioCompareCore
+//
+//  Encodes an Apple IMA4 CAF file and checks that ParallelDecodeReader
+//  decodes it bit for bit at every chunk size, that a stateful decoder's
+//  pre-roll makes chunked output match a sequential decode, and that a
+//  packet decoding short before the end is an error.
+//
+
+#include "AudioUtilities.hpp"
+#include "ParallelDecodeReader.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+using namespace audiocompare::test;
+
+namespace {
+
+const char kPath[] = "ParallelDecodeReaderTest.caf";
+const std::size_t kChannels = 2;
+const std::int64_t kFrames = 100000;
+const std::int64_t kPrimingFrames = 100;
+const std::size_t kFramesPerPacket = 64;
+
+const int kStepTable[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+    544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+    9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+const int kIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+/// A 16-bit test tone with a slow vibrato, silent outside the valid frames.
+int toneSample(std::int64_t frame, std::size_t channel)
+{
+    if (frame < kPrimingFrames || frame >= kPrimingFrames + kFrames)
+        return 0;
+    const double t = static_cast<double>(frame - kPrimingFrames) / 44100.0;
+    const double phase = 2.0 * 3.14159265358979 * (220.0 + 110.0 * static_cast<double>(channel)) * t;
+    return static_cast<int>(std::lround(20000.0 * std::sin(phase + 0.3 * std::sin(3.0 * t))));
+}
+
+void appendBE(std::vector<unsigned char>& bytes, std::uint64_t value, int size)
+{
+    for (int i = size - 1; i >= 0; --i)
+        bytes.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+/// Writes a CAF file of IMA4 packets with a 'pakt' chunk and returns the
+/// encoder's own reconstruction of the valid frames, one vector per
+/// channel: what any correct decoder must output.
+std::vector<std::vector<float>> writeIma4Caf(const std::string& path)
+{
+    const std::int64_t packets = (kFrames + kPrimingFrames + kFramesPerPacket - 1) / kFramesPerPacket;
+    const std::int64_t total = packets * static_cast<std::int64_t>(kFramesPerPacket);
+    std::vector<std::vector<float>> decoded(kChannels, std::vector<float>(static_cast<std::size_t>(total)));
+    std::vector<int> carried(kChannels, 0);
+    std::vector<int> carriedIndex(kChannels, 0);
+    std::vector<unsigned char> data;
+    for (std::int64_t p = 0; p < packets; ++p) {
+        for (std::size_t c = 0; c < kChannels; ++c) {
+            // The header keeps the top 9 bits of the predictor.
+            int predictor = static_cast<std::int16_t>(carried[c] & 0xFF80);
+            int index = carriedIndex[c];
+            appendBE(data, static_cast<std::uint16_t>((predictor & 0xFF80) | index), 2);
+            unsigned char codes[kFramesPerPacket / 2] = {};
+            for (std::size_t i = 0; i < kFramesPerPacket; ++i) {
+                const std::int64_t frame = p * static_cast<std::int64_t>(kFramesPerPacket)
+                                           + static_cast<std::int64_t>(i);
+                const int sample = toneSample(frame, c);
+                const int step = kStepTable[index];
+                int difference = sample - predictor;
+                int code = 0;
+                if (difference < 0) {
+                    code = 8;
+                    difference = -difference;
+                }
+                int delta = step >> 3;
+                if (difference >= step) {
+                    code |= 4;
+                    difference -= step;
+                    delta += step;
+                }
+                if (difference >= step >> 1) {
+                    code |= 2;
+                    difference -= step >> 1;
+                    delta += step >> 1;
+                }
+                if (difference >= step >> 2) {
+                    code |= 1;
+                    delta += step >> 2;
+                }
+                predictor = std::clamp(code & 8 ? predictor - delta : predictor + delta, -32768, 32767);
+                index = std::clamp(index + kIndexTable[code], 0, 88);
+                codes[i / 2] |= static_cast<unsigned char>(code << (4 * (i & 1)));
+                decoded[c][static_cast<std::size_t>(frame)] = static_cast<float>(predictor) / 32768.0f;
+            }
+            data.insert(data.end(), codes, codes + sizeof(codes));
+            carried[c] = predictor;
+            carriedIndex[c] = index;
+        }
+    }
+
+    std::vector<unsigned char> file = {'c', 'a', 'f', 'f', 0, 1, 0, 0};
+    file.insert(file.end(), {'d', 'e', 's', 'c'});
+    appendBE(file, 32, 8);
+    const double sampleRate = 44100.0;
+    std::uint64_t rateBits = 0;
+    std::memcpy(&rateBits, &sampleRate, sizeof(rateBits));
+    appendBE(file, rateBits, 8);
+    file.insert(file.end(), {'i', 'm', 'a', '4'});
+    appendBE(file, 0, 4);
+    appendBE(file, 34 * kChannels, 4);
+    appendBE(file, kFramesPerPacket, 4);
+    appendBE(file, kChannels, 4);
+    appendBE(file, 0, 4);
+    file.insert(file.end(), {'p', 'a', 'k', 't'});
+    appendBE(file, 24, 8);
+    appendBE(file, static_cast<std::uint64_t>(packets), 8);
+    appendBE(file, static_cast<std::uint64_t>(kFrames), 8);
+    appendBE(file, static_cast<std::uint64_t>(kPrimingFrames), 4);
+    appendBE(file, static_cast<std::uint64_t>(total - kFrames - kPrimingFrames), 4);
+    file.insert(file.end(), {'d', 'a', 't', 'a'});
+    appendBE(file, data.size() + 4, 8);
+    appendBE(file, 0, 4);
+    file.insert(file.end(), data.begin(), data.end());
+
+    std::FILE* stream = std::fopen(path.c_str(), "wb");
+    if (!stream || std::fwrite(file.data(), 1, file.size(), stream) != file.size() || std::fclose(stream) != 0)
+        throw std::runtime_error("cannot write " + path);
+
+    for (std::vector<float>& channel : decoded) {
+        channel.erase(channel.begin(), channel.begin() + kPrimingFrames);
+        channel.resize(static_cast<std::size_t>(kFrames));
+    }
+    return decoded;
+}
+
+/// Every frame of `reader`, one vector per channel.
+std::vector<std::vector<float>> readAll(AudioReader& reader)
+{
+    const std::size_t channels = reader.format().channelCount;
+    std::vector<std::vector<float>> samples(channels);
+    FloatBuffers block(channels, 3000);
+    while (const std::size_t read = reader.readFrames(block.data(), 3000))
+        for (std::size_t c = 0; c < channels; ++c)
+            samples[c].insert(samples[c].end(), block.channel(c), block.channel(c) + read);
+    return samples;
+}
+
+bool identical(const std::vector<std::vector<float>>& a, const std::vector<std::vector<float>>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t c = 0; c < a.size(); ++c)
+        if (a[c].size() != b[c].size() || std::memcmp(a[c].data(), b[c].data(), a[c].size() * sizeof(float)) != 0)
+            return false;
+    return true;
+}
+
+/// A codec whose output depends on the last `memory` packets, as an AAC
+/// frame depends on the one before it through the overlapped transform.
+/// Reports `preRoll` packets of pre-roll. With `shortPacket` set, that
+/// packet, counted from the first this decoder sees, decodes one frame short.
+class MemoryDecoder : public PacketDecoder {
+public:
+    MemoryDecoder(std::size_t channelCount, std::size_t memory, std::size_t preRoll, std::size_t shortPacket)
+        : channelCount_(channelCount)
+        , history_(memory, 0.0f)
+        , preRoll_(preRoll)
+        , shortPacket_(shortPacket)
+    {
+    }
+
+    std::size_t preRollPackets() const override { return preRoll_; }
+
+    std::size_t decodePacket(const unsigned char* packet, std::size_t, float* output) override
+    {
+        std::rotate(history_.begin(), history_.begin() + 1, history_.end());
+        history_.back() = static_cast<float>(packet[0] * 256 + packet[1]);
+        float sum = 0.0f;
+        for (const float value : history_)
+            sum += value;
+        for (std::size_t i = 0; i < kFramesPerPacket * channelCount_; ++i)
+            output[i] = sum + static_cast<float>(i);
+        return decoded_++ == shortPacket_ ? kFramesPerPacket - 1 : kFramesPerPacket;
+    }
+
+private:
+    std::size_t channelCount_;
+    std::vector<float> history_;
+    std::size_t preRoll_;
+    std::size_t shortPacket_;
+    std::size_t decoded_ = 0;
+};
+
+ParallelDecodeOptions chunked(std::size_t chunkFrames, std::size_t threads)
+{
+    ParallelDecodeOptions options;
+    options.chunkFrames = chunkFrames;
+    options.threadCount = threads;
+    return options;
+}
+
+void checkIma4(Checks& checks, const std::vector<std::vector<float>>& expected)
+{
+    for (const std::size_t chunkFrames : {std::size_t(64), std::size_t(1000), std::size_t(1) << 20}) {
+        for (const std::size_t threads : {std::size_t(1), std::size_t(3)}) {
+            ParallelDecodeReader reader(kPath, chunked(chunkFrames, threads));
+            const std::string setup = " with " + std::to_string(chunkFrames) + "-frame chunks on "
+                                      + std::to_string(threads) + " threads";
+            checks.expect(reader.frameCount() == kFrames, "frame count" + setup);
+            checks.expect(identical(readAll(reader), expected), "IMA4 decode is bit-exact" + setup);
+
+            // Random seeks land on the same samples.
+            std::mt19937 random(7);
+            FloatBuffers block(kChannels, 500);
+            bool seeksMatch = true;
+            for (int i = 0; i < 50; ++i) {
+                const auto frame = static_cast<std::int64_t>(random() % kFrames);
+                reader.seekToFrame(frame);
+                const std::size_t read = reader.readFrames(block.data(), 500);
+                const std::size_t wanted = static_cast<std::size_t>(std::min<std::int64_t>(500, kFrames - frame));
+                seeksMatch = seeksMatch && read == wanted;
+                for (std::size_t c = 0; c < kChannels && read == wanted; ++c) {
+                    const float* want = expected[c].data() + frame;
+                    seeksMatch = seeksMatch && std::memcmp(block.channel(c), want, read * sizeof(float)) == 0;
+                }
+            }
+            checks.expect(seeksMatch, "IMA4 samples after seeks" + setup);
+        }
+    }
+}
+
+void checkPreRoll(Checks& checks)
+{
+    const std::size_t memory = 3;
+    const auto factory = [memory](std::size_t preRoll) {
+        return [memory, preRoll](const PacketTable& table) -> std::unique_ptr<PacketDecoder> {
+            return std::make_unique<MemoryDecoder>(table.channelCount, memory, preRoll, SIZE_MAX);
+        };
+    };
+    ParallelDecodeOptions sequential = chunked(std::size_t(1) << 30, 1);
+    sequential.decoderFactory = factory(memory - 1);
+    ParallelDecodeReader whole(kPath, sequential);
+    const std::vector<std::vector<float>> expected = readAll(whole);
+
+    for (const std::size_t chunkFrames : {std::size_t(64), std::size_t(640), std::size_t(10000)}) {
+        ParallelDecodeOptions options = chunked(chunkFrames, 3);
+        options.decoderFactory = factory(memory - 1);
+        ParallelDecodeReader reader(kPath, options);
+        checks.expect(identical(readAll(reader), expected),
+                      "pre-roll matches a sequential decode with " + std::to_string(chunkFrames) + "-frame chunks");
+    }
+
+    // Without enough pre-roll the chunk starts differ, so the check above
+    // would notice a reader that skipped it.
+    ParallelDecodeOptions options = chunked(640, 3);
+    options.decoderFactory = factory(memory - 2);
+    ParallelDecodeReader reader(kPath, options);
+    checks.expect(!identical(readAll(reader), expected), "short pre-roll is detected");
+}
+
+void checkShortPackets(Checks& checks)
+{
+    const PacketTable table = PacketTable::readCaf(MappedFile(kPath));
+    const auto shortAt = [](std::size_t packet) {
+        return [packet](const PacketTable& caf) -> std::unique_ptr<PacketDecoder> {
+            return std::make_unique<MemoryDecoder>(caf.channelCount, 1, 0, packet);
+        };
+    };
+
+    ParallelDecodeOptions options = chunked(std::size_t(1) << 30, 1);
+    options.decoderFactory = shortAt(5);
+    ParallelDecodeReader reader(kPath, options);
+    bool threw = false;
+    try {
+        readAll(reader);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    checks.expect(threw, "a short packet before the last is an error");
+
+    // The last packet may be short; its padding is trimmed anyway.
+    options.decoderFactory = shortAt(table.packetCount() - 1);
+    ParallelDecodeReader last(kPath, options);
+    threw = false;
+    try {
+        readAll(last);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    checks.expect(!threw, "a short last packet is accepted");
+}
+
+} // namespace
+
+int main()
+{
+    Checks checks("ParallelDecodeReaderTest");
+    try {
+        const std::vector<std::vector<float>> expected = writeIma4Caf(kPath);
+        checkIma4(checks, expected);
+        checkPreRoll(checks);
+        checkShortPackets(checks);
+    } catch (const std::exception& error) {
+        checks.expect(false, error.what());
+    }
+    std::remove(kPath);
+    return checks.report();
+}
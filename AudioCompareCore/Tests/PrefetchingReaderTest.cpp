@@ -0,0 +1,93 @@
+//
+//  PrefetchingReaderTest.cpp
+//  AudioCompareCore
+//
+//  Checks that PrefetchingReader returns exactly the frames of its source
+//  across random reads and seeks at several look-ahead depths, and that a
+//  source error surfaces after the frames before it and clears on seek.
+//
+
+#include "AudioUtilities.hpp"
+#include "PrefetchingReader.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace audiocompare;
+using namespace audiocompare::test;
+
+namespace {
+
+const std::size_t kChannels = 2;
+const std::int64_t kFrames = 200000;
+const std::size_t kMaxRead = 20000;
+
+void checkReadsAndSeeks(Checks& checks, std::size_t lookAhead)
+{
+    PatternReader source(kChannels, kFrames);
+    PatternReader reference(kChannels, kFrames);
+    PrefetchingReader reader(source, lookAhead, lookAhead > 3 ? lookAhead / 3 : 1);
+    FloatBuffers got(kChannels, kMaxRead);
+    FloatBuffers expected(kChannels, kMaxRead);
+    std::mt19937 random(3);
+    // Tiny rings hand over a few frames at a time, so they get short reads.
+    const std::size_t maxRead = std::min(kMaxRead, 16 * lookAhead) + 1;
+    const std::string depth = " at look-ahead " + std::to_string(lookAhead);
+    for (int step = 0; step < 300; ++step) {
+        if (random() % 4 == 0) {
+            const std::int64_t frame = static_cast<std::int64_t>(random() % (kFrames + 100));
+            reader.seekToFrame(frame);
+            reference.seekToFrame(frame);
+            checks.expect(reader.framePosition() == reference.framePosition(), "position after seek" + depth);
+        }
+        const std::size_t frames = random() % maxRead;
+        const std::size_t read = reader.readFrames(got.data(), frames);
+        const std::size_t wanted = reference.readFrames(expected.data(), frames);
+        checks.expect(read == wanted, "frames read" + depth);
+        checks.expect(reader.framePosition() == reference.framePosition(), "position after read" + depth);
+        for (std::size_t c = 0; c < kChannels && read == wanted; ++c)
+            checks.expect(std::memcmp(got.channel(c), expected.channel(c), read * sizeof(float)) == 0,
+                          "samples" + depth);
+    }
+}
+
+void checkErrors(Checks& checks)
+{
+    const std::int64_t failAt = 100000;
+    PatternReader source(kChannels, kFrames, failAt);
+    PrefetchingReader reader(source, 8192, 1000);
+    FloatBuffers block(kChannels, 4096);
+    for (int pass = 0; pass < 2; ++pass) {
+        std::int64_t total = 0;
+        bool threw = false;
+        try {
+            while (const std::size_t read = reader.readFrames(block.data(), 4096))
+                total += static_cast<std::int64_t>(read);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        checks.expect(threw, "source error rethrown");
+        checks.expect(total == failAt, "every frame before the error delivered");
+        reader.seekToFrame(0);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    Checks checks("PrefetchingReaderTest");
+    for (const std::size_t lookAhead : {std::size_t(1), std::size_t(100), std::size_t(4096), std::size_t(1) << 18})
+        checkReadsAndSeeks(checks, lookAhead);
+    checkErrors(checks);
+    {
+        // Destroying the reader while its thread is still decoding must
+        // neither hang nor crash.
+        PatternReader source(kChannels, kFrames);
+        PrefetchingReader reader(source, 1 << 16);
+    }
+    return checks.report();
+}
@@ -0,0 +1,91 @@
+//
+//  ResamplingReaderTest.cpp
+//  AudioCompareCore
+//
+//  Checks that ResamplingReader handles a model starting before the source:
+//  outputs whose filter reaches before source frame 0 must match resampling
+//  the same source with that much explicit silence prepended, across reads
+//  and seeks.
+//
+
+#include "AudioUtilities.hpp"
+#include "ResamplingReader.hpp"
+#include "TestSupport.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+using namespace audiocompare::test;
+
+namespace {
+
+const std::size_t kFrames = 100000;
+const std::size_t kPadding = 30000;
+const std::size_t kMaxRead = 10000;
+
+std::vector<float> noise()
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> uniform(-0.5f, 0.5f);
+    std::vector<float> samples(kFrames);
+    for (float& sample : samples)
+        sample = uniform(random);
+    return samples;
+}
+
+void checkAgainstPadded(Checks& checks, double start, double ratio)
+{
+    const std::vector<float> samples = noise();
+    std::vector<float> padded(kPadding, 0.0f);
+    padded.insert(padded.end(), samples.begin(), samples.end());
+    SignalReader source(samples);
+    SignalReader paddedSource(padded);
+    ResamplingReader reader(source, start, ratio);
+    ResamplingReader reference(paddedSource, start + static_cast<double>(kPadding), ratio);
+
+    const std::string model = " from start " + std::to_string(start);
+    checks.expect(reader.frameCount() == reference.frameCount(), "frame count" + model);
+
+    FloatBuffers got(1, kMaxRead);
+    FloatBuffers expected(1, kMaxRead);
+    std::mt19937 random(7);
+    for (int step = 0; step < 200; ++step) {
+        if (step > 0 && random() % 3 == 0) {
+            const std::int64_t frame = static_cast<std::int64_t>(random() % (kFrames + kPadding));
+            reader.seekToFrame(frame);
+            reference.seekToFrame(frame);
+        }
+        const std::size_t frames = random() % kMaxRead + 1;
+        const std::size_t read = reader.readFrames(got.data(), frames);
+        checks.expect(read == reference.readFrames(expected.data(), frames), "frames read" + model);
+        float error = 0.0f;
+        for (std::size_t i = 0; i < read; ++i)
+            error = std::max(error, std::fabs(got.channel(0)[i] - expected.channel(0)[i]));
+        checks.expect(error < 1e-5f, "samples" + model);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    Checks checks("ResamplingReaderTest");
+    {
+        // Every output of the first block lies before the source starts.
+        SignalReader source(noise());
+        ResamplingReader reader(source, -20000.0, 1.0001);
+        FloatBuffers block(1, 8192);
+        const std::size_t read = reader.readFrames(block.data(), 8192);
+        checks.expect(read == 8192, "block before the source is produced");
+        checks.expect(std::all_of(block.channel(0), block.channel(0) + read, [](float s) { return s == 0.0f; }),
+                      "block before the source is silent");
+    }
+    checkAgainstPadded(checks, -20000.0, 1.0001);
+    checkAgainstPadded(checks, -10.25, 0.9998);
+    checkAgainstPadded(checks, 3.5, 1.0);
+    return checks.report();
+}
@@ -0,0 +1,82 @@
+//
+//  SnapshotPublisherTest.cpp
+//  AudioCompareCore
+//
+//  Stress test of SnapshotPublisher: a writer publishes snapshots whose
+//  values all equal their sequence number while a reader checks that no
+//  snapshot it holds is torn and that sequences never go backwards. The
+//  ThreadSanitizer build of this harness checks the memory ordering.
+//
+
+#include "SnapshotPublisher.hpp"
+#include "TestSupport.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace audiocompare;
+using namespace audiocompare::test;
+
+namespace {
+
+const std::size_t kValues = 1000;
+const std::uint64_t kSnapshots = 200000;
+
+float valueFor(std::uint64_t sequence)
+{
+    return static_cast<float>(sequence % 100000);
+}
+
+} // namespace
+
+int main()
+{
+    Checks checks("SnapshotPublisherTest");
+    SnapshotPublisher publisher(kValues);
+    const SnapshotPublisher::Snapshot first = publisher.acquire();
+    checks.expect(first.sequence == 0 && first.values.size() == kValues, "empty snapshot before the first publish");
+
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        for (std::uint64_t sequence = 1; sequence <= kSnapshots; ++sequence) {
+            float* values = publisher.writeBuffer();
+            for (std::size_t i = 0; i < kValues; ++i)
+                values[i] = valueFor(sequence);
+            publisher.publish();
+        }
+        done = true;
+    });
+
+    std::uint64_t last = 0;
+    std::size_t torn = 0;
+    std::size_t backwards = 0;
+    for (;;) {
+        const bool finished = done.load();
+        const SnapshotPublisher::Snapshot snapshot = publisher.acquire();
+        backwards += snapshot.sequence < last;
+        last = snapshot.sequence;
+        if (snapshot.sequence > 0) {
+            for (const float value : snapshot.values) {
+                if (value != valueFor(snapshot.sequence)) {
+                    ++torn;
+                    break;
+                }
+            }
+        }
+        if (finished && last == kSnapshots)
+            break;
+    }
+    writer.join();
+    checks.expect(torn == 0, "no torn snapshots");
+    checks.expect(backwards == 0, "sequences never go backwards");
+    checks.expect(last == kSnapshots, "the last snapshot is seen");
+
+    // publish(values) copies into the write buffer.
+    SnapshotPublisher copying(3);
+    const float values[3] = {1.0f, 2.0f, 3.0f};
+    copying.publish(values);
+    const SnapshotPublisher::Snapshot copied = copying.acquire();
+    checks.expect(copied.sequence == 1 && copied.values[0] == 1.0f && copied.values[2] == 3.0f, "copying publish");
+    return checks.report();
+}
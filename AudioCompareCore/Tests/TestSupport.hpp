@@ -0,0 +1,130 @@
+//
+//  TestSupport.hpp
+//  AudioCompareCore
+//
+//  Shared pieces of the test harnesses. Each harness is a plain program
+//  that prints its failures and exits non-zero, so CTest needs no framework.
+//
+
+#pragma once
+
+#include "AudioReader.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace audiocompare {
+namespace test {
+
+/// Counts failed checks; `report` turns the count into an exit status.
+class Checks {
+public:
+    explicit Checks(std::string name)
+        : name_(std::move(name))
+    {
+    }
+
+    void expect(bool condition, const std::string& what)
+    {
+        if (condition)
+            return;
+        std::cerr << name_ << ": FAILED " << what << "\n";
+        ++failures_;
+    }
+
+    int report() const
+    {
+        if (failures_ == 0)
+            std::cout << name_ << ": passed\n";
+        return failures_ == 0 ? 0 : 1;
+    }
+
+private:
+    std::string name_;
+    std::size_t failures_ = 0;
+};
+
+/// Deterministic sample of `channel` at `frame`: a different value for
+/// every frame and channel, so misplaced or repeated frames show.
+inline float patternSample(std::int64_t frame, std::size_t channel)
+{
+    return static_cast<float>((frame * 7 + static_cast<std::int64_t>(channel) * 3) % 65521) / 65521.0f;
+}
+
+/// In-memory reader of `patternSample` frames. When `failAt` is reached,
+/// reads throw std::runtime_error, as a decoder does on a damaged packet.
+class PatternReader : public AudioReader {
+public:
+    PatternReader(std::size_t channelCount, std::int64_t frameCount, std::int64_t failAt = -1)
+        : channelCount_(channelCount)
+        , frameCount_(frameCount)
+        , failAt_(failAt)
+    {
+    }
+
+    AudioFormat format() const override { return {48000.0, channelCount_}; }
+    std::int64_t frameCount() const override { return frameCount_; }
+
+    std::size_t readFrames(float* const* buffers, std::size_t frames) override
+    {
+        if (failAt_ >= 0 && position_ >= failAt_)
+            throw std::runtime_error("damaged packet");
+        std::int64_t end = std::min(frameCount_, position_ + static_cast<std::int64_t>(frames));
+        if (failAt_ >= 0)
+            end = std::min(end, failAt_);
+        const auto count = static_cast<std::size_t>(std::max<std::int64_t>(0, end - position_));
+        for (std::size_t c = 0; c < channelCount_; ++c)
+            for (std::size_t i = 0; i < count; ++i)
+                buffers[c][i] = patternSample(position_ + static_cast<std::int64_t>(i), c);
+        position_ += static_cast<std::int64_t>(count);
+        return count;
+    }
+
+    void seekToFrame(std::int64_t frame) override { position_ = std::clamp<std::int64_t>(frame, 0, frameCount_); }
+    std::int64_t framePosition() const override { return position_; }
+
+private:
+    std::size_t channelCount_;
+    std::int64_t frameCount_;
+    std::int64_t failAt_;
+    std::int64_t position_ = 0;
+};
+
+/// In-memory mono reader of a fixed signal.
+class SignalReader : public AudioReader {
+public:
+    explicit SignalReader(std::vector<float> samples, double sampleRate = 48000.0)
+        : samples_(std::move(samples))
+        , sampleRate_(sampleRate)
+    {
+    }
+
+    AudioFormat format() const override { return {sampleRate_, 1}; }
+    std::int64_t frameCount() const override { return static_cast<std::int64_t>(samples_.size()); }
+
+    std::size_t readFrames(float* const* buffers, std::size_t frames) override
+    {
+        const std::size_t count = std::min(frames, samples_.size() - static_cast<std::size_t>(position_));
+        std::copy(samples_.begin() + position_, samples_.begin() + position_ + static_cast<std::int64_t>(count),
+                  buffers[0]);
+        position_ += static_cast<std::int64_t>(count);
+        return count;
+    }
+
+    void seekToFrame(std::int64_t frame) override { position_ = std::clamp<std::int64_t>(frame, 0, frameCount()); }
+    std::int64_t framePosition() const override { return position_; }
+
+private:
+    std::vector<float> samples_;
+    double sampleRate_;
+    std::int64_t position_ = 0;
+};
+
+} // namespace test
+} // namespace audiocompare
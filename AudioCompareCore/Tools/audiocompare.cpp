@@ -0,0 +1,242 @@
+//
+//  audiocompare.cpp
+//  AudioCompareCore
+//
+//  Headless comparison of two audio files.
+//
+
+#include "ComparisonPipeline.hpp"
+#include "ComparisonReport.hpp"
+#include "DeltaRenderer.hpp"
+#include "DifferenceIndex.hpp"
+#include "ParallelDecodeReader.hpp"
+#include "PrefetchingReader.hpp"
+#include "WaveFileWriter.hpp"
+#include "WriteBehindWriter.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace audiocompare;
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "usage: audiocompare [options] reference.wav candidate.wav\n"
+                 "  --block N       frames read per block (default 4096)\n"
+                 "  --fft N         spectral window size, power of two (default 2048)\n"
+                 "  --hop N         frames between spectral windows (default: half the window)\n"
+                 "  --window NAME   hann, blackman-harris, kaiser or kaiser:BETA (default hann)\n"
+                 "  --zero-pad N    transform N times the window length, power of two (default 1)\n"
+                 "  --no-spectral   skip the spectral metrics\n"
+                 "  --hash          hash blocks first and only analyze the differing ones\n"
+                 "  --hash-block N  frames per hashed block (default 65536)\n"
+                 "  --offset N      candidate offset in frames\n"
+                 "  --align         estimate the offset with GCC-PHAT before comparing\n"
+                 "  --max-offset S  alignment search range in seconds (default 60)\n"
+                 "  --pyramid N     align coarse-to-fine over N 2x decimation levels\n"
+                 "  --integer-lag   do not correct the sub-sample part of the offset\n"
+                 "  --drift         also estimate and compensate clock drift\n"
+                 "  --delta PATH    write reference - gain * candidate to a float WAVE file\n"
+                 "  --no-gain-match render the delta with unity gain\n"
+                 "  --index PATH    write a 10 ms / 1 s / 1 min difference index\n"
+                 "  --decoders N    decode threads per compressed CAF input (default: one per core)\n"
+                 "  --prefetch N    decode up to N frames of each input ahead on a background thread\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    ComparisonOptions options;
+    AlignmentOptions alignmentOptions;
+    PyramidOptions pyramidOptions;
+    bool align = false;
+    bool pyramid = false;
+    bool subsample = true;
+    bool drift = false;
+    bool hash = false;
+    std::size_t hashBlockFrames = 65536;
+    std::string deltaPath;
+    bool gainMatch = true;
+    std::string indexPath;
+    ParallelDecodeOptions decodeOptions;
+    std::size_t prefetchFrames = 0;
+    std::string windowName;
+    std::string paths[2];
+    int pathCount = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--block" && i + 1 < argc) {
+            options.blockSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--fft" && i + 1 < argc) {
+            options.fftSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--hop" && i + 1 < argc) {
+            options.hopSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--window" && i + 1 < argc) {
+            windowName = argv[++i];
+        } else if (arg == "--zero-pad" && i + 1 < argc) {
+            options.zeroPadding = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--no-spectral") {
+            options.spectral = false;
+        } else if (arg == "--hash") {
+            hash = true;
+        } else if (arg == "--hash-block" && i + 1 < argc) {
+            hash = true;
+            hashBlockFrames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--offset" && i + 1 < argc) {
+            options.candidateOffset = std::strtoll(argv[++i], nullptr, 10);
+        } else if (arg == "--align") {
+            align = true;
+        } else if (arg == "--pyramid" && i + 1 < argc) {
+            align = true;
+            pyramid = true;
+            pyramidOptions.levels = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--drift") {
+            align = true;
+            drift = true;
+        } else if (arg == "--delta" && i + 1 < argc) {
+            deltaPath = argv[++i];
+        } else if (arg == "--index" && i + 1 < argc) {
+            indexPath = argv[++i];
+        } else if (arg == "--no-gain-match") {
+            gainMatch = false;
+        } else if (arg == "--integer-lag") {
+            subsample = false;
+        } else if (arg == "--decoders" && i + 1 < argc) {
+            decodeOptions.threadCount = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--prefetch" && i + 1 < argc) {
+            prefetchFrames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--max-offset" && i + 1 < argc) {
+            alignmentOptions.maxOffsetSeconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (pathCount < 2 && arg.compare(0, 2, "--") != 0) {
+            paths[pathCount++] = arg;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (pathCount != 2) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        if (!windowName.empty())
+            options.window = parseFftWindow(windowName);
+        const std::unique_ptr<AudioReader> referenceFile = openAudioFile(paths[0], decodeOptions);
+        const std::unique_ptr<AudioReader> candidateFile = openAudioFile(paths[1], decodeOptions);
+        std::unique_ptr<PrefetchingReader> referencePrefetch;
+        std::unique_ptr<PrefetchingReader> candidatePrefetch;
+        if (prefetchFrames > 0) {
+            referencePrefetch = std::make_unique<PrefetchingReader>(*referenceFile, prefetchFrames);
+            candidatePrefetch = std::make_unique<PrefetchingReader>(*candidateFile, prefetchFrames);
+        }
+        AudioReader& reference = referencePrefetch ? *referencePrefetch : *referenceFile;
+        AudioReader& candidateSource = candidatePrefetch ? *candidatePrefetch : *candidateFile;
+        PipelineOptions pipelineOptions;
+        pipelineOptions.comparison = options;
+        pipelineOptions.alignment = alignmentOptions;
+        pipelineOptions.pyramid = pyramidOptions;
+        pipelineOptions.align = align;
+        pipelineOptions.usePyramid = pyramid;
+        pipelineOptions.subsample = subsample;
+        pipelineOptions.drift = drift;
+        pipelineOptions.hash = hash;
+        pipelineOptions.hashBlockFrames = hashBlockFrames;
+        ComparisonPipeline pipeline(reference, candidateSource, pipelineOptions);
+        pipeline.align();
+
+        if (const auto& alignment = pipeline.pyramidAlignment()) {
+            std::cout << "alignment read    " << alignment->readSeconds << " s\n";
+            for (const PyramidLevelReport& level : alignment->levels)
+                std::cout << "  level " << level.level << " @ " << level.sampleRate << " Hz: offset "
+                          << level.offset << ", decimate " << level.decimationSeconds << " s, search "
+                          << level.searchSeconds << " s\n";
+        } else if (const auto& alignment = pipeline.alignment()) {
+            std::cout << "alignment peak    " << alignment->peak.value << " (sidelobe ratio "
+                      << alignment->peak.sidelobeRatio << ")\n";
+        }
+        if (const auto& estimate = pipeline.driftEstimate()) {
+            std::cout << "clock drift       " << estimate->ppm() << " ppm (residual "
+                      << estimate->residualRms << " frames)\n";
+            for (const DriftSegment& segment : estimate->segments)
+                std::cout << "  at frame " << segment.referenceFrame << ": offset " << segment.offset << "\n";
+        } else if (&pipeline.candidate() != &candidateSource) {
+            std::cout << "fractional offset " << pipeline.fractionalOffset() << " frames\n";
+        }
+        AudioReader& candidate = pipeline.candidate();
+
+        // Hash-matched blocks are written as silence, which only holds at unity gain.
+        std::unique_ptr<WaveFileWriter> deltaFile;
+        std::unique_ptr<WriteBehindWriter> deltaWriter;
+        std::unique_ptr<DeltaRenderer> delta;
+        if (!deltaPath.empty()) {
+            const double gain = gainMatch && !hash
+                                    ? estimateMatchingGain(reference, candidate, pipeline.candidateOffset())
+                                    : 1.0;
+            std::cout << "delta gain        " << 20.0 * std::log10(std::fabs(gain)) << " dB\n";
+            deltaFile = std::make_unique<WaveFileWriter>(deltaPath, reference.format());
+            deltaWriter = std::make_unique<WriteBehindWriter>(*deltaFile);
+            delta = std::make_unique<DeltaRenderer>(*deltaWriter, reference.format().channelCount,
+                                                    static_cast<float>(gain));
+        }
+
+        std::unique_ptr<DifferenceIndexBuilder> index;
+        if (!indexPath.empty())
+            index = std::make_unique<DifferenceIndexBuilder>(reference.format());
+        CompositeObserver observers;
+        observers.add(delta.get());
+        observers.add(index.get());
+        ComparisonObserver* observer = observers.empty() ? nullptr : &observers;
+
+        const ComparisonResult result = pipeline.compare(observer);
+        if (const auto& summary = pipeline.hashSummary())
+            std::cout << "hashed blocks     " << summary->blocks << " (" << summary->differingBlocks
+                      << " differ in " << summary->differingRanges.size() << " ranges)\n";
+        if (delta) {
+            delta->padTo(result.comparedFrames + result.hashMatchedFrames);
+            deltaWriter->flush();
+            deltaFile->close();
+            std::cout << "delta written     " << delta->framesWritten() << " frames to " << deltaPath;
+            if (deltaWriter->overflowChunks() > 0)
+                std::cout << " (" << deltaWriter->overflowChunks() << " extra buffers while the disk caught up";
+            if (deltaWriter->stalls() > 0)
+                std::cout << (deltaWriter->overflowChunks() > 0 ? ", " : " (") << deltaWriter->stalls()
+                          << " waits for the disk";
+            if (deltaWriter->overflowChunks() > 0 || deltaWriter->stalls() > 0)
+                std::cout << ")";
+            std::cout << "\n";
+        }
+        if (index) {
+            const DifferenceIndex built = index->finish(result.comparedFrames + result.hashMatchedFrames,
+                                                        result.referenceStart);
+            built.write(indexPath);
+            const double rate = built.sampleRate();
+            std::cout << "difference index  " << indexPath << "\n";
+            for (const DifferenceRegion& region : built.worstRegions(5, DifferenceMetric::Residual))
+                std::cout << "  worst at " << static_cast<double>(region.startFrame) / rate << " s: residual "
+                          << 10.0 * std::log10(region.value) << " dBFS, peak at "
+                          << static_cast<double>(region.peakFrame) / rate << " s\n";
+        }
+        if (referencePrefetch)
+            std::cout << "prefetch stalls   " << referencePrefetch->stalls() << " / " << candidatePrefetch->stalls()
+                      << " (" << referencePrefetch->stallSeconds() + candidatePrefetch->stallSeconds()
+                      << " s waiting)\n";
+        writeReport(std::cout, result);
+        return result.identical() ? 0 : 1;
+    } catch (const std::exception& error) {
+        std::cerr << "audiocompare: " << error.what() << "\n";
+        return 2;
+    }
+}
@@ -0,0 +1,261 @@
+//
+//  audiocomparebatch.cpp
+//  AudioCompareCore
+//
+//  Compares every reference/candidate pair listed in a manifest, in parallel.
+//
+
+#include "ComparisonPipeline.hpp"
+#include "ParallelDecodeReader.hpp"
+#include "ThreadPool.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "usage: audiocomparebatch [options] pairs.txt\n"
+                 "  Each manifest line holds a reference and a candidate path separated by a\n"
+                 "  tab (or whitespace); blank lines and lines starting with # are skipped.\n"
+                 "  --threads N     worker threads (default: one per hardware thread)\n"
+                 "  --decoders N    decode threads per compressed CAF input (default 1)\n"
+                 "  --output PATH   write the results table to PATH instead of stdout\n"
+                 "  --fft N         spectral window size, power of two (default 2048)\n"
+                 "  --hop N         frames between spectral windows (default: half the window)\n"
+                 "  --window NAME   hann, blackman-harris, kaiser or kaiser:BETA (default hann)\n"
+                 "  --zero-pad N    transform N times the window length, power of two (default 1)\n"
+                 "  --no-spectral   skip the spectral metrics\n"
+                 "  --align         estimate each offset with GCC-PHAT before comparing\n"
+                 "  --max-offset S  alignment search range in seconds (default 60)\n"
+                 "  --pyramid N     align coarse-to-fine over N 2x decimation levels\n"
+                 "  --drift         also estimate and compensate clock drift\n"
+                 "  --hash          hash blocks first and only analyze the differing ones\n";
+}
+
+struct Pair {
+    std::string reference;
+    std::string candidate;
+};
+
+std::vector<Pair> readManifest(const std::string& path)
+{
+    std::ifstream stream(path);
+    if (!stream)
+        throw std::runtime_error("cannot open " + path);
+    std::vector<Pair> pairs;
+    std::string line;
+    for (std::size_t number = 1; std::getline(stream, line); ++number) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+        Pair pair;
+        const std::size_t tab = line.find('\t');
+        if (tab != std::string::npos) {
+            pair.reference = line.substr(0, tab);
+            pair.candidate = line.substr(tab + 1);
+        } else {
+            std::istringstream fields(line);
+            fields >> pair.reference >> pair.candidate;
+        }
+        if (pair.reference.empty() || pair.candidate.empty())
+            throw std::runtime_error(path + ":" + std::to_string(number) + ": expected two paths");
+        pairs.push_back(pair);
+    }
+    return pairs;
+}
+
+enum class Status { Pending, Identical, Differ, Error };
+
+const char* statusName(Status status)
+{
+    switch (status) {
+    case Status::Identical:
+        return "identical";
+    case Status::Differ:
+        return "differ";
+    case Status::Error:
+        return "error";
+    default:
+        return "pending";
+    }
+}
+
+/// State of one pair between its align and compare tasks.
+struct PairJob {
+    const Pair* pair = nullptr;
+    std::unique_ptr<AudioReader> reference;
+    std::unique_ptr<AudioReader> candidate;
+    std::unique_ptr<ComparisonPipeline> pipeline;
+    std::chrono::steady_clock::time_point started;
+
+    Status status = Status::Pending;
+    ComparisonResult result;
+    double fractionalOffset = 0.0;
+    double seconds = 0.0;
+    std::string message;
+
+    void fail(const std::exception& error)
+    {
+        status = Status::Error;
+        message = error.what();
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        pipeline.reset();
+        reference.reset();
+        candidate.reset();
+    }
+};
+
+void writeResults(std::ostream& stream, const std::vector<PairJob>& jobs)
+{
+    stream << "status\treference\tcandidate\toffset\tcompared_frames\tnull_depth_db\tpeak_difference"
+              "\tmean_lsd_db\tseconds\tmessage\n";
+    stream << std::fixed;
+    for (const PairJob& job : jobs) {
+        stream << statusName(job.status) << '\t' << job.pair->reference << '\t' << job.pair->candidate << '\t'
+               << std::setprecision(3) << job.fractionalOffset << '\t' << job.result.comparedFrames << '\t'
+               << job.result.overall.nullDepthDb() << '\t' << std::setprecision(9)
+               << job.result.overall.peakDifference << '\t' << std::setprecision(3)
+               << job.result.spectral.meanLogSpectralDistance() << '\t' << job.seconds << '\t' << job.message
+               << '\n';
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    PipelineOptions options;
+    std::size_t threads = 0;
+    // Pairs already run in parallel, so each compressed input gets one
+    // decode thread unless asked otherwise.
+    ParallelDecodeOptions decodeOptions;
+    decodeOptions.threadCount = 1;
+    std::string manifestPath;
+    std::string outputPath;
+    std::string windowName;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--decoders" && i + 1 < argc) {
+            decodeOptions.threadCount = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--fft" && i + 1 < argc) {
+            options.comparison.fftSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--hop" && i + 1 < argc) {
+            options.comparison.hopSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--window" && i + 1 < argc) {
+            windowName = argv[++i];
+        } else if (arg == "--zero-pad" && i + 1 < argc) {
+            options.comparison.zeroPadding = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--no-spectral") {
+            options.comparison.spectral = false;
+        } else if (arg == "--align") {
+            options.align = true;
+        } else if (arg == "--max-offset" && i + 1 < argc) {
+            options.alignment.maxOffsetSeconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--pyramid" && i + 1 < argc) {
+            options.usePyramid = true;
+            options.pyramid.levels = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--drift") {
+            options.drift = true;
+        } else if (arg == "--hash") {
+            options.hash = true;
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (manifestPath.empty() && arg.compare(0, 2, "--") != 0) {
+            manifestPath = arg;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (manifestPath.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        if (!windowName.empty())
+            options.comparison.window = parseFftWindow(windowName);
+        const std::vector<Pair> pairs = readManifest(manifestPath);
+        std::vector<PairJob> jobs(pairs.size());
+        const auto start = std::chrono::steady_clock::now();
+        ThreadPool pool(threads);
+
+        // Two tasks per pair: opening and aligning, then comparing. The
+        // compare task lands on the same worker's deque and normally runs
+        // next while the pair's pages are still cached.
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            PairJob& job = jobs[i];
+            job.pair = &pairs[i];
+            pool.submit([&job, &pool, &decodeOptions, options] {
+                job.started = std::chrono::steady_clock::now();
+                try {
+                    job.reference = openAudioFile(job.pair->reference, decodeOptions);
+                    job.candidate = openAudioFile(job.pair->candidate, decodeOptions);
+                    job.pipeline = std::make_unique<ComparisonPipeline>(*job.reference, *job.candidate, options);
+                    job.pipeline->align();
+                } catch (const std::exception& error) {
+                    job.fail(error);
+                    return;
+                }
+                pool.submit([&job] {
+                    try {
+                        job.result = job.pipeline->compare();
+                        job.fractionalOffset = job.pipeline->fractionalOffset();
+                        job.status = job.result.identical() ? Status::Identical : Status::Differ;
+                        job.pipeline.reset();
+                        job.reference.reset();
+                        job.candidate.reset();
+                    } catch (const std::exception& error) {
+                        job.fail(error);
+                    }
+                    job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.started).count();
+                });
+            });
+        }
+        pool.wait();
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (outputPath.empty()) {
+            writeResults(std::cout, jobs);
+        } else {
+            std::ofstream output(outputPath);
+            writeResults(output, jobs);
+            if (!output)
+                throw std::runtime_error(outputPath + ": write failed");
+        }
+
+        std::size_t counts[4] = {};
+        for (const PairJob& job : jobs)
+            ++counts[static_cast<int>(job.status)];
+        std::cerr << pairs.size() << " pairs in " << std::setprecision(3) << elapsed << " s on "
+                  << pool.threadCount() << " threads (" << pool.steals() << " steals): "
+                  << counts[static_cast<int>(Status::Identical)] << " identical, "
+                  << counts[static_cast<int>(Status::Differ)] << " differ, "
+                  << counts[static_cast<int>(Status::Error)] << " errors\n";
+        if (counts[static_cast<int>(Status::Error)] > 0)
+            return 2;
+        return counts[static_cast<int>(Status::Differ)] > 0 ? 1 : 0;
+    } catch (const std::exception& error) {
+        std::cerr << "audiocomparebatch: " << error.what() << "\n";
+        return 2;
+    }
+}
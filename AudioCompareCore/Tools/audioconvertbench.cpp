@@ -0,0 +1,247 @@
+//
+//  audioconvertbench.cpp
+//  AudioCompareCore
+//
+//  Times the sample conversion and (de)interleave kernels against plain
+//  scalar loops and checks that both produce the same bits.
+//
+
+#include "AudioUtilities.hpp"
+#include "SampleConversion.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "usage: audioconvertbench [options]\n"
+                 "  --frames N      frames per pass (default 1048576)\n"
+                 "  --passes N      timed passes per kernel, best one reported (default 10)\n";
+}
+
+double bestSeconds(std::size_t passes, const std::function<void()>& work)
+{
+    double best = 0.0;
+    for (std::size_t p = 0; p < passes; ++p) {
+        const auto start = std::chrono::steady_clock::now();
+        work();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (p == 0 || seconds < best)
+            best = seconds;
+    }
+    return best;
+}
+
+std::uint64_t readBits(const unsigned char* p, std::size_t bytes, ByteOrder order)
+{
+    std::uint64_t value = 0;
+    for (std::size_t b = 0; b < bytes; ++b) {
+        const std::size_t shift = order == ByteOrder::LittleEndian ? b : bytes - 1 - b;
+        value |= static_cast<std::uint64_t>(p[b]) << (8 * shift);
+    }
+    return value;
+}
+
+std::int32_t readInteger(const unsigned char* p, std::size_t bytes, ByteOrder order)
+{
+    // Sign-extend from the top of the sample.
+    const auto value = static_cast<std::uint32_t>(readBits(p, bytes, order));
+    return static_cast<std::int32_t>(value << (32 - 8 * bytes)) >> (32 - 8 * bytes);
+}
+
+template <std::size_t Bytes>
+void referenceInteger(const unsigned char* source, ByteOrder order, std::size_t count, float scale, float* output)
+{
+    for (std::size_t i = 0; i < count; ++i)
+        output[i] = static_cast<float>(readInteger(source + Bytes * i, Bytes, order)) * scale;
+}
+
+// The plain loops the kernels replace, one per format, so the speedup is
+// the kernel's and not the cost of choosing a format per sample.
+void referenceConvert(const unsigned char* source, SampleFormat format, ByteOrder order, std::size_t count,
+                      float* output)
+{
+    switch (format) {
+    case SampleFormat::UInt8:
+        for (std::size_t i = 0; i < count; ++i)
+            output[i] = (static_cast<float>(source[i]) - 128.0f) * (1.0f / 128.0f);
+        break;
+    case SampleFormat::Int8:
+        for (std::size_t i = 0; i < count; ++i)
+            output[i] = static_cast<float>(static_cast<signed char>(source[i])) * (1.0f / 128.0f);
+        break;
+    case SampleFormat::Int16:
+        referenceInteger<2>(source, order, count, 1.0f / 32768.0f, output);
+        break;
+    case SampleFormat::Int24:
+        referenceInteger<3>(source, order, count, 1.0f / 8388608.0f, output);
+        break;
+    case SampleFormat::Int32:
+        referenceInteger<4>(source, order, count, 1.0f / 2147483648.0f, output);
+        break;
+    case SampleFormat::Float32:
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto bits = static_cast<std::uint32_t>(readBits(source + 4 * i, 4, order));
+            std::memcpy(&output[i], &bits, sizeof(float));
+        }
+        break;
+    case SampleFormat::Float64:
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint64_t bits = readBits(source + 8 * i, 8, order);
+            double value;
+            std::memcpy(&value, &bits, sizeof(double));
+            output[i] = static_cast<float>(value);
+        }
+        break;
+    }
+}
+
+const char* formatName(SampleFormat format)
+{
+    switch (format) {
+    case SampleFormat::UInt8: return "uint8";
+    case SampleFormat::Int8: return "int8";
+    case SampleFormat::Int16: return "int16";
+    case SampleFormat::Int24: return "int24";
+    case SampleFormat::Int32: return "int32";
+    case SampleFormat::Float32: return "float32";
+    case SampleFormat::Float64: return "float64";
+    }
+    return "?";
+}
+
+void printRow(const std::string& name, std::size_t samples, double kernel, double reference, bool exact)
+{
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(8) << static_cast<double>(samples) / kernel / 1e6 << " M/s" << std::setw(8)
+              << static_cast<double>(samples) / reference / 1e6 << " M/s" << std::setprecision(2) << std::setw(7)
+              << reference / kernel << "x" << (exact ? "" : "  MISMATCH") << "\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t frames = 1 << 20;
+    std::size_t passes = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--passes" && i + 1 < argc) {
+            passes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (frames == 0 || passes == 0) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        const std::size_t maxChannels = 8;
+        std::mt19937 random(20);
+        std::vector<unsigned char> bytes(frames * maxChannels * sizeof(double));
+        for (unsigned char& byte : bytes)
+            byte = static_cast<unsigned char>(random());
+        // Keep the float inputs finite so the comparison is not about NaN payloads.
+        std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+        std::vector<float> interleaved(frames * maxChannels);
+        for (float& value : interleaved)
+            value = sample(random);
+
+        bool exact = true;
+        std::cout << "kernel                  kernel       scalar  speedup\n";
+        std::vector<float> fast(frames * maxChannels);
+        std::vector<float> slow(frames * maxChannels);
+        const SampleFormat formats[] = {SampleFormat::UInt8, SampleFormat::Int8, SampleFormat::Int16,
+                                        SampleFormat::Int24, SampleFormat::Int32, SampleFormat::Float32,
+                                        SampleFormat::Float64};
+        for (const ByteOrder order : {ByteOrder::LittleEndian, ByteOrder::BigEndian}) {
+            for (const SampleFormat format : formats) {
+                std::vector<unsigned char> source = bytes;
+                if (format == SampleFormat::Float32 || format == SampleFormat::Float64) {
+                    const std::size_t size = bytesPerSample(format);
+                    for (std::size_t i = 0; i < frames * 2; ++i) {
+                        unsigned char* p = source.data() + i * size;
+                        if (format == SampleFormat::Float32) {
+                            std::memcpy(p, &interleaved[i], sizeof(float));
+                        } else {
+                            const double value = interleaved[i];
+                            std::memcpy(p, &value, sizeof(double));
+                        }
+                        if (order == ByteOrder::BigEndian)
+                            std::reverse(p, p + size);
+                    }
+                }
+                const std::size_t count = frames * 2;
+                const double kernel = bestSeconds(passes, [&] {
+                    convertToFloat(source.data(), format, order, count, fast.data());
+                });
+                const double reference = bestSeconds(passes, [&] {
+                    referenceConvert(source.data(), format, order, count, slow.data());
+                });
+                const bool same = std::memcmp(fast.data(), slow.data(), count * sizeof(float)) == 0;
+                exact = exact && same;
+                printRow(std::string(formatName(format)) + (order == ByteOrder::LittleEndian ? " le" : " be"),
+                         count, kernel, reference, same);
+            }
+        }
+
+        for (const std::size_t channels : {1, 2, 3, 4, 6, 8}) {
+            FloatBuffers planar(channels, frames);
+            FloatBuffers expected(channels, frames);
+            const double split = bestSeconds(passes, [&] {
+                deinterleave(interleaved.data(), channels, frames, planar.data());
+            });
+            const double splitReference = bestSeconds(passes, [&] {
+                for (std::size_t c = 0; c < channels; ++c)
+                    for (std::size_t i = 0; i < frames; ++i)
+                        expected.channel(c)[i] = interleaved[i * channels + c];
+            });
+            bool same = true;
+            for (std::size_t c = 0; c < channels; ++c)
+                same = same && std::memcmp(planar.channel(c), expected.channel(c), frames * sizeof(float)) == 0;
+            exact = exact && same;
+            printRow("deinterleave " + std::to_string(channels) + " ch", frames * channels, split, splitReference,
+                     same);
+
+            const double merge = bestSeconds(passes, [&] {
+                interleave(planar.data(), channels, frames, fast.data());
+            });
+            const double mergeReference = bestSeconds(passes, [&] {
+                for (std::size_t c = 0; c < channels; ++c)
+                    for (std::size_t i = 0; i < frames; ++i)
+                        slow[i * channels + c] = planar.channel(c)[i];
+            });
+            same = std::memcmp(fast.data(), slow.data(), frames * channels * sizeof(float)) == 0;
+            exact = exact && same;
+            printRow("interleave " + std::to_string(channels) + " ch", frames * channels, merge, mergeReference,
+                     same);
+        }
+        return exact ? 0 : 1;
+    } catch (const std::exception& error) {
+        std::cerr << "audioconvertbench: " << error.what() << "\n";
+        return 2;
+    }
+}
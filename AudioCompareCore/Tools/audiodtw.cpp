@@ -0,0 +1,142 @@
+//
+//  audiodtw.cpp
+//  AudioCompareCore
+//
+//  Aligns two performances with banded dynamic time warping.
+//
+
+#include "DtwAligner.hpp"
+#include "FeatureCache.hpp"
+#include "ParallelDecodeReader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace audiocompare;
+
+namespace {
+
+const double kWorstWindowSeconds = 1.0;
+
+void printUsage()
+{
+    std::cerr << "usage: audiodtw [options] reference.wav candidate.wav\n"
+                 "  --band S        Sakoe-Chiba half-width in seconds (default 5)\n"
+                 "  --path PATH     write the warping path as reference/candidate seconds and cost\n"
+                 "  --cache DIR     reuse frame features cached in DIR, adding those it lacks\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double bandSeconds = 5.0;
+    std::string pathOutput;
+    std::string cacheDirectory;
+    std::string paths[2];
+    int pathCount = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--band" && i + 1 < argc) {
+            bandSeconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--path" && i + 1 < argc) {
+            pathOutput = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else if (pathCount < 2 && arg.compare(0, 2, "--") != 0) {
+            paths[pathCount++] = arg;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (pathCount != 2) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        std::unique_ptr<FeatureCache> cache;
+        if (!cacheDirectory.empty())
+            cache = std::make_unique<FeatureCache>(cacheDirectory);
+        const auto loadFeatures = [&cache](const std::string& path) {
+            if (cache)
+                return cache->open(path).frameFeatures();
+            const std::unique_ptr<AudioReader> reader = openAudioFile(path);
+            return extractFrameFeatures(*reader);
+        };
+        const FrameFeatures referenceFeatures = loadFeatures(paths[0]);
+        const FrameFeatures candidateFeatures = loadFeatures(paths[1]);
+        const double frameSeconds = referenceFeatures.frameSeconds;
+        const std::vector<float> reference = dtwFeatures(referenceFeatures);
+        const std::vector<float> candidate = dtwFeatures(candidateFeatures);
+
+        const DtwAligner aligner(static_cast<std::size_t>(std::lround(bandSeconds / frameSeconds)));
+        const DtwResult result = aligner.align(reference.data(), referenceFeatures.frameCount, candidate.data(),
+                                               candidateFeatures.frameCount, kDtwDimension);
+
+        // Deviation from a constant tempo, and the worst-matching second.
+        const double ratio = static_cast<double>(candidateFeatures.frameCount)
+                             / static_cast<double>(referenceFeatures.frameCount);
+        double maxDeviation = 0.0;
+        std::size_t deviationAt = 0;
+        for (std::size_t p = 0; p < result.path.size(); ++p) {
+            const double deviation = std::fabs(result.path[p].candidate - ratio * result.path[p].reference);
+            if (deviation > maxDeviation) {
+                maxDeviation = deviation;
+                deviationAt = p;
+            }
+        }
+        const std::size_t window = std::min(
+            result.path.size(), std::max<std::size_t>(1, static_cast<std::size_t>(kWorstWindowSeconds / frameSeconds)));
+        double windowCost = 0.0;
+        for (std::size_t p = 0; p < window; ++p)
+            windowCost += result.path[p].cost;
+        double worstCost = windowCost;
+        std::size_t worstAt = 0;
+        for (std::size_t p = window; p < result.path.size(); ++p) {
+            windowCost += result.path[p].cost - result.path[p - window].cost;
+            if (windowCost > worstCost) {
+                worstCost = windowCost;
+                worstAt = p + 1 - window;
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "frames            " << referenceFeatures.frameCount << " / " << candidateFeatures.frameCount
+                  << " (" << frameSeconds * 1000.0 << " ms)\n";
+        std::cout << "band              " << result.bandFrames * frameSeconds << " s, " << result.cellCount
+                  << " cells\n";
+        std::cout << "mean path cost    " << result.meanCost() << "\n";
+        std::cout << "tempo ratio       " << ratio << "\n";
+        std::cout << "max deviation     " << maxDeviation * frameSeconds << " s at reference "
+                  << result.path[deviationAt].reference * frameSeconds << " s\n";
+        std::cout << "worst region      reference " << result.path[worstAt].reference * frameSeconds
+                  << " s, mean cost " << worstCost / static_cast<double>(window) << "\n";
+
+        if (!pathOutput.empty()) {
+            std::ofstream output(pathOutput);
+            output << "reference_s\tcandidate_s\tcost\n" << std::fixed << std::setprecision(3);
+            for (const DtwPathPoint& point : result.path)
+                output << point.reference * frameSeconds << '\t' << point.candidate * frameSeconds << '\t'
+                       << point.cost << '\n';
+            if (!output)
+                throw std::runtime_error(pathOutput + ": write failed");
+        }
+        return 0;
+    } catch (const std::exception& error) {
+        std::cerr << "audiodtw: " << error.what() << "\n";
+        return 2;
+    }
+}
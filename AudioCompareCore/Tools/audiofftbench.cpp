@@ -0,0 +1,239 @@
+//
+//  audiofftbench.cpp
+//  AudioCompareCore
+//
+//  Times every FFT backend available in this build and checks each one
+//  against a double-precision reference and, on Apple platforms, against
+//  vDSP. Then times a spectrogram both a frame at a time through
+//  `RollingFft` and a batch at a time through `BatchedStft`.
+//
+
+#include "BatchedStft.hpp"
+#include "FftPlan.hpp"
+#include "RollingFft.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+
+namespace {
+
+/// Largest deviation accepted, relative to the spectrum's peak magnitude.
+const double kTolerance = 1e-5;
+/// Spectrogram frames per STFT timing, at a hop of a quarter window.
+const std::size_t kStftFrames = 256;
+
+void printUsage()
+{
+    std::cerr << "usage: audiofftbench [options]\n"
+                 "  --min-size N    smallest transform, power of two (default 64)\n"
+                 "  --max-size N    largest transform, power of two (default 65536)\n"
+                 "  --passes N      timed passes per transform, best one reported (default 5)\n";
+}
+
+void referenceTransform(std::vector<std::complex<double>>& values)
+{
+    const std::size_t n = values.size();
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(values[i], values[j]);
+    }
+    for (std::size_t length = 2; length <= n; length <<= 1) {
+        const double angle = -2.0 * 3.14159265358979323846 / static_cast<double>(length);
+        for (std::size_t start = 0; start < n; start += length) {
+            for (std::size_t k = 0; k < length / 2; ++k) {
+                const std::complex<double> w = std::polar(1.0, angle * static_cast<double>(k));
+                const std::complex<double> t = w * values[start + k + length / 2];
+                values[start + k + length / 2] = values[start + k] - t;
+                values[start + k] += t;
+            }
+        }
+    }
+}
+
+double peakMagnitude(const std::vector<std::complex<double>>& spectrum)
+{
+    double peak = 0.0;
+    for (const std::complex<double>& value : spectrum)
+        peak = std::max(peak, std::abs(value));
+    return peak;
+}
+
+double spectrumError(const std::vector<std::complex<double>>& expected, const std::vector<float>& real,
+                     const std::vector<float>& imag)
+{
+    double worst = 0.0;
+    for (std::size_t k = 0; k < real.size(); ++k)
+        worst = std::max(worst, std::abs(expected[k] - std::complex<double>(real[k], imag[k])));
+    return worst / std::max(peakMagnitude(expected), 1e-30);
+}
+
+/// Seconds per call, from the fastest of `passes` runs of enough calls to
+/// last about a millisecond.
+template <typename Work>
+double secondsPerCall(std::size_t passes, std::size_t size, Work work)
+{
+    const std::size_t calls = std::max<std::size_t>(1, (1 << 18) / size);
+    double best = 0.0;
+    for (std::size_t p = 0; p < passes; ++p) {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t c = 0; c < calls; ++c)
+            work();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (p == 0 || seconds < best)
+            best = seconds;
+    }
+    return best / static_cast<double>(calls);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t minSize = 64;
+    std::size_t maxSize = 65536;
+    std::size_t passes = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--min-size" && i + 1 < argc) {
+            minSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--max-size" && i + 1 < argc) {
+            maxSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--passes" && i + 1 < argc) {
+            passes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage();
+            return 0;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (minSize < 4 || maxSize < minSize || passes == 0) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        std::vector<FftBackend> backends;
+        for (const FftBackend backend : {FftBackend::Radix2, FftBackend::SplitRadix, FftBackend::Accelerate})
+            if (isFftBackendAvailable(backend))
+                backends.push_back(backend);
+        const bool haveAccelerate = isFftBackendAvailable(FftBackend::Accelerate);
+
+        std::cout << "default backend " << fftBackendName(defaultFftBackend()) << "\n"
+                  << "   size  backend       forward      inverse  speedup   error  round trip  vs vDSP\n";
+        std::mt19937 random(22);
+        std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+        bool withinTolerance = true;
+        for (std::size_t size = minSize; size <= maxSize; size <<= 1) {
+            const std::unique_ptr<FftPlan> probe = FftPlan::create(size, FftBackend::Radix2);
+            const std::size_t bins = probe->binCount();
+            std::vector<float> input(size);
+            for (float& value : input)
+                value = sample(random);
+            std::vector<std::complex<double>> expected(input.begin(), input.end());
+            referenceTransform(expected);
+            expected.resize(bins);
+
+            std::vector<float> vdspReal(bins), vdspImag(bins);
+            if (haveAccelerate)
+                FftPlan::create(size, FftBackend::Accelerate)->forward(input.data(), vdspReal.data(), vdspImag.data());
+            std::vector<std::complex<double>> vdsp(bins);
+            for (std::size_t k = 0; k < bins; ++k)
+                vdsp[k] = std::complex<double>(vdspReal[k], vdspImag[k]);
+
+            double radix2Seconds = 0.0;
+            for (const FftBackend backend : backends) {
+                const std::unique_ptr<FftPlan> plan = FftPlan::create(size, backend);
+                std::vector<float> real(bins), imag(bins), output(size);
+                const double forward = secondsPerCall(passes, size, [&] {
+                    plan->forward(input.data(), real.data(), imag.data());
+                });
+                const double inverse = secondsPerCall(passes, size, [&] {
+                    plan->inverse(real.data(), imag.data(), output.data());
+                });
+                if (backend == FftBackend::Radix2)
+                    radix2Seconds = forward + inverse;
+
+                const double error = spectrumError(expected, real, imag);
+                double roundTrip = 0.0;
+                for (std::size_t i = 0; i < size; ++i)
+                    roundTrip = std::max(roundTrip, static_cast<double>(std::fabs(output[i] - input[i])));
+                const double againstVdsp = haveAccelerate ? spectrumError(vdsp, real, imag) : 0.0;
+                const bool ok = error <= kTolerance && roundTrip <= kTolerance && againstVdsp <= kTolerance;
+                withinTolerance = withinTolerance && ok;
+
+                std::cout << std::setw(7) << size << "  " << std::left << std::setw(11) << fftBackendName(backend)
+                          << std::right << std::fixed << std::setprecision(2) << std::setw(10) << forward * 1e6
+                          << " us" << std::setw(10) << inverse * 1e6 << " us" << std::setw(8)
+                          << radix2Seconds / (forward + inverse) << "x" << std::scientific << std::setprecision(1)
+                          << std::setw(9) << error << std::setw(12) << roundTrip;
+                if (haveAccelerate)
+                    std::cout << std::setw(9) << againstVdsp;
+                else
+                    std::cout << "        -";
+                std::cout << (ok ? "" : "  OUT OF TOLERANCE") << "\n";
+            }
+        }
+
+        std::cout << "\n   size  STFT frames   per frame      batched  speedup   error\n";
+        for (std::size_t size = minSize; size <= maxSize; size <<= 1) {
+            const std::size_t hop = size / 4;
+            std::vector<float> signal(size + (kStftFrames - 1) * hop);
+            for (float& value : signal)
+                value = sample(random);
+
+            RollingFft rolling(size);
+            std::vector<float> perFrame(kStftFrames * rolling.binCount());
+            const double rollingSeconds = secondsPerCall(passes, signal.size(), [&] {
+                rolling.reset();
+                rolling.appendSamples(signal.data(), size - hop);
+                for (std::size_t f = 0; f < kStftFrames; ++f) {
+                    const float* magnitudes = rolling.computeFFT(signal.data() + size - hop + f * hop, hop);
+                    std::copy(magnitudes, magnitudes + rolling.binCount(), perFrame.begin() + f * rolling.binCount());
+                }
+            });
+
+            const BatchedStft stft(size, hop);
+            std::vector<float> batched(kStftFrames * stft.binCount());
+            const double batchedSeconds = secondsPerCall(passes, signal.size(), [&] {
+                stft.process(signal.data(), kStftFrames, batched.data());
+            });
+
+            double peak = 0.0, worst = 0.0;
+            for (std::size_t i = 0; i < batched.size(); ++i) {
+                peak = std::max(peak, static_cast<double>(perFrame[i]));
+                worst = std::max(worst, static_cast<double>(std::fabs(batched[i] - perFrame[i])));
+            }
+            const double error = worst / std::max(peak, 1e-30);
+            const bool ok = error <= kTolerance;
+            withinTolerance = withinTolerance && ok;
+
+            std::cout << std::setw(7) << size << std::setw(13) << kStftFrames << std::fixed << std::setprecision(2)
+                      << std::setw(12) << rollingSeconds * 1e3 << " ms" << std::setw(10) << batchedSeconds * 1e3
+                      << " ms" << std::setw(8) << rollingSeconds / batchedSeconds << "x" << std::scientific
+                      << std::setprecision(1) << std::setw(9) << error << (ok ? "" : "  OUT OF TOLERANCE") << "\n";
+        }
+        return withinTolerance ? 0 : 1;
+    } catch (const std::exception& error) {
+        std::cerr << "audiofftbench: " << error.what() << "\n";
+        return 2;
+    }
+}
@@ -0,0 +1,169 @@
+//
+//  audiofingerprint.cpp
+//  AudioCompareCore
+//
+//  Builds landmark fingerprint indexes and identifies clips against them.
+//
+
+#include "FeatureCache.hpp"
+#include "FingerprintIndex.hpp"
+#include "ParallelDecodeReader.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "usage: audiofingerprint index [options] files.txt output.fpindex\n"
+                 "       audiofingerprint query [options] index.fpindex clip.wav\n"
+                 "  files.txt lists one audio file per line; lines starting with # are skipped.\n"
+                 "  --threads N     worker threads for indexing (default: one per hardware thread)\n"
+                 "  --memory N      postings buffered before spilling a sorted run (default 16M)\n"
+                 "  --cache DIR     reuse landmarks cached in DIR when indexing, adding those it lacks\n"
+                 "  --count N       matches to list (default 5)\n"
+                 "  --min-votes N   landmarks that must agree on a match (default 10)\n";
+}
+
+std::vector<std::string> readFileList(const std::string& path)
+{
+    std::ifstream stream(path);
+    if (!stream)
+        throw std::runtime_error("cannot open " + path);
+    std::vector<std::string> files;
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty() && line[0] != '#')
+            files.push_back(line);
+    }
+    return files;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    const std::string command = argv[1];
+    std::size_t threads = 0;
+    std::size_t memoryPostings = std::size_t(1) << 24;
+    std::size_t count = 5;
+    std::size_t minimumVotes = 10;
+    std::string cacheDirectory;
+    std::string paths[2];
+    int pathCount = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--memory" && i + 1 < argc) {
+            memoryPostings = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        } else if (arg == "--count" && i + 1 < argc) {
+            count = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--min-votes" && i + 1 < argc) {
+            minimumVotes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (pathCount < 2 && arg.compare(0, 2, "--") != 0) {
+            paths[pathCount++] = arg;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (pathCount != 2 || (command != "index" && command != "query")) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        if (command == "query") {
+            const FingerprintIndex index = FingerprintIndex::open(paths[0]);
+            const std::unique_ptr<AudioReader> clip = openAudioFile(paths[1]);
+            const std::vector<Landmark> landmarks = extractLandmarks(*clip);
+            const std::vector<FingerprintMatch> matches = index.query(landmarks, count, minimumVotes);
+            if (matches.empty()) {
+                std::cout << "no match (" << landmarks.size() << " landmarks)\n";
+                return 1;
+            }
+            std::cout << std::fixed << std::setprecision(0);
+            for (const FingerprintMatch& match : matches)
+                std::cout << match.votes << " votes\t" << match.offsetMilliseconds << " ms\t"
+                          << index.trackName(match.track) << '\n';
+            return 0;
+        }
+
+        const std::vector<std::string> files = readFileList(paths[0]);
+        // Files are fingerprinted in parallel, so each compressed one decodes
+        // on a single extra thread.
+        ParallelDecodeOptions decodeOptions;
+        decodeOptions.threadCount = 1;
+        std::unique_ptr<FeatureCache> cache;
+        if (!cacheDirectory.empty())
+            cache = std::make_unique<FeatureCache>(cacheDirectory, FeatureOptions(), decodeOptions);
+        FingerprintIndexBuilder builder(paths[1], memoryPostings);
+        ThreadPool pool(threads);
+        // Extract a batch in parallel, then add it in list order so track
+        // numbers follow the list without holding every landmark at once.
+        const std::size_t batchSize = 4 * pool.threadCount();
+        std::vector<std::vector<Landmark>> batch(batchSize);
+        std::vector<std::string> errors(batchSize);
+        std::size_t failures = 0;
+        std::size_t landmarkCount = 0;
+        for (std::size_t first = 0; first < files.size(); first += batchSize) {
+            const std::size_t last = std::min(files.size(), first + batchSize);
+            for (std::size_t i = first; i < last; ++i) {
+                pool.submit([&, i] {
+                    try {
+                        if (cache) {
+                            const CachedFeatures cached = cache->open(files[i]);
+                            batch[i - first].assign(cached.landmarks(),
+                                                    cached.landmarks() + cached.landmarkCount());
+                            return;
+                        }
+                        const std::unique_ptr<AudioReader> reader = openAudioFile(files[i], decodeOptions);
+                        batch[i - first] = extractLandmarks(*reader);
+                    } catch (const std::exception& error) {
+                        errors[i - first] = error.what();
+                    }
+                });
+            }
+            pool.wait();
+            for (std::size_t i = first; i < last; ++i) {
+                // Failed files keep their track number with no landmarks.
+                if (!errors[i - first].empty()) {
+                    std::cerr << "audiofingerprint: " << errors[i - first] << "\n";
+                    errors[i - first].clear();
+                    ++failures;
+                }
+                builder.addTrack(files[i], batch[i - first]);
+                landmarkCount += batch[i - first].size();
+                batch[i - first].clear();
+            }
+        }
+        builder.finish();
+        std::cout << files.size() << " tracks, " << landmarkCount << " landmarks\n";
+        return failures > 0 ? 2 : 0;
+    } catch (const std::exception& error) {
+        std::cerr << "audiofingerprint: " << error.what() << "\n";
+        return 2;
+    }
+}
@@ -0,0 +1,75 @@
+//
+//  audioindex.cpp
+//  AudioCompareCore
+//
+//  Lists the worst regions of a difference index written by audiocompare.
+//
+
+#include "DifferenceIndex.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using namespace audiocompare;
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "usage: audioindex [options] differences.index\n"
+                 "  --count N       regions to list (default 10)\n"
+                 "  --level L       0 = 10 ms, 1 = 1 s, 2 = 1 min cells (default 1)\n"
+                 "  --spectral      rank by spectral distance instead of residual power\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t count = 10;
+    std::size_t level = 1;
+    DifferenceMetric metric = DifferenceMetric::Residual;
+    std::string path;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) {
+            count = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--level" && i + 1 < argc) {
+            level = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--spectral") {
+            metric = DifferenceMetric::Spectral;
+        } else if (path.empty() && arg.compare(0, 2, "--") != 0) {
+            path = arg;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (path.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        const DifferenceIndex index = DifferenceIndex::open(path);
+        const double rate = index.sampleRate();
+        std::cout << std::fixed << std::setprecision(3);
+        for (const DifferenceRegion& region : index.worstRegions(count, metric, level)) {
+            std::cout << static_cast<double>(region.startFrame) / rate << " s  ";
+            if (metric == DifferenceMetric::Residual)
+                std::cout << "residual " << 10.0 * std::log10(region.value) << " dBFS";
+            else
+                std::cout << "LSD " << region.value << " dB";
+            std::cout << ", worst 10 ms at " << static_cast<double>(region.peakFrame) / rate << " s\n";
+        }
+        return 0;
+    } catch (const std::exception& error) {
+        std::cerr << "audioindex: " << error.what() << "\n";
+        return 2;
+    }
+}
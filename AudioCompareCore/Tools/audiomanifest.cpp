@@ -0,0 +1,85 @@
+//
+//  audiomanifest.cpp
+//  AudioCompareCore
+//
+//  Writes and diffs per-block hash manifests of renders.
+//
+
+#include "HashManifest.hpp"
+#include "ParallelDecodeReader.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace audiocompare;
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "usage: audiomanifest write [--block N] input.wav output.manifest\n"
+                 "       audiomanifest diff reference.manifest candidate.manifest\n"
+                 "  --block N       frames per hashed block (default 4096)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    const std::string command = argv[1];
+    std::size_t blockFrames = 4096;
+    std::string paths[2];
+    int pathCount = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--block" && i + 1 < argc) {
+            blockFrames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (pathCount < 2 && arg.compare(0, 2, "--") != 0) {
+            paths[pathCount++] = arg;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (pathCount != 2 || (command != "write" && command != "diff")) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        if (command == "write") {
+            const std::unique_ptr<AudioReader> input = openAudioFile(paths[0]);
+            const HashManifest manifest = computeManifest(*input, blockFrames);
+            manifest.write(paths[1]);
+            std::cout << manifest.blockCount() << " blocks of " << manifest.blockFrames << " frames, "
+                      << manifest.channelCount << " ch\n";
+            return 0;
+        }
+
+        const HashManifest reference = HashManifest::read(paths[0]);
+        const HashManifest candidate = HashManifest::read(paths[1]);
+        const ManifestDifference difference = diffManifests(reference, candidate);
+        if (difference.identical()) {
+            std::cout << "identical (" << reference.blockCount() << " blocks)\n";
+            return 0;
+        }
+        const double rate = reference.sampleRate;
+        std::cout << "first divergent block " << difference.firstBlock << " (channel "
+                  << difference.firstChannel << ", frame " << difference.firstFrame << ", "
+                  << (rate > 0.0 ? static_cast<double>(difference.firstFrame) / rate : 0.0) << " s)\n";
+        std::cout << "differing blocks      " << difference.differingBlocks << " of "
+                  << std::max(reference.blockCount(), candidate.blockCount()) << "\n";
+        return 1;
+    } catch (const std::exception& error) {
+        std::cerr << "audiomanifest: " << error.what() << "\n";
+        return 2;
+    }
+}
@@ -0,0 +1,225 @@
+//
+//  audiosimilarity.cpp
+//  AudioCompareCore
+//
+//  Builds and queries all-pairs similarity matrices of audio catalogues.
+//
+
+#include "AudioFeatures.hpp"
+#include "ContentSignature.hpp"
+#include "FeatureCache.hpp"
+#include "ParallelDecodeReader.hpp"
+#include "SimilarityMatrix.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace audiocompare;
+
+namespace {
+
+void printUsage()
+{
+    std::cerr << "usage: audiosimilarity build [options] files.txt output.matrix\n"
+                 "       audiosimilarity pairs [--threshold T] files.txt input.matrix\n"
+                 "       audiosimilarity near [options] files.txt\n"
+                 "  files.txt lists one audio file per line; lines starting with # are skipped.\n"
+                 "  --threads N     worker threads (default: one per hardware thread)\n"
+                 "  --tile N        rows per matrix tile (default: sized for the L1 cache)\n"
+                 "  --bands N       feature bands (default 32)\n"
+                 "  --cache DIR     reuse features cached in DIR, adding those it lacks\n"
+                 "  --threshold T   list pairs with a cosine similarity of at least T (default 0.99)\n"
+                 "  near finds re-encoded, EQ'd or time-stretched versions through LSH buckets\n"
+                 "  instead of scoring every pair, and lists those passing both tests; a test\n"
+                 "  is skipped (shown as -) when a file has no melody or no audible frames:\n"
+                 "  --min-minhash J melody shingle Jaccard estimate of at least J (default 0.125)\n"
+                 "  --min-simhash S timbre SimHash agreement of at least S (default 0.9)\n";
+}
+
+std::vector<std::string> readFileList(const std::string& path)
+{
+    std::ifstream stream(path);
+    if (!stream)
+        throw std::runtime_error("cannot open " + path);
+    std::vector<std::string> files;
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty() && line[0] != '#')
+            files.push_back(line);
+    }
+    return files;
+}
+
+std::string score(double similarity)
+{
+    if (std::isnan(similarity))
+        return "-";
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3) << similarity;
+    return text.str();
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    const std::string command = argv[1];
+    std::size_t threads = 0;
+    std::size_t tileRows = 0;
+    float threshold = 0.99f;
+    NearDuplicateOptions nearOptions;
+    // Files are analysed in parallel, so each compressed one decodes on a
+    // single extra thread.
+    ParallelDecodeOptions decodeOptions;
+    decodeOptions.threadCount = 1;
+    FeatureOptions featureOptions;
+    std::string cacheDirectory;
+    std::string paths[2];
+    int pathCount = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--tile" && i + 1 < argc) {
+            tileRows = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--bands" && i + 1 < argc) {
+            featureOptions.bandCount = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--min-minhash" && i + 1 < argc) {
+            nearOptions.minMinHash = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--min-simhash" && i + 1 < argc) {
+            nearOptions.minSimHash = std::strtod(argv[++i], nullptr);
+        } else if (pathCount < 2 && arg.compare(0, 2, "--") != 0) {
+            paths[pathCount++] = arg;
+        } else {
+            printUsage();
+            return 2;
+        }
+    }
+    const bool near = command == "near";
+    if (pathCount != (near ? 1 : 2) || (command != "build" && command != "pairs" && !near)) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        const std::vector<std::string> files = readFileList(paths[0]);
+        std::unique_ptr<FeatureCache> cache;
+        if (!cacheDirectory.empty())
+            cache = std::make_unique<FeatureCache>(cacheDirectory, featureOptions, decodeOptions);
+
+        if (near) {
+            std::vector<ContentSignature> signatures(files.size());
+            ThreadPool pool(threads);
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                pool.submit([&, i] {
+                    if (cache) {
+                        signatures[i] = computeSignature(cache->open(files[i]).frameFeatures());
+                        return;
+                    }
+                    const std::unique_ptr<AudioReader> reader = openAudioFile(files[i], decodeOptions);
+                    signatures[i] = computeSignature(extractFrameFeatures(*reader));
+                });
+            }
+            pool.wait();
+
+            LshIndex index;
+            for (std::size_t i = 0; i < files.size(); ++i)
+                index.add(static_cast<std::uint32_t>(i), signatures[i]);
+            std::cout << "minhash\tsimhash\tfirst\tsecond\n";
+            for (const auto& pair : index.candidatePairs()) {
+                if (!isNearDuplicate(signatures[pair.first], signatures[pair.second], nearOptions))
+                    continue;
+                const double harmony = minHashSimilarity(signatures[pair.first], signatures[pair.second]);
+                const double timbre = simHashSimilarity(signatures[pair.first], signatures[pair.second]);
+                std::cout << score(harmony) << '\t' << score(timbre) << '\t' << files[pair.first] << '\t'
+                          << files[pair.second] << '\n';
+            }
+            return 0;
+        }
+
+        if (command == "pairs") {
+            const SimilarityMatrix matrix = SimilarityMatrix::open(paths[1]);
+            if (matrix.count() != files.size())
+                throw std::runtime_error(paths[1] + " holds " + std::to_string(matrix.count())
+                                         + " files, " + paths[0] + " lists " + std::to_string(files.size()));
+            std::cout << std::fixed << std::setprecision(6);
+            for (const SimilarPair& pair : matrix.pairsAbove(threshold))
+                std::cout << pair.similarity << '\t' << files[pair.first] << '\t' << files[pair.second] << '\n';
+            return 0;
+        }
+
+        // Each file is decoded exactly once, into a row of the feature table.
+        const std::size_t dimension = featureDimension(featureOptions);
+        std::vector<float> features(files.size() * dimension, 0.0f);
+        std::mutex errorMutex;
+        std::size_t errors = 0;
+        ThreadPool pool(threads);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            pool.submit([&, i] {
+                try {
+                    float* row = features.data() + i * dimension;
+                    if (cache) {
+                        const CachedFeatures cached = cache->open(files[i]);
+                        std::copy(cached.summary(), cached.summary() + dimension, row);
+                        return;
+                    }
+                    const std::unique_ptr<AudioReader> reader = openAudioFile(files[i], decodeOptions);
+                    const std::vector<float> extracted = extractFeatures(*reader, featureOptions);
+                    std::copy(extracted.begin(), extracted.end(), row);
+                } catch (const std::exception& error) {
+                    // The row stays zero so the matrix still lines up with the list.
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    std::cerr << "audiosimilarity: " << error.what() << "\n";
+                    ++errors;
+                }
+            });
+        }
+        pool.wait();
+        const double featureSeconds = secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        const SimilarityMatrix matrix
+            = SimilarityMatrix::compute(features.data(), files.size(), dimension, paths[1], pool, tileRows);
+        const double matrixSeconds = secondsSince(start);
+
+        std::cout << matrix.count() << " files, " << dimension << " features; extracted in " << std::setprecision(3)
+                  << featureSeconds << " s, matrix in " << matrixSeconds << " s on " << pool.threadCount()
+                  << " threads\n";
+        if (cache)
+            std::cout << cache->hits() << " cache hits, " << cache->misses() << " misses\n";
+        return errors > 0 ? 2 : 0;
+    } catch (const std::exception& error) {
+        std::cerr << "audiosimilarity: " << error.what() << "\n";
+        return 2;
+    }
+}